@@ -0,0 +1,60 @@
+// APU synthesis throughput with every band-limited step kernel the CPU
+// supports, with all four channels busy at a high pitch and the noise
+// clocked fastest, in channel samples rendered per second
+//
+// usage: apu-bench [seconds]
+
+#include <cstdlib>
+#include <vector>
+
+#include "apu.h"
+#include "playback-module.h"
+
+#include "bench.h"
+
+static void keep_channels_busy(APU &apu) {
+	apu.write(APU::NR52, 0x80);
+	apu.write(APU::NR50, 0x77);
+	apu.write(APU::NR51, 0xff);
+	apu.write(APU::NR11, 0x80);
+	apu.write(APU::NR12, 0xf0);
+	apu.write(APU::NR13, 0x00);
+	apu.write(APU::NR14, 0x87);
+	apu.write(APU::NR21, 0x40);
+	apu.write(APU::NR22, 0xf0);
+	apu.write(APU::NR23, 0x80);
+	apu.write(APU::NR24, 0x87);
+	for (uint8_t i = 0; i < 0x10; ++i) {
+		apu.write(APU::WAVE_RAM + i, (uint8_t)(i * 0x11 ^ 0x0f));
+	}
+	apu.write(APU::NR30, 0x80);
+	apu.write(APU::NR32, 0x20);
+	apu.write(APU::NR33, 0x00);
+	apu.write(APU::NR34, 0x87);
+	apu.write(APU::NR42, 0xf0);
+	apu.write(APU::NR43, 0x00);
+	apu.write(APU::NR44, 0x80);
+}
+
+int main(int argc, char **argv) {
+	double seconds = argc > 1 ? atof(argv[1]) : 10.0;
+	std::size_t samples = (std::size_t)(SAMPLE_RATE * seconds);
+	std::vector<float> buffer(BUFFER_SIZE * 2);
+
+	printf("%-8s %12s %20s\n", "kernel", "ms", "channel samples/s");
+	const Blip_Buffer::Kernel best = Blip_Buffer::best_kernel();
+	for (Blip_Buffer::Kernel kernel : { Blip_Buffer::Kernel::SCALAR, Blip_Buffer::Kernel::SSE2, Blip_Buffer::Kernel::AVX2 }) {
+		if (kernel > best) { break; }
+		double ms = best_ms(3, [&]() {
+			APU apu(SAMPLE_RATE, BUFFER_SIZE);
+			apu.kernel(kernel);
+			keep_channels_busy(apu);
+			for (std::size_t rendered = 0; rendered < samples; rendered += BUFFER_SIZE) {
+				apu.render(buffer.data(), buffer.data() + 1, std::min(samples - rendered, (std::size_t)BUFFER_SIZE), 2);
+			}
+		});
+		double throughput = APU::NUM_CHANNELS * (double)samples / (ms / 1000.0);
+		printf("%-8s %12.3f %19.1fM\n", Blip_Buffer::kernel_name(kernel), ms, throughput / 1e6);
+	}
+	return 0;
+}
@@ -0,0 +1,78 @@
+// load time of asm files: splitting lines with std::getline and an
+// std::istringstream per line, as the parsers did before Asm_Reader,
+// against Asm_Reader, then a whole song parse on top of it
+//
+// usage: asm-reader-bench [file.asm...]; with no files it times songs
+// it generates in the tmp directory
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "asm-reader.h"
+#include "parse-song.h"
+#include "utils.h"
+
+#include "bench.h"
+
+static size_t read_with_streams(const char *f) {
+	std::ifstream ifs(f);
+	size_t macros = 0;
+	while (ifs.good()) {
+		std::string line;
+		std::getline(ifs, line);
+		size_t comment = line.find(';');
+		if (comment != std::string::npos) { line.erase(comment); }
+		rtrim(line);
+		std::istringstream lss(line);
+		int first = lss.peek();
+		if (first == ' ' || first == '\t') {
+			std::string macro;
+			lss >> std::ws >> macro >> std::ws;
+			macros += !macro.empty();
+		}
+	}
+	return macros;
+}
+
+static size_t read_with_asm_reader(const char *f) {
+	Asm_Reader reader(f);
+	size_t macros = 0;
+	std::string_view line, macro;
+	while (reader.next_line(line)) {
+		if (leading_macro(line, macro)) {
+			macros += !macro.empty();
+		}
+	}
+	return macros;
+}
+
+int main(int argc, char **argv) {
+	std::vector<std::string> files(argv + 1, argv + argc);
+	if (files.empty()) {
+		for (int sections : { 100, 1000, 5000 }) {
+			std::string f = "tmp/bench-song-" + std::to_string(sections) + ".asm";
+			if (!write_bench_song(f.c_str(), sections)) {
+				fprintf(stderr, "cannot write %s\n", f.c_str());
+				return 1;
+			}
+			files.push_back(f);
+		}
+	}
+
+	printf("%-28s %10s %12s %12s %8s %12s\n", "file", "macros", "streams ms", "reader ms", "speedup", "parse ms");
+	for (const std::string &f : files) {
+		size_t stream_macros = 0, reader_macros = 0;
+		double stream_ms = best_ms(5, [&]() { stream_macros = read_with_streams(f.c_str()); });
+		double reader_ms = best_ms(5, [&]() { reader_macros = read_with_asm_reader(f.c_str()); });
+		Parsed_Song::Result result = Parsed_Song::Result::SONG_NULL;
+		double parse_ms = best_ms(5, [&]() { result = Parsed_Song(f.c_str()).result(); });
+		if (stream_macros != reader_macros) {
+			fprintf(stderr, "%s: the readers disagree (%zu and %zu macros)\n", f.c_str(), stream_macros, reader_macros);
+			return 1;
+		}
+		printf("%-28s %10zu %12.3f %12.3f %7.1fx %12.3f%s\n", f.c_str(), reader_macros, stream_ms, reader_ms,
+			stream_ms / reader_ms, parse_ms, result == Parsed_Song::Result::SONG_OK ? "" : " (parse failed)");
+	}
+	return 0;
+}
@@ -0,0 +1,66 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+
+// shared by the benchmark programs, which `make bench` builds and runs
+
+// the fastest of several runs of f, in milliseconds
+template<typename F>
+double best_ms(int runs, F f) {
+	double best = 0.0;
+	for (int i = 0; i < runs; ++i) {
+		auto start = std::chrono::steady_clock::now();
+		f();
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		best = i == 0 ? ms : std::min(best, ms);
+	}
+	return best;
+}
+
+// writes a looping four-channel song to f; each channel has the given
+// number of sections, each a called phrase followed by a short loop
+inline bool write_bench_song(const char *f, int sections, unsigned seed = 1) {
+	FILE *file = fopen(f, "w");
+	if (!file) { return false; }
+	std::mt19937 rng(seed);
+	auto random = [&](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rng); };
+	const char *pitches[] = { "C_", "D#", "E_", "F#", "G_", "A_", "A#", "B_" };
+
+	fprintf(file, "Music_Bench:\n\tchannel_count 4\n");
+	for (int c = 1; c <= 4; ++c) {
+		fprintf(file, "\tchannel %d, Music_Bench_Ch%d\n", c, c);
+	}
+	for (int c = 1; c <= 4; ++c) {
+		fprintf(file, "\nMusic_Bench_Ch%d:\n", c);
+		if (c == 1) { fprintf(file, "\ttempo 160\n\tvolume 7, 7\n"); }
+		if (c == 3) { fprintf(file, "\tnote_type 12, 2, 3\n"); }
+		else if (c == 4) { fprintf(file, "\ttoggle_noise 0\n\tdrum_speed 12\n"); }
+		else { fprintf(file, "\tnote_type 12, 10, 7\n\tduty_cycle 2\n"); }
+		fprintf(file, ".mainLoop:\n");
+		for (int s = 0; s < sections; ++s) {
+			fprintf(file, "\tsound_call .sub%d\n.loop%d:\n", s, s);
+			for (int k = random(1, 4); k > 0; --k) {
+				if (c == 4) { fprintf(file, "\tdrum_note %d, %d\n", random(1, 12), random(1, 16)); }
+				else { fprintf(file, "\toctave %d\n\tnote %s, %d ; melody\n", random(2, 5), pitches[random(0, 7)], random(1, 16)); }
+			}
+			fprintf(file, "\trest %d\n\tsound_loop %d, .loop%d\n", random(1, 16), random(2, 4), s);
+		}
+		fprintf(file, "\tsound_loop 0, .mainLoop\n");
+		for (int s = 0; s < sections; ++s) {
+			fprintf(file, "\n.sub%d:\n", s);
+			for (int k = random(2, 8); k > 0; --k) {
+				if (c == 4) { fprintf(file, "\tdrum_note %d, %d\n", random(1, 12), random(1, 16)); }
+				else { fprintf(file, "\tnote %s, %d\n", pitches[random(0, 7)], random(1, 16)); }
+			}
+			fprintf(file, "\tsound_ret\n");
+		}
+	}
+	return fclose(file) == 0;
+}
+
+#endif
@@ -0,0 +1,38 @@
+// postprocess on a channel of 20,000 commands: the old fixpoint loop,
+// which erased each redundant command where it found it, against the
+// linear passes that replaced it
+//
+// usage: postprocess-bench [commands]
+
+#include <cstdlib>
+
+#include "song.h"
+
+#include "bench.h"
+#include "../test/postprocess-reference.h"
+
+int main(int argc, char **argv) {
+	size_t n = argc > 1 ? (size_t)atol(argv[1]) : 20000;
+	std::mt19937 rng(1);
+	std::vector<Command> channel = random_channel(rng, n, false);
+
+	size_t reference_size = 0, linear_size = 0;
+	double reference_ms = best_ms(3, [&]() {
+		std::vector<Command> commands = channel;
+		reference_postprocess(commands);
+		reference_size = commands.size();
+	});
+	double linear_ms = best_ms(3, [&]() {
+		Command_List commands(RANGE(channel));
+		postprocess(commands);
+		linear_size = commands.size();
+	});
+	if (reference_size != linear_size) {
+		fprintf(stderr, "the results differ (%zu and %zu commands)\n", reference_size, linear_size);
+		return 1;
+	}
+
+	printf("%10s %10s %14s %12s %8s\n", "commands", "after", "reference ms", "linear ms", "speedup");
+	printf("%10zu %10zu %14.3f %12.3f %7.1fx\n", channel.size(), linear_size, reference_ms, linear_ms, reference_ms / linear_ms);
+	return 0;
+}
@@ -0,0 +1,360 @@
+// the bulk note edits, each applied to every note of a channel at once,
+// as when the whole channel is selected in the piano roll; each row is a
+// Song_State::Action, and the setters among them rewrite the selection
+// in one pass. the reference column runs those setters as they were
+// before, one note at a time, and checks that both give the same
+// commands; the other rows still edit in place, so they have no reference
+//
+// move left/right and lengthen need room around each note, which the piano
+// roll checks before it allows them, so every other note is first made a
+// rest. the loop and call actions edit a single loop or call in the middle
+// of the channel
+//
+// usage: rewrite-notes-bench [sections]
+
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+
+#include "song.h"
+
+#include "bench.h"
+#include "../test/rewrite-notes-reference.h"
+
+// no note boxes are selected, since there is no piano roll
+static const std::set<int32_t> no_boxes;
+
+struct Bench_Action {
+	const char *name;
+	int channel;
+	std::function<void(Song &, int, const std::set<int32_t> &, const std::vector<Note_View> &)> apply;
+	// the same edit as it was made one note at a time, for the setters
+	std::function<void(std::vector<Command> &, const std::set<int32_t> &, const std::vector<Note_View> &)> reference = nullptr;
+	// whether a note can take the action
+	std::function<bool(const Command_List &, int32_t, const Note_View &)> allows = [](const Command_List &, int32_t, const Note_View &) { return true; };
+	bool make_room = false;
+};
+
+// a loop or call in the middle of the channel, with what the piano roll
+// would work out from its box
+struct Bench_Site {
+	int32_t index = -1; // the sound_loop or sound_call
+	int32_t start_index = -1; // the command with the loop's or call's label
+	int32_t end_index = -1; // the sound_loop or sound_ret
+	int32_t length = 0; // in ticks
+	Note_View start_view, end_view;
+};
+
+// an edit of a single loop or call, whose arguments are worked out
+// from the channel first, as the piano roll would
+struct Bench_Edit {
+	const char *name;
+	int channel;
+	std::function<std::function<void()>(Song &, int)> setup;
+};
+
+static bool is_note_or_rest(Command_Type type) {
+	return is_note_command(type) || type == Command_Type::REST;
+}
+
+// each note's view as the piano roll would have it, and the notes to edit
+static std::vector<Note_View> select_notes(const Command_List &commands, const Bench_Action &action, std::set<int32_t> &selected_notes) {
+	std::vector<Note_View> view;
+	for (int32_t i = 0; i < (int32_t)commands.size(); ++i) {
+		if (!is_note_command(commands[i].type)) { continue; }
+		Note_View note;
+		if (commands.find_note_view(i, 0, note) && action.allows(commands, i, note)) {
+			view.push_back(note);
+			selected_notes.insert(i);
+		}
+	}
+	return view;
+}
+
+// leaves a rest after each note, by making every other note one
+static void make_room(Song &song, int channel) {
+	const Command_List &commands = song.channel_commands(channel);
+	std::set<int32_t> rests;
+	bool odd = false;
+	for (int32_t i = 0; i < (int32_t)commands.size(); ++i) {
+		if (!is_note_command(commands[i].type)) { continue; }
+		if (odd) { rests.insert(i); }
+		odd = !odd;
+	}
+	song.delete_selection(channel, rests, no_boxes);
+	song.postprocess_channel(channel, no_boxes);
+}
+
+static Bench_Site site_at(const Command_List &commands, int32_t index) {
+	Bench_Site site;
+	site.index = index;
+	site.start_index = itr_index(commands, find_note_with_label(commands, commands[index].target));
+	site.end_index = index;
+	if (commands[index].type == Command_Type::SOUND_CALL) {
+		site.end_index = site.start_index;
+		while (commands[site.end_index].type != Command_Type::SOUND_RET) { ++site.end_index; }
+	}
+	int32_t first = site.start_index, last = site.end_index;
+	while (!is_note_or_rest(commands[first].type)) { ++first; }
+	while (!is_note_or_rest(commands[last].type)) { --last; }
+	site.start_view = get_note_view(commands, first);
+	site.end_view = get_note_view(commands, last);
+	site.length = calc_snippet_length(commands, commands.begin() + site.start_index, commands.begin() + site.end_index, site.start_view);
+	site.start_view.index = commands[index].type == Command_Type::SOUND_CALL ? index : site.start_index;
+	site.end_view.index = site.end_index;
+	return site;
+}
+
+// the middle loop or call of the channel; a loop is left one after it is reduced
+static Bench_Site middle_site(const Command_List &commands, Command_Type type) {
+	std::vector<int32_t> indexes;
+	for (int32_t i = 0; i < (int32_t)commands.size(); ++i) {
+		if (commands[i].type == type && (type != Command_Type::SOUND_LOOP || commands[i].sound_loop.loop_count >= 3)) {
+			indexes.push_back(i);
+		}
+	}
+	return site_at(commands, indexes[indexes.size() / 2]);
+}
+
+static std::function<void()> reduce_loop_edit(Song &s, int c) {
+	Bench_Site site = middle_site(s.channel_commands(c), Command_Type::SOUND_LOOP);
+	return [&s, c, site]() { s.reduce_loop(c, no_boxes, 0, site.index, site.length, site.start_view, site.end_view); };
+}
+
+// extends a loop into the rest that reducing it left
+static std::function<void()> extend_loop_edit(Song &s, int c) {
+	reduce_loop_edit(s, c)();
+	Bench_Site site = middle_site(s.channel_commands(c), Command_Type::SOUND_LOOP);
+	return [&s, c, site]() { s.extend_loop(c, no_boxes, 0, site.index, site.length, site.start_view, site.end_view); };
+}
+
+static std::function<void()> unroll_loop_edit(Song &s, int c) {
+	Bench_Site site = middle_site(s.channel_commands(c), Command_Type::SOUND_LOOP);
+	std::vector<Command> snippet = copy_snippet(s.channel_commands(c), site.start_index, site.end_index);
+	snippet.pop_back();
+	for (Command &command : snippet) {
+		command.labels.clear();
+	}
+	return [&s, c, site, snippet]() { s.unroll_loop(c, no_boxes, 0, site.index, snippet); };
+}
+
+// loops the middle note that has at least as long a rest after it
+static std::function<void()> create_loop_edit(Song &s, int c) {
+	const Command_List &commands = s.channel_commands(c);
+	std::vector<int32_t> indexes;
+	for (int32_t i = 0; i + 1 < (int32_t)commands.size(); ++i) {
+		if (
+			is_note_command(commands[i].type) && commands[i].labels.size() == 0 &&
+			commands[i + 1].type == Command_Type::REST && commands[i + 1].labels.size() == 0 &&
+			commands[i + 1].rest.length >= commands[i].note.length
+		) {
+			indexes.push_back(i);
+		}
+	}
+	int32_t index = indexes[indexes.size() / 2];
+	Note_View view = get_note_view(commands, index);
+	return [&s, c, index, view]() { s.create_loop(c, no_boxes, 0, index, index, view.length * view.speed, view, view, false); };
+}
+
+// a call that sets no speed of its own only plays ambiguous ticks
+static std::function<void()> delete_call_edit(Song &s, int c) {
+	const Command_List &commands = s.channel_commands(c);
+	Bench_Site site = middle_site(commands, Command_Type::SOUND_CALL);
+	int32_t ticks = 0;
+	for (int32_t i = site.start_index; i < site.end_index; ++i) {
+		if (commands[i].type == Command_Type::NOTE) { ticks += commands[i].note.length; }
+		else if (commands[i].type == Command_Type::DRUM_NOTE) { ticks += commands[i].drum_note.length; }
+		else if (commands[i].type == Command_Type::REST) { ticks += commands[i].rest.length; }
+	}
+	return [&s, c, site, ticks]() { s.delete_call(c, no_boxes, 0, site.index, ticks, 0, site.start_view, site.end_view, site.start_index, site.end_index); };
+}
+
+static std::function<void()> unpack_call_edit(Song &s, int c) {
+	Bench_Site site = middle_site(s.channel_commands(c), Command_Type::SOUND_CALL);
+	std::vector<Command> snippet = copy_snippet(s.channel_commands(c), site.start_index, site.end_index, true);
+	snippet.pop_back();
+	for (Command &command : snippet) {
+		command.labels.clear();
+	}
+	return [&s, c, site, snippet]() { s.unpack_call(c, no_boxes, 0, site.index, snippet, site.start_index, site.end_index); };
+}
+
+// calls the body of the middle loop, after its label
+static std::function<void()> create_call_edit(Song &s, int c) {
+	const Command_List &commands = s.channel_commands(c);
+	Bench_Site site = middle_site(commands, Command_Type::SOUND_LOOP);
+	int32_t start_index = site.start_index + 1, end_index = site.index - 1;
+	std::vector<Command> snippet = copy_snippet(commands, start_index, end_index);
+	snippet.push_back(Command(Command_Type::SOUND_RET));
+	std::string scope = get_scope(commands, (int32_t)commands.size() - 1);
+	int call_number = 1;
+	snippet[0].labels.insert(snippet[0].labels.begin(), get_next_call_label(commands, scope, call_number));
+	return [&s, c, start_index, end_index, snippet]() { s.create_call(c, no_boxes, 0, start_index, end_index, snippet, {}); };
+}
+
+// calls the shortest phrase from the first rest before the phrases that has room for it
+static std::function<void()> insert_call_edit(Song &s, int c) {
+	const Command_List &commands = s.channel_commands(c);
+	Bench_Site call;
+	int32_t body_end = (int32_t)commands.size();
+	for (int32_t i = 0; i < (int32_t)commands.size(); ++i) {
+		if (commands[i].type == Command_Type::SOUND_LOOP && commands[i].sound_loop.loop_count == 0) {
+			body_end = std::min(body_end, i);
+		}
+		if (commands[i].type != Command_Type::SOUND_CALL) { continue; }
+		Bench_Site other = site_at(commands, i);
+		if (call.index == -1 || other.length < call.length) { call = other; }
+	}
+	for (int32_t i = 0; i < body_end; ++i) {
+		if (commands[i].type != Command_Type::REST || commands[i].labels.size() > 0) { continue; }
+		Note_View rest_view = get_note_view(commands, i);
+		if (rest_view.length * rest_view.speed >= call.length) {
+			Label target = commands[call.index].target;
+			return [&s, c, i, target, call, rest_view]() { s.insert_call(c, no_boxes, 0, 0, i, target, call.length, rest_view, call.start_view, call.end_view); };
+		}
+	}
+	return []() {};
+}
+
+static bool same_commands(const Command_List &commands, const std::vector<Command> &expected) {
+	if (commands.size() != expected.size()) { return false; }
+	for (size_t i = 0; i < expected.size(); ++i) {
+		if (memcmp(&commands[i], &expected[i], sizeof(Command))) { return false; }
+	}
+	return true;
+}
+
+int main(int argc, char **argv) {
+	int sections = argc > 1 ? atoi(argv[1]) : 1000;
+	std::string f = "tmp/bench-song-" + std::to_string(sections) + ".asm";
+	if (!write_bench_song(f.c_str(), sections)) {
+		fprintf(stderr, "cannot write %s\n", f.c_str());
+		return 1;
+	}
+
+	const Bench_Action actions[] = {
+		{ "SET_SPEED", 1, [](Song &s, int c, auto &n, auto &v) { s.set_speed(c, n, no_boxes, v, 6); } },
+		{ "SET_VOLUME", 1, [](Song &s, int c, auto &n, auto &v) { s.set_volume(c, n, no_boxes, v, 5); },
+			[](auto &r, auto &n, auto &v) { reference_set_volume(r, n, v, 5); } },
+		{ "SET_FADE", 1, [](Song &s, int c, auto &n, auto &v) { s.set_fade(c, n, no_boxes, v, 3); },
+			[](auto &r, auto &n, auto &v) { reference_set_fade(r, n, v, 3); } },
+		{ "SET_VIBRATO_DELAY", 1, [](Song &s, int c, auto &n, auto &v) { s.set_vibrato_delay(c, n, no_boxes, v, 4); },
+			[](auto &r, auto &n, auto &v) { reference_set_vibrato_delay(r, n, v, 4); } },
+		{ "SET_VIBRATO_EXTENT", 1, [](Song &s, int c, auto &n, auto &v) { s.set_vibrato_extent(c, n, no_boxes, v, 2); },
+			[](auto &r, auto &n, auto &v) { reference_set_vibrato_extent(r, n, v, 2); } },
+		{ "SET_VIBRATO_RATE", 1, [](Song &s, int c, auto &n, auto &v) { s.set_vibrato_rate(c, n, no_boxes, v, 3); },
+			[](auto &r, auto &n, auto &v) { reference_set_vibrato_rate(r, n, v, 3); } },
+		{ "SET_WAVE", 3, [](Song &s, int c, auto &n, auto &v) { s.set_wave(c, n, no_boxes, v, 1); },
+			[](auto &r, auto &n, auto &v) { reference_set_wave(r, n, v, 1); } },
+		{ "SET_DRUMKIT", 4, [](Song &s, int c, auto &n, auto &) { s.set_drumkit(c, n, no_boxes, 1); },
+			[](auto &r, auto &n, auto &) { reference_set_drumkit(r, n, 1); } },
+		{ "SET_DUTY", 1, [](Song &s, int c, auto &n, auto &) { s.set_duty(c, n, no_boxes, 3); },
+			[](auto &r, auto &n, auto &) { reference_set_duty(r, n, 3); } },
+		{ "SET_TEMPO", 1, [](Song &s, int c, auto &n, auto &) { s.set_tempo(c, n, no_boxes, 144); },
+			[](auto &r, auto &n, auto &) { reference_set_tempo(r, n, 144); } },
+		{ "SET_TRANSPOSE_OCTAVES", 1, [](Song &s, int c, auto &n, auto &v) { s.set_transpose_octaves(c, n, no_boxes, v, 1); },
+			[](auto &r, auto &n, auto &v) { reference_set_transpose_octaves(r, n, v, 1); } },
+		{ "SET_TRANSPOSE_PITCHES", 1, [](Song &s, int c, auto &n, auto &v) { s.set_transpose_pitches(c, n, no_boxes, v, 2); },
+			[](auto &r, auto &n, auto &v) { reference_set_transpose_pitches(r, n, v, 2); } },
+		{ "SET_SLIDE_DURATION", 1, [](Song &s, int c, auto &n, auto &v) { s.set_slide_duration(c, n, no_boxes, v, 2); },
+			[](auto &r, auto &n, auto &v) { reference_set_slide_duration(r, n, v, 2); } },
+		{ "SET_SLIDE_OCTAVE", 1, [](Song &s, int c, auto &n, auto &v) { s.set_slide_octave(c, n, no_boxes, v, 4); },
+			[](auto &r, auto &n, auto &v) { reference_set_slide_octave(r, n, v, 4); } },
+		{ "SET_SLIDE_PITCH", 1, [](Song &s, int c, auto &n, auto &v) { s.set_slide_pitch(c, n, no_boxes, v, Pitch::G_NAT); },
+			[](auto &r, auto &n, auto &v) { reference_set_slide_pitch(r, n, v, Pitch::G_NAT); } },
+		{ "SET_SLIDE", 1, [](Song &s, int c, auto &n, auto &) { s.set_slide(c, n, no_boxes, 2, 4, Pitch::G_NAT); },
+			[](auto &r, auto &n, auto &) { reference_set_slide(r, n, 2, 4, Pitch::G_NAT); } },
+		{ "SET_STEREO_PANNING", 1, [](Song &s, int c, auto &n, auto &) { s.set_stereo_panning(c, n, no_boxes, true, false); },
+			[](auto &r, auto &n, auto &) { reference_set_stereo_panning(r, n, true, false); } },
+		{ "PITCH_UP", 1, [](Song &s, int c, auto &n, auto &v) { s.pitch_up(c, n, no_boxes, v); },
+			[](auto &r, auto &n, auto &v) { reference_pitch_up(r, n, v); } },
+		{ "PITCH_DOWN", 1, [](Song &s, int c, auto &n, auto &v) { s.pitch_down(c, n, no_boxes, v); },
+			[](auto &r, auto &n, auto &v) { reference_pitch_down(r, n, v); } },
+		{ "OCTAVE_UP", 1, [](Song &s, int c, auto &n, auto &v) { s.octave_up(c, n, no_boxes, v); },
+			[](auto &r, auto &n, auto &v) { reference_octave_up(r, n, v); } },
+		{ "OCTAVE_DOWN", 1, [](Song &s, int c, auto &n, auto &v) { s.octave_down(c, n, no_boxes, v); },
+			[](auto &r, auto &n, auto &v) { reference_octave_down(r, n, v); } },
+		{ "SHORTEN", 1, [](Song &s, int c, auto &n, auto &) { s.shorten(c, n, no_boxes, -1); },
+			[](auto &r, auto &n, auto &) { reference_shorten(r, n); },
+			[](const Command_List &, int32_t, const Note_View &note) { return note.length > 1; } },
+		{ "MOVE_LEFT", 1, [](Song &s, int c, auto &n, auto &v) { s.move_left(c, n, no_boxes, v); }, nullptr,
+			[](const Command_List &commands, int32_t i, const Note_View &) {
+				return i > 0 && commands[i].labels.size() == 0 && commands[i - 1].type == Command_Type::REST;
+			}, true },
+		{ "MOVE_RIGHT", 1, [](Song &s, int c, auto &n, auto &v) { s.move_right(c, n, no_boxes, v); }, nullptr,
+			[](const Command_List &commands, int32_t i, const Note_View &) {
+				return i + 1 < (int32_t)commands.size() && commands[i + 1].type == Command_Type::REST && commands[i + 1].labels.size() == 0;
+			}, true },
+		{ "LENGTHEN", 1, [](Song &s, int c, auto &n, auto &v) { s.lengthen(c, n, no_boxes, v, -1); }, nullptr,
+			[](const Command_List &commands, int32_t i, const Note_View &note) {
+				return note.length < 16 && is_followed_by_n_ticks_of_rest(commands.begin() + i, commands.end(), note.speed, note.speed);
+			}, true },
+		{ "DELETE_SELECTION", 1, [](Song &s, int c, auto &n, auto &) { s.delete_selection(c, n, no_boxes); } },
+		{ "SNIP_SELECTION", 1, [](Song &s, int c, auto &n, auto &) { s.snip_selection(c, n, no_boxes); } },
+	};
+
+	const Bench_Edit edits[] = {
+		{ "REDUCE_LOOP", 1, reduce_loop_edit },
+		{ "EXTEND_LOOP", 1, extend_loop_edit },
+		{ "UNROLL_LOOP", 1, unroll_loop_edit },
+		{ "CREATE_LOOP", 1, create_loop_edit },
+		{ "DELETE_CALL", 1, delete_call_edit },
+		{ "UNPACK_CALL", 1, unpack_call_edit },
+		{ "CREATE_CALL", 1, create_call_edit },
+		{ "INSERT_CALL", 1, insert_call_edit },
+	};
+
+	printf("%-24s %8s %10s %14s %10s\n", "action", "notes", "commands", "reference ms", "ms");
+	for (const Bench_Action &action : actions) {
+		double best = 0.0, reference_best = 0.0;
+		size_t notes = 0, commands = 0;
+		for (int run = 0; run < 3; ++run) {
+			Song song;
+			if (song.read_song(f.c_str()) != Parsed_Song::Result::SONG_OK) {
+				fprintf(stderr, "cannot read %s\n", f.c_str());
+				return 1;
+			}
+			if (action.make_room) {
+				make_room(song, action.channel);
+			}
+			std::set<int32_t> selected_notes;
+			std::vector<Note_View> view = select_notes(song.channel_commands(action.channel), action, selected_notes);
+			std::vector<Command> reference(RANGE(song.channel_commands(action.channel)));
+			double ms = best_ms(1, [&]() { action.apply(song, action.channel, selected_notes, view); });
+			best = run == 0 ? ms : std::min(best, ms);
+			notes = selected_notes.size();
+			commands = song.channel_commands(action.channel).size();
+			if (action.reference) {
+				double reference_ms = best_ms(1, [&]() { action.reference(reference, selected_notes, view); });
+				reference_best = run == 0 ? reference_ms : std::min(reference_best, reference_ms);
+				if (!same_commands(song.channel_commands(action.channel), reference)) {
+					fprintf(stderr, "%s: the results differ (%zu and %zu commands)\n", action.name, commands, reference.size());
+					return 1;
+				}
+			}
+		}
+		if (action.reference) {
+			printf("%-24s %8zu %10zu %14.3f %10.3f\n", action.name, notes, commands, reference_best, best);
+		}
+		else {
+			printf("%-24s %8zu %10zu %14s %10.3f\n", action.name, notes, commands, "-", best);
+		}
+	}
+	for (const Bench_Edit &edit : edits) {
+		double best = 0.0;
+		size_t commands = 0;
+		for (int run = 0; run < 3; ++run) {
+			Song song;
+			if (song.read_song(f.c_str()) != Parsed_Song::Result::SONG_OK) {
+				fprintf(stderr, "cannot read %s\n", f.c_str());
+				return 1;
+			}
+			std::function<void()> apply = edit.setup(song, edit.channel);
+			double ms = best_ms(1, apply);
+			best = run == 0 ? ms : std::min(best, ms);
+			commands = song.channel_commands(edit.channel).size();
+		}
+		printf("%-24s %8s %10zu %14s %10.3f\n", edit.name, "-", commands, "-", best);
+	}
+	return 0;
+}
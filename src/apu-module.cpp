@@ -0,0 +1,392 @@
+#include <algorithm>
+
+#include "apu-module.h"
+
+#include "utils.h"
+
+// the engine runs once per frame, at 59.73 frames per second
+static constexpr int64_t CYCLES_PER_FRAME = 70224;
+static constexpr double FRAMES_PER_SECOND = (double)APU::CLOCK_RATE / CYCLES_PER_FRAME;
+
+// the frequencies of the pitches in the lowest octave; the engine shifts
+// them right once for each octave up, keeping their sign
+static constexpr int16_t FREQUENCIES[NUM_PITCHES] = {
+	-0x07d4, -0x0763, -0x06f9, -0x0695, -0x0636, -0x05dd,
+	-0x0589, -0x0539, -0x04ee, -0x04a8, -0x0465, -0x0426,
+};
+
+static int32_t note_frequency(int32_t octave, Pitch pitch, int32_t transpose_octaves, int32_t transpose_pitches) {
+	int32_t index = (int32_t)pitch - 1 + transpose_pitches;
+	int32_t shift = std::max(octave - 1 - transpose_octaves, 0) + index / (int32_t)NUM_PITCHES;
+	return (FREQUENCIES[index % NUM_PITCHES] >> std::min(shift, 15)) & 0x7ff;
+}
+
+static uint8_t volume_envelope(int32_t volume, int32_t fade) {
+	return (uint8_t)((volume << 4) | (fade < 0 ? 0x08 | -fade : fade));
+}
+
+// clearing this register turns a channel's DAC off, which silences it
+static uint8_t dac_register(int32_t channel) {
+	return channel == 2 ? (uint8_t)APU::NR30 : (uint8_t)(APU::NR12 + 5 * channel);
+}
+
+APU_Module::APU_Module(
+	const std::vector<Note_View> &channel_1_notes,
+	const std::vector<Note_View> &channel_2_notes,
+	const std::vector<Note_View> &channel_3_notes,
+	const std::vector<Note_View> &channel_4_notes,
+	const std::vector<Wave> &waves,
+	const std::vector<Drumkit> &drumkits,
+	const std::vector<Drum> &drums,
+	int32_t loop_tick,
+	bool stereo,
+	bool open
+) : _notes{ channel_1_notes, channel_2_notes, channel_3_notes, channel_4_notes }, _waves(waves), _drumkits(drumkits), _drums(drums),
+	_loop_tick(loop_tick), _stereo(stereo), _num_inline_waves((int32_t)waves.size() - 0x10), _apu(SAMPLE_RATE, BUFFER_SIZE) {
+	for (int32_t c = 0; c < APU::NUM_CHANNELS; ++c) {
+		int32_t tick = 0;
+		_note_ticks[c].reserve(_notes[c].size());
+		for (const Note_View &note : _notes[c]) {
+			_note_ticks[c].push_back(tick);
+			tick += note.length * note.speed;
+		}
+		_loop_notes[c] = NO_LOOP;
+		if (loop_tick != -1) {
+			auto tick_itr = std::upper_bound(RANGE(_note_ticks[c]), loop_tick);
+			if (tick_itr != _note_ticks[c].begin()) {
+				_loop_notes[c] = tick_itr - _note_ticks[c].begin() - 1;
+			}
+		}
+	}
+	find_tempo_changes();
+	_duration_seconds = find_duration_seconds();
+	reset();
+
+	if (open) {
+		open_stream();
+	}
+}
+
+APU_Module::~APU_Module() noexcept {
+	delete _next_song.exchange(nullptr);
+}
+
+void APU_Module::find_tempo_changes() {
+	int32_t first_channel = 0;
+	while (first_channel < APU::NUM_CHANNELS - 1 && _notes[first_channel].empty()) {
+		first_channel += 1;
+	}
+
+	const auto mid_note = [this](int32_t channel, int32_t tick) {
+		const std::vector<int32_t> &ticks = _note_ticks[channel];
+		auto tick_itr = std::upper_bound(RANGE(ticks), tick);
+		if (tick_itr == ticks.begin()) { return false; }
+		const Note_View &note = _notes[channel][tick_itr - ticks.begin() - 1];
+		return *(tick_itr - 1) < tick && tick < *(tick_itr - 1) + note.length * note.speed;
+	};
+
+	for (int32_t c = 0; c < APU::NUM_CHANNELS; ++c) {
+		int32_t tempo = 0;
+		for (std::size_t i = 0; i < _notes[c].size(); ++i) {
+			if (_notes[c][i].tempo == tempo) { continue; }
+			tempo = _notes[c][i].tempo;
+			if (c != first_channel && _tempo_change_wrong_channel == -1) {
+				_tempo_change_wrong_channel = c + 1;
+			}
+			for (int32_t o = 0; o < APU::NUM_CHANNELS && _tempo_change_mid_note == -1; ++o) {
+				if (o != c && mid_note(o, _note_ticks[c][i])) {
+					_tempo_change_mid_note = o + 1;
+				}
+			}
+		}
+	}
+}
+
+void APU_Module::reset() {
+	_engine = Engine();
+	_apu.reset();
+	_apu.write(APU::NR52, 0x80);
+	_apu.write(APU::NR50, 0x77);
+	_apu.write(APU::NR51, _engine.panning);
+	_frame_timer = 0;
+}
+
+void APU_Module::prepare_hot_swap(
+	const std::vector<Note_View> &channel_1_notes,
+	const std::vector<Note_View> &channel_2_notes,
+	const std::vector<Note_View> &channel_3_notes,
+	const std::vector<Note_View> &channel_4_notes,
+	const std::vector<Wave> &waves,
+	const std::vector<Drumkit> &drumkits,
+	const std::vector<Drum> &drums,
+	int32_t loop_tick,
+	bool stereo
+) {
+	APU_Module *song = new APU_Module(channel_1_notes, channel_2_notes, channel_3_notes, channel_4_notes, waves, drumkits, drums, loop_tick, stereo, false);
+	// replaces any song that has not been swapped in yet
+	delete _next_song.exchange(song);
+}
+
+void APU_Module::hot_swap() {
+	APU_Module *song = _next_song.exchange(nullptr);
+	if (!song) { return; }
+
+	const int32_t tick = current_tick();
+	std::swap(_notes, song->_notes);
+	std::swap(_note_ticks, song->_note_ticks);
+	std::swap(_loop_notes, song->_loop_notes);
+	std::swap(_waves, song->_waves);
+	std::swap(_drumkits, song->_drumkits);
+	std::swap(_drums, song->_drums);
+	std::swap(_loop_tick, song->_loop_tick);
+	std::swap(_stereo, song->_stereo);
+	std::swap(_num_inline_waves, song->_num_inline_waves);
+	std::swap(_tempo_change_wrong_channel, song->_tempo_change_wrong_channel);
+	std::swap(_tempo_change_mid_note, song->_tempo_change_mid_note);
+	_duration_seconds = song->_duration_seconds.load();
+
+	// run the new song silently up to the same tick, leaving the APU as
+	// it is; the panning it was last given is still what it plays with
+	Engine engine;
+	while (engine_tick(engine) < tick && step_frame(engine, nullptr)) {}
+	engine.panning = _engine.panning;
+	_engine = engine;
+
+	delete song;
+}
+
+bool APU_Module::start_note(Engine &engine, int32_t channel, APU *apu) const {
+	Channel_State &state = engine.channels[channel];
+	const std::vector<Note_View> &notes = _notes[channel];
+	if (state.next == notes.size()) {
+		if (_loop_notes[channel] == NO_LOOP) { return false; }
+		state.next = _loop_notes[channel];
+		state.looped = true;
+	}
+	const Note_View &note = notes[state.next];
+	state.note = note;
+	state.tick = _note_ticks[channel][state.next];
+	state.next += 1;
+	state.started = true;
+
+	// a tempo command sets every channel's tempo and clears their remainders
+	if (note.tempo != state.tempo) {
+		state.tempo = note.tempo;
+		if (note.tempo) {
+			engine.tempo = note.tempo;
+			for (Channel_State &other : engine.channels) {
+				other.fraction = 0;
+			}
+		}
+	}
+	int32_t units = note.length * note.speed * engine.tempo + state.fraction;
+	state.fraction = units & 0xff;
+	state.duration = units >> 8;
+	state.elapsed = 0;
+
+	uint8_t panning = engine.panning & ~(0x11 << channel);
+	if (!_stereo || note.panning_left) { panning |= 0x10 << channel; }
+	if (!_stereo || note.panning_right) { panning |= 0x01 << channel; }
+	if (panning != engine.panning) {
+		engine.panning = panning;
+		if (apu) { apu->write(APU::NR51, panning); }
+	}
+
+	if (channel == 3) {
+		if (
+			note.pitch != Pitch::REST &&
+			note.drumkit >= 0 &&
+			note.drumkit < (int32_t)_drumkits.size() &&
+			_drumkits[note.drumkit].drums[(int32_t)note.pitch] >= 0 &&
+			_drumkits[note.drumkit].drums[(int32_t)note.pitch] < (int32_t)_drums.size()
+		) {
+			state.drum = &_drums[_drumkits[note.drumkit].drums[(int32_t)note.pitch]];
+			state.noise_note = 0;
+			state.noise_delay = 0;
+		}
+		return true;
+	}
+
+	if (channel == 2 && (note.wave != 0x0f || !_num_inline_waves)) {
+		engine.wave = note.wave;
+	}
+	if (note.pitch == Pitch::REST || (channel == 2 && (engine.wave < 0 || engine.wave >= (int32_t)_waves.size()))) {
+		state.frequency = -1;
+		if (apu) { apu->write(dac_register(channel), 0); }
+		return true;
+	}
+
+	state.frequency = note_frequency(note.octave, note.pitch, note.transpose_octaves, note.transpose_pitches);
+	state.written_frequency = state.frequency;
+	state.vibrato_delay = note.vibrato_delay;
+	state.vibrato_timer = 0;
+	state.vibrato_up = false;
+	state.slide_frames = 0;
+	if (note.slide_pitch != Pitch::REST) {
+		state.slide_target = note_frequency(note.slide_octave, note.slide_pitch, note.transpose_octaves, note.transpose_pitches);
+		state.slide_frames = std::max(state.duration - note.slide_duration, 1);
+	}
+
+	if (!apu) { return true; }
+	if (channel == 2) {
+		const Wave &wave = _waves[engine.wave];
+		apu->write(APU::NR30, 0);
+		for (std::size_t i = 0; i < NUM_WAVE_SAMPLES / 2; ++i) {
+			apu->write((uint8_t)(APU::WAVE_RAM + i), (uint8_t)((wave[i * 2] << 4) | (wave[i * 2 + 1] & 0x0f)));
+		}
+		apu->write(APU::NR30, 0x80);
+		apu->write(APU::NR32, (uint8_t)((note.volume & 0b11) << 5));
+	}
+	else {
+		if (channel == 0) { apu->write(APU::NR10, 0); }
+		apu->write((uint8_t)(APU::NR11 + 5 * channel), (uint8_t)((note.duty & 0b11) << 6));
+		apu->write((uint8_t)(APU::NR12 + 5 * channel), volume_envelope(note.volume, note.fade));
+	}
+	apu->write((uint8_t)(APU::NR13 + 5 * channel), state.frequency & 0xff);
+	apu->write((uint8_t)(APU::NR14 + 5 * channel), 0x80 | (state.frequency >> 8));
+	return true;
+}
+
+void APU_Module::update_frequency(Channel_State &state, int32_t channel, APU *apu) const {
+	if (state.frequency == -1) { return; }
+	int32_t frequency = state.frequency;
+	if (state.slide_frames) {
+		int32_t elapsed = std::min(state.elapsed, state.slide_frames);
+		frequency += (state.slide_target - state.frequency) * elapsed / state.slide_frames;
+	}
+	else if (state.vibrato_delay > 0) {
+		state.vibrato_delay -= 1;
+	}
+	else if (state.note.vibrato_extent) {
+		if (state.vibrato_timer > 0) {
+			state.vibrato_timer -= 1;
+		}
+		else {
+			state.vibrato_timer = state.note.vibrato_rate;
+			state.vibrato_up = !state.vibrato_up;
+		}
+		// only the low byte moves, and it stops at its limits
+		int32_t down = state.note.vibrato_extent / 2;
+		int32_t up = state.note.vibrato_extent - down;
+		int32_t low = frequency & 0xff;
+		low = state.vibrato_up ? std::min(low + up, 0xff) : std::max(low - down, 0);
+		frequency = (frequency & 0x700) | low;
+	}
+	if (frequency != state.written_frequency) {
+		state.written_frequency = frequency;
+		if (apu) {
+			apu->write((uint8_t)(APU::NR13 + 5 * channel), frequency & 0xff);
+			apu->write((uint8_t)(APU::NR14 + 5 * channel), frequency >> 8);
+		}
+	}
+}
+
+void APU_Module::read_noise_note(Channel_State &state, APU *apu) const {
+	if (state.noise_note == state.drum->noise_notes.size()) {
+		state.drum = nullptr;
+		return;
+	}
+	const Noise_Note &note = state.drum->noise_notes[state.noise_note++];
+	state.noise_delay = (note.length & 0x0f) + 1;
+	if (apu) {
+		apu->write(APU::NR42, (uint8_t)((note.volume << 4) | (note.envelope_direction ? 0x08 : 0) | (note.sweep_pace & 0b111)));
+		apu->write(APU::NR43, (uint8_t)((note.clock_shift << 4) | (note.lfsr_width ? 0x08 : 0) | (note.clock_divider & 0b111)));
+		apu->write(APU::NR44, 0x80);
+	}
+}
+
+bool APU_Module::step_frame(Engine &engine, APU *apu) const {
+	bool playing = false;
+	for (int32_t c = 0; c < APU::NUM_CHANNELS; ++c) {
+		Channel_State &state = engine.channels[c];
+		if (state.ended) { continue; }
+		if (state.started && state.duration >= 2) {
+			state.duration -= 1;
+			state.elapsed += 1;
+			if (c != 3) {
+				update_frequency(state, c, apu);
+			}
+		}
+		else if (!start_note(engine, c, apu)) {
+			state.ended = true;
+			if (apu) { apu->write(dac_register(c), 0); }
+			continue;
+		}
+		if (c == 3 && state.drum && --state.noise_delay <= 0) {
+			read_noise_note(state, apu);
+		}
+		playing = true;
+	}
+	if (playing) {
+		engine.frames += 1;
+	}
+	return playing;
+}
+
+std::size_t APU_Module::render(float *left, float *right, std::size_t count, std::size_t stride) {
+	const int64_t frame_units = CYCLES_PER_FRAME * SAMPLE_RATE;
+	std::size_t rendered = 0;
+	while (rendered < count) {
+		if (_frame_timer <= 0) {
+			hot_swap();
+			if (!step_frame(_engine, &_apu)) { break; }
+			_frame_timer += frame_units;
+		}
+		std::size_t n = std::min(count - rendered, (std::size_t)((_frame_timer + APU::CLOCK_RATE - 1) / APU::CLOCK_RATE));
+		_apu.render(left + rendered * stride, right + rendered * stride, n, stride);
+		_frame_timer -= (int64_t)n * APU::CLOCK_RATE;
+		rendered += n;
+	}
+	return rendered;
+}
+
+std::size_t APU_Module::render_block(float *frames, std::size_t count) {
+	return render(frames, frames + 1, count, 2);
+}
+
+void APU_Module::mute_channel(int32_t channel, bool mute) {
+	if (channel >= 1 && channel <= APU::NUM_CHANNELS) {
+		_apu.mute_channel(channel, mute);
+	}
+}
+
+int32_t APU_Module::current_tick() const {
+	return engine_tick(_engine);
+}
+
+int32_t APU_Module::engine_tick(const Engine &engine) const {
+	int32_t tick = 0;
+	for (const Channel_State &state : engine.channels) {
+		if (!state.started) { continue; }
+		int32_t length = state.note.length * state.note.speed;
+		int32_t offset = state.ended ? length : std::min((int32_t)((int64_t)state.elapsed * 0x100 / std::max(engine.tempo, 1)), length - 1);
+		tick = std::max(tick, state.tick + offset);
+	}
+	return tick;
+}
+
+void APU_Module::set_tick(int32_t tick) {
+	reset();
+	while (current_tick() < tick && step_frame(_engine, &_apu)) {
+		_apu.skip(CYCLES_PER_FRAME);
+		_frame_timer = CYCLES_PER_FRAME * SAMPLE_RATE;
+	}
+}
+
+double APU_Module::get_position_seconds() {
+	return _engine.frames / FRAMES_PER_SECOND;
+}
+
+double APU_Module::get_duration_seconds() {
+	return _duration_seconds;
+}
+
+double APU_Module::find_duration_seconds() const {
+	// play without sound until every channel has ended or looped
+	Engine engine;
+	const auto finished = [&engine]() {
+		return std::all_of(RANGE(engine.channels), [](const Channel_State &state) { return state.ended || state.looped; });
+	};
+	while (!finished() && step_frame(engine, nullptr)) {}
+	return engine.frames / FRAMES_PER_SECOND;
+}
@@ -0,0 +1,143 @@
+#ifndef APU_MODULE_H
+#define APU_MODULE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <vector>
+
+#include "apu.h"
+#include "command.h"
+#include "parse-waves.h"
+#include "parse-drumkits.h"
+#include "playback-module.h"
+
+// plays a song on an emulated APU the way the game's sound engine does:
+// once per frame, each channel counts down its note's duration before it
+// starts the next one, and updates its vibrato, pitch slide and drum, so
+// tempo, envelopes and noise need no conversion to a tracker's units
+class APU_Module : public Playback_Module {
+private:
+	struct Channel_State {
+		// the next note to start, and the one playing
+		std::size_t next = 0;
+		Note_View note;
+		int32_t tick = 0;
+		bool started = false;
+		bool looped = false;
+		bool ended = false;
+
+		// frames left in the note, counted down the way the engine does,
+		// and the remainder of the tempo carried between notes
+		int32_t duration = 0;
+		int32_t elapsed = 0;
+		int32_t fraction = 0;
+		int32_t tempo = 0;
+
+		int32_t frequency = 0;
+		int32_t written_frequency = 0;
+		int32_t vibrato_delay = 0;
+		int32_t vibrato_timer = 0;
+		bool vibrato_up = false;
+		int32_t slide_target = 0;
+		int32_t slide_frames = 0;
+
+		const Drum *drum = nullptr;
+		std::size_t noise_note = 0;
+		int32_t noise_delay = 0;
+	};
+	struct Engine {
+		std::array<Channel_State, APU::NUM_CHANNELS> channels;
+		int32_t tempo = 0x100;
+		int32_t wave = 0;
+		uint8_t panning = 0xff;
+		int64_t frames = 0;
+	};
+
+	std::array<std::vector<Note_View>, APU::NUM_CHANNELS> _notes;
+	// the tick each note starts on, and the note each channel loops to
+	std::array<std::vector<int32_t>, APU::NUM_CHANNELS> _note_ticks;
+	static constexpr std::size_t NO_LOOP = SIZE_MAX;
+	std::array<std::size_t, APU::NUM_CHANNELS> _loop_notes;
+	std::vector<Wave> _waves;
+	std::vector<Drumkit> _drumkits;
+	std::vector<Drum> _drums;
+	int32_t _loop_tick = -1;
+	bool _stereo = true;
+	int32_t _num_inline_waves = 0;
+
+	int32_t _tempo_change_wrong_channel = -1;
+	int32_t _tempo_change_mid_note = -1;
+
+	APU _apu;
+	Engine _engine;
+	// time left in the current frame, in units of a cycle per sample rate
+	int64_t _frame_timer = 0;
+	// found along with the song, and swapped in with it, so reading it
+	// never steps through notes that a hot swap is replacing
+	std::atomic<double> _duration_seconds{0.0};
+	// an edited song compiled in the background, swapped in by render
+	std::atomic<APU_Module *> _next_song{nullptr};
+public:
+	APU_Module(
+		const std::vector<Note_View> &channel_1_notes,
+		const std::vector<Note_View> &channel_2_notes,
+		const std::vector<Note_View> &channel_3_notes,
+		const std::vector<Note_View> &channel_4_notes,
+		const std::vector<Wave> &waves,
+		const std::vector<Drumkit> &drumkits,
+		const std::vector<Drum> &drums,
+		int32_t loop_tick,
+		bool stereo,
+		bool open = true
+	);
+	~APU_Module() noexcept override;
+
+	APU_Module(const APU_Module&) = delete;
+	APU_Module& operator=(const APU_Module&) = delete;
+
+	int32_t tempo_change_wrong_channel() const override { return _tempo_change_wrong_channel; }
+	int32_t tempo_change_mid_note() const override { return _tempo_change_mid_note; }
+
+	bool looping() override { return _loop_tick != -1; }
+
+	void mute_channel(int32_t channel, bool mute) override;
+
+	int32_t current_tick() const override;
+	void set_tick(int32_t tick) override;
+
+	double get_position_seconds() override;
+	double get_duration_seconds() override;
+
+	// may run while playing; the song changes on the next frame, at the
+	// same tick, and notes already playing carry on until they end
+	void prepare_hot_swap(
+		const std::vector<Note_View> &channel_1_notes,
+		const std::vector<Note_View> &channel_2_notes,
+		const std::vector<Note_View> &channel_3_notes,
+		const std::vector<Note_View> &channel_4_notes,
+		const std::vector<Wave> &waves,
+		const std::vector<Drumkit> &drumkits,
+		const std::vector<Drum> &drums,
+		int32_t loop_tick,
+		bool stereo
+	);
+
+	// renders up to count frames, fewer once the song has ended
+	std::size_t render(float *left, float *right, std::size_t count, std::size_t stride);
+protected:
+	std::size_t render_block(float *frames, std::size_t count) override;
+private:
+	void find_tempo_changes(void);
+	double find_duration_seconds(void) const;
+	void reset(void);
+	void hot_swap(void);
+	int32_t engine_tick(const Engine &engine) const;
+	bool step_frame(Engine &engine, APU *apu) const;
+	bool start_note(Engine &engine, int32_t channel, APU *apu) const;
+	void update_frequency(Channel_State &state, int32_t channel, APU *apu) const;
+	void read_noise_note(Channel_State &state, APU *apu) const;
+};
+
+#endif
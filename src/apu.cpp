@@ -0,0 +1,292 @@
+#include <algorithm>
+#include <cmath>
+
+#include "apu.h"
+
+// cycles between steps of the frame sequencer, which clocks the lengths
+// at 256 Hz, the sweep at 128 Hz and the envelopes at 64 Hz
+static constexpr int64_t SEQUENCER_PERIOD = 8192;
+
+static constexpr uint8_t DUTY_PATTERNS[4] = { 0b00000001, 0b10000001, 0b10000111, 0b01111110 };
+
+// each channel's registers start at NR10 + 5 * channel
+static inline uint8_t channel_register(int32_t channel, int32_t offset) {
+	return (uint8_t)(APU::NR10 + 5 * channel + offset);
+}
+
+APU::APU(int32_t sample_rate, std::size_t block_size) : _sample_rate(sample_rate), _blip(block_size) {
+	_charge_factor = (float)std::pow(0.999958, (double)CLOCK_RATE / sample_rate);
+	reset();
+}
+
+void APU::reset() {
+	_channels = {};
+	_registers = {};
+	_shadow_frequency = 0;
+	_sweep_timer = 0;
+	_sweep_enabled = false;
+	_lfsr = 0x7fff;
+	_sequencer_timer = SEQUENCER_PERIOD * _sample_rate;
+	_sequencer_step = 0;
+	_blip.clear();
+	_time = 0;
+}
+
+int64_t APU::period(int32_t channel) const {
+	const Channel &ch = _channels[channel];
+	int64_t cycles;
+	if (channel == 3) {
+		uint8_t nr43 = reg(NR43);
+		int32_t divider = nr43 & 0b111;
+		cycles = (int64_t)(divider ? divider * 16 : 8) << (nr43 >> 4);
+	}
+	else {
+		cycles = (int64_t)(2048 - ch.frequency) * (channel == 2 ? 2 : 4);
+	}
+	return cycles * _sample_rate;
+}
+
+void APU::write(uint8_t address, uint8_t value) {
+	if (address < NR10 || address >= WAVE_RAM + 0x10) { return; }
+	if (address == NR52) {
+		if (!(value & 0x80)) {
+			std::array<uint8_t, 0x10> wave_ram;
+			std::copy(_registers.end() - 0x10, _registers.end(), wave_ram.begin());
+			reset();
+			std::copy(wave_ram.begin(), wave_ram.end(), _registers.end() - 0x10);
+		}
+		_registers[address - NR10] = value & 0x80;
+		return;
+	}
+	_registers[address - NR10] = value;
+	if (address >= NR50) {
+		// the volume and panning scale every channel's level
+		for (int32_t i = 0; i < NUM_CHANNELS; ++i) {
+			update_level(i);
+		}
+		return;
+	}
+
+	int32_t channel = (address - NR10) / 5;
+	int32_t offset = (address - NR10) % 5;
+	Channel &ch = _channels[channel];
+	if (offset == 0) {
+		if (channel == 2) {
+			ch.dac = !!(value & 0x80);
+			if (!ch.dac) { ch.enabled = false; }
+		}
+	}
+	else if (offset == 1) {
+		ch.length = channel == 2 ? 256 - value : 64 - (value & 0x3f);
+	}
+	else if (offset == 2) {
+		if (channel != 2) {
+			ch.dac = !!(value & 0xf8);
+			if (!ch.dac) { ch.enabled = false; }
+		}
+	}
+	else if (offset == 3) {
+		if (channel != 3) {
+			ch.frequency = (ch.frequency & 0x700) | value;
+		}
+	}
+	else if (offset == 4) {
+		if (channel != 3) {
+			ch.frequency = (ch.frequency & 0xff) | ((value & 0b111) << 8);
+		}
+		ch.length_enabled = !!(value & 0x40);
+		if (value & 0x80) {
+			trigger(channel);
+		}
+	}
+	update_output(channel);
+}
+
+void APU::trigger(int32_t channel) {
+	Channel &ch = _channels[channel];
+	ch.enabled = ch.dac;
+	if (ch.length == 0) {
+		ch.length = channel == 2 ? 256 : 64;
+	}
+	ch.timer = period(channel);
+	ch.position = 0;
+	if (channel != 2) {
+		uint8_t envelope = reg(channel_register(channel, 2));
+		ch.volume = envelope >> 4;
+		ch.envelope_up = !!(envelope & 0x08);
+		ch.envelope_pace = envelope & 0b111;
+		ch.envelope_timer = ch.envelope_pace ? ch.envelope_pace : 8;
+	}
+	if (channel == 3) {
+		_lfsr = 0x7fff;
+	}
+	if (channel == 0) {
+		uint8_t sweep = reg(NR10);
+		int32_t pace = (sweep >> 4) & 0b111;
+		_shadow_frequency = ch.frequency;
+		_sweep_timer = pace ? pace : 8;
+		_sweep_enabled = pace || (sweep & 0b111);
+		if (sweep & 0b111) {
+			sweep_frequency();
+		}
+	}
+}
+
+int32_t APU::sweep_frequency() {
+	uint8_t sweep = reg(NR10);
+	int32_t delta = _shadow_frequency >> (sweep & 0b111);
+	int32_t frequency = (sweep & 0x08) ? _shadow_frequency - delta : _shadow_frequency + delta;
+	if (frequency > 2047) {
+		_channels[0].enabled = false;
+	}
+	return frequency;
+}
+
+void APU::clock_sequencer() {
+	if (_sequencer_step % 2 == 0) {
+		for (Channel &ch : _channels) {
+			if (ch.length_enabled && ch.length > 0 && --ch.length == 0) {
+				ch.enabled = false;
+			}
+		}
+	}
+	if (_sequencer_step == 2 || _sequencer_step == 6) {
+		uint8_t sweep = reg(NR10);
+		int32_t pace = (sweep >> 4) & 0b111;
+		if (--_sweep_timer <= 0) {
+			_sweep_timer = pace ? pace : 8;
+			if (_sweep_enabled && pace) {
+				int32_t frequency = sweep_frequency();
+				if (frequency <= 2047 && (sweep & 0b111)) {
+					_shadow_frequency = frequency;
+					_channels[0].frequency = frequency;
+					_registers[NR13 - NR10] = frequency & 0xff;
+					_registers[NR14 - NR10] = (_registers[NR14 - NR10] & 0xf8) | (frequency >> 8);
+					sweep_frequency();
+				}
+			}
+		}
+	}
+	if (_sequencer_step == 7) {
+		for (int32_t i = 0; i < NUM_CHANNELS; ++i) {
+			Channel &ch = _channels[i];
+			if (i == 2 || ch.envelope_pace == 0) { continue; }
+			if (--ch.envelope_timer <= 0) {
+				ch.envelope_timer = ch.envelope_pace;
+				if (ch.envelope_up && ch.volume < 15) {
+					ch.volume += 1;
+				}
+				else if (!ch.envelope_up && ch.volume > 0) {
+					ch.volume -= 1;
+				}
+			}
+		}
+	}
+	_sequencer_step = (_sequencer_step + 1) % 8;
+	for (int32_t i = 0; i < NUM_CHANNELS; ++i) {
+		update_output(i);
+	}
+}
+
+void APU::step(int32_t channel) {
+	Channel &ch = _channels[channel];
+	if (channel == 3) {
+		uint16_t bit = (_lfsr ^ (_lfsr >> 1)) & 1;
+		_lfsr = (uint16_t)((_lfsr >> 1) | (bit << 14));
+		if (reg(NR43) & 0x08) {
+			_lfsr = (uint16_t)((_lfsr & ~0x40) | (bit << 6));
+		}
+	}
+	else {
+		ch.position = (ch.position + 1) % (channel == 2 ? 32 : 8);
+	}
+	update_output(channel);
+}
+
+void APU::update_output(int32_t channel) {
+	Channel &ch = _channels[channel];
+	if (!ch.enabled) {
+		ch.output = 0;
+	}
+	else if (channel == 2) {
+		uint8_t sample = _registers[WAVE_RAM - NR10 + ch.position / 2];
+		sample = ch.position % 2 ? sample & 0x0f : sample >> 4;
+		int32_t level = (reg(NR32) >> 5) & 0b11;
+		ch.output = level ? sample >> (level - 1) : 0;
+	}
+	else if (channel == 3) {
+		ch.output = (~_lfsr & 1) ? ch.volume : 0;
+	}
+	else {
+		uint8_t pattern = DUTY_PATTERNS[reg(channel_register(channel, 1)) >> 6];
+		ch.output = ((pattern >> (7 - ch.position)) & 1) ? ch.volume : 0;
+	}
+	update_level(channel);
+}
+
+void APU::update_level(int32_t channel) {
+	Channel &ch = _channels[channel];
+	float left = 0.0f, right = 0.0f;
+	if (ch.dac && !_muted[channel]) {
+		const uint8_t panning = reg(NR51);
+		float level = (float)ch.output / 7.5f - 1.0f;
+		if (panning & (0x10 << channel)) {
+			left = level * (float)(((reg(NR50) >> 4) & 0b111) + 1) / (8.0f * NUM_CHANNELS);
+		}
+		if (panning & (0x01 << channel)) {
+			right = level * (float)((reg(NR50) & 0b111) + 1) / (8.0f * NUM_CHANNELS);
+		}
+	}
+	if (left == ch.left_level && right == ch.right_level) { return; }
+	_blip.add_delta((std::size_t)(_time / CLOCK_RATE), (int32_t)(_time % CLOCK_RATE * Blip_Buffer::PHASES / CLOCK_RATE),
+		left - ch.left_level, right - ch.right_level);
+	ch.left_level = left;
+	ch.right_level = right;
+}
+
+void APU::run_channel(int32_t channel, int64_t end) {
+	Channel &ch = _channels[channel];
+	if (!ch.enabled) { return; }
+	while (_time + ch.timer <= end) {
+		_time += ch.timer;
+		step(channel);
+		ch.timer = period(channel);
+	}
+	ch.timer -= end - _time;
+}
+
+void APU::skip(int64_t cycles) {
+	_sequencer_timer -= cycles * _sample_rate;
+	while (_sequencer_timer <= 0) {
+		clock_sequencer();
+		_sequencer_timer += SEQUENCER_PERIOD * _sample_rate;
+	}
+}
+
+void APU::render(float *left, float *right, std::size_t count, std::size_t stride) {
+	while (count > 0) {
+		std::size_t n = std::min(count, _blip.capacity());
+		const int64_t block_end = (int64_t)n * CLOCK_RATE;
+		// run each channel up to the next step of the frame sequencer,
+		// which may change any of their levels
+		while (_time < block_end) {
+			const int64_t start = _time;
+			const int64_t end = std::min(block_end, start + _sequencer_timer);
+			for (int32_t c = 0; c < NUM_CHANNELS; ++c) {
+				_time = start;
+				run_channel(c, end);
+			}
+			_time = end;
+			_sequencer_timer -= end - start;
+			if (_sequencer_timer <= 0) {
+				clock_sequencer();
+				_sequencer_timer += SEQUENCER_PERIOD * _sample_rate;
+			}
+		}
+		_blip.read(left, right, n, stride, _charge_factor);
+		_time = 0;
+		left += n * stride;
+		right += n * stride;
+		count -= n;
+	}
+}
@@ -0,0 +1,93 @@
+#ifndef APU_H
+#define APU_H
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+
+#include "blip-buffer.h"
+
+// the Game Boy's sound hardware: two pulse channels, the first with a
+// frequency sweep, a wave channel playing 32 samples from wave RAM, and
+// a noise channel clocking a linear feedback shift register
+//
+// registers are written by their low address byte, from NR10 ($10) to
+// the end of wave RAM ($3f), and rendered at a given sample rate by
+// adding a band-limited step to a blip buffer whenever a channel's
+// level changes, in blocks of at most block_size samples
+class APU {
+public:
+	static constexpr int32_t CLOCK_RATE = 4194304;
+	static constexpr int32_t NUM_CHANNELS = 4;
+
+	enum Register : uint8_t {
+		NR10 = 0x10, NR11, NR12, NR13, NR14,
+		NR21 = 0x16, NR22, NR23, NR24,
+		NR30 = 0x1a, NR31, NR32, NR33, NR34,
+		NR41 = 0x20, NR42, NR43, NR44,
+		NR50 = 0x24, NR51, NR52,
+		WAVE_RAM = 0x30
+	};
+private:
+	struct Channel {
+		bool enabled = false;
+		bool dac = false;
+		int32_t length = 0;
+		bool length_enabled = false;
+
+		int32_t frequency = 0;
+		// time until the next step, in units of a cycle per sample rate
+		int64_t timer = 0;
+		int32_t position = 0;
+		int32_t output = 0;
+
+		int32_t volume = 0;
+		int32_t envelope_pace = 0;
+		bool envelope_up = false;
+		int32_t envelope_timer = 0;
+
+		// the level last added to the blip buffer
+		float left_level = 0.0f;
+		float right_level = 0.0f;
+	};
+	int32_t _sample_rate = 0;
+	std::array<Channel, NUM_CHANNELS> _channels;
+	std::array<uint8_t, 0x30> _registers{};
+	std::array<bool, NUM_CHANNELS> _muted{};
+
+	// channel 1's sweep
+	int32_t _shadow_frequency = 0;
+	int32_t _sweep_timer = 0;
+	bool _sweep_enabled = false;
+
+	uint16_t _lfsr = 0x7fff;
+
+	int64_t _sequencer_timer = 0;
+	int32_t _sequencer_step = 0;
+
+	Blip_Buffer _blip;
+	// time into the block being rendered, in units of a cycle per sample rate
+	int64_t _time = 0;
+	float _charge_factor = 1.0f;
+
+	inline uint8_t reg(uint8_t address) const { return _registers[address - NR10]; }
+	int64_t period(int32_t channel) const;
+	void trigger(int32_t channel);
+	int32_t sweep_frequency(void);
+	void clock_sequencer(void);
+	void step(int32_t channel);
+	void update_output(int32_t channel);
+	void update_level(int32_t channel);
+	void run_channel(int32_t channel, int64_t end);
+public:
+	APU(int32_t sample_rate, std::size_t block_size);
+	void reset(void);
+	inline void kernel(Blip_Buffer::Kernel kernel) { _blip.kernel(kernel); }
+	void write(uint8_t address, uint8_t value);
+	inline void mute_channel(int32_t channel, bool mute) { _muted[channel - 1] = mute; update_level(channel - 1); }
+	// advances the envelopes, sweep and lengths without rendering
+	void skip(int64_t cycles);
+	void render(float *left, float *right, std::size_t count, std::size_t stride);
+};
+
+#endif
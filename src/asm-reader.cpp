@@ -0,0 +1,97 @@
+#include <cstring>
+
+#pragma warning(push, 0)
+#include <FL/filename.H>
+#include <FL/fl_utf8.h>
+#pragma warning(pop)
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "asm-reader.h"
+
+#include "utils.h"
+
+#ifdef _WIN32
+
+Mapped_File::Mapped_File(const char *f) {
+	wchar_t wf[FL_PATH_MAX] = {};
+	fl_utf8towc(f, (unsigned int) strlen(f), wf, sizeof(wf));
+	HANDLE file = CreateFileW(wf, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) { return; }
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(file, &size)) {
+		if (size.QuadPart == 0) {
+			// empty files cannot be mapped
+			_good = true;
+		}
+		else if (HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL)) {
+			_data = (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			_size = _data ? (size_t)size.QuadPart : 0;
+			_good = _data != nullptr;
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(file);
+}
+
+Mapped_File::~Mapped_File() {
+	if (_data) { UnmapViewOfFile(_data); }
+}
+
+#else
+
+Mapped_File::Mapped_File(const char *f) {
+	int fd = open(f, O_RDONLY);
+	if (fd == -1) { return; }
+	struct stat s;
+	if (!fstat(fd, &s) && S_ISREG(s.st_mode)) {
+		if (s.st_size == 0) {
+			// empty files cannot be mapped
+			_good = true;
+		}
+		else {
+			void *data = mmap(NULL, (size_t)s.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data != MAP_FAILED) {
+				_data = (const char *)data;
+				_size = (size_t)s.st_size;
+				_good = true;
+			}
+		}
+	}
+	close(fd);
+}
+
+Mapped_File::~Mapped_File() {
+	if (_data) { munmap((void *)_data, _size); }
+}
+
+#endif
+
+Asm_Reader::Asm_Reader(const char *f) : _file(f), _text(_file.text()), _good(_file.good()) {}
+
+Asm_Reader::Asm_Reader(std::string_view text) : _text(text), _good(true) {}
+
+bool Asm_Reader::next_line(std::string_view &line) {
+	if (done()) { return false; }
+	_line_begin = _offset;
+	size_t p = _text.find('\n', _offset);
+	if (p == std::string_view::npos) {
+		line = _text.substr(_offset);
+		_offset = _text.size() + 1;
+	}
+	else {
+		line = _text.substr(_offset, p - _offset);
+		_offset = p + 1;
+	}
+	_line_end = std::min(_offset, _text.size());
+	remove_comment(line);
+	rtrim(line);
+	return true;
+}
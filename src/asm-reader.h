@@ -0,0 +1,45 @@
+#ifndef ASM_READER_H
+#define ASM_READER_H
+
+#include <cstdint>
+#include <string_view>
+
+class Mapped_File {
+private:
+	const char *_data = nullptr;
+	size_t _size = 0;
+	bool _good = false;
+public:
+	Mapped_File() = default;
+	Mapped_File(const char *f);
+	~Mapped_File();
+	Mapped_File(const Mapped_File &) = delete;
+	Mapped_File &operator=(const Mapped_File &) = delete;
+	inline bool good(void) const { return _good; }
+	inline std::string_view text(void) const { return std::string_view(_data, _size); }
+};
+
+// hands out the lines of an asm file as views into its mapping,
+// without comments or trailing whitespace; views are only valid
+// as long as the reader is alive
+class Asm_Reader {
+private:
+	Mapped_File _file;
+	std::string_view _text;
+	bool _good = false;
+	size_t _offset = 0;
+	size_t _line_begin = 0, _line_end = 0;
+public:
+	Asm_Reader(const char *f);
+	// reads text held elsewhere, which has to outlive the reader
+	Asm_Reader(std::string_view text);
+	inline bool good(void) const { return _good; }
+	inline bool done(void) const { return _offset > _text.size(); }
+	inline void rewind(void) { _offset = 0; }
+	bool next_line(std::string_view &line);
+	// where the last line read starts and ends in the file, including its newline
+	inline size_t line_begin(void) const { return _line_begin; }
+	inline size_t line_end(void) const { return _line_end; }
+};
+
+#endif
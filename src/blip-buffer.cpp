@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "blip-buffer.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BLIP_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define BLIP_TARGET(t)
+#else
+#define BLIP_TARGET(t) __attribute__((target(t)))
+#endif
+#endif
+
+typedef std::array<float, Blip_Buffer::PHASES * Blip_Buffer::KERNEL_SIZE> Impulses;
+
+// a Blackman-windowed sinc, cut off a little below the Nyquist frequency,
+// for each fraction of a sample; every row sums to one, so an integrated
+// impulse is a step of exactly its delta
+static Impulses make_impulses() {
+	const double pi = 3.14159265358979323846;
+	const double cutoff = 0.9;
+	const int32_t half = Blip_Buffer::KERNEL_SIZE / 2;
+	Impulses impulses;
+	for (int32_t p = 0; p < Blip_Buffer::PHASES; ++p) {
+		float *row = impulses.data() + p * Blip_Buffer::KERNEL_SIZE;
+		double sum = 0.0;
+		for (int32_t k = 0; k < Blip_Buffer::KERNEL_SIZE; ++k) {
+			double x = k - (half - 1) - (double)p / Blip_Buffer::PHASES;
+			double sinc = x == 0.0 ? 1.0 : std::sin(pi * cutoff * x) / (pi * cutoff * x);
+			double window = 0.42 + 0.5 * std::cos(pi * x / half) + 0.08 * std::cos(2.0 * pi * x / half);
+			row[k] = (float)(sinc * window);
+			sum += row[k];
+		}
+		for (int32_t k = 0; k < Blip_Buffer::KERNEL_SIZE; ++k) {
+			row[k] = (float)(row[k] / sum);
+		}
+	}
+	return impulses;
+}
+
+static const Impulses &impulses() {
+	static const Impulses table = make_impulses();
+	return table;
+}
+
+static void add_impulse_scalar(float *left, float *right, const float *impulse, float left_delta, float right_delta) {
+	for (int32_t k = 0; k < Blip_Buffer::KERNEL_SIZE; ++k) {
+		left[k] += impulse[k] * left_delta;
+		right[k] += impulse[k] * right_delta;
+	}
+}
+
+#ifdef BLIP_X86
+
+BLIP_TARGET("sse2")
+static void add_impulse_sse2(float *left, float *right, const float *impulse, float left_delta, float right_delta) {
+	const __m128 l = _mm_set1_ps(left_delta);
+	const __m128 r = _mm_set1_ps(right_delta);
+	for (int32_t k = 0; k < Blip_Buffer::KERNEL_SIZE; k += 4) {
+		const __m128 taps = _mm_loadu_ps(impulse + k);
+		_mm_storeu_ps(left + k, _mm_add_ps(_mm_loadu_ps(left + k), _mm_mul_ps(taps, l)));
+		_mm_storeu_ps(right + k, _mm_add_ps(_mm_loadu_ps(right + k), _mm_mul_ps(taps, r)));
+	}
+}
+
+BLIP_TARGET("avx2")
+static void add_impulse_avx2(float *left, float *right, const float *impulse, float left_delta, float right_delta) {
+	const __m256 l = _mm256_set1_ps(left_delta);
+	const __m256 r = _mm256_set1_ps(right_delta);
+	for (int32_t k = 0; k < Blip_Buffer::KERNEL_SIZE; k += 8) {
+		const __m256 taps = _mm256_loadu_ps(impulse + k);
+		_mm256_storeu_ps(left + k, _mm256_add_ps(_mm256_loadu_ps(left + k), _mm256_mul_ps(taps, l)));
+		_mm256_storeu_ps(right + k, _mm256_add_ps(_mm256_loadu_ps(right + k), _mm256_mul_ps(taps, r)));
+	}
+}
+
+static bool cpu_supports_sse2() {
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	return !!(info[3] & (1 << 26));
+#else
+	return __builtin_cpu_supports("sse2");
+#endif
+}
+
+static bool cpu_supports_avx2() {
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) { return false; }
+	__cpuid(info, 1);
+	// the OS must save the AVX registers too
+	if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)) || (_xgetbv(0) & 0b110) != 0b110) { return false; }
+	__cpuidex(info, 7, 0);
+	return !!(info[1] & (1 << 5));
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+Blip_Buffer::Blip_Buffer(std::size_t capacity) : _capacity(capacity),
+	_left(capacity + KERNEL_SIZE), _right(capacity + KERNEL_SIZE), _impulses(impulses().data()) {
+	kernel(best_kernel());
+}
+
+Blip_Buffer::Kernel Blip_Buffer::best_kernel() {
+#ifdef BLIP_X86
+	static const Kernel best = cpu_supports_avx2() ? Kernel::AVX2 : cpu_supports_sse2() ? Kernel::SSE2 : Kernel::SCALAR;
+	return best;
+#else
+	return Kernel::SCALAR;
+#endif
+}
+
+const char *Blip_Buffer::kernel_name(Kernel kernel) {
+	switch (kernel) {
+	case Kernel::SSE2: return "SSE2";
+	case Kernel::AVX2: return "AVX2";
+	default: return "scalar";
+	}
+}
+
+void Blip_Buffer::kernel(Kernel kernel) {
+	// never more than the CPU supports
+	kernel = std::min(kernel, best_kernel());
+#ifdef BLIP_X86
+	_add_impulse =
+		kernel == Kernel::AVX2 ? add_impulse_avx2 :
+		kernel == Kernel::SSE2 ? add_impulse_sse2 :
+		add_impulse_scalar;
+#else
+	_add_impulse = add_impulse_scalar;
+#endif
+}
+
+void Blip_Buffer::clear() {
+	std::fill(_left.begin(), _left.end(), 0.0f);
+	std::fill(_right.begin(), _right.end(), 0.0f);
+	_left_sum = 0.0f;
+	_right_sum = 0.0f;
+	_left_capacitor = 0.0f;
+	_right_capacitor = 0.0f;
+}
+
+void Blip_Buffer::read(float *left, float *right, std::size_t count, std::size_t stride, float charge_factor) {
+	for (std::size_t i = 0; i < count; ++i) {
+		_left_sum += _left[i];
+		_right_sum += _right[i];
+		float l = _left_sum - _left_capacitor;
+		float r = _right_sum - _right_capacitor;
+		_left_capacitor = _left_sum - l * charge_factor;
+		_right_capacitor = _right_sum - r * charge_factor;
+		left[i * stride] = l;
+		right[i * stride] = r;
+	}
+	std::copy(_left.begin() + count, _left.begin() + count + KERNEL_SIZE, _left.begin());
+	std::copy(_right.begin() + count, _right.begin() + count + KERNEL_SIZE, _right.begin());
+	std::fill(_left.begin() + KERNEL_SIZE, _left.begin() + count + KERNEL_SIZE, 0.0f);
+	std::fill(_right.begin() + KERNEL_SIZE, _right.begin() + count + KERNEL_SIZE, 0.0f);
+}
@@ -0,0 +1,50 @@
+#ifndef BLIP_BUFFER_H
+#define BLIP_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// band-limited synthesis of step functions: every change in a channel's
+// output adds a windowed sinc impulse at its fractional sample position
+// to a buffer of deltas, and reading integrates them, so square, wave and
+// noise edges do not alias however high they are pitched
+//
+// adding an impulse is the hot loop, and has SSE2 and AVX2 versions that
+// are picked at runtime from what the CPU supports
+class Blip_Buffer {
+public:
+	enum class Kernel { SCALAR, SSE2, AVX2 };
+	static constexpr int32_t KERNEL_SIZE = 16;
+	static constexpr int32_t PHASES = 64;
+	typedef void (*Add_Impulse)(float *left, float *right, const float *impulse, float left_delta, float right_delta);
+private:
+	std::size_t _capacity = 0;
+	std::vector<float> _left;
+	std::vector<float> _right;
+	float _left_sum = 0.0f;
+	float _right_sum = 0.0f;
+	// high-pass filter charge, as the output capacitors of the hardware
+	float _left_capacitor = 0.0f;
+	float _right_capacitor = 0.0f;
+	Add_Impulse _add_impulse = nullptr;
+	// PHASES rows of KERNEL_SIZE taps, shared by every buffer
+	const float *_impulses = nullptr;
+public:
+	Blip_Buffer(std::size_t capacity);
+	static Kernel best_kernel(void);
+	static const char *kernel_name(Kernel kernel);
+	void kernel(Kernel kernel);
+	inline std::size_t capacity(void) const { return _capacity; }
+	void clear(void);
+	// the sample and its fraction in PHASES, which must be before capacity
+	inline void add_delta(std::size_t sample, int32_t phase, float left_delta, float right_delta);
+	// integrates count samples and keeps the tails of their impulses
+	void read(float *left, float *right, std::size_t count, std::size_t stride, float charge_factor);
+};
+
+inline void Blip_Buffer::add_delta(std::size_t sample, int32_t phase, float left_delta, float right_delta) {
+	_add_impulse(_left.data() + sample, _right.data() + sample, _impulses + phase * KERNEL_SIZE, left_delta, right_delta);
+}
+
+#endif
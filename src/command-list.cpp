@@ -0,0 +1,384 @@
+#include <algorithm>
+#include <cstring>
+
+#include "utils.h"
+#include "command-list.h"
+#include "length-index.h"
+
+// chunks are split when they grow past twice this, and merged with a
+// neighbor when the two would fit in it
+static constexpr size_t CHUNK_SIZE = 256;
+
+static inline bool same_command(const Command &a, const Command &b) {
+	return !memcmp(&a, &b, sizeof(Command));
+}
+
+Command_List &Command_List::operator=(const Command_List &other) {
+	if (this != &other) {
+		_chunks = other._chunks;
+		_starts = other._starts;
+		_chunk_labels = other._chunk_labels;
+		_indexed.assign(_chunks.size(), false);
+		_unindexed = _chunks.size();
+		_label_index.clear();
+		_chunk_numbers.clear();
+		_tick_index.clear();
+		_length_index.reset();
+	}
+	return *this;
+}
+
+Command_List &Command_List::operator=(Command_List &&other) noexcept {
+	if (this != &other) {
+		_chunks = std::move(other._chunks);
+		_starts = std::move(other._starts);
+		_chunk_labels = std::move(other._chunk_labels);
+		_indexed = std::move(other._indexed);
+		_unindexed = other._unindexed;
+		_label_index = std::move(other._label_index);
+		_chunk_numbers = std::move(other._chunk_numbers);
+		_tick_index = std::move(other._tick_index);
+		_length_index = std::move(other._length_index);
+		other.clear();
+	}
+	return *this;
+}
+
+std::vector<Command> &Command_List::writable_chunk(size_t c) {
+	if (_indexed[c]) {
+		unindex_chunk(c);
+	}
+	invalidate_indexes(_starts[c]);
+	std::shared_ptr<Chunk> &chunk = _chunks[c];
+	if (chunk.use_count() > 1) {
+		chunk = std::make_shared<Chunk>(*chunk);
+		_chunk_numbers.clear();
+	}
+	_chunk_labels[c].reset();
+	return chunk->commands;
+}
+
+void Command_List::locate(size_t index, size_t &c, size_t &offset) const {
+	if (index >= size()) {
+		c = _chunks.size();
+		offset = 0;
+		return;
+	}
+	c = std::upper_bound(_starts.begin(), _starts.end(), index) - _starts.begin() - 1;
+	offset = index - _starts[c];
+}
+
+void Command_List::update_starts(size_t c) {
+	_starts.resize(_chunks.size() + 1);
+	for (; c < _chunks.size(); ++c) {
+		_starts[c + 1] = _starts[c] + chunk(c).size();
+	}
+	_chunk_numbers.clear();
+}
+
+void Command_List::invalidate_indexes(size_t index) {
+	_tick_index.invalidate(index);
+	if (_length_index) {
+		_length_index->invalidate(index);
+	}
+}
+
+void Command_List::insert_chunks(size_t c, std::vector<std::shared_ptr<Chunk>> &&chunks) {
+	_indexed.insert(_indexed.begin() + c, chunks.size(), false);
+	_unindexed += chunks.size();
+	_chunk_labels.insert(_chunk_labels.begin() + c, chunks.size(), nullptr);
+	_chunks.insert(_chunks.begin() + c, std::make_move_iterator(chunks.begin()), std::make_move_iterator(chunks.end()));
+	_chunk_numbers.clear();
+}
+
+void Command_List::erase_chunk(size_t c) {
+	if (_indexed[c]) {
+		unindex_chunk(c);
+	}
+	invalidate_indexes(_starts[c]);
+	--_unindexed;
+	_indexed.erase(_indexed.begin() + c);
+	_chunk_labels.erase(_chunk_labels.begin() + c);
+	_chunks.erase(_chunks.begin() + c);
+	_chunk_numbers.clear();
+}
+
+void Command_List::split_chunk(size_t c) {
+	if (chunk(c).size() <= CHUNK_SIZE * 2) { return; }
+	std::vector<Command> &commands = writable_chunk(c);
+	std::vector<std::shared_ptr<Chunk>> pieces;
+	for (size_t i = CHUNK_SIZE; i < commands.size(); i += CHUNK_SIZE) {
+		std::shared_ptr<Chunk> piece = std::make_shared<Chunk>();
+		piece->commands.assign(commands.begin() + i, commands.begin() + std::min(i + CHUNK_SIZE, commands.size()));
+		pieces.push_back(std::move(piece));
+	}
+	commands.resize(CHUNK_SIZE);
+	insert_chunks(c + 1, std::move(pieces));
+}
+
+void Command_List::insert_commands(size_t index, const Command *first, size_t n) {
+	if (n == 0) { return; }
+	if (_chunks.empty()) {
+		insert_chunks(0, { std::make_shared<Chunk>() });
+	}
+	size_t c, offset;
+	if (index >= size()) {
+		c = _chunks.size() - 1;
+		offset = chunk(c).size();
+	}
+	else {
+		locate(index, c, offset);
+	}
+	std::vector<Command> &commands = writable_chunk(c);
+	commands.insert(commands.begin() + offset, first, first + n);
+	split_chunk(c);
+	update_starts(c);
+}
+
+void Command_List::erase_commands(size_t index, size_t n) {
+	if (n == 0) { return; }
+	size_t c, offset;
+	locate(index, c, offset);
+	size_t first_chunk = c;
+	while (n > 0) {
+		size_t count = std::min(n, chunk(c).size() - offset);
+		if (count == chunk(c).size()) {
+			erase_chunk(c);
+		}
+		else {
+			std::vector<Command> &commands = writable_chunk(c);
+			commands.erase(commands.begin() + offset, commands.begin() + offset + count);
+			++c;
+		}
+		n -= count;
+		offset = 0;
+	}
+	// keep the chunks around the gap from dwindling
+	if (first_chunk > 0) { --first_chunk; }
+	for (c = first_chunk; c + 1 < _chunks.size() && c <= first_chunk + 1; ) {
+		if (chunk(c).size() + chunk(c + 1).size() <= CHUNK_SIZE) {
+			std::vector<Command> &commands = writable_chunk(c);
+			commands.insert(commands.end(), RANGE(chunk(c + 1)));
+			erase_chunk(c + 1);
+		}
+		else {
+			++c;
+		}
+	}
+	update_starts(first_chunk);
+}
+
+const Command &Command_List::operator[](size_t i) const {
+	size_t c, offset;
+	locate(i, c, offset);
+	return chunk(c)[offset];
+}
+
+Command &Command_List::modify(size_t i) {
+	size_t c, offset;
+	locate(i, c, offset);
+	return writable_chunk(c)[offset];
+}
+
+void Command_List::clear() {
+	_chunks.clear();
+	_starts.assign(1, 0);
+	_chunk_labels.clear();
+	_indexed.clear();
+	_unindexed = 0;
+	_label_index.clear();
+	_chunk_numbers.clear();
+	_tick_index.clear();
+	_length_index.reset();
+}
+
+void Command_List::resize(size_t n) {
+	if (n < size()) {
+		erase_commands(n, size() - n);
+	}
+	else if (n > size()) {
+		std::vector<Command> commands(n - size());
+		insert_commands(size(), commands.data(), commands.size());
+	}
+}
+
+void Command_List::push_back(const Command &command) {
+	if (_chunks.empty() || chunk(_chunks.size() - 1).size() >= CHUNK_SIZE) {
+		insert_chunks(_chunks.size(), { std::make_shared<Chunk>() });
+		_starts.push_back(_starts.back());
+	}
+	writable_chunk(_chunks.size() - 1).push_back(command);
+	++_starts.back();
+}
+
+Command_List::iterator Command_List::insert(const_iterator pos, size_t n, const Command &command) {
+	size_t index = pos.index();
+	std::vector<Command> commands(n, command);
+	insert_commands(index, commands.data(), commands.size());
+	return begin() + index;
+}
+
+Command_List::iterator Command_List::erase(const_iterator first, const_iterator last) {
+	size_t index = first.index();
+	erase_commands(index, last.index() - first.index());
+	return begin() + index;
+}
+
+size_t Command_List::common_prefix(const Command_List &other) const {
+	size_t c = 0;
+	while (c < _chunks.size() && c < other._chunks.size() && _chunks[c] == other._chunks[c]) { ++c; }
+	const_iterator a(this, c, 0), b(&other, c, 0);
+	size_t n = _starts[c];
+	for (; a != end() && b != other.end() && same_command(*a, *b); ++a, ++b) { ++n; }
+	return n;
+}
+
+size_t Command_List::common_suffix(const Command_List &other, size_t limit) const {
+	size_t c = _chunks.size(), d = other._chunks.size();
+	size_t n = 0;
+	while (c > 0 && d > 0 && _chunks[c - 1] == other._chunks[d - 1] && n + chunk(c - 1).size() <= limit) {
+		n += chunk(--c).size();
+		--d;
+	}
+	const_iterator a(this, c, 0), b(&other, d, 0);
+	for (; n < limit && a != begin() && b != other.begin(); ++n) {
+		if (!same_command(*--a, *--b)) { break; }
+	}
+	return n;
+}
+
+const Command_List::Chunk_Labels &Command_List::chunk_labels(size_t c) const {
+	if (!_chunk_labels[c]) {
+		std::shared_ptr<Chunk_Labels> built = std::make_shared<Chunk_Labels>();
+		Chunk_Labels &labels = *built;
+		const std::vector<Command> &commands = chunk(c);
+		for (uint32_t i = 0; i < commands.size(); ++i) {
+			const Command &command = commands[i];
+			for (Label label : command.labels) {
+				labels.definitions.emplace_back(label, i);
+				if (label.find_first_of(".") == std::string::npos) {
+					labels.last_scope = label;
+				}
+			}
+			if (
+				(command.type == Command_Type::SOUND_JUMP ||
+				command.type == Command_Type::SOUND_LOOP ||
+				command.type == Command_Type::SOUND_CALL) &&
+				!command.target.empty()
+			) {
+				labels.references.push_back(command.target);
+			}
+		}
+		_chunk_labels[c] = std::move(built);
+	}
+	return *_chunk_labels[c];
+}
+
+void Command_List::index_chunk(size_t c) const {
+	const Chunk *chunk = _chunks[c].get();
+	const Chunk_Labels &labels = chunk_labels(c);
+	for (const auto &[label, offset] : labels.definitions) {
+		Label_Entry &entry = _label_index[label.id()];
+		entry.chunk = entry.definitions++ == 0 ? chunk : nullptr;
+		entry.offset = offset;
+	}
+	for (Label label : labels.references) {
+		_label_index[label.id()].references += 1;
+	}
+	_indexed[c] = true;
+	--_unindexed;
+}
+
+void Command_List::unindex_chunk(size_t c) const {
+	const Chunk_Labels &labels = chunk_labels(c);
+	const auto release = [this](uint32_t id, Label_Entry &entry) {
+		if (entry.definitions == 0 && entry.references == 0) {
+			_label_index.erase(id);
+		}
+	};
+	for (const auto &[label, offset] : labels.definitions) {
+		Label_Entry &entry = _label_index[label.id()];
+		// a label defined more than once is found by scanning until it is unique again
+		entry.definitions -= 1;
+		entry.chunk = nullptr;
+		release(label.id(), entry);
+	}
+	for (Label label : labels.references) {
+		Label_Entry &entry = _label_index[label.id()];
+		entry.references -= 1;
+		release(label.id(), entry);
+	}
+	_indexed[c] = false;
+	++_unindexed;
+}
+
+void Command_List::update_index() const {
+	if (_unindexed == 0) { return; }
+	for (size_t c = 0; c < _chunks.size(); ++c) {
+		if (!_indexed[c]) {
+			index_chunk(c);
+		}
+	}
+}
+
+size_t Command_List::find_label_index(Label label) const {
+	update_index();
+	auto entry_itr = _label_index.find(label.id());
+	if (entry_itr == _label_index.end() || entry_itr->second.definitions == 0) { return size(); }
+	Label_Entry &entry = entry_itr->second;
+	if (entry.chunk) {
+		if (_chunk_numbers.empty()) {
+			for (size_t c = 0; c < _chunks.size(); ++c) {
+				_chunk_numbers[_chunks[c].get()] = c;
+			}
+		}
+		return _starts[_chunk_numbers[entry.chunk]] + entry.offset;
+	}
+	for (size_t c = 0; c < _chunks.size(); ++c) {
+		for (const auto &[defined, offset] : chunk_labels(c).definitions) {
+			if (defined != label) { continue; }
+			if (entry.definitions == 1) {
+				entry.chunk = _chunks[c].get();
+				entry.offset = offset;
+			}
+			return _starts[c] + offset;
+		}
+	}
+	return size();
+}
+
+Command_List::const_iterator Command_List::find_label(Label label) const {
+	return begin() + find_label_index(label);
+}
+
+size_t Command_List::count_references(Label label) const {
+	update_index();
+	auto entry_itr = _label_index.find(label.id());
+	return entry_itr == _label_index.end() ? 0 : entry_itr->second.references;
+}
+
+Length_Index &Command_List::length_index() const {
+	if (!_length_index) {
+		_length_index = std::make_shared<Length_Index>();
+	}
+	return *_length_index;
+}
+
+Label Command_List::find_scope(size_t index) const {
+	if (empty()) { return Label(); }
+	size_t c, offset;
+	locate(std::min(index, size() - 1), c, offset);
+	for (size_t i = offset + 1; i-- > 0; ) {
+		const Label_List &labels = chunk(c)[i].labels;
+		for (auto label_itr = labels.rbegin(); label_itr != labels.rend(); ++label_itr) {
+			if (label_itr->find_first_of(".") == std::string::npos) {
+				return *label_itr;
+			}
+		}
+	}
+	while (c-- > 0) {
+		Label scope = chunk_labels(c).last_scope;
+		if (!scope.empty()) { return scope; }
+	}
+	return Label();
+}
@@ -0,0 +1,220 @@
+#ifndef COMMAND_LIST_H
+#define COMMAND_LIST_H
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "command.h"
+#include "tick-index.h"
+
+class Length_Index;
+
+// a channel's commands, stored as a sequence of small chunks so that
+// inserting or erasing in the middle only moves one chunk's commands;
+// copies share their chunks, and a chunk is only copied when one of
+// its sharers writes to it
+//
+// reading never writes, so iterators and operator[] only give const
+// access, even to a non-const list; a command is changed in place through
+// modify, which copies its chunk if it is shared and drops it from the
+// indexes
+//
+// the list also indexes where each label is defined and how often it is
+// referenced; a chunk leaves the index whenever it is written to, and is
+// read back into it by the next query, so queries cost the chunks edited
+// since the last one rather than the whole channel. queries update the
+// index, so a list must not be queried from two threads at once
+//
+// it likewise keeps a tick index of how the channel plays and a length
+// index of where it first ends, which an edit discards from the edited
+// command onward
+class Command_List {
+private:
+	struct Chunk_Labels {
+		// each label and the offset of the command it is on
+		std::vector<std::pair<Label, uint32_t>> definitions;
+		// the targets of jumps, loops and calls
+		std::vector<Label> references;
+		// the last label without a '.', which scopes the ones after it
+		Label last_scope;
+	};
+	struct Chunk {
+		std::vector<Command> commands;
+	};
+	struct Label_Entry {
+		uint32_t definitions = 0;
+		uint32_t references = 0;
+		// where the label is defined, unless that is ambiguous
+		const Chunk *chunk = nullptr;
+		uint32_t offset = 0;
+	};
+	std::vector<std::shared_ptr<Chunk>> _chunks;
+	// the index of each chunk's first command, followed by the size
+	std::vector<size_t> _starts = { 0 };
+	// each chunk's labels, built on demand and reset whenever its commands
+	// may change; kept per list rather than in the shared chunks, so lists
+	// used from different threads never write to the same cache, and only
+	// shared once built
+	mutable std::vector<std::shared_ptr<const Chunk_Labels>> _chunk_labels;
+	// which chunks are counted in the label index
+	mutable std::vector<bool> _indexed;
+	mutable size_t _unindexed = 0;
+	mutable std::unordered_map<uint32_t, Label_Entry> _label_index;
+	mutable std::unordered_map<const Chunk *, size_t> _chunk_numbers;
+	mutable Tick_Index _tick_index;
+	// created on first use, since it depends on parse-song.h, which depends on this
+	mutable std::shared_ptr<Length_Index> _length_index;
+
+	inline const std::vector<Command> &chunk(size_t c) const { return _chunks[c]->commands; }
+	std::vector<Command> &writable_chunk(size_t c);
+	void locate(size_t index, size_t &c, size_t &offset) const;
+	void update_starts(size_t c);
+	void invalidate_indexes(size_t index);
+	void split_chunk(size_t c);
+	void insert_chunks(size_t c, std::vector<std::shared_ptr<Chunk>> &&chunks);
+	void erase_chunk(size_t c);
+	void insert_commands(size_t index, const Command *first, size_t n);
+	void erase_commands(size_t index, size_t n);
+	const Chunk_Labels &chunk_labels(size_t c) const;
+	void index_chunk(size_t c) const;
+	void unindex_chunk(size_t c) const;
+	void update_index(void) const;
+	size_t find_label_index(Label label) const;
+public:
+	class Iterator {
+		friend class Command_List;
+	public:
+		typedef std::random_access_iterator_tag iterator_category;
+		typedef Command value_type;
+		typedef ptrdiff_t difference_type;
+		typedef const Command *pointer;
+		typedef const Command &reference;
+	private:
+		const Command_List *_list = nullptr;
+		size_t _chunk = 0;
+		size_t _offset = 0;
+		Iterator(const Command_List *list, size_t c, size_t offset) : _list(list), _chunk(c), _offset(offset) {}
+		inline size_t index(void) const { return _list->_starts[_chunk] + _offset; }
+		inline size_t chunk_size(void) const { return _list->chunk(_chunk).size(); }
+	public:
+		Iterator() = default;
+		inline reference operator*() const { return _list->chunk(_chunk)[_offset]; }
+		inline pointer operator->() const { return &**this; }
+		inline reference operator[](difference_type n) const { return *(*this + n); }
+		inline Iterator &operator++() {
+			if (++_offset == chunk_size()) { ++_chunk; _offset = 0; }
+			return *this;
+		}
+		inline Iterator &operator--() {
+			if (_offset == 0) { --_chunk; _offset = chunk_size() - 1; }
+			else { --_offset; }
+			return *this;
+		}
+		inline Iterator operator++(int) { Iterator itr = *this; ++*this; return itr; }
+		inline Iterator operator--(int) { Iterator itr = *this; --*this; return itr; }
+		inline Iterator &operator+=(difference_type n) {
+			if (n >= -(difference_type)_offset && _chunk < _list->_chunks.size() && n < (difference_type)(chunk_size() - _offset)) {
+				_offset += n;
+			}
+			else {
+				_list->locate(index() + n, _chunk, _offset);
+			}
+			return *this;
+		}
+		inline Iterator &operator-=(difference_type n) { return *this += -n; }
+		inline Iterator operator+(difference_type n) const { Iterator itr = *this; return itr += n; }
+		inline Iterator operator-(difference_type n) const { Iterator itr = *this; return itr += -n; }
+		friend inline Iterator operator+(difference_type n, const Iterator &itr) { return itr + n; }
+		inline difference_type operator-(const Iterator &itr) const { return (difference_type)index() - (difference_type)itr.index(); }
+		inline bool operator==(const Iterator &itr) const { return _chunk == itr._chunk && _offset == itr._offset; }
+		inline bool operator!=(const Iterator &itr) const { return !(*this == itr); }
+		inline bool operator<(const Iterator &itr) const { return _chunk < itr._chunk || (_chunk == itr._chunk && _offset < itr._offset); }
+		inline bool operator>(const Iterator &itr) const { return itr < *this; }
+		inline bool operator<=(const Iterator &itr) const { return !(itr < *this); }
+		inline bool operator>=(const Iterator &itr) const { return !(*this < itr); }
+	};
+	typedef Iterator iterator;
+	typedef Iterator const_iterator;
+	typedef std::reverse_iterator<iterator> reverse_iterator;
+	typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+	typedef Command value_type;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+	typedef const Command &reference;
+	typedef const Command &const_reference;
+
+	Command_List() = default;
+	// copies share the chunks but not the index, which is only rebuilt if queried
+	Command_List(const Command_List &other) : _chunks(other._chunks), _starts(other._starts),
+		_chunk_labels(other._chunk_labels), _indexed(other._chunks.size(), false), _unindexed(other._chunks.size()) {}
+	Command_List(Command_List &&other) noexcept { *this = std::move(other); }
+	Command_List &operator=(const Command_List &other);
+	Command_List &operator=(Command_List &&other) noexcept;
+	template<typename I, typename = typename std::iterator_traits<I>::iterator_category>
+	Command_List(I first, I last) { insert(end(), first, last); }
+	Command_List(std::initializer_list<Command> commands) { insert_commands(0, commands.begin(), commands.size()); }
+
+	inline size_t size(void) const { return _starts.back(); }
+	inline bool empty(void) const { return size() == 0; }
+
+	inline const_iterator begin(void) const { return const_iterator(this, 0, 0); }
+	inline const_iterator end(void) const { return const_iterator(this, _chunks.size(), 0); }
+	inline const_iterator cbegin(void) const { return begin(); }
+	inline const_iterator cend(void) const { return end(); }
+	inline const_reverse_iterator rbegin(void) const { return const_reverse_iterator(end()); }
+	inline const_reverse_iterator rend(void) const { return const_reverse_iterator(begin()); }
+
+	const Command &operator[](size_t i) const;
+	inline const Command &front(void) const { return chunk(0).front(); }
+	inline const Command &back(void) const { return chunk(_chunks.size() - 1).back(); }
+	// the only way to change a command in place
+	Command &modify(size_t i);
+	inline Command &modify(const_iterator pos) { return writable_chunk(pos._chunk)[pos._offset]; }
+
+	void clear(void);
+	void resize(size_t n);
+	void push_back(const Command &command);
+	inline void pop_back(void) { erase_commands(size() - 1, 1); }
+	iterator insert(const_iterator pos, const Command &command) { return insert(pos, 1, command); }
+	iterator insert(const_iterator pos, size_t n, const Command &command);
+	template<typename I, typename = typename std::iterator_traits<I>::iterator_category>
+	iterator insert(const_iterator pos, I first, I last) {
+		size_t index = pos.index();
+		// copied out first, since the range may be part of this list
+		std::vector<Command> commands(first, last);
+		insert_commands(index, commands.data(), commands.size());
+		return begin() + index;
+	}
+	iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+	iterator erase(const_iterator first, const_iterator last);
+
+	// how many leading or trailing commands two lists have in common,
+	// skipping over the chunks they share without comparing them
+	size_t common_prefix(const Command_List &other) const;
+	size_t common_suffix(const Command_List &other, size_t limit) const;
+
+	// the first command with a label, or end() if there is none
+	const_iterator find_label(Label label) const;
+	// how many jumps, loops and calls target a label
+	size_t count_references(Label label) const;
+	// the last label without a '.' on or before a command
+	Label find_scope(size_t index) const;
+
+	// the view of a command's first note or rest that ends on or after
+	// min_tick, or false, leaving view as it was, if it never plays then
+	inline bool find_note_view(int32_t index, int32_t min_tick, Note_View &view) const { return _tick_index.find_note_view(*this, index, min_tick, view); }
+	// the note or rest playing at a tick, looping past the end of the
+	// song, or nullptr if the channel stops before it
+	inline const Note_View *find_note_at_tick(int32_t tick, int32_t *tick_offset = nullptr) const { return _tick_index.find_note_at_tick(*this, tick, tick_offset); }
+	// the notes, rests, loop ends and returns in the order they play, until
+	// the song first ends or jumps back
+	inline Tick_Index::Events first_pass(void) const { return _tick_index.first_pass(*this); }
+	// where the channel first ends, for calc_channel_length
+	Length_Index &length_index(void) const;
+};
+
+#endif
@@ -3,6 +3,9 @@
 
 #include <vector>
 #include <string>
+#include <type_traits>
+
+#include "label.h"
 
 enum class Pitch {
 	REST,
@@ -87,7 +90,7 @@ enum class Command_Type {
 	FADE_WAVE,
 };
 
-static const char * const COMMAND_NAMES[] = {
+static constexpr const char *COMMAND_NAMES[] = {
 	"note",
 	"drum_note",
 	"rest",
@@ -317,10 +320,12 @@ struct Command {
 	};
 
 	Command_Type type;
-	std::vector<std::string> labels;
-	std::string target;
+	Label_List labels;
+	Label target;
+	// the largest member is the one initialized, so no payload bytes are left
+	// indeterminate and equal commands are equal byte for byte
 	union {
-		Note note = {};
+		Note note;
 		Drum_Note drum_note;
 		Rest rest;
 		Octave octave;
@@ -331,7 +336,7 @@ struct Command {
 		Duty_Cycle duty_cycle;
 		Volume_Envelope volume_envelope;
 		Pitch_Sweep pitch_sweep;
-		Duty_Cycle_Pattern duty_cycle_pattern;
+		Duty_Cycle_Pattern duty_cycle_pattern = {};
 		Pitch_Slide pitch_slide;
 		Vibrato vibrato;
 		Toggle_Noise toggle_noise;
@@ -362,6 +367,9 @@ struct Command {
 	}
 };
 
+static_assert(std::is_trivially_copyable<Command>::value, "commands are copied wholesale by undo and the clipboard");
+static_assert(sizeof(Command) == sizeof(Command_Type) + sizeof(Label_List) + sizeof(Label) + sizeof(Command::Duty_Cycle_Pattern), "commands must have no padding");
+
 struct Note_View {
 	int32_t length = 0;
 	Pitch pitch = Pitch::REST;
@@ -320,15 +320,17 @@ void Drumkit_Window::refresh() {
 }
 
 void Drumkit_Window::start_audio_thread() {
-	_audio_kill_signal = std::promise<void>();
-	std::future<void> kill_future = _audio_kill_signal.get_future();
-	_audio_thread = std::thread(&playback_thread, this, std::move(kill_future));
+	_audio_signal.reset();
+	if (_mod) {
+		_mod->render_signal(&_audio_signal);
+	}
+	_audio_thread = std::thread(&playback_thread, this);
 }
 
 void Drumkit_Window::stop_audio_thread() {
 	if (_audio_thread.joinable()) {
 		_audio_mutex.lock();
-		_audio_kill_signal.set_value();
+		_audio_signal.stop();
 		_audio_thread.join();
 		_audio_mutex.unlock();
 	}
@@ -474,7 +476,7 @@ void Drumkit_Window::regenerate_mod() {
 		Drumkit drumkit = {};
 		drumkit.drums[(size_t)_playing_drum] = _selected_drum ? _selected_drum - 1 : 0;
 
-		_drum_samples = generate_noise_samples(_drumkits.drums, drumkit.drums[(size_t)_playing_drum], true);
+		_drum_samples = Drum_Samples(_drumkits.drums, drumkit.drums[(size_t)_playing_drum], true);
 		_mod->regenerate_it_module({}, { drumkit }, _drum_samples, _playing_drumkit - 1, true);
 		_mod->start();
 		_audio_mutex.unlock();
@@ -810,7 +812,7 @@ void Drumkit_Window::play_drumkit_drum_cb(Fl_Widget *w, Drumkit_Window *dw) {
 	dw->_playing_drumkit = dw->_selected_drumkit;
 	dw->_mod_channel = -1;
 
-	dw->_drum_samples = generate_noise_samples(dw->_drumkits.drums, dw->_drumkits.drumkits[dw->_selected_drumkit-1].drums[(size_t)pitch]);
+	dw->_drum_samples = Drum_Samples(dw->_drumkits.drums, dw->_drumkits.drumkits[dw->_selected_drumkit-1].drums[(size_t)pitch]);
 	dw->_mod = new IT_Module({}, dw->_drumkits.drumkits, dw->_drum_samples, dw->_selected_drumkit - 1);
 	dw->_mod->start();
 
@@ -1079,7 +1081,7 @@ void Drumkit_Window::play_drum_cb(Fl_Widget *, Drumkit_Window *dw) {
 		Drumkit drumkit = {};
 		drumkit.drums[(size_t)dw->_playing_drum] = dw->_selected_drum ? dw->_selected_drum - 1 : 0;
 
-		dw->_drum_samples = generate_noise_samples(dw->_drumkits.drums, drumkit.drums[(size_t)dw->_playing_drum], true);
+		dw->_drum_samples = Drum_Samples(dw->_drumkits.drums, drumkit.drums[(size_t)dw->_playing_drum], true);
 		dw->_mod = new IT_Module({}, { drumkit }, dw->_drum_samples, dw->_playing_drumkit - 1, true);
 		dw->_mod->start();
 
@@ -1087,12 +1089,12 @@ void Drumkit_Window::play_drum_cb(Fl_Widget *, Drumkit_Window *dw) {
 	}
 }
 
-void Drumkit_Window::playback_thread(Drumkit_Window *dw, std::future<void> kill_signal) {
+void Drumkit_Window::playback_thread(Drumkit_Window *dw) {
 	Pitch pitch = Pitch::REST;
 	int instrument = 0;
 
 	int error_count = 0;
-	while (kill_signal.wait_for(std::chrono::milliseconds(8)) == std::future_status::timeout) {
+	while (dw->_audio_signal.wait(Playback_Module::fill_interval())) {
 		if (dw->_audio_mutex.try_lock()) {
 			IT_Module *mod = dw->_mod;
 			if (mod && mod->playing()) {
@@ -2,7 +2,8 @@
 #define DRUMKIT_WINDOW_H
 
 #include <array>
-#include <future>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #pragma warning(push, 0)
@@ -104,14 +105,14 @@ private:
 	int _selected_drumkit = 0;
 	int _selected_drum = 0;
 
-	std::vector<std::vector<uint8_t>> _drum_samples;
+	Drum_Samples _drum_samples;
 	Pitch _playing_drum = Pitch::REST;
 	int _playing_drumkit = 0;
 	IT_Module *_mod = nullptr;
 	int32_t _mod_channel = -1;
 	std::thread _audio_thread;
 	std::mutex _audio_mutex;
-	std::promise<void> _audio_kill_signal;
+	Render_Signal _audio_signal;
 public:
 	Drumkit_Window(int x, int y);
 	~Drumkit_Window();
@@ -153,7 +154,7 @@ private:
 	static void remove_note_cb(Fl_Widget *w, Drumkit_Window *dw);
 	static void play_drum_cb(Fl_Widget *w, Drumkit_Window *dw);
 
-	static void playback_thread(Drumkit_Window *dw, std::future<void> kill_signal);
+	static void playback_thread(Drumkit_Window *dw);
 };
 
 #endif
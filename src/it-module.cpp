@@ -7,20 +7,16 @@
 IT_Module::IT_Module(
 	const std::vector<Wave> &waves,
 	const std::vector<Drumkit> &drumkits,
-	const std::vector<std::vector<uint8_t>> &drums,
+	const Drum_Samples &drums,
 	int32_t drumkit,
 	bool loop_drums
 ) {
-	generate_it_module({}, {}, {}, {}, waves, drumkits, drums, drumkit, loop_drums);
+	generate_it_module(_song, {}, {}, {}, {}, waves, drumkits, drums, drumkit, loop_drums);
 
-	_mod = new openmpt::module_ext(_data);
+	_mod = new openmpt::module_ext(_song.data);
 	_mod->set_repeat_count(-1);
 
-	_is_interleaved = false;
-	if (!try_open()) {
-		_is_interleaved = true;
-		try_open();
-	}
+	open_stream(INTERACTIVE_RING_BUFFERS);
 }
 
 IT_Module::IT_Module(
@@ -30,22 +26,18 @@ IT_Module::IT_Module(
 	const std::vector<Note_View> &channel_4_notes,
 	const std::vector<Wave> &waves,
 	const std::vector<Drumkit> &drumkits,
-	const std::vector<std::vector<uint8_t>> &drums,
+	const Drum_Samples &drums,
 	int32_t loop_tick,
 	bool stereo
 ) {
-	generate_it_module(channel_1_notes, channel_2_notes, channel_3_notes, channel_4_notes, waves, drumkits, drums, -1, false, loop_tick, stereo);
+	generate_it_module(_song, channel_1_notes, channel_2_notes, channel_3_notes, channel_4_notes, waves, drumkits, drums, -1, false, loop_tick, stereo);
 
-	_mod = new openmpt::module_ext(_data);
+	_mod = new openmpt::module_ext(_song.data);
 	if (loop_tick != -1) {
 		_mod->set_repeat_count(-1);
 	}
 
-	_is_interleaved = false;
-	if (!try_open()) {
-		_is_interleaved = true;
-		try_open();
-	}
+	open_stream();
 }
 
 IT_Module::~IT_Module() noexcept {
@@ -53,12 +45,13 @@ IT_Module::~IT_Module() noexcept {
 		delete _mod;
 		_mod = nullptr;
 	}
+	delete _next_mod.exchange(nullptr);
 }
 
 void IT_Module::regenerate_it_module(
 	const std::vector<Wave> &waves,
 	const std::vector<Drumkit> &drumkits,
-	const std::vector<std::vector<uint8_t>> &drums,
+	const Drum_Samples &drums,
 	int32_t drumkit,
 	bool loop_drums
 ) {
@@ -66,58 +59,121 @@ void IT_Module::regenerate_it_module(
 		delete _mod;
 		_mod = nullptr;
 	}
-	_data.clear();
-	_tempo_change_wrong_channel = -1;
-	_tempo_change_mid_note = -1;
-	_too_many_drums = false;
+	delete _next_mod.exchange(nullptr);
+	_hot_swap_song.reset();
 	_current_pattern = 0;
 	_current_row = 0;
 
-	generate_it_module({}, {}, {}, {}, waves, drumkits, drums, drumkit, loop_drums);
+	generate_it_module(_song, {}, {}, {}, {}, waves, drumkits, drums, drumkit, loop_drums);
 
-	_mod = new openmpt::module_ext(_data);
+	_mod = new openmpt::module_ext(_song.data);
 	_mod->set_repeat_count(-1);
 }
 
+void IT_Module::regenerate_it_module(
+	const std::vector<Note_View> &channel_1_notes,
+	const std::vector<Note_View> &channel_2_notes,
+	const std::vector<Note_View> &channel_3_notes,
+	const std::vector<Note_View> &channel_4_notes,
+	const std::vector<Wave> &waves,
+	const std::vector<Drumkit> &drumkits,
+	const Drum_Samples &drums,
+	int32_t loop_tick,
+	bool stereo
+) {
+	if (_mod) {
+		delete _mod;
+		_mod = nullptr;
+	}
+	delete _next_mod.exchange(nullptr);
+	_hot_swap_song.reset();
+	_current_pattern = 0;
+	_current_row = 0;
+
+	generate_it_module(_song, channel_1_notes, channel_2_notes, channel_3_notes, channel_4_notes, waves, drumkits, drums, -1, false, loop_tick, stereo);
+
+	_mod = new openmpt::module_ext(_song.data);
+	if (loop_tick != -1) {
+		_mod->set_repeat_count(-1);
+	}
+}
+
+void IT_Module::prepare_hot_swap(
+	const std::vector<Note_View> &channel_1_notes,
+	const std::vector<Note_View> &channel_2_notes,
+	const std::vector<Note_View> &channel_3_notes,
+	const std::vector<Note_View> &channel_4_notes,
+	const std::vector<Wave> &waves,
+	const std::vector<Drumkit> &drumkits,
+	const Drum_Samples &drums,
+	int32_t loop_tick,
+	bool stereo
+) {
+	// encoded apart from the song playing, starting from the caches of the
+	// last one encoded; only one hot swap is prepared at a time
+	if (!_hot_swap_song) {
+		_hot_swap_song.reset(new Encoded_Song(_song));
+	}
+	generate_it_module(*_hot_swap_song, channel_1_notes, channel_2_notes, channel_3_notes, channel_4_notes, waves, drumkits, drums, -1, false, loop_tick, stereo);
+
+	openmpt::module_ext *mod = new openmpt::module_ext(_hot_swap_song->data);
+	if (loop_tick != -1) {
+		mod->set_repeat_count(-1);
+	}
+	// replaces any song that has not been swapped in yet
+	delete _next_mod.exchange(mod);
+}
+
+void IT_Module::hot_swap() {
+	openmpt::module_ext *mod = _next_mod.exchange(nullptr);
+	if (!mod) return;
+
+	mod->set_position_order_row(_mod->get_current_order(), _mod->get_current_row());
+	openmpt::ext::interactive *interactive = static_cast<openmpt::ext::interactive *>(mod->get_interface(openmpt::ext::interactive_id));
+	std::lock_guard<std::mutex> lock(_mod_mutex);
+	for (int32_t i = 0; i < (int32_t)_muted.size() && i < mod->get_num_channels(); ++i) {
+		interactive->set_channel_mute_status(i, _muted[i]);
+	}
+	delete _mod;
+	_mod = mod;
+}
+
 bool IT_Module::export_file(const char *f) {
 	std::ofstream ofs;
 	open_ofstream(ofs, f);
 	if (!ofs.good()) return false;
 
-	ofs.write((char *)&_data[0], _data.size());
+	ofs.write((char *)&_song.data[0], _song.data.size());
 	ofs.close();
 
 	return true;
 }
 
-bool IT_Module::play() {
-	if (!ready() || !playing()) return true;
-
-	std::size_t count = _is_interleaved ?
-		_mod->read_interleaved_stereo(SAMPLE_RATE, BUFFER_SIZE, _buffer.data()) :
-		_mod->read(SAMPLE_RATE, BUFFER_SIZE, _buffer.data(), _buffer.data() + BUFFER_SIZE);
+std::size_t IT_Module::render_block(float *frames, std::size_t count) {
+	count = _mod->read_interleaved_stereo(SAMPLE_RATE, count, frames);
+	if (count > 0 && _mod->get_current_pattern() != _current_pattern) {
+		hot_swap();
+	}
 	_current_pattern = _mod->get_current_pattern();
 	_current_row = _mod->get_current_row();
+	return count;
+}
 
-	if (count == 0) {
-		stop();
-		return true;
-	}
-	try {
-		if (_is_interleaved) {
-			_stream.write(_buffer.data(), static_cast<unsigned long>(count));
-		}
-		else {
-			const float * const buffers[2] = { _buffer.data(), _buffer.data() + BUFFER_SIZE };
-			_stream.write(buffers, static_cast<unsigned long>(count));
-		}
-		return true;
-	}
-	catch (...) {}
-	return false;
+std::string IT_Module::get_warnings() {
+	std::lock_guard<std::mutex> lock(_mod_mutex);
+	return _mod->get_metadata("warnings");
+}
+
+bool IT_Module::looping() {
+	std::lock_guard<std::mutex> lock(_mod_mutex);
+	return _mod->get_repeat_count() == -1;
 }
 
 void IT_Module::mute_channel(int32_t channel, bool mute) {
+	std::lock_guard<std::mutex> lock(_mod_mutex);
+	if (channel >= 1 && channel <= (int32_t)_muted.size()) {
+		_muted[channel - 1] = mute;
+	}
 	if (channel - 1 < _mod->get_num_channels()) {
 		openmpt::ext::interactive *interactive = static_cast<openmpt::ext::interactive *>(_mod->get_interface(openmpt::ext::interactive_id));
 		interactive->set_channel_mute_status(channel - 1, mute);
@@ -139,52 +195,32 @@ int32_t IT_Module::play_note(Pitch pitch, int32_t octave, int channel, int32_t d
 		instrument = 4 + 16 + (int32_t)pitch;
 	}
 	int32_t note = channel != 4 ? octave * NUM_PITCHES + (int32_t)pitch - 1 : 60;
+	std::lock_guard<std::mutex> lock(_mod_mutex);
 	openmpt::ext::interactive *interactive = static_cast<openmpt::ext::interactive *>(_mod->get_interface(openmpt::ext::interactive_id));
 	return interactive->play_note(instrument, note, 1.0, 0.0);
 }
 
 void IT_Module::stop_note(int32_t mod_channel) {
+	std::lock_guard<std::mutex> lock(_mod_mutex);
 	openmpt::ext::interactive *interactive = static_cast<openmpt::ext::interactive *>(_mod->get_interface(openmpt::ext::interactive_id));
 	interactive->stop_note(mod_channel);
 }
 
 void IT_Module::set_tick(int32_t tick) {
+	std::lock_guard<std::mutex> lock(_mod_mutex);
 	_mod->set_position_order_row(tick / ROWS_PER_PATTERN, tick % ROWS_PER_PATTERN);
 }
 
 double IT_Module::get_position_seconds() {
+	std::lock_guard<std::mutex> lock(_mod_mutex);
 	return _mod->get_position_seconds();
 }
 
 double IT_Module::get_duration_seconds() {
+	std::lock_guard<std::mutex> lock(_mod_mutex);
 	return _mod->get_duration_seconds();
 }
 
-bool IT_Module::try_open() {
-	try {
-		portaudio::System &portaudio = portaudio::System::instance();
-		portaudio::DirectionSpecificStreamParameters outputstream_parameters(
-			portaudio.defaultOutputDevice(),
-			2,
-			portaudio::FLOAT32,
-			_is_interleaved,
-			portaudio.defaultOutputDevice().defaultHighOutputLatency(),
-			0
-		);
-		portaudio::StreamParameters stream_parameters(
-			portaudio::DirectionSpecificStreamParameters::null(),
-			outputstream_parameters,
-			SAMPLE_RATE,
-			paFramesPerBufferUnspecified,
-			paNoFlag
-		);
-		_stream.open(stream_parameters);
-		return true;
-	}
-	catch (...) {}
-	return false;
-}
-
 static inline void put_int(std::vector<uint8_t> &data, const uint32_t v) {
 	data.push_back(v >>  0);
 	data.push_back(v >>  8);
@@ -204,6 +240,48 @@ static inline void patch_int(std::vector<uint8_t> &data, const uint32_t i, const
 	data[i + 3] = (v >> 24);
 }
 
+static constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+
+// FNV-1a a word at a time, since this runs over every note in the song
+static inline void hash_int(uint64_t &h, const int64_t v) {
+	h = (h ^ (uint64_t)v) * 1099511628211ull;
+}
+
+// every property a pattern is encoded from, which excludes the index
+static void hash_note(uint64_t &h, const Note_View &view) {
+	hash_int(h, view.length);
+	hash_int(h, (int64_t)view.pitch);
+	hash_int(h, view.octave);
+	hash_int(h, view.speed);
+	hash_int(h, view.volume);
+	hash_int(h, view.fade);
+	hash_int(h, view.drumkit);
+	hash_int(h, view.tempo);
+	hash_int(h, view.duty);
+	hash_int(h, view.vibrato_delay);
+	hash_int(h, view.vibrato_extent);
+	hash_int(h, view.vibrato_rate);
+	hash_int(h, view.transpose_octaves);
+	hash_int(h, view.transpose_pitches);
+	hash_int(h, view.slide_duration);
+	hash_int(h, view.slide_octave);
+	hash_int(h, (int64_t)view.slide_pitch);
+	hash_int(h, view.panning_left);
+	hash_int(h, view.panning_right);
+}
+
+bool IT_Module::Pattern_State::operator==(const Pattern_State &other) const {
+	return
+		indices == other.indices &&
+		note_lengths == other.note_lengths &&
+		note_durations == other.note_durations &&
+		channel_tempos == other.channel_tempos &&
+		global_tempo == other.global_tempo &&
+		wave == other.wave &&
+		tempo_change_wrong_channel == other.tempo_change_wrong_channel &&
+		tempo_change_mid_note == other.tempo_change_mid_note;
+}
+
 std::vector<std::vector<uint8_t>> IT_Module::get_instruments() {
 	std::vector<std::vector<uint8_t>> instruments;
 	return instruments;
@@ -392,7 +470,8 @@ std::vector<std::vector<uint8_t>> IT_Module::get_samples(const std::vector<Wave>
 	return samples;
 }
 
-std::vector<std::vector<uint8_t>> IT_Module::get_patterns(
+void IT_Module::get_patterns(
+	Encoded_Song &song,
 	const std::vector<Note_View> &channel_1_notes,
 	const std::vector<Note_View> &channel_2_notes,
 	const std::vector<Note_View> &channel_3_notes,
@@ -434,8 +513,6 @@ std::vector<std::vector<uint8_t>> IT_Module::get_patterns(
 
 	const uint8_t FINELY = 0xf;
 
-	std::vector<std::vector<uint8_t>> patterns;
-
 	auto channel_1_itr = channel_1_notes.begin();
 	auto channel_2_itr = channel_2_notes.begin();
 	auto channel_3_itr = channel_3_notes.begin();
@@ -520,7 +597,100 @@ std::vector<std::vector<uint8_t>> IT_Module::get_patterns(
 		return 0x80;
 	};
 
+	const std::vector<Note_View> *channel_notes[4] = { &channel_1_notes, &channel_2_notes, &channel_3_notes, &channel_4_notes };
+
+	auto save_state = [&]() {
+		Pattern_State state;
+		state.indices = {
+			(std::size_t)(channel_1_itr - channel_1_notes.begin()),
+			(std::size_t)(channel_2_itr - channel_2_notes.begin()),
+			(std::size_t)(channel_3_itr - channel_3_notes.begin()),
+			(std::size_t)(channel_4_itr - channel_4_notes.begin()),
+		};
+		state.note_lengths = { channel_1_note_length, channel_2_note_length, channel_3_note_length, channel_4_note_length };
+		state.note_durations = { channel_1_note_duration, channel_2_note_duration, channel_3_note_duration };
+		state.channel_tempos = { channel_1_tempo, channel_2_tempo, channel_3_tempo, channel_4_tempo };
+		state.global_tempo = global_tempo;
+		state.wave = wave;
+		state.tempo_change_wrong_channel = song.tempo_change_wrong_channel;
+		state.tempo_change_mid_note = song.tempo_change_mid_note;
+		return state;
+	};
+
+	// each previous note is the one before its channel's index
+	auto load_state = [&](const Pattern_State &state) {
+		channel_1_itr = channel_1_notes.begin() + state.indices[0];
+		channel_2_itr = channel_2_notes.begin() + state.indices[1];
+		channel_3_itr = channel_3_notes.begin() + state.indices[2];
+		channel_4_itr = channel_4_notes.begin() + state.indices[3];
+		channel_1_prev_note = state.indices[0] ? channel_1_notes[state.indices[0] - 1] : Note_View();
+		channel_2_prev_note = state.indices[1] ? channel_2_notes[state.indices[1] - 1] : Note_View();
+		channel_3_prev_note = state.indices[2] ? channel_3_notes[state.indices[2] - 1] : Note_View();
+		channel_4_prev_note = state.indices[3] ? channel_4_notes[state.indices[3] - 1] : Note_View();
+		channel_1_note_length = state.note_lengths[0];
+		channel_2_note_length = state.note_lengths[1];
+		channel_3_note_length = state.note_lengths[2];
+		channel_4_note_length = state.note_lengths[3];
+		channel_1_note_duration = state.note_durations[0];
+		channel_2_note_duration = state.note_durations[1];
+		channel_3_note_duration = state.note_durations[2];
+		channel_1_tempo = state.channel_tempos[0];
+		channel_2_tempo = state.channel_tempos[1];
+		channel_3_tempo = state.channel_tempos[2];
+		channel_4_tempo = state.channel_tempos[3];
+		global_tempo = state.global_tempo;
+		wave = state.wave;
+		song.tempo_change_wrong_channel = state.tempo_change_wrong_channel;
+		song.tempo_change_mid_note = state.tempo_change_mid_note;
+	};
+
+	// hashes the notes read between two states, and whether each channel
+	// had run out of them; false if a channel has fewer notes than that now
+	auto hash_notes = [&](const Pattern_State &start, const Pattern_State &end, uint64_t &hash) {
+		uint64_t h = FNV_OFFSET_BASIS;
+		for (int32_t c = 0; c < 4; ++c) {
+			const std::vector<Note_View> &notes = *channel_notes[c];
+			if (end.indices[c] > notes.size()) {
+				return false;
+			}
+			for (std::size_t i = start.indices[c] ? start.indices[c] - 1 : 0; i < end.indices[c]; ++i) {
+				hash_note(h, notes[i]);
+			}
+			hash_int(h, end.indices[c] == notes.size());
+		}
+		hash = h;
+		return true;
+	};
+
+	// any change to these can change every pattern
+	uint64_t patterns_key = FNV_OFFSET_BASIS;
+	hash_int(patterns_key, loop_tick);
+	hash_int(patterns_key, stereo);
+	hash_int(patterns_key, num_inline_waves);
+	hash_int(patterns_key, first_channel);
+	for (const Drumkit &drumkit : drumkits) {
+		for (int32_t drum : drumkit.drums) {
+			hash_int(patterns_key, drum);
+		}
+	}
+	if (patterns_key != song.patterns_key) {
+		song.patterns.clear();
+		song.patterns_key = patterns_key;
+	}
+
+	std::size_t pattern_index = 0;
 	do {
+		const Pattern_State start = save_state();
+		if (pattern_index < song.patterns.size() && song.patterns[pattern_index].start == start) {
+			const Encoded_Pattern &encoded = song.patterns[pattern_index];
+			uint64_t hash = 0;
+			if (hash_notes(start, encoded.end, hash) && hash == encoded.hash) {
+				load_state(encoded.end);
+				pattern_index += 1;
+				continue;
+			}
+		}
+
 		std::vector<uint8_t> pattern;
 
 		std::vector<uint8_t> pattern_data;
@@ -565,15 +735,15 @@ std::vector<std::vector<uint8_t>> IT_Module::get_patterns(
 					pattern_data.push_back(TEMPO);
 					pattern_data.push_back(channel_1_tempo / 256);
 
-					if (_tempo_change_mid_note == -1) {
+					if (song.tempo_change_mid_note == -1) {
 						if (channel_2_note_length > 0) {
-							_tempo_change_mid_note = 2;
+							song.tempo_change_mid_note = 2;
 						}
 						else if (channel_3_note_length > 0) {
-							_tempo_change_mid_note = 3;
+							song.tempo_change_mid_note = 3;
 						}
 						else if (channel_4_note_length > 0) {
-							_tempo_change_mid_note = 4;
+							song.tempo_change_mid_note = 4;
 						}
 					}
 				}
@@ -663,17 +833,17 @@ std::vector<std::vector<uint8_t>> IT_Module::get_patterns(
 					pattern_data.push_back(channel_2_tempo / 256);
 
 					if (first_channel != 2) {
-						_tempo_change_wrong_channel = 2;
+						song.tempo_change_wrong_channel = 2;
 					}
-					if (_tempo_change_mid_note == -1) {
+					if (song.tempo_change_mid_note == -1) {
 						if (channel_1_note_length > 0) {
-							_tempo_change_mid_note = 1;
+							song.tempo_change_mid_note = 1;
 						}
 						else if (channel_3_note_length > 0) {
-							_tempo_change_mid_note = 3;
+							song.tempo_change_mid_note = 3;
 						}
 						else if (channel_4_note_length > 0) {
-							_tempo_change_mid_note = 4;
+							song.tempo_change_mid_note = 4;
 						}
 					}
 				}
@@ -766,17 +936,17 @@ std::vector<std::vector<uint8_t>> IT_Module::get_patterns(
 					pattern_data.push_back(channel_3_tempo / 256);
 
 					if (first_channel != 3) {
-						_tempo_change_wrong_channel = 3;
+						song.tempo_change_wrong_channel = 3;
 					}
-					if (_tempo_change_mid_note == -1) {
+					if (song.tempo_change_mid_note == -1) {
 						if (channel_1_note_length > 0) {
-							_tempo_change_mid_note = 1;
+							song.tempo_change_mid_note = 1;
 						}
 						else if (channel_2_note_length > 0) {
-							_tempo_change_mid_note = 2;
+							song.tempo_change_mid_note = 2;
 						}
 						else if (channel_4_note_length > 0) {
-							_tempo_change_mid_note = 4;
+							song.tempo_change_mid_note = 4;
 						}
 					}
 				}
@@ -842,17 +1012,17 @@ std::vector<std::vector<uint8_t>> IT_Module::get_patterns(
 					pattern_data.push_back(channel_4_tempo / 256);
 
 					if (first_channel != 4) {
-						_tempo_change_wrong_channel = 4;
+						song.tempo_change_wrong_channel = 4;
 					}
-					if (_tempo_change_mid_note == -1) {
+					if (song.tempo_change_mid_note == -1) {
 						if (channel_1_note_length > 0) {
-							_tempo_change_mid_note = 1;
+							song.tempo_change_mid_note = 1;
 						}
 						else if (channel_2_note_length > 0) {
-							_tempo_change_mid_note = 2;
+							song.tempo_change_mid_note = 2;
 						}
 						else if (channel_3_note_length > 0) {
-							_tempo_change_mid_note = 3;
+							song.tempo_change_mid_note = 3;
 						}
 					}
 				}
@@ -911,10 +1081,18 @@ std::vector<std::vector<uint8_t>> IT_Module::get_patterns(
 		put_short(pattern, 0); // unused
 		pattern.insert(pattern.end(), pattern_data.begin(), pattern_data.end());
 
-		patterns.push_back(std::move(pattern));
+		if (pattern_index >= song.patterns.size()) {
+			song.patterns.resize(pattern_index + 1);
+		}
+		Encoded_Pattern &encoded = song.patterns[pattern_index];
+		encoded.start = start;
+		encoded.end = save_state();
+		hash_notes(encoded.start, encoded.end, encoded.hash);
+		encoded.data = std::move(pattern);
+		pattern_index += 1;
 	} while (!song_finished());
 
-	return patterns;
+	song.patterns.resize(pattern_index);
 }
 
 static uint32_t get_total_size(const std::vector<std::vector<uint8_t>> &data) {
@@ -926,13 +1104,14 @@ static uint32_t get_total_size(const std::vector<std::vector<uint8_t>> &data) {
 }
 
 void IT_Module::generate_it_module(
+	Encoded_Song &song,
 	const std::vector<Note_View> &channel_1_notes,
 	const std::vector<Note_View> &channel_2_notes,
 	const std::vector<Note_View> &channel_3_notes,
 	const std::vector<Note_View> &channel_4_notes,
 	const std::vector<Wave> &waves,
 	const std::vector<Drumkit> &drumkits,
-	const std::vector<std::vector<uint8_t>> &drums,
+	const Drum_Samples &drums,
 	int32_t preserve_drumkit,
 	bool loop_drums,
 	int32_t loop_tick,
@@ -958,7 +1137,10 @@ void IT_Module::generate_it_module(
 
 	const uint32_t sample_header_size = 80;
 
-	_too_many_drums = false;
+	song.data.clear();
+	song.tempo_change_wrong_channel = -1;
+	song.tempo_change_mid_note = -1;
+	song.too_many_drums = false;
 	std::vector<Drumkit> optimized_drumkits = std::vector<Drumkit>(drumkits.size());
 	for (Drumkit &drumkit : optimized_drumkits) {
 		for (uint32_t i = 0; i < NUM_DRUMS_PER_DRUMKIT; ++i) {
@@ -975,7 +1157,7 @@ void IT_Module::generate_it_module(
 				optimized_drumkits[note.drumkit].drums[(int32_t)note.pitch] == -1
 			) {
 				if (optimized_drums.size() >= 64) {
-					_too_many_drums = true;
+					song.too_many_drums = true;
 					break;
 				}
 				int32_t drum_index = drumkits[note.drumkit].drums[(int32_t)note.pitch];
@@ -986,7 +1168,7 @@ void IT_Module::generate_it_module(
 						}
 					}
 				}
-				optimized_drums.push_back(&drums[drum_index]);
+				optimized_drums.push_back(&drums.sample(drum_index));
 			}
 		}
 	}
@@ -994,15 +1176,39 @@ void IT_Module::generate_it_module(
 		if (preserve_drumkit < (int32_t)drumkits.size()) {
 			for (uint32_t i = 0; i < NUM_DRUMS_PER_DRUMKIT; ++i) {
 				int32_t drum_index = drumkits[preserve_drumkit].drums[i];
-				optimized_drums.push_back(&drums[drum_index]);
+				optimized_drums.push_back(&drums.sample(drum_index));
 			}
 		}
 		optimized_drums.resize(NUM_DRUMS_PER_DRUMKIT);
 	}
 
 	std::vector<std::vector<uint8_t>> instruments = get_instruments();
-	std::vector<std::vector<uint8_t>> samples = get_samples(waves, optimized_drums, loop_drums);
-	std::vector<std::vector<uint8_t>> patterns = get_patterns(channel_1_notes, channel_2_notes, channel_3_notes, channel_4_notes, optimized_drumkits, loop_tick, stereo, (int32_t)waves.size() - 0x10);
+
+	// the samples only change with the waves and drums they are made from
+	uint64_t samples_key = FNV_OFFSET_BASIS;
+	for (const Wave &wave : waves) {
+		for (uint8_t sample : wave) {
+			hash_int(samples_key, sample);
+		}
+	}
+	hash_int(samples_key, waves.size());
+	hash_int(samples_key, drums.id());
+	for (const std::vector<uint8_t> *drum : optimized_drums) {
+		hash_int(samples_key, (int64_t)(intptr_t)drum);
+	}
+	hash_int(samples_key, loop_drums);
+	if (song.samples.empty() || samples_key != song.samples_key) {
+		song.samples = get_samples(waves, optimized_drums, loop_drums);
+		song.samples_key = samples_key;
+	}
+	std::vector<std::vector<uint8_t>> &samples = song.samples;
+
+	get_patterns(song, channel_1_notes, channel_2_notes, channel_3_notes, channel_4_notes, optimized_drumkits, loop_tick, stereo, (int32_t)waves.size() - 0x10);
+	const std::vector<Encoded_Pattern> &patterns = song.patterns;
+	uint32_t patterns_size = 0;
+	for (const Encoded_Pattern &pattern : patterns) {
+		patterns_size += (uint32_t)pattern.data.size();
+	}
 
 	const uint32_t number_of_orders = (uint32_t)patterns.size() + 1;
 	const uint32_t number_of_instruments = (uint32_t)instruments.size();
@@ -1017,70 +1223,70 @@ void IT_Module::generate_it_module(
 		number_of_patterns * 4;
 	const uint32_t samples_start = instruments_start + get_total_size(instruments);
 	const uint32_t patterns_start = samples_start + get_total_size(samples);
-	const uint32_t total_size = patterns_start + get_total_size(patterns);
+	const uint32_t total_size = patterns_start + patterns_size;
 
-	_data.reserve(total_size);
+	song.data.reserve(total_size);
 
 	// header, 192 bytes
 	{
-		_data.push_back('I');
-		_data.push_back('M');
-		_data.push_back('P');
-		_data.push_back('M');
+		song.data.push_back('I');
+		song.data.push_back('M');
+		song.data.push_back('P');
+		song.data.push_back('M');
 
 		for (uint32_t i = 0; i < song_name_length; ++i) {
-			_data.push_back('\0');
+			song.data.push_back('\0');
 		}
 
-		put_short(_data, pattern_row_highlight);
-		put_short(_data, number_of_orders);
-		put_short(_data, number_of_instruments);
-		put_short(_data, number_of_samples);
-		put_short(_data, number_of_patterns);
-		put_short(_data, tracker_version);
-		put_short(_data, compatible_version);
-		put_short(_data, flags);
-		put_short(_data, special);
-
-		_data.push_back(global_volume);
-		_data.push_back(mix_volume);
-		_data.push_back(initial_speed);
-		_data.push_back(initial_tempo);
-		_data.push_back(panning_separation);
-		_data.push_back(pitch_wheel_depth);
-
-		put_short(_data, 0); // message length
-		put_int(_data, 0); // message offset
-		put_int(_data, 0); // reserved
-
-		_data.push_back(default_channel_panning);
-		_data.push_back(default_channel_panning);
-		_data.push_back(default_channel_panning);
-		_data.push_back(default_channel_panning);
+		put_short(song.data, pattern_row_highlight);
+		put_short(song.data, number_of_orders);
+		put_short(song.data, number_of_instruments);
+		put_short(song.data, number_of_samples);
+		put_short(song.data, number_of_patterns);
+		put_short(song.data, tracker_version);
+		put_short(song.data, compatible_version);
+		put_short(song.data, flags);
+		put_short(song.data, special);
+
+		song.data.push_back(global_volume);
+		song.data.push_back(mix_volume);
+		song.data.push_back(initial_speed);
+		song.data.push_back(initial_tempo);
+		song.data.push_back(panning_separation);
+		song.data.push_back(pitch_wheel_depth);
+
+		put_short(song.data, 0); // message length
+		put_int(song.data, 0); // message offset
+		put_int(song.data, 0); // reserved
+
+		song.data.push_back(default_channel_panning);
+		song.data.push_back(default_channel_panning);
+		song.data.push_back(default_channel_panning);
+		song.data.push_back(default_channel_panning);
 		for (uint32_t i = 0; i < max_num_channels - 4; ++i) {
-			_data.push_back(default_channel_panning | channel_disabled);
+			song.data.push_back(default_channel_panning | channel_disabled);
 		}
 		for (uint32_t i = 0; i < max_num_channels; ++i) {
-			_data.push_back(default_channel_volume);
+			song.data.push_back(default_channel_volume);
 		}
 	}
 
 	// orders
 	for (uint32_t i = 0; i < number_of_orders - 1; ++i) {
-		_data.push_back(i);
+		song.data.push_back(i);
 	}
-	_data.push_back(0xff);
+	song.data.push_back(0xff);
 
 	// instrument offsets
 	uint32_t instrument_offset = instruments_start;
 	for (const auto &instrument : instruments) {
-		put_int(_data, instrument_offset);
+		put_int(song.data, instrument_offset);
 		instrument_offset += (uint32_t)instrument.size();
 	}
 	// sample offsets
 	uint32_t sample_offset = samples_start;
 	for (auto &sample : samples) {
-		put_int(_data, sample_offset);
+		put_int(song.data, sample_offset);
 
 		// fix inner sample offset
 		patch_int(sample, 72, sample_offset + sample_header_size);
@@ -1090,112 +1296,125 @@ void IT_Module::generate_it_module(
 	// pattern offsets
 	uint32_t pattern_offset = patterns_start;
 	for (const auto &pattern : patterns) {
-		put_int(_data, pattern_offset);
-		pattern_offset += (uint32_t)pattern.size();
+		put_int(song.data, pattern_offset);
+		pattern_offset += (uint32_t)pattern.data.size();
 	}
 
 	// instruments
 	for (const auto &instrument : instruments) {
-		_data.insert(_data.end(), instrument.begin(), instrument.end());
+		song.data.insert(song.data.end(), instrument.begin(), instrument.end());
 	}
 	// samples
 	for (const auto &sample : samples) {
-		_data.insert(_data.end(), sample.begin(), sample.end());
+		song.data.insert(song.data.end(), sample.begin(), sample.end());
 	}
 	// patterns
 	for (const auto &pattern : patterns) {
-		_data.insert(_data.end(), pattern.begin(), pattern.end());
+		song.data.insert(song.data.end(), pattern.data.begin(), pattern.data.end());
 	}
 
 	// extensions
 	{
-		_data.push_back('S');
-		_data.push_back('T');
-		_data.push_back('P');
-		_data.push_back('M');
+		song.data.push_back('S');
+		song.data.push_back('T');
+		song.data.push_back('P');
+		song.data.push_back('M');
 
 		// compatibility flags, defaults unless noted
 		{
-			_data.push_back('.');
-			_data.push_back('F');
-			_data.push_back('S');
-			_data.push_back('M');
-
-			put_short(_data, 15);
-
-			_data.push_back(0xc1); // bit 6: fine tone portamento
-			_data.push_back(0xfe); // bit 0: tempo clamp off
-			_data.push_back(0xff);
-			_data.push_back(0xff);
-			_data.push_back(0xff);
-			_data.push_back(0xff);
-			_data.push_back(0x05);
-			_data.push_back(0x00);
-			_data.push_back(0x00);
-			_data.push_back(0x00);
-			_data.push_back(0x80);
-			_data.push_back(0x01);
-			_data.push_back(0xd0);
-			_data.push_back(0x01);
-			_data.push_back(0x08);
+			song.data.push_back('.');
+			song.data.push_back('F');
+			song.data.push_back('S');
+			song.data.push_back('M');
+
+			put_short(song.data, 15);
+
+			song.data.push_back(0xc1); // bit 6: fine tone portamento
+			song.data.push_back(0xfe); // bit 0: tempo clamp off
+			song.data.push_back(0xff);
+			song.data.push_back(0xff);
+			song.data.push_back(0xff);
+			song.data.push_back(0xff);
+			song.data.push_back(0x05);
+			song.data.push_back(0x00);
+			song.data.push_back(0x00);
+			song.data.push_back(0x00);
+			song.data.push_back(0x80);
+			song.data.push_back(0x01);
+			song.data.push_back(0xd0);
+			song.data.push_back(0x01);
+			song.data.push_back(0x08);
 		}
 	}
 }
 
-std::vector<std::vector<uint8_t>> generate_noise_samples(const std::vector<Drum> &drums, int32_t only, bool pad) {
-	std::vector<std::vector<uint8_t>> samples;
-	for (const Drum &drum : drums) {
-		std::vector<uint8_t> sample;
-		if (only == -1 || only == samples.size()) {
-			bool needs_pad = true;
-			for (uint32_t i = 0; i < drum.noise_notes.size(); ++i) {
-				const Noise_Note &note = drum.noise_notes[i];
-				bool last = i == drum.noise_notes.size() - 1;
-
-				uint32_t sample_len = note.length * 48 * NOISE_SAMPLE_SPEED_FACTOR;
-				uint32_t lfsr_period = std::max(
-					(uint32_t)(((note.clock_divider == 0 ? 0.5f : note.clock_divider) * (1 << note.clock_shift)) * (32768.0f * NOISE_SAMPLE_SPEED_FACTOR / 262144.0f)),
-					(uint32_t)1
-				);
-				uint32_t envelope_period = note.sweep_pace * 512 * NOISE_SAMPLE_SPEED_FACTOR;
-
-				uint16_t lfsr = 0;
-				int32_t volume = note.volume;
-
-				uint32_t j = 0;
-				while (
-					j < sample_len ||
-					(last && volume != 0 && j < 255 * 48 * NOISE_SAMPLE_SPEED_FACTOR * 8)
-				) {
-					if (j % lfsr_period == 0) {
-						uint16_t xnor = (~(((lfsr >> 1) & 1) ^ (lfsr & 1))) & 1;
-						if (note.lfsr_width) {
-							lfsr = ((lfsr & 0b0111111101111111) | (xnor << 15) | (xnor << 7)) >> 1;
-						}
-						else {
-							lfsr = ((lfsr & 0b0111111111111111) | (xnor << 15)) >> 1;
-						}
-					}
-					if (envelope_period && j % envelope_period == 0) {
-						if (note.envelope_direction == 0 && volume != 0) {
-							volume -= 1;
-						}
-						else if (note.envelope_direction == 1 && volume != 15) {
-							volume += 1;
-						}
-					}
-					sample.push_back((lfsr & 1) ? (volume * 255 / 15 / 2) : 0);
-					j += 1;
+static std::vector<uint8_t> generate_noise_sample(const Drum &drum, bool pad) {
+	std::vector<uint8_t> sample;
+	bool needs_pad = true;
+	for (uint32_t i = 0; i < drum.noise_notes.size(); ++i) {
+		const Noise_Note &note = drum.noise_notes[i];
+		bool last = i == drum.noise_notes.size() - 1;
+
+		uint32_t sample_len = note.length * 48 * NOISE_SAMPLE_SPEED_FACTOR;
+		uint32_t lfsr_period = std::max(
+			(uint32_t)(((note.clock_divider == 0 ? 0.5f : note.clock_divider) * (1 << note.clock_shift)) * (32768.0f * NOISE_SAMPLE_SPEED_FACTOR / 262144.0f)),
+			(uint32_t)1
+		);
+		uint32_t envelope_period = note.sweep_pace * 512 * NOISE_SAMPLE_SPEED_FACTOR;
+
+		uint16_t lfsr = 0;
+		int32_t volume = note.volume;
+
+		uint32_t j = 0;
+		while (
+			j < sample_len ||
+			(last && volume != 0 && j < 255 * 48 * NOISE_SAMPLE_SPEED_FACTOR * 8)
+		) {
+			if (j % lfsr_period == 0) {
+				uint16_t xnor = (~(((lfsr >> 1) & 1) ^ (lfsr & 1))) & 1;
+				if (note.lfsr_width) {
+					lfsr = ((lfsr & 0b0111111101111111) | (xnor << 15) | (xnor << 7)) >> 1;
+				}
+				else {
+					lfsr = ((lfsr & 0b0111111111111111) | (xnor << 15)) >> 1;
 				}
-				if (j >= 255 * 48 * NOISE_SAMPLE_SPEED_FACTOR * 8) needs_pad = false;
 			}
-			if (pad && needs_pad) {
-				for (uint32_t i = 0; i < 255 * 48 * NOISE_SAMPLE_SPEED_FACTOR; ++i) {
-					sample.push_back(0);
+			if (envelope_period && j % envelope_period == 0) {
+				if (note.envelope_direction == 0 && volume != 0) {
+					volume -= 1;
+				}
+				else if (note.envelope_direction == 1 && volume != 15) {
+					volume += 1;
 				}
 			}
+			sample.push_back((lfsr & 1) ? (volume * 255 / 15 / 2) : 0);
+			j += 1;
 		}
-		samples.push_back(std::move(sample));
+		if (j >= 255 * 48 * NOISE_SAMPLE_SPEED_FACTOR * 8) needs_pad = false;
 	}
-	return samples;
+	if (pad && needs_pad) {
+		for (uint32_t i = 0; i < 255 * 48 * NOISE_SAMPLE_SPEED_FACTOR; ++i) {
+			sample.push_back(0);
+		}
+	}
+	return sample;
+}
+
+Drum_Samples::Drum_Samples(const std::vector<Drum> &drums, int32_t only, bool pad) : _drums(drums), _only(only), _pad(pad),
+	_samples(std::make_shared<Samples>()) {
+	static std::atomic<uint32_t> next_id = 0;
+	_id = ++next_id;
+	_samples->samples.resize(drums.size());
+	_samples->generated.reset(new std::once_flag[drums.size()]);
+}
+
+const std::vector<uint8_t> &Drum_Samples::sample(int32_t drum_index) const {
+	static const std::vector<uint8_t> silence;
+	if (drum_index < 0 || drum_index >= (int32_t)_drums.size() || (_only != -1 && _only != drum_index)) {
+		return silence;
+	}
+	std::call_once(_samples->generated[drum_index], [&]() {
+		_samples->samples[drum_index] = generate_noise_sample(_drums[drum_index], _pad);
+	});
+	return _samples->samples[drum_index];
 }
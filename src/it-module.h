@@ -3,46 +3,103 @@
 
 #include <cstdint>
 #include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include <libopenmpt/libopenmpt_ext.hpp>
-#include <portaudiocpp/PortAudioCpp.hxx>
 
 #include "command.h"
 #include "parse-waves.h"
 #include "parse-drumkits.h"
-
-constexpr std::size_t BUFFER_SIZE = 2048;
-constexpr std::int32_t SAMPLE_RATE = 48000;
+#include "playback-module.h"
 
 constexpr uint32_t ROWS_PER_PATTERN = 192;
 
 constexpr uint32_t NOISE_SAMPLE_SPEED_FACTOR = 4;
 
+// noise samples for a project's drums, each one synthesized the first time it is
+// requested; with `only`, every other drum is silent
+//
+// samples may be requested from several threads at once, and copies share the
+// samples already synthesized
+class Drum_Samples {
+private:
+	struct Samples {
+		std::vector<std::vector<uint8_t>> samples;
+		std::unique_ptr<std::once_flag[]> generated;
+	};
+	std::vector<Drum> _drums;
+	int32_t _only = -1;
+	bool _pad = false;
+	// distinct for each set of drums, so their samples can be cached by address
+	uint32_t _id = 0;
+	std::shared_ptr<Samples> _samples;
+public:
+	Drum_Samples() {}
+	Drum_Samples(const std::vector<Drum> &drums, int32_t only = -1, bool pad = false);
+	inline uint32_t id(void) const { return _id; }
+	const std::vector<uint8_t> &sample(int32_t drum_index) const;
+};
+
 constexpr float UNITS_PER_MINUTE = 256.0f /* units per frame */ * (262144.0f / 4389.0f) /* frames per second */ * 60.0f /* seconds per minute */;
 
-class IT_Module {
+class IT_Module : public Playback_Module {
 private:
-	std::vector<uint8_t> _data;
-	int32_t _tempo_change_wrong_channel = -1;
-	int32_t _tempo_change_mid_note = -1;
-	bool _too_many_drums = false;
+	// everything carried from one pattern into the next
+	struct Pattern_State {
+		std::array<std::size_t, 4> indices{};
+		std::array<int32_t, 4> note_lengths{};
+		std::array<int32_t, 3> note_durations{};
+		std::array<int32_t, 4> channel_tempos{};
+		int32_t global_tempo = 256;
+		int32_t wave = 0;
+		int32_t tempo_change_wrong_channel = -1;
+		int32_t tempo_change_mid_note = -1;
+
+		bool operator==(const Pattern_State &other) const;
+	};
+	// a pattern is reused while it starts in the same state and the notes
+	// it read, from each channel's previous note on, hash the same
+	struct Encoded_Pattern {
+		Pattern_State start;
+		Pattern_State end;
+		uint64_t hash = 0;
+		std::vector<uint8_t> data;
+	};
+	// a module's data, with the patterns and samples it was encoded from
+	struct Encoded_Song {
+		std::vector<uint8_t> data;
+		std::vector<Encoded_Pattern> patterns;
+		uint64_t patterns_key = 0;
+		std::vector<std::vector<uint8_t>> samples;
+		uint64_t samples_key = 0;
+		int32_t tempo_change_wrong_channel = -1;
+		int32_t tempo_change_mid_note = -1;
+		bool too_many_drums = false;
+	};
+
+	Encoded_Song _song;
+	// the last song encoded for a hot swap, only used while preparing one
+	std::unique_ptr<Encoded_Song> _hot_swap_song;
 
 	openmpt::module_ext *_mod = nullptr;
-
-	portaudio::BlockingStream _stream;
-	std::array<float, BUFFER_SIZE * 2> _buffer;
-	bool _is_interleaved = false;
+	// an edited song compiled in the background, swapped in by play
+	std::atomic<openmpt::module_ext *> _next_mod{nullptr};
+	// held while swapping _mod, and by every call from outside play,
+	// so none of them use a module that has been deleted
+	std::mutex _mod_mutex;
+	std::array<bool, 4> _muted{};
 
 	int32_t _current_pattern = 0;
 	int32_t _current_row = 0;
-
-	bool _paused = false;
 public:
+	// plays notes live, through a shorter ring
 	IT_Module(
 		const std::vector<Wave> &waves,
 		const std::vector<Drumkit> &drumkits,
-		const std::vector<std::vector<uint8_t>> &drums,
+		const Drum_Samples &drums,
 		int32_t drumkit = -1,
 		bool loop_drums = false
 	);
@@ -53,11 +110,11 @@ public:
 		const std::vector<Note_View> &channel_4_notes,
 		const std::vector<Wave> &waves,
 		const std::vector<Drumkit> &drumkits,
-		const std::vector<std::vector<uint8_t>> &drums,
+		const Drum_Samples &drums,
 		int32_t loop_tick,
 		bool stereo
 	);
-	~IT_Module() noexcept;
+	~IT_Module() noexcept override;
 
 	IT_Module(const IT_Module&) = delete;
 	IT_Module& operator=(const IT_Module&) = delete;
@@ -65,44 +122,64 @@ public:
 	void regenerate_it_module(
 		const std::vector<Wave> &waves,
 		const std::vector<Drumkit> &drumkits,
-		const std::vector<std::vector<uint8_t>> &drums,
+		const Drum_Samples &drums,
 		int32_t drumkit = -1,
 		bool loop_drums = false
 	);
+	// keeps the stream open, and re-encodes only the patterns and samples
+	// whose inputs changed since the module was last generated
+	void regenerate_it_module(
+		const std::vector<Note_View> &channel_1_notes,
+		const std::vector<Note_View> &channel_2_notes,
+		const std::vector<Note_View> &channel_3_notes,
+		const std::vector<Note_View> &channel_4_notes,
+		const std::vector<Wave> &waves,
+		const std::vector<Drumkit> &drumkits,
+		const Drum_Samples &drums,
+		int32_t loop_tick,
+		bool stereo
+	);
+	// may run while playing; the song changes at the start of the next
+	// pattern, continuing from the same order and row
+	void prepare_hot_swap(
+		const std::vector<Note_View> &channel_1_notes,
+		const std::vector<Note_View> &channel_2_notes,
+		const std::vector<Note_View> &channel_3_notes,
+		const std::vector<Note_View> &channel_4_notes,
+		const std::vector<Wave> &waves,
+		const std::vector<Drumkit> &drumkits,
+		const Drum_Samples &drums,
+		int32_t loop_tick,
+		bool stereo
+	);
 
 	bool export_file(const char *f);
 
-	std::string get_warnings() { return _mod->get_metadata("warnings"); }
-	int32_t tempo_change_wrong_channel() const { return _tempo_change_wrong_channel; }
-	int32_t tempo_change_mid_note() const { return _tempo_change_mid_note; }
-	bool too_many_drums() const { return _too_many_drums; }
-
-	bool ready() const { return _stream.isOpen(); }
-	bool playing() { return Pa_IsStreamActive(_stream.paStream()) == 1; }
-	bool paused() const { return _paused; }
-	bool stopped() { return !playing() && !paused(); }
-	bool looping() { return _mod->get_repeat_count() == -1; }
+	std::string get_warnings() override;
+	int32_t tempo_change_wrong_channel() const override { return _song.tempo_change_wrong_channel; }
+	int32_t tempo_change_mid_note() const override { return _song.tempo_change_mid_note; }
+	bool too_many_drums() const override { return _song.too_many_drums; }
 
-	bool start() { _paused = false; return Pa_StartStream(_stream.paStream()) == paNoError; }
-	bool stop()  { _paused = false; return Pa_StopStream(_stream.paStream())  == paNoError; }
-	bool pause() { _paused = true;  return Pa_StopStream(_stream.paStream())  == paNoError; }
-	bool play();
+	bool looping() override;
 
-	void mute_channel(int32_t channel, bool mute);
+	void mute_channel(int32_t channel, bool mute) override;
 
 	int32_t play_note(Pitch pitch, int32_t octave, int channel, int32_t duty_wave);
 	void stop_note(int32_t mod_channel);
 
-	int32_t current_tick() const { return _current_pattern * ROWS_PER_PATTERN + _current_row; }
-	void set_tick(int32_t tick);
+	int32_t current_tick() const override { return _current_pattern * ROWS_PER_PATTERN + _current_row; }
+	void set_tick(int32_t tick) override;
 
-	double get_position_seconds();
-	double get_duration_seconds();
+	double get_position_seconds() override;
+	double get_duration_seconds() override;
+protected:
+	std::size_t render_block(float *frames, std::size_t count) override;
 private:
-	bool try_open();
+	void hot_swap(void);
 	std::vector<std::vector<uint8_t>> get_instruments();
 	std::vector<std::vector<uint8_t>> get_samples(const std::vector<Wave> &waves, const std::vector<const std::vector<uint8_t> *> &drums, bool loop_drums);
-	std::vector<std::vector<uint8_t>> get_patterns(
+	void get_patterns(
+		Encoded_Song &song,
 		const std::vector<Note_View> &channel_1_notes,
 		const std::vector<Note_View> &channel_2_notes,
 		const std::vector<Note_View> &channel_3_notes,
@@ -113,13 +190,14 @@ private:
 		int32_t num_inline_waves
 	);
 	void generate_it_module(
+		Encoded_Song &song,
 		const std::vector<Note_View> &channel_1_notes = {},
 		const std::vector<Note_View> &channel_2_notes = {},
 		const std::vector<Note_View> &channel_3_notes = {},
 		const std::vector<Note_View> &channel_4_notes = {},
 		const std::vector<Wave> &waves = {},
 		const std::vector<Drumkit> &drumkits = {},
-		const std::vector<std::vector<uint8_t>> &drums = {},
+		const Drum_Samples &drums = {},
 		int32_t preserve_drumkit = -1,
 		bool loop_drums = false,
 		int32_t loop_tick = -1,
@@ -127,6 +205,4 @@ private:
 	);
 };
 
-std::vector<std::vector<uint8_t>> generate_noise_samples(const std::vector<Drum> &drums, int32_t only = -1, bool pad = false);
-
 #endif
@@ -0,0 +1,154 @@
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "label.h"
+
+// entries are stored in fixed blocks that never move, so reading an entry
+// by an ID that was handed out needs no lock; only interning takes one.
+// an entry is written before the size that covers it is released, and
+// readers acquire the size before they read
+template<typename T>
+class Intern_Table {
+private:
+	static constexpr size_t BLOCK_SIZE = 4096;
+	static constexpr size_t MAX_BLOCKS = 4096;
+	std::atomic<T *> _blocks[MAX_BLOCKS] = {};
+	std::atomic<size_t> _size = 0;
+public:
+	inline const T &operator[](uint32_t id) const {
+		static const T missing{};
+		if (id >= _size.load(std::memory_order_acquire)) { return missing; }
+		return _blocks[id / BLOCK_SIZE].load(std::memory_order_acquire)[id % BLOCK_SIZE];
+	}
+	// only while holding intern_mutex
+	uint32_t push_back(T &&v) {
+		size_t size = _size.load(std::memory_order_relaxed);
+		if (size == BLOCK_SIZE * MAX_BLOCKS) {
+			throw std::length_error("too many distinct labels");
+		}
+		std::atomic<T *> &block = _blocks[size / BLOCK_SIZE];
+		if (!block.load(std::memory_order_relaxed)) {
+			block.store(new T[BLOCK_SIZE], std::memory_order_release);
+		}
+		block.load(std::memory_order_relaxed)[size % BLOCK_SIZE] = std::move(v);
+		_size.store(size + 1, std::memory_order_release);
+		return (uint32_t)size;
+	}
+};
+
+static std::mutex intern_mutex;
+
+static Intern_Table<std::string> &label_table() {
+	static Intern_Table<std::string> *table = [] {
+		auto t = new Intern_Table<std::string>();
+		t->push_back("");
+		return t;
+	}();
+	return *table;
+}
+
+static Intern_Table<std::vector<Label>> &label_list_table() {
+	static Intern_Table<std::vector<Label>> *table = [] {
+		auto t = new Intern_Table<std::vector<Label>>();
+		t->push_back({});
+		return t;
+	}();
+	return *table;
+}
+
+// only while holding intern_mutex
+static std::unordered_map<std::string, uint32_t> &label_ids() {
+	static std::unordered_map<std::string, uint32_t> ids;
+	return ids;
+}
+
+Label::Label(const std::string &s) {
+	if (s.empty()) { return; }
+	std::lock_guard<std::mutex> lock(intern_mutex);
+	auto id_itr = label_ids().find(s);
+	if (id_itr != label_ids().end()) {
+		_id = id_itr->second;
+		return;
+	}
+	_id = label_table().push_back(std::string(s));
+	label_ids().emplace(s, _id);
+}
+
+bool Label::find(const std::string &s, Label &label) {
+	if (s.empty()) {
+		label = Label();
+		return true;
+	}
+	std::lock_guard<std::mutex> lock(intern_mutex);
+	auto id_itr = label_ids().find(s);
+	if (id_itr == label_ids().end()) { return false; }
+	label._id = id_itr->second;
+	return true;
+}
+
+const std::string &Label::str() const {
+	return label_table()[_id];
+}
+
+void Label_List::assign(const std::vector<Label> &labels) {
+	if (labels.size() <= 1) {
+		_value = labels.empty() ? Label() : labels.front();
+		return;
+	}
+	static std::map<std::vector<uint32_t>, uint32_t> ids;
+	std::vector<uint32_t> key;
+	key.reserve(labels.size());
+	for (Label label : labels) {
+		key.push_back(label.id());
+	}
+	std::lock_guard<std::mutex> lock(intern_mutex);
+	auto id_itr = ids.find(key);
+	if (id_itr == ids.end()) {
+		uint32_t id = label_list_table().push_back(std::vector<Label>(labels));
+		id_itr = ids.emplace(std::move(key), id).first;
+	}
+	_value._id = id_itr->second | LIST_BIT;
+}
+
+const std::vector<Label> &Label_List::labels() const {
+	return label_list_table()[_value._id & ~LIST_BIT];
+}
+
+void Label_List::push_back(Label label) {
+	std::vector<Label> labels(begin(), end());
+	labels.push_back(label);
+	assign(labels);
+}
+
+void Label_List::replace(size_t i, Label label) {
+	std::vector<Label> labels(begin(), end());
+	labels[i] = label;
+	assign(labels);
+}
+
+Label_List::const_iterator Label_List::insert(const_iterator pos, Label label) {
+	size_t i = pos - begin();
+	std::vector<Label> labels(begin(), end());
+	labels.insert(labels.begin() + i, label);
+	assign(labels);
+	return begin() + i;
+}
+
+Label_List::const_iterator Label_List::insert(const_iterator pos, const_iterator first, const_iterator last) {
+	size_t i = pos - begin();
+	std::vector<Label> labels(begin(), end());
+	labels.insert(labels.begin() + i, first, last);
+	assign(labels);
+	return begin() + i;
+}
+
+Label_List::const_iterator Label_List::erase(const_iterator pos) {
+	size_t i = pos - begin();
+	std::vector<Label> labels(begin(), end());
+	labels.erase(labels.begin() + i);
+	assign(labels);
+	return begin() + i;
+}
@@ -0,0 +1,82 @@
+#ifndef LABEL_H
+#define LABEL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <iterator>
+#include <initializer_list>
+
+// an interned label: equal labels share an ID, so commands copy them
+// as plain integers and compare them without touching the text;
+// the table lives for the whole process, since commands are parsed on
+// worker threads before their song exists, and are read back from the
+// song cache and copied between songs
+class Label {
+	friend class Label_List;
+private:
+	uint32_t _id = 0; // the empty label
+public:
+	Label() = default;
+	Label(const std::string &s);
+	Label(const char *s) : Label(std::string(s)) {}
+	// the label for s if it has been interned, without interning it
+	static bool find(const std::string &s, Label &label);
+	inline uint32_t id(void) const { return _id; }
+	const std::string &str(void) const;
+	inline operator const std::string &() const { return str(); }
+	inline bool empty(void) const { return _id == 0; }
+	inline size_t size(void) const { return str().size(); }
+	inline size_t find_first_of(const char *s, size_t p = 0) const { return str().find_first_of(s, p); }
+	inline const char *c_str(void) const { return str().c_str(); }
+	friend inline bool operator==(Label a, Label b) { return a._id == b._id; }
+	friend inline bool operator!=(Label a, Label b) { return a._id != b._id; }
+	// by ID, not alphabetically; only for sets and maps of labels
+	friend inline bool operator<(Label a, Label b) { return a._id < b._id; }
+};
+
+// an immutable list of labels; edits make a new list
+//
+// almost every labeled command has a single label, which the list holds
+// directly; only lists of several labels are interned, so that editing
+// labels hardly adds to the table. iterators into a list of one label
+// point into the list itself
+class Label_List {
+public:
+	typedef const Label *const_iterator;
+	typedef const_iterator iterator;
+	typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+	typedef const_reverse_iterator reverse_iterator;
+	typedef Label value_type;
+private:
+	// marks an interned list's ID, which no label ID reaches
+	static constexpr uint32_t LIST_BIT = 0x80000000u;
+	// empty, a single label, or an interned list
+	Label _value;
+	inline bool interned(void) const { return (_value._id & LIST_BIT) != 0; }
+	void assign(const std::vector<Label> &labels);
+	const std::vector<Label> &labels(void) const;
+public:
+	Label_List() = default;
+	Label_List(std::initializer_list<Label> labels) { assign(std::vector<Label>(labels)); }
+	Label_List(const std::vector<Label> &labels) { assign(labels); }
+	inline size_t size(void) const { return empty() ? 0 : interned() ? labels().size() : 1; }
+	inline bool empty(void) const { return _value.empty(); }
+	inline const_iterator begin(void) const { return empty() ? nullptr : interned() ? labels().data() : &_value; }
+	inline const_iterator end(void) const { return begin() + size(); }
+	inline const_reverse_iterator rbegin(void) const { return const_reverse_iterator(end()); }
+	inline const_reverse_iterator rend(void) const { return const_reverse_iterator(begin()); }
+	inline const Label &operator[](size_t i) const { return begin()[i]; }
+	inline const Label &front(void) const { return *begin(); }
+	inline const Label &back(void) const { return end()[-1]; }
+	inline void clear(void) { _value = Label(); }
+	void push_back(Label label);
+	void replace(size_t i, Label label);
+	const_iterator insert(const_iterator pos, Label label);
+	const_iterator insert(const_iterator pos, const_iterator first, const_iterator last);
+	const_iterator erase(const_iterator pos);
+	friend inline bool operator==(Label_List a, Label_List b) { return a._value == b._value; }
+	friend inline bool operator!=(Label_List a, Label_List b) { return a._value != b._value; }
+};
+
+#endif
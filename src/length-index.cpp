@@ -0,0 +1,266 @@
+#include <algorithm>
+
+#include "utils.h"
+#include "length-index.h"
+
+// commands played between checkpoints when there are no jumps, loops or calls
+static constexpr uint32_t CHECKPOINT_INTERVAL = 256;
+
+Length_Index::Length_Index(int32_t start_index, int32_t start_speed, int32_t start_drumkit) {
+	_state.index = start_index;
+	_state.speed = start_speed;
+	_state.drumkit = start_drumkit;
+}
+
+void Length_Index::rewind() {
+	if (_edited == NOT_EDITED) { return; }
+	size_t edited = _edited;
+	_edited = NOT_EDITED;
+	if (_state.reach < (int64_t)edited) { return; }
+
+	auto checkpoint_itr = std::partition_point(RANGE(_checkpoints), [edited](const State &state) {
+		return state.reach < (int64_t)edited;
+	});
+	_state = *(checkpoint_itr - 1);
+	_checkpoints.erase(checkpoint_itr, _checkpoints.end());
+
+	for (; _label_log.size() > _state.labels_logged; _label_log.pop_back()) {
+		_label_infos.erase(_label_log.back());
+	}
+	for (; _visited_label_log.size() > _state.visited_labels_logged; _visited_label_log.pop_back()) {
+		_visited_labels_not_during_call.erase(_visited_label_log.back());
+	}
+
+	_finished = false;
+	_result = Parsed_Song::Result::SONG_OK;
+	_loop_tick = -1;
+	_end_tick = -1;
+	_info.reset();
+}
+
+void Length_Index::finish(Parsed_Song::Result result) {
+	_result = result;
+	_finished = true;
+}
+
+void Length_Index::finish_at_loop(const Label_Info &label_info) {
+	_loop_tick = label_info.tick;
+	_end_tick = _state.tick;
+	Extra_Info &info = _info.emplace();
+	info.loop_index = label_info.index;
+	info.speed_at_loop = label_info.speed;
+	info.volume_at_loop = label_info.volume;
+	info.fade_at_loop = label_info.fade;
+	info.drumkit_at_loop = label_info.drumkit;
+
+	info.end_index = _state.index;
+	info.speed_at_end = _state.speed;
+	info.volume_at_end = _state.volume;
+	info.fade_at_end = _state.fade;
+	info.drumkit_at_end = _state.drumkit;
+
+	if (_loop_tick == _end_tick) {
+		finish(Parsed_Song::Result::SONG_EMPTY_LOOP);
+	}
+	else if (_state.loop_stack.size() > 0) {
+		finish(Parsed_Song::Result::SONG_UNFINISHED_LOOP);
+	}
+	else if (_state.call_stack.size() > 0) {
+		finish(Parsed_Song::Result::SONG_UNFINISHED_CALL);
+	}
+	else {
+		finish(Parsed_Song::Result::SONG_OK);
+	}
+}
+
+void Length_Index::play(const Command_List &commands, Command_List::const_iterator end_itr) {
+	State &state = _state;
+	auto command_itr = commands.begin() + state.index;
+
+	const auto jump = [&](Label target) {
+		command_itr = commands.find_label(target);
+		state.index = (int32_t)(command_itr - commands.begin());
+		state.reach = std::max(state.reach, state.index);
+	};
+
+	const auto may_jump = [&]() {
+		return (
+			!_visited_labels_not_during_call.count(command_itr->target) ||
+			(state.call_stack.size() > 0 && !state.visited_labels_during_call.count(command_itr->target))
+		);
+	};
+
+	while (command_itr != end_itr) {
+		if (
+			_checkpoints.empty() ||
+			(state.steps != _checkpoints.back().steps &&
+			(is_control_command(command_itr->type) || state.steps - _checkpoints.back().steps >= CHECKPOINT_INTERVAL))
+		) {
+			state.labels_logged = (uint32_t)_label_log.size();
+			state.visited_labels_logged = (uint32_t)_visited_label_log.size();
+			_checkpoints.push_back(state);
+		}
+		state.reach = std::max(state.reach, state.index);
+		state.steps += 1;
+
+		for (Label label : command_itr->labels) {
+			if (_label_infos.insert({ label, { state.tick, state.index, state.speed, state.volume, state.fade, state.drumkit } }).second) {
+				_label_log.push_back(label);
+			}
+			if (state.call_stack.size() > 0) {
+				state.visited_labels_during_call.insert(label);
+			}
+			else if (_visited_labels_not_during_call.insert(label).second) {
+				_visited_label_log.push_back(label);
+			}
+		}
+
+		if (command_itr->type == Command_Type::NOTE) {
+			state.tick += command_itr->note.length * state.speed;
+		}
+		else if (command_itr->type == Command_Type::DRUM_NOTE) {
+			if (state.drumkit == -1) {
+				finish(Parsed_Song::Result::SONG_NO_DRUMKIT_SELECTED);
+				return;
+			}
+			state.tick += command_itr->drum_note.length * state.speed;
+		}
+		else if (command_itr->type == Command_Type::REST) {
+			state.tick += command_itr->rest.length * state.speed;
+		}
+		else if (command_itr->type == Command_Type::NOTE_TYPE) {
+			state.speed = command_itr->note_type.speed;
+			state.volume = command_itr->note_type.volume;
+			state.fade = command_itr->note_type.fade;
+		}
+		else if (command_itr->type == Command_Type::DRUM_SPEED) {
+			state.speed = command_itr->drum_speed.speed;
+		}
+		else if (command_itr->type == Command_Type::VOLUME_ENVELOPE) {
+			state.volume = command_itr->volume_envelope.volume;
+			state.fade = command_itr->volume_envelope.fade;
+		}
+		else if (command_itr->type == Command_Type::TOGGLE_NOISE) {
+			if (state.drumkit == -1 && command_itr->toggle_noise.drumkit == -1) {
+				finish(Parsed_Song::Result::SONG_TOGGLE_NOISE_ALREADY_DISABLED);
+				return;
+			}
+			if (state.drumkit != -1 && command_itr->toggle_noise.drumkit != -1) {
+				finish(Parsed_Song::Result::SONG_TOGGLE_NOISE_ALREADY_ENABLED);
+				return;
+			}
+			state.drumkit = command_itr->toggle_noise.drumkit;
+		}
+		else if (command_itr->type == Command_Type::SOUND_JUMP) {
+			if (may_jump()) {
+				jump(command_itr->target);
+				continue;
+			}
+			finish_at_loop(_label_infos.at(command_itr->target));
+			return; // song is finished
+		}
+		else if (command_itr->type == Command_Type::SOUND_LOOP) {
+			if (state.loop_stack.size() > 0 && state.loop_stack.back().first == state.index) {
+				state.loop_stack.back().second -= 1;
+				if (state.loop_stack.back().second == 0) {
+					state.loop_stack.pop_back();
+				}
+				else {
+					jump(command_itr->target);
+					continue;
+				}
+			}
+			else {
+				if (command_itr->sound_loop.loop_count == 0) {
+					if (may_jump()) {
+						jump(command_itr->target);
+						continue;
+					}
+					finish_at_loop(_label_infos.at(command_itr->target));
+					return; // song is finished
+				}
+				else if (command_itr->sound_loop.loop_count > 1) {
+					// nested loops not allowed
+					if (state.loop_stack.size() > 0) {
+						finish(Parsed_Song::Result::SONG_NESTED_LOOP);
+						return;
+					}
+
+					state.loop_stack.emplace_back(state.index, command_itr->sound_loop.loop_count - 1);
+					jump(command_itr->target);
+					continue;
+				}
+			}
+		}
+		else if (command_itr->type == Command_Type::SOUND_CALL) {
+			// nested calls not allowed
+			if (state.call_stack.size() > 0) {
+				finish(Parsed_Song::Result::SONG_NESTED_CALL);
+				return;
+			}
+
+			state.call_stack.push_back(state.index);
+			jump(command_itr->target);
+			continue;
+		}
+		else if (command_itr->type == Command_Type::SOUND_RET) {
+			if (state.call_stack.size() == 0) {
+				_end_tick = state.tick;
+				Extra_Info &info = _info.emplace();
+				info.loop_index = -1;
+				info.speed_at_loop = -1;
+				info.volume_at_loop = -1;
+				info.fade_at_loop = -1;
+				info.drumkit_at_loop = -1;
+
+				info.end_index = state.index;
+				info.speed_at_end = state.speed;
+				info.volume_at_end = state.volume;
+				info.fade_at_end = state.fade;
+				info.drumkit_at_end = state.drumkit;
+
+				if (state.loop_stack.size() > 0) {
+					finish(Parsed_Song::Result::SONG_UNFINISHED_LOOP);
+					return;
+				}
+				finish(Parsed_Song::Result::SONG_OK);
+				return; // song is finished
+			}
+			else {
+				state.index = state.call_stack.back();
+				command_itr = commands.begin() + state.index;
+				state.call_stack.pop_back();
+				state.visited_labels_during_call.clear();
+			}
+		}
+		else if (command_itr->type == Command_Type::SPEED) {
+			state.speed = command_itr->speed.speed;
+		}
+		else if (command_itr->type == Command_Type::CHANNEL_VOLUME) {
+			state.volume = command_itr->channel_volume.volume;
+		}
+		else if (command_itr->type == Command_Type::FADE_WAVE) {
+			state.fade = command_itr->fade_wave.fade;
+		}
+		++command_itr;
+		++state.index;
+	}
+
+	// running off the end depends on nothing being added after it
+	state.reach = std::max(state.reach, (int32_t)(end_itr - commands.begin()));
+	_end_tick = state.tick;
+	finish(Parsed_Song::Result::SONG_OK);
+}
+
+Parsed_Song::Result Length_Index::calc(const Command_List &commands, Command_List::const_iterator end_itr, int32_t &loop_tick, int32_t &end_tick, Extra_Info *info) {
+	rewind();
+	if (!_finished) {
+		play(commands, end_itr);
+	}
+	loop_tick = _loop_tick;
+	end_tick = _end_tick;
+	if (info && _info) {
+		*info = *_info;
+	}
+	return _result;
+}
@@ -0,0 +1,91 @@
+#ifndef LENGTH_INDEX_H
+#define LENGTH_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "command.h"
+#include "command-list.h"
+#include "parse-song.h"
+
+struct Extra_Info {
+	int32_t loop_index = 0;
+	int32_t speed_at_loop = 1;
+	int32_t volume_at_loop = 0;
+	int32_t fade_at_loop = 0;
+	int32_t drumkit_at_loop = -1;
+
+	int32_t end_index = 0;
+	int32_t speed_at_end = 1;
+	int32_t volume_at_end = 0;
+	int32_t fade_at_end = 0;
+	int32_t drumkit_at_end = -1;
+};
+
+// plays a channel until it first ends, to find its loop and end ticks
+//
+// like Tick_Index, the player's state is saved at every jump, loop, call
+// and return, and every so often in between, so after an edit only the
+// commands from the last checkpoint that had not read it yet are played
+// again; a channel's own index is kept by its Command_List
+class Length_Index {
+private:
+	struct Label_Info {
+		int32_t tick = 0;
+		int32_t index = 0;
+		int32_t speed = 0;
+		int32_t volume = 0;
+		int32_t fade = 0;
+		int32_t drumkit = 0;
+	};
+	struct State {
+		int32_t tick = 0;
+		int32_t index = 0;
+		int32_t speed = 1;
+		int32_t volume = 0;
+		int32_t fade = 0;
+		int32_t drumkit = -1;
+		std::vector<std::pair<int32_t, int32_t>> loop_stack;
+		std::vector<int32_t> call_stack;
+		std::set<Label> visited_labels_during_call;
+		// how many commands were played before this state, and how many
+		// labels had been logged
+		uint32_t steps = 0;
+		uint32_t labels_logged = 0;
+		uint32_t visited_labels_logged = 0;
+		// the furthest command that was read before this state
+		int32_t reach = -1;
+	};
+	std::vector<State> _checkpoints;
+	State _state;
+	// labels are only ever added to these, so instead of being saved with
+	// each checkpoint, they are logged and rewound to its counts
+	std::map<Label, Label_Info> _label_infos;
+	std::set<Label> _visited_labels_not_during_call;
+	std::vector<Label> _label_log;
+	std::vector<Label> _visited_label_log;
+	bool _finished = false;
+	Parsed_Song::Result _result = Parsed_Song::Result::SONG_OK;
+	int32_t _loop_tick = -1;
+	int32_t _end_tick = -1;
+	std::optional<Extra_Info> _info;
+	// the first command that may have changed since it was played
+	static constexpr size_t NOT_EDITED = SIZE_MAX;
+	size_t _edited = NOT_EDITED;
+
+	void rewind(void);
+	void play(const Command_List &commands, Command_List::const_iterator end_itr);
+	void finish(Parsed_Song::Result result);
+	void finish_at_loop(const Label_Info &label_info);
+public:
+	Length_Index(int32_t start_index = 0, int32_t start_speed = 1, int32_t start_drumkit = -1);
+	inline void invalidate(size_t index) { if (index < _edited) { _edited = index; } }
+	Parsed_Song::Result calc(const Command_List &commands, Command_List::const_iterator end_itr, int32_t &loop_tick, int32_t &end_tick, Extra_Info *info = nullptr);
+};
+
+#endif
@@ -47,6 +47,14 @@ Main_Window::Main_Window(int x, int y, int w, int h, const char *) : Fl_Double_W
 	int note_labels_config = Preferences::get("note_labels", 0);
 	int ruler_config = Preferences::get("ruler", 1);
 	int bpm_config = Preferences::get("bpm", 1);
+	// render playback on an emulated APU instead of through an IT module
+	int native_apu_config = Preferences::get("native_apu", 0);
+	// megabytes of undo history to keep before dropping the oldest edits
+	int undo_memory_config = std::clamp(Preferences::get("undo_memory", DEFAULT_UNDO_BUDGET / (1024 * 1024)), 1, 4096);
+	_song.undo_budget((size_t)undo_memory_config * 1024 * 1024);
+	// frames per audio buffer; larger buffers underrun less often but respond later
+	int buffer_frames_config = std::clamp(Preferences::get("buffer_frames", (int)DEFAULT_BUFFER_FRAMES), (int)MIN_BUFFER_FRAMES, (int)BUFFER_SIZE);
+	Playback_Module::buffer_frames((size_t)buffer_frames_config);
 
 	for (int i = 0; i < NUM_RECENT; i++) {
 		_recent[i].filepath          = Preferences::get_string(Fl_Preferences::Name("recent%d", i));
@@ -160,6 +168,8 @@ Main_Window::Main_Window(int x, int y, int w, int h, const char *) : Fl_Double_W
 	new Spacer(tx, ty, 2, STATUS_BAR_HEIGHT - 2); tx += 2;
 	_channel_4_status_label = new Label_Button(tx, ty, text_width("Ch4: Off", 4), STATUS_BAR_HEIGHT - 2); tx += _channel_4_status_label->w();
 	new Spacer(tx, ty, 2, STATUS_BAR_HEIGHT - 2); tx += 2;
+	_undo_memory_label = new Label(tx, ty, text_width("Undo: 9999.9 KB", 8), STATUS_BAR_HEIGHT - 2, "Undo: 0 KB"); tx += _undo_memory_label->w();
+	new Spacer(tx, ty, 2, STATUS_BAR_HEIGHT - 2); tx += 2;
 	_status_label = new Label(tx, ty, std::max(ww - tx + 2, 20), STATUS_BAR_HEIGHT - 2, _status_message.c_str()); tx += _status_label->w();
 	_status_bar->end();
 	begin();
@@ -192,6 +202,7 @@ Main_Window::Main_Window(int x, int y, int w, int h, const char *) : Fl_Double_W
 	_about_dialog = new Modal_Dialog(this, "About " PROGRAM_NAME, Modal_Dialog::Icon::APP_ICON);
 	_song_options_dialog = new Song_Options_Dialog("Song Options");
 	_ruler_config_dialog = new Ruler_Config_Dialog("Configure Ruler");
+	_song_picker_dialog = new Song_Picker_Dialog("Choose Song");
 	_help_window = new Help_Window(48, 48, 700, 500, PROGRAM_NAME " Help");
 	_wave_window = new Wave_Window(48, 48);
 	_drumkit_window = new Drumkit_Window(48, 48);
@@ -247,7 +258,8 @@ Main_Window::Main_Window(int x, int y, int w, int h, const char *) : Fl_Double_W
 		OS_NULL_MENU_ITEM(FL_ALT + '0', (Fl_Callback *)open_recent_cb, this, 0),
 		SYS_MENU_ITEM("Clear &Recent", 0, (Fl_Callback *)clear_recent_cb, this, 0),
 		{},
-		SYS_MENU_ITEM("&Close", FL_COMMAND + 'w', (Fl_Callback *)close_cb, this, FL_MENU_DIVIDER),
+		SYS_MENU_ITEM("&Close", FL_COMMAND + 'w', (Fl_Callback *)close_cb, this, 0),
+		SYS_MENU_ITEM("Re&load", 0, (Fl_Callback *)reload_cb, this, FL_MENU_DIVIDER),
 		SYS_MENU_ITEM("&Save", FL_COMMAND + 's', (Fl_Callback *)save_cb, this, 0),
 #ifdef __APPLE__
 		SYS_MENU_ITEM("Save &As...", FL_COMMAND + 'S', (Fl_Callback *)save_as_cb, this, 0),
@@ -263,7 +275,9 @@ Main_Window::Main_Window(int x, int y, int w, int h, const char *) : Fl_Double_W
 		SYS_MENU_ITEM("&Continuous Scroll", '\\', (Fl_Callback *)continuous_cb, this, FL_MENU_TOGGLE | FL_MENU_VALUE),
 		SYS_MENU_ITEM("&Loop", FL_COMMAND + 'l', (Fl_Callback *)loop_cb, this, FL_MENU_TOGGLE | FL_MENU_VALUE),
 		SYS_MENU_ITEM("Loop &Verification", FL_COMMAND + 'L', (Fl_Callback *)loop_verification_cb, this, FL_MENU_TOGGLE | FL_MENU_VALUE | FL_MENU_DIVIDER),
-		SYS_MENU_ITEM("S&tereo", FL_COMMAND + 't', (Fl_Callback *)stereo_cb, this, FL_MENU_TOGGLE | FL_MENU_VALUE | FL_MENU_DIVIDER),
+		SYS_MENU_ITEM("S&tereo", FL_COMMAND + 't', (Fl_Callback *)stereo_cb, this, FL_MENU_TOGGLE | FL_MENU_VALUE),
+		SYS_MENU_ITEM("&Native APU", 0, (Fl_Callback *)native_apu_cb, this,
+			FL_MENU_DIVIDER | FL_MENU_TOGGLE | (native_apu_config ? FL_MENU_VALUE : 0)),
 		SYS_MENU_ITEM("Mute Channel &1", FL_F + 5, (Fl_Callback *)channel_1_mute_cb, this, FL_MENU_TOGGLE),
 		SYS_MENU_ITEM("Mute Channel &2", FL_F + 6, (Fl_Callback *)channel_2_mute_cb, this, FL_MENU_TOGGLE),
 		SYS_MENU_ITEM("Mute Channel &3", FL_F + 7, (Fl_Callback *)channel_3_mute_cb, this, FL_MENU_TOGGLE),
@@ -429,12 +443,14 @@ Main_Window::Main_Window(int x, int y, int w, int h, const char *) : Fl_Double_W
 	_full_screen_mi = CT_FIND_MENU_ITEM_CB(full_screen_cb);
 	// Conditional menu items
 	_close_mi = CT_FIND_MENU_ITEM_CB(close_cb);
+	_reload_mi = CT_FIND_MENU_ITEM_CB(reload_cb);
 	_save_mi = CT_FIND_MENU_ITEM_CB(save_cb);
 	_save_as_mi = CT_FIND_MENU_ITEM_CB(save_as_cb);
 	_play_pause_mi = CT_FIND_MENU_ITEM_CB(play_pause_cb);
 	_stop_mi = CT_FIND_MENU_ITEM_CB(stop_cb);
 	_loop_mi = CT_FIND_MENU_ITEM_CB(loop_cb);
 	_stereo_mi = CT_FIND_MENU_ITEM_CB(stereo_cb);
+	_native_apu_mi = CT_FIND_MENU_ITEM_CB(native_apu_cb);
 	_step_backward_mi = CT_FIND_MENU_ITEM_CB(step_backward_cb);
 	_step_forward_mi = CT_FIND_MENU_ITEM_CB(step_forward_cb);
 	_skip_backward_mi = CT_FIND_MENU_ITEM_CB(skip_backward_cb);
@@ -866,11 +882,12 @@ Main_Window::~Main_Window() {
 	delete _about_dialog;
 	delete _song_options_dialog;
 	delete _ruler_config_dialog;
+	delete _song_picker_dialog;
 	delete _help_window;
 	delete _wave_window;
 	delete _drumkit_window;
-	if (_it_module) {
-		delete _it_module;
+	if (_playback_module) {
+		delete _playback_module;
 	}
 	if (_interactive_module) {
 		delete _interactive_module;
@@ -1037,8 +1054,8 @@ void Main_Window::set_song_position(int32_t tick) {
 		}
 		_menu_bar->update();
 	}
-	if (_it_module) {
-		_it_module->set_tick(tick);
+	if (_playback_module) {
+		_playback_module->set_tick(tick);
 	}
 	update_song_status();
 	_audio_mutex.unlock();
@@ -1258,6 +1275,7 @@ void Main_Window::selected_channel(int i) {
 }
 
 void Main_Window::update_active_controls() {
+	update_undo_memory();
 	if (_song.loaded()) {
 		bool playing = this->playing();
 		bool stopped = this->stopped();
@@ -1326,6 +1344,12 @@ void Main_Window::update_active_controls() {
 			_redo_mi->deactivate();
 			_redo_tb->deactivate();
 		}
+		if (_asm_file.size() && stopped) {
+			_reload_mi->activate();
+		}
+		else {
+			_reload_mi->deactivate();
+		}
 		if (stopped) {
 			if (selected_channel()) {
 				_select_all_mi->activate();
@@ -1549,6 +1573,7 @@ void Main_Window::update_active_controls() {
 	}
 	else {
 		_close_mi->deactivate();
+		_reload_mi->deactivate();
 		_save_mi->deactivate();
 		_save_tb->deactivate();
 		_save_as_mi->deactivate();
@@ -1739,10 +1764,26 @@ void Main_Window::open_song(const char *filename) {
 		return;
 	}
 
-	open_song(directory, filename);
+	// a file holding several songs opens the one picked from its index
+	std::string song_label;
+	std::vector<Indexed_Song> songs;
+	if (Parsed_Song::index_songs(filename, songs) && songs.size() > 1) {
+		std::vector<std::string> labels;
+		for (const Indexed_Song &song : songs) {
+			labels.push_back(song.label);
+		}
+		_song_picker_dialog->set_songs(labels);
+		_song_picker_dialog->show(this);
+		if (_song_picker_dialog->canceled()) { return; }
+		int picked = _song_picker_dialog->picked_song();
+		if (picked < 0 || picked >= (int)songs.size()) { return; }
+		song_label = songs[picked].label;
+	}
+
+	open_song(directory, filename, song_label);
 }
 
-void Main_Window::open_song(const char *directory, const char *filename) {
+void Main_Window::open_song(const char *directory, const char *filename, const std::string &song_label) {
 	Song_Options_Dialog::Song_Options options;
 	if (!filename) {
 		bool reset = true;
@@ -1776,12 +1817,30 @@ void Main_Window::open_song(const char *directory, const char *filename) {
 		_asm_save_chooser->directory(directory);
 	}
 
-	if (!load_waves()) {
+	// the three files are independent, so they are parsed at once,
+	// the song on this thread; results are still reported in order
+	std::unique_ptr<Parsed_Waves> parsed_waves;
+	std::unique_ptr<Parsed_Drumkits> parsed_drumkits;
+	Parsed_Song::Result r = Parsed_Song::Result::SONG_NULL;
+	{
+		std::string cache_dir = Preferences::userdata_path();
+		std::thread waves_thread([&]() { parsed_waves = parse_waves(); });
+		std::thread drumkits_thread([&]() { parsed_drumkits = parse_drumkits(); });
+		if (filename) {
+			r = _song.read_song(filename, cache_dir.c_str(), song_label);
+		}
+		waves_thread.join();
+		drumkits_thread.join();
+	}
+
+	if (!store_waves(std::move(parsed_waves))) {
+		_song.clear();
 		_directory.clear();
 		return;
 	}
 
-	if (!load_drumkits()) {
+	if (!store_drumkits(std::move(parsed_drumkits))) {
+		_song.clear();
 		_directory.clear();
 		return;
 	}
@@ -1790,7 +1849,6 @@ void Main_Window::open_song(const char *directory, const char *filename) {
 
 	if (filename) {
 		basename = fl_filename_name(_asm_file.c_str());
-		Parsed_Song::Result r = _song.read_song(filename);
 		if (r != Parsed_Song::Result::SONG_OK) {
 			_song.clear();
 			std::string msg = "Error reading ";
@@ -1854,7 +1912,7 @@ void Main_Window::open_song(const char *directory, const char *filename) {
 
 		loop(false);
 	}
-	regenerate_it_module();
+	regenerate_playback_module();
 
 	// set filenames
 	char buffer[FL_PATH_MAX] = {};
@@ -1912,6 +1970,9 @@ bool Main_Window::save_song(bool force) {
 		if (!_song.write_song(filename)) {
 			std::string msg = "Could not write to ";
 			msg = msg + basename + "!";
+			if (*_song.error_message()) {
+				msg = msg + "\n\n" + _song.error_message();
+			}
 			_error_dialog->message(msg);
 			_error_dialog->show(this);
 			return false;
@@ -1936,69 +1997,157 @@ bool Main_Window::save_song(bool force) {
 	return true;
 }
 
-bool Main_Window::load_waves() {
-	Parsed_Waves parsed_waves(_directory.c_str());
-	if (parsed_waves.result() != Parsed_Waves::Result::WAVES_OK) {
-		std::string msg = "Error reading wave definitions!\n\n" + parsed_waves.get_error_message();
-		_error_dialog->message(msg);
-		_error_dialog->show(this);
-		return false;
+// parses the project's waves unless the cached ones are still current;
+// touches no widgets, so it can run off the FLTK thread
+std::unique_ptr<Parsed_Waves> Main_Window::parse_waves(bool reload) const {
+	const Project_Cache &cache = _project_cache;
+	const char *waves_file = cache.waves.waves_file.c_str();
+	if (
+		!reload && cache.waves_directory == _directory && cache.waves_mod_time != 0 &&
+		file_modified(waves_file) == cache.waves_mod_time && file_size(waves_file) == cache.waves_size
+	) {
+		return nullptr;
 	}
-	if (parsed_waves.num_parsed_waves() > 16) {
-		std::string msg = "Wave samples file contains too many waves: " + std::to_string(parsed_waves.num_parsed_waves()) + "\n\n"
+	return std::make_unique<Parsed_Waves>(_directory.c_str());
+}
+
+bool Main_Window::store_waves(std::unique_ptr<Parsed_Waves> parsed_waves) {
+	Project_Cache &cache = _project_cache;
+	if (parsed_waves) {
+		cache.waves_directory.clear();
+		if (parsed_waves->result() != Parsed_Waves::Result::WAVES_OK) {
+			std::string msg = "Error reading wave definitions!\n\n" + parsed_waves->get_error_message();
+			_error_dialog->message(msg);
+			_error_dialog->show(this);
+			return false;
+		}
+		cache.waves.waves_file = parsed_waves->waves_file();
+		cache.waves.waves_label = parsed_waves->waves_label();
+		cache.waves.waves = parsed_waves->waves();
+		cache.waves.num_waves = std::min(parsed_waves->num_parsed_waves(), 16);
+		cache.waves.uses_dn = parsed_waves->uses_dn();
+		cache.num_parsed_waves = parsed_waves->num_parsed_waves();
+		cache.waves_directory = _directory;
+		cache.waves_size = file_size(cache.waves.waves_file.c_str());
+		cache.waves_mod_time = file_modified(cache.waves.waves_file.c_str());
+	}
+	if (cache.num_parsed_waves > 16) {
+		std::string msg = "Wave samples file contains too many waves: " + std::to_string(cache.num_parsed_waves) + "\n\n"
 			"Only the first 16 waves can be used.";
 		_warning_dialog->message(msg);
 		_warning_dialog->show(this);
 	}
-	_waves.waves_file = parsed_waves.waves_file();
-	_waves.waves_label = parsed_waves.waves_label();
-	_waves.waves = parsed_waves.waves();
-	_waves.num_waves = std::min(parsed_waves.num_parsed_waves(), 16);
-	_waves.uses_dn = parsed_waves.uses_dn();
+	_waves = cache.waves;
 	return true;
 }
 
-bool Main_Window::load_drumkits() {
-	Parsed_Drumkits parsed_drumkits(_directory.c_str());
-	if (parsed_drumkits.result() != Parsed_Drumkits::Result::DRUMKITS_OK) {
-		std::string msg = "Error reading drumkit definitions!\n\n" + parsed_drumkits.get_error_message();
-		_error_dialog->message(msg);
-		_error_dialog->show(this);
-		return false;
+bool Main_Window::load_waves(bool reload) {
+	return store_waves(parse_waves(reload));
+}
+
+// parses the project's drumkits unless the cached ones are still current;
+// touches no widgets, so it can run off the FLTK thread
+std::unique_ptr<Parsed_Drumkits> Main_Window::parse_drumkits(bool reload) const {
+	const Project_Cache &cache = _project_cache;
+	const char *drumkits_file = cache.drumkits.drumkits_file.c_str();
+	if (
+		!reload && cache.drumkits_directory == _directory && cache.drumkits_mod_time != 0 &&
+		file_modified(drumkits_file) == cache.drumkits_mod_time && file_size(drumkits_file) == cache.drumkits_size
+	) {
+		return nullptr;
 	}
-	if (parsed_drumkits.num_parsed_drumkits() > 256) {
-		std::string msg = "Drumkits file contains too many drumkits: " + std::to_string(parsed_drumkits.num_parsed_drumkits()) + "\n\n"
+	return std::make_unique<Parsed_Drumkits>(_directory.c_str());
+}
+
+bool Main_Window::store_drumkits(std::unique_ptr<Parsed_Drumkits> parsed_drumkits) {
+	Project_Cache &cache = _project_cache;
+	if (parsed_drumkits) {
+		cache.drumkits_directory.clear();
+		if (parsed_drumkits->result() != Parsed_Drumkits::Result::DRUMKITS_OK) {
+			std::string msg = "Error reading drumkit definitions!\n\n" + parsed_drumkits->get_error_message();
+			_error_dialog->message(msg);
+			_error_dialog->show(this);
+			return false;
+		}
+		cache.drumkits.drumkits_file = parsed_drumkits->drumkits_file();
+		cache.drumkits.drumkits_label = parsed_drumkits->drumkits_label();
+		cache.drumkits.drumkits = parsed_drumkits->drumkits();
+		cache.drumkits.drums = parsed_drumkits->drums();
+		cache.drumkits.uses_dr = parsed_drumkits->uses_dr();
+		cache.drumkits.uses_local = parsed_drumkits->uses_local();
+		cache.num_parsed_drumkits = parsed_drumkits->num_parsed_drumkits();
+		cache.drum_samples = Drum_Samples(cache.drumkits.drums);
+		cache.drumkits_directory = _directory;
+		cache.drumkits_size = file_size(cache.drumkits.drumkits_file.c_str());
+		cache.drumkits_mod_time = file_modified(cache.drumkits.drumkits_file.c_str());
+	}
+	if (cache.num_parsed_drumkits > 256) {
+		std::string msg = "Drumkits file contains too many drumkits: " + std::to_string(cache.num_parsed_drumkits) + "\n\n"
 			"Only the first 256 drumkits can be used.";
 		_warning_dialog->message(msg);
 		_warning_dialog->show(this);
 	}
-	_drumkits.drumkits_file = parsed_drumkits.drumkits_file();
-	_drumkits.drumkits_label = parsed_drumkits.drumkits_label();
-	_drumkits.drumkits = parsed_drumkits.drumkits();
-	_drumkits.drums = parsed_drumkits.drums();
-	_drumkits.uses_dr = parsed_drumkits.uses_dr();
-	_drumkits.uses_local = parsed_drumkits.uses_local();
-	_drum_samples = generate_noise_samples(_drumkits.drums);
+	_drumkits = cache.drumkits;
 	return true;
 }
 
-void Main_Window::regenerate_it_module() {
-	if (_it_module) {
-		delete _it_module;
-	}
-	_it_module = new IT_Module(
+bool Main_Window::load_drumkits(bool reload) {
+	return store_drumkits(parse_drumkits(reload));
+}
+
+IT_Module *Main_Window::new_it_module() const {
+	return new IT_Module(
 		_piano_roll->channel_1_notes(),
 		_piano_roll->channel_2_notes(),
 		_piano_roll->channel_3_notes(),
 		_piano_roll->channel_4_notes(),
 		_waves.waves,
 		_drumkits.drumkits,
-		_drum_samples,
+		_project_cache.drum_samples,
 		loop() ? _piano_roll->get_loop_tick() : -1,
 		stereo()
 	);
 }
 
+void Main_Window::regenerate_playback_module() {
+	finish_hot_swap();
+	// an existing IT module keeps its stream and reuses unchanged patterns
+	IT_Module *it_module = native_apu() ? nullptr : dynamic_cast<IT_Module *>(_playback_module);
+	if (it_module) {
+		it_module->regenerate_it_module(
+			_piano_roll->channel_1_notes(),
+			_piano_roll->channel_2_notes(),
+			_piano_roll->channel_3_notes(),
+			_piano_roll->channel_4_notes(),
+			_waves.waves,
+			_drumkits.drumkits,
+			_project_cache.drum_samples,
+			loop() ? _piano_roll->get_loop_tick() : -1,
+			stereo()
+		);
+		return;
+	}
+	if (_playback_module) {
+		delete _playback_module;
+	}
+	if (native_apu()) {
+		_playback_module = new APU_Module(
+			_piano_roll->channel_1_notes(),
+			_piano_roll->channel_2_notes(),
+			_piano_roll->channel_3_notes(),
+			_piano_roll->channel_4_notes(),
+			_waves.waves,
+			_drumkits.drumkits,
+			_drumkits.drums,
+			loop() ? _piano_roll->get_loop_tick() : -1,
+			stereo()
+		);
+	}
+	else {
+		_playback_module = new_it_module();
+	}
+}
+
 void Main_Window::regenerate_interactive_module() {
 	_playing_channel = selected_channel();
 	_playing_instrument = 0;
@@ -2025,7 +2174,7 @@ void Main_Window::regenerate_interactive_module() {
 	_interactive_module = new IT_Module(
 		waves,
 		_drumkits.drumkits,
-		_drum_samples,
+		_project_cache.drum_samples,
 		_playing_channel == 4 ? _playing_instrument : -1
 	);
 }
@@ -2104,42 +2253,42 @@ void Main_Window::toggle_playback() {
 			warn_differences(4, _piano_roll->verify_channel_4_loop_view(_song));
 		}
 
-		regenerate_it_module();
-		_it_module->mute_channel(1, channel_1_muted());
-		_it_module->mute_channel(2, channel_2_muted());
-		_it_module->mute_channel(3, channel_3_muted());
-		_it_module->mute_channel(4, channel_4_muted());
+		regenerate_playback_module();
+		_playback_module->mute_channel(1, channel_1_muted());
+		_playback_module->mute_channel(2, channel_2_muted());
+		_playback_module->mute_channel(3, channel_3_muted());
+		_playback_module->mute_channel(4, channel_4_muted());
 
-		std::string warnings = _it_module->get_warnings();
+		std::string warnings = _playback_module->get_warnings();
 		if (warnings.size() > 0 && !_showed_it_warning) {
 			_warning_dialog->message(warnings);
 			_warning_dialog->show(this);
 			_showed_it_warning = true;
 		}
-		if (_it_module->tempo_change_wrong_channel() != -1) {
-			std::string warning = "Detected tempo change on channel " + std::to_string(_it_module->tempo_change_wrong_channel()) + ".\n\n"
+		if (_playback_module->tempo_change_wrong_channel() != -1) {
+			std::string warning = "Detected tempo change on channel " + std::to_string(_playback_module->tempo_change_wrong_channel()) + ".\n\n"
 				"Tempo changes should only be used on the first channel in the song. A desync in-game may occur.";
 			_warning_dialog->message(warning);
 			_warning_dialog->show(this);
 		}
-		else if (_it_module->tempo_change_mid_note() != -1) {
-			std::string warning = "Detected tempo change in the middle of a note or rest on channel " + std::to_string(_it_module->tempo_change_mid_note()) + ".\n\n"
+		else if (_playback_module->tempo_change_mid_note() != -1) {
+			std::string warning = "Detected tempo change in the middle of a note or rest on channel " + std::to_string(_playback_module->tempo_change_mid_note()) + ".\n\n"
 				"Tempo changes should only be used when all active channels are simultaneously triggering a note or a rest. A desync in-game may occur.\n\n"
-				"This can be fixed automatically for most kinds of rests by selecting Postprocess Channel from the Edit menu while channel " + std::to_string(_it_module->tempo_change_mid_note()) + " is active or by making any edit to that channel.";
+				"This can be fixed automatically for most kinds of rests by selecting Postprocess Channel from the Edit menu while channel " + std::to_string(_playback_module->tempo_change_mid_note()) + " is active or by making any edit to that channel.";
 			_warning_dialog->message(warning);
 			_warning_dialog->show(this);
 		}
-		if (_it_module->too_many_drums()) {
+		if (_playback_module->too_many_drums()) {
 			std::string warning = "Channel 4 uses too many drums.\n\n"
 				"Immediate playback only supports up to 64 drums. Some notes may not play correctly in the editor.";
 			_warning_dialog->message(warning);
 			_warning_dialog->show(this);
 		}
 
-		if (_it_module->ready() && _it_module->start()) {
+		if (_playback_module->ready() && _playback_module->start()) {
 			_tick = _piano_roll->tick();
 			if (_tick != -1) {
-				_it_module->set_tick(_tick);
+				_playback_module->set_tick(_tick);
 			}
 			_piano_roll->start_following();
 			start_audio_thread();
@@ -2153,7 +2302,7 @@ void Main_Window::toggle_playback() {
 		}
 	}
 	else if (paused()) {
-		if (_it_module->ready() && _it_module->start()) {
+		if (_playback_module->ready() && _playback_module->start()) {
 			_piano_roll->unpause_following();
 			start_audio_thread();
 			update_active_controls();
@@ -2166,7 +2315,7 @@ void Main_Window::toggle_playback() {
 		}
 	}
 	else { // if (playing())
-		_it_module->pause();
+		_playback_module->pause();
 		_piano_roll->pause_following();
 		update_active_controls();
 	}
@@ -2175,40 +2324,93 @@ void Main_Window::toggle_playback() {
 void Main_Window::stop_playback() {
 	stop_audio_thread();
 
-	if (_it_module && !_it_module->stopped()) {
-		_it_module->stop();
+	if (_playback_module && !_playback_module->stopped()) {
+		_playback_module->stop();
 		_tick = -1;
 		_piano_roll->stop_following();
 		set_song_position(0);
 		update_active_controls();
+		report_underruns();
+	}
+}
+
+void Main_Window::report_underruns() {
+	uint32_t underruns = _playback_module ? _playback_module->underruns() : 0;
+	if (underruns > 0) {
+		_status_message = "Audio underran " + std::to_string(underruns) + (underruns == 1 ? " time" : " times") + " during playback";
+		_status_label->label(_status_message.c_str());
 	}
 }
 
 void Main_Window::start_audio_thread() {
-	_audio_kill_signal = std::promise<void>();
-	std::future<void> kill_future = _audio_kill_signal.get_future();
-	_audio_thread = std::thread(&playback_thread, this, std::move(kill_future));
+	_audio_signal.reset();
+	if (_playback_module) {
+		_playback_module->render_signal(&_audio_signal);
+	}
+	_audio_thread = std::thread(&playback_thread, this);
 }
 
 void Main_Window::stop_audio_thread() {
 	if (_audio_thread.joinable()) {
 		_audio_mutex.lock();
-		_audio_kill_signal.set_value();
+		_audio_signal.stop();
 		_audio_thread.join();
 		_audio_mutex.unlock();
 	}
+	finish_hot_swap();
+}
+
+void Main_Window::hot_swap_playback_module() {
+	if (stopped()) { return; }
+	finish_hot_swap();
+
+	// the inputs are copied, since the next edit or reload changes them
+	std::array<std::vector<Note_View>, 4> notes = {
+		_piano_roll->channel_1_notes(),
+		_piano_roll->channel_2_notes(),
+		_piano_roll->channel_3_notes(),
+		_piano_roll->channel_4_notes(),
+	};
+	int32_t loop_tick = loop() ? _piano_roll->get_loop_tick() : -1;
+	bool stereo = this->stereo();
+	Playback_Module *mod = _playback_module;
+	_hot_swap_thread = std::thread([
+		mod, notes = std::move(notes), waves = _waves.waves, drumkits = _drumkits.drumkits,
+		drums = _drumkits.drums, drum_samples = _project_cache.drum_samples, loop_tick, stereo
+	]() {
+		if (IT_Module *it_module = dynamic_cast<IT_Module *>(mod)) {
+			it_module->prepare_hot_swap(
+				notes[0], notes[1], notes[2], notes[3],
+				waves, drumkits, drum_samples, loop_tick, stereo
+			);
+		}
+		else if (APU_Module *apu_module = dynamic_cast<APU_Module *>(mod)) {
+			apu_module->prepare_hot_swap(
+				notes[0], notes[1], notes[2], notes[3],
+				waves, drumkits, drums, loop_tick, stereo
+			);
+		}
+	});
+}
+
+void Main_Window::finish_hot_swap() {
+	if (_hot_swap_thread.joinable()) {
+		_hot_swap_thread.join();
+	}
 }
 
 void Main_Window::start_interactive_thread() {
-	_interactive_kill_signal = std::promise<void>();
-	std::future<void> kill_future = _interactive_kill_signal.get_future();
-	_interactive_thread = std::thread(&interactive_thread, this, std::move(kill_future));
+	_interactive_signal.reset();
+	if (_interactive_module) {
+		_interactive_module->render_signal(&_interactive_signal);
+	}
+	_interactive_thread = std::thread(&interactive_thread, this);
 }
 
 void Main_Window::stop_interactive_thread() {
 	if (_interactive_thread.joinable()) {
 		_interactive_mutex.lock();
-		_interactive_kill_signal.set_value();
+		_interactive_signal.stop();
 		_interactive_thread.join();
 		_interactive_mutex.unlock();
 	}
@@ -2362,13 +2564,13 @@ void Main_Window::update_song_status() {
 }
 
 void Main_Window::update_timestamp() {
-	if (!_song.loaded() || !_it_module) {
+	if (!_song.loaded() || !_playback_module) {
 		_timestamp_label->label("00:00.00 / 00:00.00");
 	}
 	else {
 		char buffer[64] = {};
-		double position_seconds = _it_module->get_position_seconds();
-		double duration_seconds = _it_module->get_duration_seconds();
+		double position_seconds = _playback_module->get_position_seconds();
+		double duration_seconds = _playback_module->get_duration_seconds();
 		snprintf(
 			buffer, sizeof(buffer), "%02d:%02d.%02d / %02d:%02d.%02d",
 			(int)position_seconds / 60,
@@ -2382,6 +2584,18 @@ void Main_Window::update_timestamp() {
 	}
 }
 
+void Main_Window::update_undo_memory() {
+	char buffer[32] = {};
+	double kilobytes = _song.undo_memory() / 1024.0;
+	if (kilobytes < 1000.0) {
+		snprintf(buffer, sizeof(buffer), "Undo: %.0f KB", kilobytes);
+	}
+	else {
+		snprintf(buffer, sizeof(buffer), "Undo: %.1f MB", kilobytes / 1024.0);
+	}
+	_undo_memory_label->copy_label(buffer);
+}
+
 void Main_Window::update_tempo() {
 	if (!_song.loaded()) {
 		_tempo_label->label(bpm() ? "BPM: 0" : "Tempo: 0");
@@ -2551,10 +2765,9 @@ void Main_Window::close_cb(Fl_Widget *, Main_Window *mw) {
 	mw->_drumkits.drums.clear();
 	mw->_drumkits.uses_dr = false;
 	mw->_drumkits.uses_local = false;
-	mw->_drum_samples.clear();
-	if (mw->_it_module) {
-		delete mw->_it_module;
-		mw->_it_module = nullptr;
+	if (mw->_playback_module) {
+		delete mw->_playback_module;
+		mw->_playback_module = nullptr;
 	}
 	mw->_showed_it_warning = false;
 	if (!mw->_loop_tb->active()) {
@@ -2583,6 +2796,65 @@ void Main_Window::close_cb(Fl_Widget *, Main_Window *mw) {
 	mw->redraw();
 }
 
+void Main_Window::reload_cb(Fl_Widget *, Main_Window *mw) {
+	if (Fl::modal()) return;
+
+	if (!mw->_song.loaded() || mw->_asm_file.empty() || !mw->stopped()) { return; }
+
+	const char *basename = fl_filename_name(mw->_asm_file.c_str());
+
+	if (mw->_song.modified()) {
+		std::string msg = basename;
+		msg = msg + " has unsaved changes!\n\n"
+			"Reload it anyway?";
+		mw->_confirm_dialog->message(msg);
+		mw->_confirm_dialog->show(mw);
+		if (mw->_confirm_dialog->canceled()) { return; }
+	}
+
+	size_t num_song_waves = std::min(mw->_song.waves().size(), (size_t)15);
+	std::set<int32_t> changed_channels;
+	Parsed_Song::Result r = mw->_song.reload_song(mw->_asm_file.c_str(), changed_channels);
+	if (r != Parsed_Song::Result::SONG_OK) {
+		std::string msg = "Error reading ";
+		msg = msg + basename + "!\n\n" + mw->_song.error_message();
+		mw->_error_dialog->message(msg);
+		mw->_error_dialog->show(mw);
+		return;
+	}
+	if (mw->_song.mixed_labels().size() > 0) {
+		std::string msg = "The following labels are used by multiple channels. These sections have been duplicated so that each channel is now independent.\n\n"
+			"After modifying and saving the song, these labels will need to be fixed manually in a text editor.\n";
+		for (const std::string &label : mw->_song.mixed_labels()) {
+			msg += "\n- " + label;
+		}
+		mw->_warning_dialog->message(msg);
+		mw->_warning_dialog->show(mw);
+	}
+
+	// only the channels that changed on disk are laid out again
+	if (!changed_channels.empty()) {
+		mw->_waves.waves.resize(mw->_waves.waves.size() - num_song_waves);
+		mw->_waves.waves.insert(mw->_waves.waves.end(), mw->_song.waves().begin(), mw->_song.waves().begin() + std::min(mw->_song.waves().size(), (size_t)15));
+
+		if (mw->selected_channel() && mw->_song.channel_end_tick(mw->selected_channel()) == -1) {
+			mw->selected_channel(0);
+			mw->sync_channel_buttons();
+		}
+		mw->_piano_roll->set_channel_timelines(mw->_song, changed_channels);
+		mw->regenerate_playback_module();
+		mw->refresh_note_properties();
+	}
+
+	mw->_status_message = "Reloaded ";
+	mw->_status_message += basename;
+	mw->_status_label->label(mw->_status_message.c_str());
+
+	mw->update_active_controls();
+	mw->update_song_status();
+	mw->redraw();
+}
+
 void Main_Window::save_cb(Fl_Widget *w, Main_Window *mw) {
 	if (Fl::modal()) return;
 
@@ -2712,6 +2984,8 @@ void Main_Window::exit_cb(Fl_Widget *, Main_Window *mw) {
 	Preferences::set("note_labels", mw->note_labels());
 	Preferences::set("ruler", mw->ruler());
 	Preferences::set("bpm", mw->bpm());
+	Preferences::set("native_apu", mw->native_apu());
+	Preferences::set("undo_memory", (int)(mw->_song.undo_budget() / (1024 * 1024)));
 	for (int i = 0; i < NUM_RECENT; i++) {
 		if (i == 0 && mw->_asm_file == mw->_recent[i].filepath) {
 			Ruler_Config_Dialog::Ruler_Options ruler_config = mw->_ruler->get_options();
@@ -2745,11 +3019,10 @@ void Main_Window::export_it_cb(Fl_Widget *, Main_Window *mw) {
 	strcpy(filename, mw->_asm_file.c_str());
 	fl_filename_setext(filename, ".it");
 
-	if (mw->stopped()) {
-		mw->regenerate_it_module();
-	}
-
-	if (mw->_it_module->export_file(filename)) {
+	mw->finish_hot_swap();
+	// the native backend has no module to export
+	std::unique_ptr<IT_Module> it_module(mw->new_it_module());
+	if (it_module->export_file(filename)) {
 		const char *basename = fl_filename_name(filename);
 		mw->_status_message = "Dumped ";
 		mw->_status_message += basename;
@@ -2904,6 +3177,14 @@ void Main_Window::stereo_cb(Fl_Widget *w, Main_Window *mw) {
 	mw->_stereo_label->label(mw->stereo() ? "Stereo" : "Mono");
 }
 
+void Main_Window::native_apu_cb(Fl_Menu_ *, Main_Window *mw) {
+	// the backend changes the next time playback starts
+	if (mw->_song.loaded() && mw->stopped()) {
+		mw->regenerate_playback_module();
+		mw->update_song_status();
+	}
+}
+
 void Main_Window::channel_1_mute_cb(Fl_Widget *w, Main_Window *mw) {
 	if (w == mw->_channel_1_status_label) {
 		if (mw->channel_1_muted()) {
@@ -2916,8 +3197,8 @@ void Main_Window::channel_1_mute_cb(Fl_Widget *w, Main_Window *mw) {
 		Fl::focus(nullptr);
 	}
 	mw->_piano_roll->channel_1_muted(mw->channel_1_muted());
-	if (mw->_it_module) {
-		mw->_it_module->mute_channel(1, mw->channel_1_muted());
+	if (mw->_playback_module) {
+		mw->_playback_module->mute_channel(1, mw->channel_1_muted());
 	}
 	mw->update_channel_status();
 }
@@ -2934,8 +3215,8 @@ void Main_Window::channel_2_mute_cb(Fl_Widget *w, Main_Window *mw) {
 		Fl::focus(nullptr);
 	}
 	mw->_piano_roll->channel_2_muted(mw->channel_2_muted());
-	if (mw->_it_module) {
-		mw->_it_module->mute_channel(2, mw->channel_2_muted());
+	if (mw->_playback_module) {
+		mw->_playback_module->mute_channel(2, mw->channel_2_muted());
 	}
 	mw->update_channel_status();
 }
@@ -2952,8 +3233,8 @@ void Main_Window::channel_3_mute_cb(Fl_Widget *w, Main_Window *mw) {
 		Fl::focus(nullptr);
 	}
 	mw->_piano_roll->channel_3_muted(mw->channel_3_muted());
-	if (mw->_it_module) {
-		mw->_it_module->mute_channel(3, mw->channel_3_muted());
+	if (mw->_playback_module) {
+		mw->_playback_module->mute_channel(3, mw->channel_3_muted());
 	}
 	mw->update_channel_status();
 }
@@ -2970,8 +3251,8 @@ void Main_Window::channel_4_mute_cb(Fl_Widget *w, Main_Window *mw) {
 		Fl::focus(nullptr);
 	}
 	mw->_piano_roll->channel_4_muted(mw->channel_4_muted());
-	if (mw->_it_module) {
-		mw->_it_module->mute_channel(4, mw->channel_4_muted());
+	if (mw->_playback_module) {
+		mw->_playback_module->mute_channel(4, mw->channel_4_muted());
 	}
 	mw->update_channel_status();
 }
@@ -3678,7 +3959,7 @@ void Main_Window::resize_song_cb(Fl_Widget *, Main_Window *mw) {
 		mw->_status_message = "Resized song";
 		mw->_status_label->label(mw->_status_message.c_str());
 
-		mw->regenerate_it_module();
+		mw->regenerate_playback_module();
 
 		mw->update_active_controls();
 		mw->update_song_status();
@@ -4161,6 +4442,8 @@ void Main_Window::wave_editor_cb(Fl_Widget *, Main_Window *mw) {
 	mw->_wave_window->show(mw);
 
 	mw->_waves = mw->_wave_window->saved_waves();
+	// the editor may have saved within the same second as the last parse
+	mw->_project_cache.waves_mod_time = 0;
 
 	if (mw->_song.waves().size() > 15) {
 		mw->_waves.waves.insert(mw->_waves.waves.end(), mw->_song.waves().begin(), mw->_song.waves().begin() + 15);
@@ -4175,7 +4458,7 @@ void Main_Window::wave_editor_cb(Fl_Widget *, Main_Window *mw) {
 void Main_Window::reload_waves_cb(Fl_Widget *, Main_Window *mw) {
 	if (Fl::modal()) return;
 
-	if (!mw->load_waves()) {
+	if (!mw->load_waves(true)) {
 		return;
 	}
 
@@ -4202,6 +4485,9 @@ void Main_Window::drumkit_editor_cb(Fl_Widget *, Main_Window *mw) {
 	mw->_drumkit_window->show(mw);
 
 	mw->_drumkits = mw->_drumkit_window->saved_drumkits();
+	// the editor may have saved within the same second as the last parse
+	mw->_project_cache.drumkits_mod_time = 0;
+	mw->_project_cache.drum_samples = Drum_Samples(mw->_drumkits.drums);
 
 	mw->_piano_roll->set_channel_4_note_tooltips();
 
@@ -4211,7 +4497,7 @@ void Main_Window::drumkit_editor_cb(Fl_Widget *, Main_Window *mw) {
 void Main_Window::reload_drumkits_cb(Fl_Widget *, Main_Window *mw) {
 	if (Fl::modal()) return;
 
-	if (!mw->load_drumkits()) {
+	if (!mw->load_drumkits(true)) {
 		return;
 	}
 
@@ -4232,12 +4518,12 @@ void Main_Window::about_cb(Fl_Widget *, Main_Window *mw) {
 	mw->_about_dialog->show(mw);
 }
 
-void Main_Window::playback_thread(Main_Window *mw, std::future<void> kill_signal) {
+void Main_Window::playback_thread(Main_Window *mw) {
 	int error_count = 0;
 	int32_t tick = -1;
-	while (kill_signal.wait_for(std::chrono::milliseconds(8)) == std::future_status::timeout) {
+	while (mw->_audio_signal.wait(Playback_Module::fill_interval())) {
 		if (mw->_audio_mutex.try_lock()) {
-			IT_Module *mod = mw->_it_module;
+			Playback_Module *mod = mw->_playback_module;
 			if (mod && mod->playing()) {
 				bool success = mod->play();
 				if (success) {
@@ -4273,7 +4559,7 @@ void Main_Window::playback_thread(Main_Window *mw, std::future<void> kill_signal
 
 void Main_Window::sync_cb(Main_Window *mw) {
 	mw->_audio_mutex.lock();
-	IT_Module *mod = mw->_it_module;
+	Playback_Module *mod = mw->_playback_module;
 	if (mod && mod->playing() && mw->_tick > 0) {
 		mw->_piano_roll->highlight_tick(mw->_tick);
 	}
@@ -4282,13 +4568,14 @@ void Main_Window::sync_cb(Main_Window *mw) {
 		mw->_piano_roll->stop_following();
 		if (mod) mod->set_tick(0);
 		mw->update_active_controls();
+		mw->report_underruns();
 	}
 	mw->update_song_status();
 	mw->_sync_requested = false;
 	mw->_audio_mutex.unlock();
 }
 
-void Main_Window::interactive_thread(Main_Window *mw, std::future<void> kill_signal) {
+void Main_Window::interactive_thread(Main_Window *mw) {
 	int channel = 0;
 	int instrument = 0;
 	Pitch pitch = Pitch::REST;
@@ -4310,7 +4597,7 @@ void Main_Window::interactive_thread(Main_Window *mw, std::future<void> kill_sig
 	}
 
 	int error_count = 0;
-	while (kill_signal.wait_for(std::chrono::milliseconds(8)) == std::future_status::timeout) {
+	while (mw->_interactive_signal.wait(Playback_Module::fill_interval())) {
 		if (mw->_interactive_mutex.try_lock()) {
 			IT_Module *mod = mw->_interactive_module;
 			if (mod && mod->playing()) {
@@ -1,7 +1,9 @@
 #ifndef MAIN_WINDOW_H
 #define MAIN_WINDOW_H
 
-#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 #pragma warning(push, 0)
 #include <FL/Fl_Double_Window.H>
@@ -19,6 +21,7 @@
 #include "edit-context-menu.h"
 #include "note-properties.h"
 #include "it-module.h"
+#include "apu-module.h"
 #include "parse-waves.h"
 #include "parse-drumkits.h"
 #include "help-window.h"
@@ -36,6 +39,23 @@ struct Recent_Cache {
 	int pickup_offset = 0;
 };
 
+// the last project's parsed waves and drumkits, reused by its other songs
+// as long as their files keep the same size and modification time
+struct Project_Cache {
+	std::string waves_directory;
+	int64_t waves_size = 0;
+	int64_t waves_mod_time = 0;
+	Waves waves;
+	int32_t num_parsed_waves = 0;
+
+	std::string drumkits_directory;
+	int64_t drumkits_size = 0;
+	int64_t drumkits_mod_time = 0;
+	Drumkits drumkits;
+	int32_t num_parsed_drumkits = 0;
+	Drum_Samples drum_samples;
+};
+
 #define NEW_SONG_NAME "New Song"
 
 class Main_Window : public Fl_Double_Window {
@@ -125,7 +145,8 @@ private:
 	Ruler *_ruler = NULL;
 	Piano_Roll *_piano_roll = NULL;
 	Label
-		*_timestamp_label = NULL;
+		*_timestamp_label = NULL,
+		*_undo_memory_label = NULL;
 	Label_Button
 		*_tempo_label = NULL,
 		*_stereo_label = NULL,
@@ -138,12 +159,14 @@ private:
 	// Conditional menu items
 	Fl_Menu_Item
 		*_close_mi = NULL,
+		*_reload_mi = NULL,
 		*_save_mi = NULL,
 		*_save_as_mi = NULL,
 		*_play_pause_mi = NULL,
 		*_stop_mi = NULL,
 		*_loop_mi = NULL,
 		*_stereo_mi = NULL,
+		*_native_apu_mi = NULL,
 		*_step_backward_mi = NULL,
 		*_step_forward_mi = NULL,
 		*_skip_backward_mi = NULL,
@@ -204,6 +227,7 @@ private:
 	Modal_Dialog *_error_dialog, *_warning_dialog, *_success_dialog, *_confirm_dialog, *_about_dialog;
 	Song_Options_Dialog *_song_options_dialog;
 	Ruler_Config_Dialog *_ruler_config_dialog;
+	Song_Picker_Dialog *_song_picker_dialog;
 	Help_Window *_help_window;
 	Wave_Window *_wave_window;
 	Drumkit_Window *_drumkit_window;
@@ -215,8 +239,8 @@ private:
 	Song _song;
 	Waves _waves;
 	Drumkits _drumkits;
-	std::vector<std::vector<uint8_t>> _drum_samples;
-	IT_Module *_it_module = nullptr;
+	Project_Cache _project_cache;
+	Playback_Module *_playback_module = nullptr;
 	IT_Module *_interactive_module = nullptr;
 	int32_t _tick = -1;
 	bool _showed_it_warning = false;
@@ -230,10 +254,11 @@ private:
 	// Threads
 	std::thread _audio_thread;
 	std::mutex _audio_mutex;
-	std::promise<void> _audio_kill_signal;
+	Render_Signal _audio_signal;
+	std::thread _hot_swap_thread;
 	std::thread _interactive_thread;
 	std::mutex _interactive_mutex;
-	std::promise<void> _interactive_kill_signal;
+	Render_Signal _interactive_signal;
 	// Window size cache
 	int _wx, _wy, _ww, _wh;
 	float _scale = 1.0f;
@@ -251,6 +276,7 @@ public:
 	inline bool loop(void) const { return _loop_mi && !!_loop_mi->value(); }
 	inline bool loop_verification(void) const { return _loop_verification_mi && !!_loop_verification_mi->value(); }
 	inline bool stereo(void) const { return _stereo_mi && !!_stereo_mi->value(); }
+	inline bool native_apu(void) const { return _native_apu_mi && !!_native_apu_mi->value(); }
 	inline bool channel_1_muted(void) const { return _channel_1_mute_mi && !!_channel_1_mute_mi->value(); }
 	inline bool channel_2_muted(void) const { return _channel_2_mute_mi && !!_channel_2_mute_mi->value(); }
 	inline bool channel_3_muted(void) const { return _channel_3_mute_mi && !!_channel_3_mute_mi->value(); }
@@ -282,13 +308,14 @@ public:
 	const char *modified_filename(void);
 	int handle(int event) override;
 	void set_song_position(int32_t tick);
+	void hot_swap_playback_module();
 	void open_song(const char *filename);
 
 	bool song_loaded() const { return _song.loaded(); }
 
-	inline bool playing() const { return _it_module && _it_module->playing(); }
-	inline bool paused()  const { return _it_module && _it_module->paused(); }
-	inline bool stopped() const { return !_it_module || _it_module->stopped(); }
+	inline bool playing() const { return _playback_module && _playback_module->playing(); }
+	inline bool paused()  const { return _playback_module && _playback_module->paused(); }
+	inline bool stopped() const { return !_playback_module || _playback_module->stopped(); }
 
 	inline int selected_channel(void) const { return _selected_channel; }
 	inline Pitch playing_pitch(void) const { return _playing_pitch; }
@@ -339,17 +366,24 @@ private:
 	void apply_recent_config(const char *filename);
 	void store_recent_song(void);
 	void update_recent_songs(void);
-	void open_song(const char *directory, const char *filename);
+	void open_song(const char *directory, const char *filename, const std::string &song_label = "");
 	void open_recent(int n);
 	bool save_song(bool force);
-	bool load_waves();
-	bool load_drumkits();
-	void regenerate_it_module();
+	std::unique_ptr<Parsed_Waves> parse_waves(bool reload = false) const;
+	bool store_waves(std::unique_ptr<Parsed_Waves> parsed_waves);
+	bool load_waves(bool reload = false);
+	std::unique_ptr<Parsed_Drumkits> parse_drumkits(bool reload = false) const;
+	bool store_drumkits(std::unique_ptr<Parsed_Drumkits> parsed_drumkits);
+	bool load_drumkits(bool reload = false);
+	IT_Module *new_it_module(void) const;
+	void regenerate_playback_module();
 	void regenerate_interactive_module();
 	void toggle_playback();
 	void stop_playback();
+	void report_underruns();
 	void start_audio_thread();
 	void stop_audio_thread();
+	void finish_hot_swap();
 	void start_interactive_thread();
 	void stop_interactive_thread();
 	void update_icon_resolution(void);
@@ -360,6 +394,7 @@ private:
 	void update_song_status(void);
 	void update_timestamp(void);
 	void update_tempo(void);
+	void update_undo_memory(void);
 	void update_channel_status(void);
 	// File menu
 	static void new_cb(Fl_Widget *w, Main_Window *mw);
@@ -367,6 +402,7 @@ private:
 	static void open_recent_cb(Fl_Menu_ *m, Main_Window *mw);
 	static void clear_recent_cb(Fl_Widget *w, Main_Window *mw);
 	static void close_cb(Fl_Widget *w, Main_Window *mw);
+	static void reload_cb(Fl_Widget *w, Main_Window *mw);
 	static void save_cb(Fl_Widget *w, Main_Window *mw);
 	static void save_as_cb(Fl_Widget *w, Main_Window *mw);
 	static void exit_cb(Fl_Widget *w, Main_Window *mw);
@@ -378,6 +414,7 @@ private:
 	static void loop_cb(Fl_Menu_ *m, Main_Window *mw);
 	static void loop_verification_cb(Fl_Menu_ *m, Main_Window *mw);
 	static void stereo_cb(Fl_Widget *w, Main_Window *mw);
+	static void native_apu_cb(Fl_Menu_ *m, Main_Window *mw);
 	static void channel_1_mute_cb(Fl_Widget *w, Main_Window *mw);
 	static void channel_2_mute_cb(Fl_Widget *w, Main_Window *mw);
 	static void channel_3_mute_cb(Fl_Widget *w, Main_Window *mw);
@@ -476,9 +513,9 @@ private:
 	static void help_cb(Fl_Widget *w, Main_Window *mw);
 	static void about_cb(Fl_Widget *w, Main_Window *mw);
 	// Audio playback
-	static void playback_thread(Main_Window *mw, std::future<void> kill_signal);
+	static void playback_thread(Main_Window *mw);
 	static void sync_cb(Main_Window *mw);
-	static void interactive_thread(Main_Window *mw, std::future<void> kill_signal);
+	static void interactive_thread(Main_Window *mw);
 };
 
 #endif
@@ -825,3 +825,44 @@ int New_Name_Dialog::refresh_content(int ww, int dy, bool reset) {
 
 	return ch;
 }
+
+Song_Picker_Dialog::Song_Picker_Dialog(const char *t) : Option_Dialog(300, t) {}
+
+Song_Picker_Dialog::~Song_Picker_Dialog() {
+	delete _song_browser;
+}
+
+void Song_Picker_Dialog::initialize_content() {
+	// Populate content group
+	_song_browser = new OS_Browser(0, 0, 0, 0);
+	// Initialize content group's children
+	_song_browser->callback((Fl_Callback *)song_browser_cb, this);
+}
+
+int Song_Picker_Dialog::refresh_content(int ww, int dy, bool reset) {
+	int win_m = 10;
+	int dx = win_m;
+	int ch = 240;
+	_content->resize(dx, dy, ww, ch);
+
+	_song_browser->resize(dx, dy, ww, ch);
+	if (reset) {
+		_song_browser->clear();
+		for (const std::string &label : _song_labels) {
+			_song_browser->add(label.c_str());
+		}
+		_song_browser->value(1);
+	}
+
+	return ch;
+}
+
+void Song_Picker_Dialog::song_browser_cb(OS_Browser *b, Song_Picker_Dialog *spd) {
+	if (b->value() == 0) {
+		b->value(1);
+	}
+	else if (Fl::event_clicks()) {
+		// double-clicking a song picks it
+		spd->_dialog->hide();
+	}
+}
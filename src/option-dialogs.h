@@ -2,6 +2,7 @@
 #define OPTION_DIALOGS_H
 
 #include <string>
+#include <vector>
 
 #include "widgets.h"
 
@@ -141,4 +142,20 @@ protected:
 	int refresh_content(int ww, int dy, bool reset);
 };
 
+class Song_Picker_Dialog : public Option_Dialog {
+private:
+	OS_Browser *_song_browser = nullptr;
+	std::vector<std::string> _song_labels;
+public:
+	Song_Picker_Dialog(const char *t);
+	~Song_Picker_Dialog();
+	void set_songs(const std::vector<std::string> &labels) { _song_labels = labels; }
+	int picked_song(void) const { return _song_browser->value() - 1; }
+protected:
+	void initialize_content(void);
+	int refresh_content(int ww, int dy, bool reset);
+private:
+	static void song_browser_cb(OS_Browser *b, Song_Picker_Dialog *spd);
+};
+
 #endif
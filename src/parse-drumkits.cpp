@@ -6,6 +6,7 @@
 
 #include "parse-drumkits.h"
 
+#include "asm-reader.h"
 #include "utils.h"
 
 Parsed_Drumkits::Parsed_Drumkits(const char *d) {
@@ -84,10 +85,11 @@ Parsed_Drumkits::Result Parsed_Drumkits::parse_drumkits(const char *d) {
 	return _result;
 }
 
-static bool get_label(std::istringstream &iss, std::string &l, const std::string &scope = "") {
-	iss >> l;
-	rtrim(l, ":");
-	trim(l);
+static bool get_label(std::string_view s, std::string &l, const std::string &scope = "") {
+	trim(s);
+	s = s.substr(0, s.find_first_of(whitespace));
+	rtrim(s, ":");
+	l = s;
 	if (l.size() == 0) {
 		return false;
 	}
@@ -97,43 +99,41 @@ static bool get_label(std::istringstream &iss, std::string &l, const std::string
 	return true;
 }
 
-static bool get_number_and_number_and_number_and_number(std::istringstream &iss, int32_t &v1, int32_t &v2, int32_t &v3, int32_t &v4) {
-	std::string l;
-	std::getline(iss, l);
+static bool get_number_and_number_and_number_and_number(std::string_view l, int32_t &v1, int32_t &v2, int32_t &v3, int32_t &v4) {
 	size_t p = l.find(',');
-	if (p == std::string::npos) {
+	if (p == std::string_view::npos) {
 		return false;
 	}
 	if (!parse_value(l.substr(0, p), v1)) {
 		return false;
 	}
-	l.erase(0, p + 1);
+	l.remove_prefix(p + 1);
 	trim(l);
 	if (l.size() == 0) {
 		return false;
 	}
 
 	p = l.find(',');
-	if (p == std::string::npos) {
+	if (p == std::string_view::npos) {
 		return false;
 	}
 	if (!parse_value(l.substr(0, p), v2)) {
 		return false;
 	}
-	l.erase(0, p + 1);
+	l.remove_prefix(p + 1);
 	trim(l);
 	if (l.size() == 0) {
 		return false;
 	}
 
 	p = l.find(',');
-	if (p == std::string::npos) {
+	if (p == std::string_view::npos) {
 		return false;
 	}
 	if (!parse_value(l.substr(0, p), v3)) {
 		return false;
 	}
-	l.erase(0, p + 1);
+	l.remove_prefix(p + 1);
 	trim(l);
 	if (l.size() == 0) {
 		return false;
@@ -154,9 +154,9 @@ static int32_t find_drum(const std::vector<Drum> &drums, const std::string &labe
 	return -1;
 }
 
-static bool leading_pointer(std::istringstream &lss, bool &uses_dr) {
-	std::string macro;
-	if (!leading_macro(lss, macro)) { return false; }
+static bool leading_pointer(std::string_view &s, bool &uses_dr) {
+	std::string_view macro;
+	if (!leading_macro(s, macro)) { return false; }
 	bool relative = equals_ignore_case(macro, "dr");
 	if (!relative && !equals_ignore_case(macro, "dw")) { return false; }
 	uses_dr |= relative;
@@ -174,9 +174,8 @@ Parsed_Drumkits::Result Parsed_Drumkits::try_parse_drumkits(const char *f) {
 	_result = Result::DRUMKITS_NULL;
 	_line_number = 0;
 
-	std::ifstream ifs;
-	open_ifstream(ifs, f);
-	if (!ifs.good()) {
+	Asm_Reader reader(f);
+	if (!reader.good()) {
 		return (_result = Result::DRUMKITS_BAD_FILE);
 	}
 
@@ -195,22 +194,18 @@ Parsed_Drumkits::Result Parsed_Drumkits::try_parse_drumkits(const char *f) {
 	size_t drumkit_index = 0;
 	auto drum_itr = _drums.begin();
 
-	while (ifs.good()) {
-		std::string line;
-		std::getline(ifs, line);
+	std::string_view line;
+	while (reader.next_line(line)) {
 		_line_number += 1;
-		remove_comment(line);
-		rtrim(line);
 		if (line.size() == 0) { continue; }
 		bool indented = is_indented(line);
-		std::istringstream lss(line);
 
 		if (step == Step::LOOKING_FOR_DRUMKITS && indented) {
 			step = Step::READING_DRUMKITS;
 		}
 
 		if (step == Step::LOOKING_FOR_DRUMKITS) {
-			if (!get_label(lss, _drumkits_label)) {
+			if (!get_label(line, _drumkits_label)) {
 				return (_result = Result::DRUMKITS_INVALID_DRUMKITS_TABLE);
 			}
 			step = Step::READING_DRUMKITS;
@@ -223,17 +218,17 @@ Parsed_Drumkits::Result Parsed_Drumkits::try_parse_drumkits(const char *f) {
 				}
 				drumkit_itr = _drumkits.begin();
 				drumkit_index = 0;
-				ifs.seekg(0);
+				reader.rewind();
 				_line_number = 0;
 				_label = drumkit_itr->label;
 				step = Step::LOOKING_FOR_DRUMKIT;
 				continue;
 			}
-			if (!leading_pointer(lss, _uses_dr)) {
+			if (!leading_pointer(line, _uses_dr)) {
 				return (_result = Result::DRUMKITS_INVALID_DRUMKITS_TABLE);
 			}
 			Drumkit drumkit;
-			if (!get_label(lss, drumkit.label)) {
+			if (!get_label(line, drumkit.label)) {
 				return (_result = Result::DRUMKITS_INVALID_DRUMKITS_TABLE);
 			}
 			if (_drumkits.size() == 0) {
@@ -259,7 +254,7 @@ Parsed_Drumkits::Result Parsed_Drumkits::try_parse_drumkits(const char *f) {
 		else if (step == Step::LOOKING_FOR_DRUMKIT) {
 			if (indented) { continue; }
 			std::string label;
-			if (!get_label(lss, label)) {
+			if (!get_label(line, label)) {
 				continue;
 			}
 			if (label[0] == '.') label.erase(0, 1);
@@ -270,11 +265,11 @@ Parsed_Drumkits::Result Parsed_Drumkits::try_parse_drumkits(const char *f) {
 
 		else if (step == Step::READING_DRUMKIT) {
 			if (!indented) { continue; }
-			if (!leading_pointer(lss, _uses_dr)) {
+			if (!leading_pointer(line, _uses_dr)) {
 				return (_result = Result::DRUMKITS_INVALID_DRUMKIT);
 			}
 			std::string label;
-			if (!get_label(lss, label)) {
+			if (!get_label(line, label)) {
 				return (_result = Result::DRUMKITS_INVALID_DRUMKIT);
 			}
 			if (_uses_local) {
@@ -306,14 +301,14 @@ Parsed_Drumkits::Result Parsed_Drumkits::try_parse_drumkits(const char *f) {
 				drumkit_itr += 1;
 				if (drumkit_itr == _drumkits.end()) {
 					drum_itr = _drums.begin();
-					ifs.seekg(0);
+					reader.rewind();
 					_line_number = 0;
 					_label = drum_itr->label;
 					step = Step::LOOKING_FOR_DRUM;
 				}
 				else {
 					drumkit_index = 0;
-					ifs.seekg(0);
+					reader.rewind();
 					_line_number = 0;
 					_label = drumkit_itr->label;
 					step = Step::LOOKING_FOR_DRUMKIT;
@@ -324,7 +319,7 @@ Parsed_Drumkits::Result Parsed_Drumkits::try_parse_drumkits(const char *f) {
 		else if (step == Step::LOOKING_FOR_DRUM) {
 			if (indented) { continue; }
 			std::string label;
-			if (!get_label(lss, label)) {
+			if (!get_label(line, label)) {
 				continue;
 			}
 			if (label[0] == '.') label.erase(0, 1);
@@ -335,13 +330,13 @@ Parsed_Drumkits::Result Parsed_Drumkits::try_parse_drumkits(const char *f) {
 
 		else if (step == Step::READING_DRUM) {
 			if (!indented) { continue; }
-			std::string macro;
-			if (!leading_macro(lss, macro)) {
+			std::string_view macro;
+			if (!leading_macro(line, macro)) {
 				return (_result = Result::DRUMKITS_UNRECOGNIZED_MACRO);
 			}
 			if (macro == "noise_note") {
 				int32_t length, volume, fade, frequency;
-				if (!get_number_and_number_and_number_and_number(lss, length, volume, fade, frequency)) {
+				if (!get_number_and_number_and_number_and_number(line, length, volume, fade, frequency)) {
 					return (_result = Result::DRUMKITS_INVALID_MACRO_ARGUMENT);
 				}
 				if (length < 0 || length > 255) {
@@ -380,7 +375,7 @@ Parsed_Drumkits::Result Parsed_Drumkits::try_parse_drumkits(const char *f) {
 					break;
 				}
 				else {
-					ifs.seekg(0);
+					reader.rewind();
 					_line_number = 0;
 					_label = drum_itr->label;
 					step = Step::LOOKING_FOR_DRUM;
@@ -1,17 +1,23 @@
 #include <algorithm>
 #include <string>
-#include <fstream>
-#include <sstream>
+#include <string_view>
 #include <map>
 #include <set>
+#include <thread>
 
 #include "parse-song.h"
 
 #include "song.h"
+#include "asm-reader.h"
 #include "utils.h"
 
-Parsed_Song::Parsed_Song(const char *f) {
-	parse_song(f);
+Parsed_Song::Parsed_Song(const char *f, const std::string &song_label, const Song_Sections *previous) {
+	Asm_Reader reader(f);
+	parse_song(reader, song_label, previous);
+}
+
+Parsed_Song::Parsed_Song(Asm_Reader &reader, const std::string &song_label, const Song_Sections *previous) {
+	parse_song(reader, song_label, previous);
 }
 
 std::string Parsed_Song::get_error_message() const {
@@ -82,10 +88,11 @@ std::string Parsed_Song::get_error_message() const {
 	}
 }
 
-static bool get_label(std::istringstream &iss, std::string &l, const std::string &scope = "") {
-	iss >> l;
-	rtrim(l, ":");
-	trim(l);
+static bool get_label(std::string_view s, std::string &l, const std::string &scope = "") {
+	trim(s);
+	s = s.substr(0, s.find_first_of(whitespace));
+	rtrim(s, ":");
+	l = s;
 	if (l.size() == 0) {
 		return false;
 	}
@@ -95,17 +102,17 @@ static bool get_label(std::istringstream &iss, std::string &l, const std::string
 	return true;
 }
 
-static bool get_number_and_label(std::istringstream &iss, int32_t &v, std::string &l, const std::string &scope = "") {
-	std::getline(iss, l);
-	size_t p = l.find(',');
-	if (p == std::string::npos) {
+static bool get_number_and_label(std::string_view s, int32_t &v, std::string &l, const std::string &scope = "") {
+	size_t p = s.find(',');
+	if (p == std::string_view::npos) {
 		return false;
 	}
-	if (!parse_value(l.substr(0, p), v)) {
+	if (!parse_value(s.substr(0, p), v)) {
 		return false;
 	}
-	l.erase(0, p + 1);
-	trim(l);
+	s.remove_prefix(p + 1);
+	trim(s);
+	l = s;
 	if (l.size() == 0) {
 		return false;
 	}
@@ -115,26 +122,22 @@ static bool get_number_and_label(std::istringstream &iss, int32_t &v, std::strin
 	return true;
 }
 
-static bool get_number(std::istringstream &iss, int32_t &v) {
-	std::string l;
-	std::getline(iss, l);
+static bool get_number(std::string_view l, int32_t &v) {
 	if (!parse_value(l, v)) {
 		return false;
 	}
 	return true;
 }
 
-static bool get_number_and_number(std::istringstream &iss, int32_t &v1, int32_t &v2) {
-	std::string l;
-	std::getline(iss, l);
+static bool get_number_and_number(std::string_view l, int32_t &v1, int32_t &v2) {
 	size_t p = l.find(',');
-	if (p == std::string::npos) {
+	if (p == std::string_view::npos) {
 		return false;
 	}
 	if (!parse_value(l.substr(0, p), v1)) {
 		return false;
 	}
-	l.erase(0, p + 1);
+	l.remove_prefix(p + 1);
 	trim(l);
 	if (l.size() == 0) {
 		return false;
@@ -145,30 +148,28 @@ static bool get_number_and_number(std::istringstream &iss, int32_t &v1, int32_t
 	return true;
 }
 
-static bool get_number_and_number_and_number(std::istringstream &iss, int32_t &v1, int32_t &v2, int32_t &v3) {
-	std::string l;
-	std::getline(iss, l);
+static bool get_number_and_number_and_number(std::string_view l, int32_t &v1, int32_t &v2, int32_t &v3) {
 	size_t p = l.find(',');
-	if (p == std::string::npos) {
+	if (p == std::string_view::npos) {
 		return false;
 	}
 	if (!parse_value(l.substr(0, p), v1)) {
 		return false;
 	}
-	l.erase(0, p + 1);
+	l.remove_prefix(p + 1);
 	trim(l);
 	if (l.size() == 0) {
 		return false;
 	}
 
 	p = l.find(',');
-	if (p == std::string::npos) {
+	if (p == std::string_view::npos) {
 		return false;
 	}
 	if (!parse_value(l.substr(0, p), v2)) {
 		return false;
 	}
-	l.erase(0, p + 1);
+	l.remove_prefix(p + 1);
 	trim(l);
 	if (l.size() == 0) {
 		return false;
@@ -180,43 +181,41 @@ static bool get_number_and_number_and_number(std::istringstream &iss, int32_t &v
 	return true;
 }
 
-static bool get_number_and_number_and_number_and_number(std::istringstream &iss, int32_t &v1, int32_t &v2, int32_t &v3, int32_t &v4) {
-	std::string l;
-	std::getline(iss, l);
+static bool get_number_and_number_and_number_and_number(std::string_view l, int32_t &v1, int32_t &v2, int32_t &v3, int32_t &v4) {
 	size_t p = l.find(',');
-	if (p == std::string::npos) {
+	if (p == std::string_view::npos) {
 		return false;
 	}
 	if (!parse_value(l.substr(0, p), v1)) {
 		return false;
 	}
-	l.erase(0, p + 1);
+	l.remove_prefix(p + 1);
 	trim(l);
 	if (l.size() == 0) {
 		return false;
 	}
 
 	p = l.find(',');
-	if (p == std::string::npos) {
+	if (p == std::string_view::npos) {
 		return false;
 	}
 	if (!parse_value(l.substr(0, p), v2)) {
 		return false;
 	}
-	l.erase(0, p + 1);
+	l.remove_prefix(p + 1);
 	trim(l);
 	if (l.size() == 0) {
 		return false;
 	}
 
 	p = l.find(',');
-	if (p == std::string::npos) {
+	if (p == std::string_view::npos) {
 		return false;
 	}
 	if (!parse_value(l.substr(0, p), v3)) {
 		return false;
 	}
-	l.erase(0, p + 1);
+	l.remove_prefix(p + 1);
 	trim(l);
 	if (l.size() == 0) {
 		return false;
@@ -228,14 +227,12 @@ static bool get_number_and_number_and_number_and_number(std::istringstream &iss,
 	return true;
 }
 
-static bool get_bool_and_bool(std::istringstream &iss, int32_t &b1, int32_t &b2) {
-	std::string l;
-	std::getline(iss, l);
+static bool get_bool_and_bool(std::string_view l, int32_t &b1, int32_t &b2) {
 	size_t p = l.find(',');
-	if (p == std::string::npos) {
+	if (p == std::string_view::npos) {
 		return false;
 	}
-	std::string s = l.substr(0, p);
+	std::string_view s = l.substr(0, p);
 	if (s == "TRUE") {
 		b1 = true;
 	}
@@ -245,7 +242,7 @@ static bool get_bool_and_bool(std::istringstream &iss, int32_t &b1, int32_t &b2)
 	else {
 		return false;
 	}
-	l.erase(0, p + 1);
+	l.remove_prefix(p + 1);
 	trim(l);
 	if (l.size() == 0) {
 		return false;
@@ -262,7 +259,7 @@ static bool get_bool_and_bool(std::istringstream &iss, int32_t &b1, int32_t &b2)
 	return true;
 }
 
-static bool get_pitch_from_string(const std::string &s, Pitch &p) {
+static bool get_pitch_from_string(std::string_view s, Pitch &p) {
 	for (size_t i = 1; i <= NUM_PITCHES; ++i) {
 		if (s == PITCH_NAMES[i]) {
 			p = (Pitch)i;
@@ -272,19 +269,17 @@ static bool get_pitch_from_string(const std::string &s, Pitch &p) {
 	return false;
 }
 
-static bool get_pitch_and_number(std::istringstream &iss, Pitch &pitch, int32_t &v) {
-	std::string l;
-	std::getline(iss, l);
+static bool get_pitch_and_number(std::string_view l, Pitch &pitch, int32_t &v) {
 	size_t p = l.find(',');
-	if (p == std::string::npos) {
+	if (p == std::string_view::npos) {
 		return false;
 	}
-	std::string s = l.substr(0, p);
+	std::string_view s = l.substr(0, p);
 	trim(s);
 	if (!get_pitch_from_string(s, pitch)) {
 		return false;
 	}
-	l.erase(0, p + 1);
+	l.remove_prefix(p + 1);
 	trim(l);
 	if (l.size() == 0) {
 		return false;
@@ -295,30 +290,28 @@ static bool get_pitch_and_number(std::istringstream &iss, Pitch &pitch, int32_t
 	return true;
 }
 
-static bool get_number_and_number_and_pitch(std::istringstream &iss, int32_t &v1, int32_t &v2, Pitch &pitch) {
-	std::string l;
-	std::getline(iss, l);
+static bool get_number_and_number_and_pitch(std::string_view l, int32_t &v1, int32_t &v2, Pitch &pitch) {
 	size_t p = l.find(',');
-	if (p == std::string::npos) {
+	if (p == std::string_view::npos) {
 		return false;
 	}
 	if (!parse_value(l.substr(0, p), v1)) {
 		return false;
 	}
-	l.erase(0, p + 1);
+	l.remove_prefix(p + 1);
 	trim(l);
 	if (l.size() == 0) {
 		return false;
 	}
 
 	p = l.find(',');
-	if (p == std::string::npos) {
+	if (p == std::string_view::npos) {
 		return false;
 	}
 	if (!parse_value(l.substr(0, p), v2)) {
 		return false;
 	}
-	l.erase(0, p + 1);
+	l.remove_prefix(p + 1);
 	trim(l);
 	if (l.size() == 0) {
 		return false;
@@ -330,7 +323,7 @@ static bool get_number_and_number_and_pitch(std::istringstream &iss, int32_t &v1
 	return true;
 }
 
-static bool is_keyword(const std::string &str) {
+static bool is_keyword(std::string_view str) {
 	static const std::vector<std::string> keywords = {
 		"def",
 		"export",
@@ -357,62 +350,276 @@ static bool is_keyword(const std::string &str) {
 	return false;
 }
 
-Parsed_Song::Result Parsed_Song::parse_song(const char *f) {
+// macros are dispatched through a perfect hash of COMMAND_NAMES,
+// whose seed is searched for at compile time
+constexpr uint32_t MACRO_TABLE_FIRST_SEED = 2166136317u; // already perfect for the current names
+constexpr size_t MACRO_TABLE_SIZE = 128;
+
+static_assert(_countof(COMMAND_NAMES) <= MACRO_TABLE_SIZE / 2, "Macro table is too full");
+
+static constexpr size_t macro_slot(std::string_view macro, uint32_t seed) {
+	uint32_t h = seed;
+	for (char c : macro) {
+		h = (h ^ (uint8_t)c) * 16777619u;
+	}
+	h ^= h >> 16;
+	return h % MACRO_TABLE_SIZE;
+}
+
+struct Macro_Table {
+	uint32_t seed = 0;
+	int8_t command_types[MACRO_TABLE_SIZE] = {};
+};
+
+static constexpr Macro_Table make_macro_table() {
+	Macro_Table table;
+	for (uint32_t seed = MACRO_TABLE_FIRST_SEED; ; ++seed) {
+		for (size_t i = 0; i < MACRO_TABLE_SIZE; ++i) {
+			table.command_types[i] = -1;
+		}
+		bool perfect = true;
+		for (size_t i = 0; i < _countof(COMMAND_NAMES) && perfect; ++i) {
+			size_t slot = macro_slot(COMMAND_NAMES[i], seed);
+			perfect = table.command_types[slot] == -1;
+			table.command_types[slot] = (int8_t)i;
+		}
+		if (perfect) {
+			table.seed = seed;
+			return table;
+		}
+	}
+}
+
+static constexpr Macro_Table MACRO_TABLE = make_macro_table();
+
+static bool find_command_type(std::string_view macro, Command_Type &type) {
+	int8_t i = MACRO_TABLE.command_types[macro_slot(macro, MACRO_TABLE.seed)];
+	if (i == -1 || macro != COMMAND_NAMES[i]) {
+		return false;
+	}
+	type = (Command_Type)i;
+	return true;
+}
+
+// the tokenized song file, shared read-only by the channel parsers
+struct Song_Text {
+	std::vector<std::string_view> lines;
+	std::vector<std::string> line_labels;
+	std::map<std::string, int32_t> label_line_numbers;
+	std::map<std::string, std::string> label_scopes;
+	int32_t first_duplicate_line_number = 0;
+	std::string first_duplicate_label;
+};
+
+// one channel's results, merged into the song in channel order
+struct Parsed_Channel {
+	Parsed_Song::Result result = Parsed_Song::Result::SONG_NULL;
+	Command_List commands;
+	int32_t loop_tick = -1;
+	int32_t end_tick = -1;
+	std::vector<Wave> waves;
+	std::vector<std::string> visit_order;
+	Channel_Section section;
+
+	// for error reporting
+	int32_t line_number = 0;
+	std::string label;
+};
+
+// hashes lines `first` through `last`, counting from 1
+static uint64_t hash_lines(const Song_Text &text, int32_t first, int32_t last) {
+	uint64_t h = 14695981039346656037ull;
+	const auto hash_byte = [&h](uint8_t b) { h = (h ^ b) * 1099511628211ull; };
+	// a span that starts the file could gain labels above it
+	hash_byte(first == 1);
+	for (int32_t i = first; i <= last; ++i) {
+		for (char c : text.lines[i - 1]) {
+			hash_byte((uint8_t)c);
+		}
+		hash_byte('\n');
+	}
+	return h;
+}
+
+// a channel parses the same as before if every span it read is still there, unchanged;
+// labels are unique, so each span can only have moved as a whole
+static bool section_matches(const Song_Text &text, const Channel_Section &section) {
+	if (section.has_waves || section.spans.empty()) { return false; }
+	for (const Channel_Section::Span &span : section.spans) {
+		auto label_itr = text.label_line_numbers.find(span.label);
+		if (label_itr == text.label_line_numbers.end()) { return false; }
+		int32_t first = label_itr->second - span.offset;
+		int32_t last = first + span.length - 1;
+		if (first < 1 || last > (int32_t)text.lines.size() || hash_lines(text, first, last) != span.hash) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Parsed_Song::index_songs(const char *f, std::vector<Indexed_Song> &songs) {
+	songs.clear();
+
+	Asm_Reader reader(f);
+	if (!reader.good()) {
+		return false;
+	}
+
+	// a song is the last global label before a channel_count, followed by its channels
+	std::map<std::string, int32_t> label_line_numbers;
+	std::vector<std::vector<std::string>> song_channel_labels;
+	std::string label;
+	int32_t label_line_number = 0;
+	size_t label_begin = 0;
+	size_t code_end = 0, code_end_before_label = 0;
+	bool reading_channels = false;
+	int32_t line_number = 0;
+	std::string_view line;
+	while (reader.next_line(line)) {
+		line_number += 1;
+		if (line.size() == 0) { continue; }
+		if (!is_indented(line)) {
+			reading_channels = false;
+			std::string l;
+			if (get_label(line, l) && l[0] != '.') {
+				label_line_numbers.insert({ l, line_number });
+				label = std::move(l);
+				label_line_number = line_number;
+				label_begin = reader.line_begin();
+				code_end_before_label = code_end;
+			}
+		}
+		else {
+			std::string_view macro;
+			leading_macro(line, macro);
+			if (macro == "channel_count") {
+				reading_channels = label_line_number > 0 && (songs.empty() || songs.back().line_number != label_line_number);
+				if (reading_channels) {
+					if (!songs.empty()) {
+						songs.back().end = code_end_before_label;
+					}
+					Indexed_Song song;
+					song.label = label;
+					song.line_number = label_line_number;
+					song.begin = label_begin;
+					songs.push_back(std::move(song));
+					song_channel_labels.emplace_back();
+				}
+			}
+			else if (macro == "channel" && reading_channels) {
+				int32_t channel_number = 0;
+				std::string channel_label;
+				if (get_number_and_label(line, channel_number, channel_label)) {
+					song_channel_labels.back().push_back(std::move(channel_label));
+				}
+			}
+			else {
+				reading_channels = false;
+			}
+		}
+		code_end = reader.line_end();
+	}
+	if (!songs.empty()) {
+		songs.back().end = code_end;
+	}
+
+	// only a song whose channels are all within its own lines can be saved in place
+	for (size_t i = 0; i < songs.size(); ++i) {
+		Indexed_Song &song = songs[i];
+		int32_t next_line_number = i + 1 < songs.size() ? songs[i + 1].line_number : line_number + 1;
+		song.self_contained = true;
+		for (const std::string &channel_label : song_channel_labels[i]) {
+			auto label_itr = label_line_numbers.find(channel_label);
+			if (label_itr == label_line_numbers.end() || label_itr->second < song.line_number || label_itr->second >= next_line_number) {
+				song.self_contained = false;
+				break;
+			}
+		}
+	}
+
+	return true;
+}
+
+Parsed_Song::Result Parsed_Song::parse_song(Asm_Reader &reader, const std::string &song_label, const Song_Sections *previous) {
 	_line_number = 0;
 	_channel_number = 0;
 	_label = "";
 	_mixed_labels.clear();
 
-	std::ifstream ifs;
-	open_ifstream(ifs, f);
-	if (!ifs.good()) {
+	if (!reader.good()) {
 		return (_result = Result::SONG_BAD_FILE);
 	}
 
-	enum class Step { LOOKING_FOR_HEADER, READING_HEADER, LOOKING_FOR_CHANNEL, READING_CHANNEL, DONE };
+	// read the whole file once, indexing every label by its line number
+	Song_Text text;
+	{
+		std::string scope;
+		std::string_view line;
+		while (reader.next_line(line)) {
+			std::string label;
+			if (line.size() > 0 && !is_indented(line)) {
+				if (get_label(line, label)) {
+					if (label[0] == '.') {
+						label = scope + label;
+					}
+					else {
+						scope = label;
+					}
+					int32_t line_number = (int32_t)text.lines.size() + 1;
+					if (!text.label_line_numbers.count(label)) {
+						text.label_line_numbers.insert({ label, line_number });
+						text.label_scopes.insert({ label, scope });
+					}
+					else if (text.first_duplicate_line_number == 0) {
+						text.first_duplicate_line_number = line_number;
+						text.first_duplicate_label = label;
+					}
+				}
+			}
+			text.lines.push_back(line);
+			text.line_labels.push_back(std::move(label));
+		}
+	}
 
-	Step step = Step::LOOKING_FOR_HEADER;
-	std::vector<Command> *current_channel_commands;
-	int32_t *current_channel_loop_tick;
-	int32_t *current_channel_end_tick;
-	std::string current_scope;
+	// a chosen song is read from its own header, wherever it is in the file
+	if (song_label.size() > 0) {
+		auto label_itr = text.label_line_numbers.find(song_label);
+		if (label_itr == text.label_line_numbers.end()) {
+			return (_result = Result::SONG_INVALID_HEADER);
+		}
+		_line_number = label_itr->second - 1;
+	}
 
-	std::set<std::string> visited_labels;
-	std::set<std::string> unvisited_labels;
-	std::vector<std::string> buffered_labels;
+	enum class Step { LOOKING_FOR_HEADER, READING_HEADER, DONE };
 
-	std::set<std::string> all_song_labels;
-	std::map<std::string, int32_t> label_line_numbers;
+	Step step = Step::LOOKING_FOR_HEADER;
+	int32_t header_line_number = 0;
 
-	while (ifs.good()) {
-		std::string line;
-		std::getline(ifs, line);
+	while (step != Step::DONE && _line_number < (int32_t)text.lines.size()) {
+		std::string_view line = text.lines[_line_number];
 		_line_number += 1;
-		remove_comment(line);
-		rtrim(line);
 		if (line.size() == 0) { continue; }
 		bool indented = is_indented(line);
-		std::istringstream lss(line);
 
 		if (step == Step::LOOKING_FOR_HEADER) {
 			if (indented) {
 				return (_result = Result::SONG_INVALID_HEADER);
 			}
-			if (!get_label(lss, _song_name)) {
+			if (!get_label(line, _song_name)) {
 				return (_result = Result::SONG_INVALID_HEADER);
 			}
-			label_line_numbers.insert({ _song_name, _line_number });
+			header_line_number = _line_number;
 			step = Step::READING_HEADER;
 		}
 
 		else if (step == Step::READING_HEADER) {
 			if (!indented) { continue; } // maybe a distracting label or something
 			if (_number_of_channels == 0) {
-				std::string macro;
-				if (!leading_macro(lss, macro, "channel_count")) {
+				std::string_view macro;
+				if (!leading_macro(line, macro, "channel_count")) {
 					return (_result = Result::SONG_INVALID_HEADER);
 				}
-				if (!get_number(lss, _number_of_channels)) {
+				if (!get_number(line, _number_of_channels)) {
 					return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
 				}
 				if (_number_of_channels < 1 || _number_of_channels > 4) {
@@ -420,13 +627,13 @@ Parsed_Song::Result Parsed_Song::parse_song(const char *f) {
 				}
 			}
 			else {
-				std::string macro;
-				if (!leading_macro(lss, macro, "channel")) {
+				std::string_view macro;
+				if (!leading_macro(line, macro, "channel")) {
 					return (_result = Result::SONG_INVALID_HEADER);
 				}
 				int32_t channel_number = 0;
 				std::string label;
-				if (!get_number_and_label(lss, channel_number, label)) {
+				if (!get_number_and_label(line, channel_number, label)) {
 					return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
 				}
 				if (channel_number < 1 || channel_number > 4) {
@@ -449,51 +656,170 @@ Parsed_Song::Result Parsed_Song::parse_song(const char *f) {
 					if (num_labelled_channels != _number_of_channels) {
 						return (_result = Result::SONG_INVALID_HEADER);
 					}
-					if (_channel_1_label.size() > 0) {
-						_channel_number = 1;
-						_label = _channel_1_label;
-						current_channel_commands = &_channel_1_commands;
-						current_channel_loop_tick = &_channel_1_loop_tick;
-						current_channel_end_tick = &_channel_1_end_tick;
-					}
-					else if (_channel_2_label.size() > 0) {
-						_channel_number = 2;
-						_label = _channel_2_label;
-						current_channel_commands = &_channel_2_commands;
-						current_channel_loop_tick = &_channel_2_loop_tick;
-						current_channel_end_tick = &_channel_2_end_tick;
-					}
-					else if (_channel_3_label.size() > 0) {
-						_channel_number = 3;
-						_label = _channel_3_label;
-						current_channel_commands = &_channel_3_commands;
-						current_channel_loop_tick = &_channel_3_loop_tick;
-						current_channel_end_tick = &_channel_3_end_tick;
-					}
-					else { // if (_channel_4_label.size() > 0)
-						_channel_number = 4;
-						_label = _channel_4_label;
-						current_channel_commands = &_channel_4_commands;
-						current_channel_loop_tick = &_channel_4_loop_tick;
-						current_channel_end_tick = &_channel_4_end_tick;
-					}
-					current_scope = "";
-					visited_labels.clear();
-					unvisited_labels.clear();
-					ifs.seekg(0);
-					_line_number = 0;
-					step = Step::LOOKING_FOR_CHANNEL;
+					step = Step::DONE;
 				}
 			}
 		}
+	}
 
-		else if (step == Step::LOOKING_FOR_CHANNEL) {
-			if (indented) {
-				buffered_labels.clear();
-				continue;
+	if (step != Step::DONE) {
+		return (_result = Result::SONG_INVALID_HEADER);
+	}
+
+	// channels whose lines are unchanged since `previous` are not parsed again
+	_sections.header_hash = hash_lines(text, header_line_number, _line_number);
+	bool reuse = previous && previous->valid && previous->header_hash == _sections.header_hash && text.first_duplicate_line_number == 0;
+
+	// channels only share the tokenized text, so they are all parsed at once,
+	// the last one on this thread
+	const std::string *channel_labels[4] = { &_channel_1_label, &_channel_2_label, &_channel_3_label, &_channel_4_label };
+	Parsed_Channel channels[4];
+	std::vector<std::thread> workers;
+	bool parallel = std::thread::hardware_concurrency() > 1;
+	int32_t num_unparsed_channels = 0;
+	for (int32_t i = 0; i < 4; ++i) {
+		if (channel_labels[i]->size() == 0) {
+			// an unchanged header has the same unused channels
+			_channel_reused[i] = reuse;
+			continue;
+		}
+		if (reuse && section_matches(text, previous->channels[i])) {
+			_channel_reused[i] = true;
+			channels[i].result = Result::SONG_OK;
+			channels[i].section = previous->channels[i];
+			channels[i].visit_order = channels[i].section.visit_order;
+		}
+		else {
+			num_unparsed_channels += 1;
+		}
+	}
+	for (int32_t i = 0; i < 4; ++i) {
+		if (channel_labels[i]->size() == 0 || _channel_reused[i]) { continue; }
+		num_unparsed_channels -= 1;
+		if (parallel && num_unparsed_channels > 0) {
+			workers.emplace_back(parse_channel, std::cref(text), i + 1, std::cref(*channel_labels[i]), std::ref(channels[i]));
+		}
+		else {
+			parse_channel(text, i + 1, *channel_labels[i], channels[i]);
+		}
+	}
+	for (std::thread &worker : workers) {
+		worker.join();
+	}
+
+	// merge in channel order, so mixed labels and errors are reported as if the channels were parsed one by one
+	Command_List *channel_commands[4] = { &_channel_1_commands, &_channel_2_commands, &_channel_3_commands, &_channel_4_commands };
+	int32_t *channel_loop_ticks[4] = { &_channel_1_loop_tick, &_channel_2_loop_tick, &_channel_3_loop_tick, &_channel_4_loop_tick };
+	int32_t *channel_end_ticks[4] = { &_channel_1_end_tick, &_channel_2_end_tick, &_channel_3_end_tick, &_channel_4_end_tick };
+	std::set<std::string> all_song_labels;
+	for (int32_t i = 0; i < 4; ++i) {
+		if (channel_labels[i]->size() == 0) { continue; }
+		Parsed_Channel &channel = channels[i];
+		for (const std::string &l : channel.visit_order) {
+			if (all_song_labels.count(l) && !std::count(RANGE(_mixed_labels), l)) {
+				_mixed_labels.push_back(l);
+			}
+		}
+		_channel_number = i + 1;
+		if (channel.result != Result::SONG_OK) {
+			_line_number = channel.line_number;
+			_label = channel.label;
+			return (_result = channel.result);
+		}
+		all_song_labels.insert(RANGE(channel.visit_order));
+		*channel_commands[i] = std::move(channel.commands);
+		*channel_loop_ticks[i] = channel.loop_tick;
+		*channel_end_ticks[i] = channel.end_tick;
+		_waves.insert(_waves.end(), RANGE(channel.waves));
+		if (!_channel_reused[i]) {
+			channel.section.visit_order = std::move(channel.visit_order);
+			channel.section.has_waves = !channel.waves.empty();
+		}
+		_sections.channels[i] = std::move(channel.section);
+	}
+
+	_sections.valid = true;
+	return (_result = Result::SONG_OK);
+}
+
+Parsed_Song::Result Parsed_Song::parse_channel(const Song_Text &text, int32_t channel_number, const std::string &channel_label, Parsed_Channel &channel) {
+	channel.label = channel_label;
+
+	std::string current_scope;
+	std::set<std::string> visited_labels;
+	std::set<std::string> unvisited_labels;
+	std::vector<std::string> buffered_labels;
+
+	// continue reading from the line of `channel.label`, as if the file had been scanned up to it
+	const auto seek_label = [&]() {
+		auto label_itr = text.label_line_numbers.find(channel.label);
+		int32_t label_line_number = label_itr != text.label_line_numbers.end() ? label_itr->second : (int32_t)text.lines.size() + 1;
+		if (text.first_duplicate_line_number != 0 && text.first_duplicate_line_number < label_line_number) {
+			channel.line_number = text.first_duplicate_line_number;
+			channel.label = text.first_duplicate_label;
+			return Result::SONG_DUPLICATE_LABEL;
+		}
+		if (label_itr == text.label_line_numbers.end()) {
+			channel.line_number = (int32_t)text.lines.size();
+			return Result::SONG_UNRECOGNIZED_LABEL;
+		}
+
+		// labels on the lines directly above the target label also label its first command
+		int32_t first_label_line_number = label_line_number;
+		while (first_label_line_number > 1) {
+			std::string_view line = text.lines[first_label_line_number - 2];
+			if (is_indented(line)) { break; }
+			first_label_line_number -= 1;
+		}
+		buffered_labels.clear();
+		for (int32_t i = first_label_line_number; i <= label_line_number; ++i) {
+			const std::string &l = text.line_labels[i - 1];
+			if (l.size() > 0 && !std::count(RANGE(buffered_labels), l)) {
+				buffered_labels.push_back(l);
+			}
+		}
+		for (const std::string &l : buffered_labels) {
+			if (is_keyword(l)) {
+				channel.line_number = label_line_number;
+				return Result::SONG_UNSUPPORTED_KEYWORD;
 			}
+			if (visited_labels.insert(l).second) {
+				channel.visit_order.push_back(l);
+			}
+			unvisited_labels.erase(l);
+		}
+
+		// the line above the labels is read too, since it ends them
+		int32_t span_start = std::max(first_label_line_number - 1, 1);
+		channel.section.spans.push_back({ channel.label, label_line_number - span_start });
+
+		current_scope = text.label_scopes.at(channel.label);
+		channel.line_number = label_line_number;
+		return Result::SONG_OK;
+	};
+
+	const auto end_span = [&]() {
+		Channel_Section::Span &span = channel.section.spans.back();
+		int32_t span_start = text.label_line_numbers.at(span.label) - span.offset;
+		span.length = channel.line_number - span_start + 1;
+		span.hash = hash_lines(text, span_start, channel.line_number);
+	};
+
+	Result r = seek_label();
+	if (r != Result::SONG_OK) {
+		return (channel.result = r);
+	}
+
+	while (channel.line_number < (int32_t)text.lines.size()) {
+		std::string_view line = text.lines[channel.line_number];
+		channel.line_number += 1;
+		if (line.size() == 0) { continue; }
+		bool indented = is_indented(line);
+
+		bool done_with_branch = false;
+		if (!indented) {
 			std::string label;
-			if (!get_label(lss, label)) {
+			if (!get_label(line, label)) {
 				continue;
 			}
 			if (label[0] == '.') {
@@ -502,631 +828,561 @@ Parsed_Song::Result Parsed_Song::parse_song(const char *f) {
 			else {
 				current_scope = label;
 			}
-			if (label_line_numbers.count(label) && label_line_numbers.at(label) != _line_number) {
-				_label = label;
-				return (_result = Result::SONG_DUPLICATE_LABEL);
+			if (text.label_line_numbers.count(label) && text.label_line_numbers.at(label) != channel.line_number) {
+				channel.label = label;
+				return (channel.result = Result::SONG_DUPLICATE_LABEL);
 			}
-			label_line_numbers.insert({ label, _line_number });
 			if (!std::count(RANGE(buffered_labels), label)) {
 				buffered_labels.push_back(label);
 			}
-			if (label == _label) {
-				for (const std::string &l : buffered_labels) {
-					if (is_keyword(l)) {
-						return (_result = Result::SONG_UNSUPPORTED_KEYWORD);
-					}
-					if (all_song_labels.count(l) && !std::count(RANGE(_mixed_labels), l)) {
-						_mixed_labels.push_back(l);
-					}
-					visited_labels.insert(l);
-					unvisited_labels.erase(l);
+			if (visited_labels.count(label)) {
+				Command jump_command(Command_Type::SOUND_JUMP);
+				jump_command.target = label;
+				channel.commands.push_back(jump_command);
+				done_with_branch = true;
+			}
+			else {
+				if (is_keyword(label)) {
+					return (channel.result = Result::SONG_UNSUPPORTED_KEYWORD);
 				}
-				step = Step::READING_CHANNEL;
+				visited_labels.insert(label);
+				channel.visit_order.push_back(label);
+				unvisited_labels.erase(label);
+				continue;
 			}
 		}
-
-		else if (step == Step::READING_CHANNEL) {
-			bool done_with_branch = false;
-			if (!indented) {
-				std::string label;
-				if (!get_label(lss, label)) {
-					continue;
+		else {
+			std::string_view macro;
+			Command_Type command_type;
+			if (!leading_macro(line, macro) || !find_command_type(macro, command_type)) {
+				return (channel.result = Result::SONG_UNRECOGNIZED_MACRO);
+			}
+			Command command;
+			command.labels = std::vector<Label>(RANGE(buffered_labels));
+			buffered_labels.clear();
+			switch (command_type) {
+			case Command_Type::NOTE: {
+				if (channel_number == 4) {
+					return (channel.result = Result::SONG_ILLEGAL_MACRO);
 				}
-				if (label[0] == '.') {
-					label = current_scope + label;
+				command.type = Command_Type::NOTE;
+				if (!get_pitch_and_number(line, command.note.pitch, command.note.length)) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 				}
-				else {
-					current_scope = label;
+				if (command.note.length < 1 || command.note.length > 16) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 				}
-				if (label_line_numbers.count(label) && label_line_numbers.at(label) != _line_number) {
-					_label = label;
-					return (_result = Result::SONG_DUPLICATE_LABEL);
+				channel.commands.push_back(command);
+				break;
+			}
+
+			case Command_Type::DRUM_NOTE: {
+				if (channel_number != 4) {
+					return (channel.result = Result::SONG_ILLEGAL_MACRO);
 				}
-				label_line_numbers.insert({ label, _line_number });
-				if (!std::count(RANGE(buffered_labels), label)) {
-					buffered_labels.push_back(label);
+				command.type = Command_Type::DRUM_NOTE;
+				if (!get_number_and_number(line, command.drum_note.instrument, command.drum_note.length)) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 				}
-				if (visited_labels.count(label)) {
-					Command jump_command(Command_Type::SOUND_JUMP);
-					jump_command.target = label;
-					current_channel_commands->push_back(jump_command);
-					done_with_branch = true;
+				if (command.drum_note.instrument < 1 || command.drum_note.instrument > 12) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 				}
-				else {
-					if (is_keyword(label)) {
-						return (_result = Result::SONG_UNSUPPORTED_KEYWORD);
-					}
-					if (all_song_labels.count(label) && !std::count(RANGE(_mixed_labels), label)) {
-						_mixed_labels.push_back(label);
-					}
-					visited_labels.insert(label);
-					unvisited_labels.erase(label);
-					continue;
+				if (command.drum_note.length < 1 || command.drum_note.length > 16) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 				}
+				channel.commands.push_back(command);
+				break;
 			}
-			else {
-				std::string macro;
-				if (!leading_macro(lss, macro)) {
-					return (_result = Result::SONG_UNRECOGNIZED_MACRO);
-				}
-				Command command;
-				command.labels = std::move(buffered_labels);
-				buffered_labels.clear();
-				if (macro == "note") {
-					if (_channel_number == 4) {
-						return (_result = Result::SONG_ILLEGAL_MACRO);
-					}
-					command.type = Command_Type::NOTE;
-					if (!get_pitch_and_number(lss, command.note.pitch, command.note.length)) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					if (command.note.length < 1 || command.note.length > 16) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					current_channel_commands->push_back(command);
-				}
 
-				else if (macro == "drum_note") {
-					if (_channel_number != 4) {
-						return (_result = Result::SONG_ILLEGAL_MACRO);
-					}
-					command.type = Command_Type::DRUM_NOTE;
-					if (!get_number_and_number(lss, command.drum_note.instrument, command.drum_note.length)) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					if (command.drum_note.instrument < 1 || command.drum_note.instrument > 12) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					if (command.drum_note.length < 1 || command.drum_note.length > 16) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					current_channel_commands->push_back(command);
+			case Command_Type::REST: {
+				command.type = Command_Type::REST;
+				if (!get_number(line, command.rest.length)) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 				}
-
-				else if (macro == "rest") {
-					command.type = Command_Type::REST;
-					if (!get_number(lss, command.rest.length)) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					if (command.rest.length < 1 || command.rest.length > 16) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					current_channel_commands->push_back(command);
+				if (command.rest.length < 1 || command.rest.length > 16) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 				}
+				channel.commands.push_back(command);
+				break;
+			}
 
-				else if (macro == "octave") {
-					command.type = Command_Type::OCTAVE;
-					if (!get_number(lss, command.octave.octave)) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					if (command.octave.octave < 1 || command.octave.octave > 8) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					current_channel_commands->push_back(command);
+			case Command_Type::OCTAVE: {
+				command.type = Command_Type::OCTAVE;
+				if (!get_number(line, command.octave.octave)) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 				}
-
-				else if (macro == "note_type") {
-					if (_channel_number == 4) {
-						return (_result = Result::SONG_ILLEGAL_MACRO);
-					}
-					if (_channel_number == 3) {
-						command.type = Command_Type::NOTE_TYPE;
-						if (!get_number_and_number_and_number(lss, command.note_type.speed, command.note_type.volume, command.note_type.wave)) {
-							return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-						}
-						if (command.note_type.speed < 1 || command.note_type.speed > 15) {
-							return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-						}
-						if (command.note_type.volume < 0 || command.note_type.volume > 3) {
-							return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-						}
-						if (command.note_type.wave < 0 || command.note_type.wave > 15) {
-							return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-						}
-						current_channel_commands->push_back(command);
-					}
-					else {
-						command.type = Command_Type::NOTE_TYPE;
-						if (!get_number_and_number_and_number(lss, command.note_type.speed, command.note_type.volume, command.note_type.fade)) {
-							return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-						}
-						if (command.note_type.speed < 1 || command.note_type.speed > 15) {
-							return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-						}
-						if (command.note_type.volume < 0 || command.note_type.volume > 15) {
-							return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-						}
-						if (command.note_type.fade == 8) command.note_type.fade = 0; // 8 is used in place of 0
-						if (command.note_type.fade < -7 || command.note_type.fade > 7) {
-							return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-						}
-						current_channel_commands->push_back(command);
-					}
+				if (command.octave.octave < 1 || command.octave.octave > 8) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 				}
+				channel.commands.push_back(command);
+				break;
+			}
 
-				else if (macro == "drum_speed") {
-					if (_channel_number != 4) {
-						return (_result = Result::SONG_ILLEGAL_MACRO);
+			case Command_Type::NOTE_TYPE: {
+				if (channel_number == 4) {
+					return (channel.result = Result::SONG_ILLEGAL_MACRO);
+				}
+				if (channel_number == 3) {
+					command.type = Command_Type::NOTE_TYPE;
+					if (!get_number_and_number_and_number(line, command.note_type.speed, command.note_type.volume, command.note_type.wave)) {
+						return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+					}
+					if (command.note_type.speed < 1 || command.note_type.speed > 15) {
+						return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 					}
-					command.type = Command_Type::DRUM_SPEED;
-					if (!get_number(lss, command.drum_speed.speed)) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
+					if (command.note_type.volume < 0 || command.note_type.volume > 3) {
+						return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 					}
-					if (command.drum_speed.speed < 1 || command.drum_speed.speed > 15) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
+					if (command.note_type.wave < 0 || command.note_type.wave > 15) {
+						return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 					}
-					current_channel_commands->push_back(command);
+					channel.commands.push_back(command);
 				}
-
-				else if (macro == "transpose") {
-					if (_channel_number == 4) {
-						return (_result = Result::SONG_ILLEGAL_MACRO);
+				else {
+					command.type = Command_Type::NOTE_TYPE;
+					if (!get_number_and_number_and_number(line, command.note_type.speed, command.note_type.volume, command.note_type.fade)) {
+						return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 					}
-					command.type = Command_Type::TRANSPOSE;
-					if (!get_number_and_number(lss, command.transpose.num_octaves, command.transpose.num_pitches)) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
+					if (command.note_type.speed < 1 || command.note_type.speed > 15) {
+						return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 					}
-					if (command.transpose.num_octaves < 0 || command.transpose.num_octaves > 7) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
+					if (command.note_type.volume < 0 || command.note_type.volume > 15) {
+						return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 					}
-					if (command.transpose.num_pitches < 0 || command.transpose.num_pitches > 15) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
+					if (command.note_type.fade == 8) command.note_type.fade = 0; // 8 is used in place of 0
+					if (command.note_type.fade < -7 || command.note_type.fade > 7) {
+						return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 					}
-					current_channel_commands->push_back(command);
+					channel.commands.push_back(command);
 				}
+				break;
+			}
 
-				else if (macro == "tempo") {
-					command.type = Command_Type::TEMPO;
-					if (!get_number(lss, command.tempo.tempo)) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					if (command.tempo.tempo < 1 || command.tempo.tempo > 1024) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					current_channel_commands->push_back(command);
+			case Command_Type::DRUM_SPEED: {
+				if (channel_number != 4) {
+					return (channel.result = Result::SONG_ILLEGAL_MACRO);
 				}
-
-				else if (macro == "duty_cycle") {
-					if (_channel_number != 1 && _channel_number != 2) {
-						return (_result = Result::SONG_ILLEGAL_MACRO);
-					}
-					command.type = Command_Type::DUTY_CYCLE;
-					if (!get_number(lss, command.duty_cycle.duty)) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					if (command.duty_cycle.duty < 0 || command.duty_cycle.duty > 3) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					current_channel_commands->push_back(command);
+				command.type = Command_Type::DRUM_SPEED;
+				if (!get_number(line, command.drum_speed.speed)) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				if (command.drum_speed.speed < 1 || command.drum_speed.speed > 15) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 				}
+				channel.commands.push_back(command);
+				break;
+			}
 
-				else if (macro == "volume_envelope") {
-					if (_channel_number == 4) {
-						return (_result = Result::SONG_ILLEGAL_MACRO);
-					}
-					if (_channel_number == 3) {
-						command.type = Command_Type::VOLUME_ENVELOPE;
-						if (!get_number_and_number(lss, command.volume_envelope.volume, command.volume_envelope.wave)) {
-							return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-						}
-						if (command.volume_envelope.volume < 0 || command.volume_envelope.volume > 3) {
-							return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-						}
-						if (command.volume_envelope.wave < 0 || command.volume_envelope.wave > 15) {
-							return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-						}
-						current_channel_commands->push_back(command);
-					}
-					else {
-						command.type = Command_Type::VOLUME_ENVELOPE;
-						if (!get_number_and_number(lss, command.volume_envelope.volume, command.volume_envelope.fade)) {
-							return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-						}
-						if (command.volume_envelope.volume < 0 || command.volume_envelope.volume > 15) {
-							return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-						}
-						if (command.volume_envelope.fade == 8) command.volume_envelope.fade = 0; // 8 is used in place of 0
-						if (command.volume_envelope.fade < -7 || command.volume_envelope.fade > 7) {
-							return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-						}
-						current_channel_commands->push_back(command);
-					}
+			case Command_Type::TRANSPOSE: {
+				if (channel_number == 4) {
+					return (channel.result = Result::SONG_ILLEGAL_MACRO);
 				}
+				command.type = Command_Type::TRANSPOSE;
+				if (!get_number_and_number(line, command.transpose.num_octaves, command.transpose.num_pitches)) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				if (command.transpose.num_octaves < 0 || command.transpose.num_octaves > 7) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				if (command.transpose.num_pitches < 0 || command.transpose.num_pitches > 15) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				channel.commands.push_back(command);
+				break;
+			}
 
-				else if (macro == "pitch_sweep") {
-					if (_channel_number != 1) {
-						return (_result = Result::SONG_ILLEGAL_MACRO);
-					}
-					command.type = Command_Type::PITCH_SWEEP;
-					if (!get_number_and_number(lss, command.pitch_sweep.duration, command.pitch_sweep.pitch_change)) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					if (command.pitch_sweep.duration < 0 || command.pitch_sweep.duration > 15) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					if (command.pitch_sweep.pitch_change == 8) command.pitch_sweep.pitch_change = 0; // 8 is used in place of 0
-					if (command.pitch_sweep.pitch_change < -7 || command.pitch_sweep.pitch_change > 7) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					current_channel_commands->push_back(command);
+			case Command_Type::TEMPO: {
+				command.type = Command_Type::TEMPO;
+				if (!get_number(line, command.tempo.tempo)) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 				}
+				if (command.tempo.tempo < 1 || command.tempo.tempo > 1024) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				channel.commands.push_back(command);
+				break;
+			}
 
-				else if (macro == "duty_cycle_pattern") {
-					if (_channel_number != 1 && _channel_number != 2) {
-						return (_result = Result::SONG_ILLEGAL_MACRO);
-					}
-					command.type = Command_Type::DUTY_CYCLE_PATTERN;
-					if (!get_number_and_number_and_number_and_number(lss, command.duty_cycle_pattern.duty1, command.duty_cycle_pattern.duty2, command.duty_cycle_pattern.duty3, command.duty_cycle_pattern.duty4)) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					if (command.duty_cycle_pattern.duty1 < 0 || command.duty_cycle_pattern.duty1 > 3) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					if (command.duty_cycle_pattern.duty2 < 0 || command.duty_cycle_pattern.duty2 > 3) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					if (command.duty_cycle_pattern.duty3 < 0 || command.duty_cycle_pattern.duty3 > 3) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					if (command.duty_cycle_pattern.duty4 < 0 || command.duty_cycle_pattern.duty4 > 3) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					current_channel_commands->push_back(command);
+			case Command_Type::DUTY_CYCLE: {
+				if (channel_number != 1 && channel_number != 2) {
+					return (channel.result = Result::SONG_ILLEGAL_MACRO);
+				}
+				command.type = Command_Type::DUTY_CYCLE;
+				if (!get_number(line, command.duty_cycle.duty)) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				if (command.duty_cycle.duty < 0 || command.duty_cycle.duty > 3) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 				}
+				channel.commands.push_back(command);
+				break;
+			}
 
-				else if (macro == "pitch_slide") {
-					if (_channel_number == 4) {
-						return (_result = Result::SONG_ILLEGAL_MACRO);
-					}
-					command.type = Command_Type::PITCH_SLIDE;
-					if (!get_number_and_number_and_pitch(lss, command.pitch_slide.duration, command.pitch_slide.octave, command.pitch_slide.pitch)) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
+			case Command_Type::VOLUME_ENVELOPE: {
+				if (channel_number == 4) {
+					return (channel.result = Result::SONG_ILLEGAL_MACRO);
+				}
+				if (channel_number == 3) {
+					command.type = Command_Type::VOLUME_ENVELOPE;
+					if (!get_number_and_number(line, command.volume_envelope.volume, command.volume_envelope.wave)) {
+						return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 					}
-					if (command.pitch_slide.duration < 1 || command.pitch_slide.duration > 256) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
+					if (command.volume_envelope.volume < 0 || command.volume_envelope.volume > 3) {
+						return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 					}
-					if (command.pitch_slide.octave < 1 || command.pitch_slide.octave > 8) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
+					if (command.volume_envelope.wave < 0 || command.volume_envelope.wave > 15) {
+						return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 					}
-					current_channel_commands->push_back(command);
+					channel.commands.push_back(command);
 				}
-
-				else if (macro == "vibrato") {
-					if (_channel_number == 4) {
-						return (_result = Result::SONG_ILLEGAL_MACRO);
-					}
-					command.type = Command_Type::VIBRATO;
-					if (!get_number_and_number_and_number(lss, command.vibrato.delay, command.vibrato.extent, command.vibrato.rate)) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					if (command.vibrato.delay < 0 || command.vibrato.delay > 255) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				else {
+					command.type = Command_Type::VOLUME_ENVELOPE;
+					if (!get_number_and_number(line, command.volume_envelope.volume, command.volume_envelope.fade)) {
+						return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 					}
-					if (command.vibrato.extent < 0 || command.vibrato.extent > 15) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
+					if (command.volume_envelope.volume < 0 || command.volume_envelope.volume > 15) {
+						return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 					}
-					if (command.vibrato.rate < 0 || command.vibrato.rate > 15) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
+					if (command.volume_envelope.fade == 8) command.volume_envelope.fade = 0; // 8 is used in place of 0
+					if (command.volume_envelope.fade < -7 || command.volume_envelope.fade > 7) {
+						return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 					}
-					current_channel_commands->push_back(command);
+					channel.commands.push_back(command);
 				}
+				break;
+			}
 
-				else if (macro == "toggle_noise") {
-					if (_channel_number != 4) {
-						return (_result = Result::SONG_ILLEGAL_MACRO);
-					}
-					command.type = Command_Type::TOGGLE_NOISE;
-					if (!get_number(lss, command.toggle_noise.drumkit)) {
-						command.toggle_noise.drumkit = -1;
-					}
-					else if (command.toggle_noise.drumkit < 0 || command.toggle_noise.drumkit > 255) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					current_channel_commands->push_back(command);
+			case Command_Type::PITCH_SWEEP: {
+				if (channel_number != 1) {
+					return (channel.result = Result::SONG_ILLEGAL_MACRO);
+				}
+				command.type = Command_Type::PITCH_SWEEP;
+				if (!get_number_and_number(line, command.pitch_sweep.duration, command.pitch_sweep.pitch_change)) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 				}
+				if (command.pitch_sweep.duration < 0 || command.pitch_sweep.duration > 15) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				if (command.pitch_sweep.pitch_change == 8) command.pitch_sweep.pitch_change = 0; // 8 is used in place of 0
+				if (command.pitch_sweep.pitch_change < -7 || command.pitch_sweep.pitch_change > 7) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				channel.commands.push_back(command);
+				break;
+			}
 
-				else if (macro == "force_stereo_panning") {
-					command.type = Command_Type::FORCE_STEREO_PANNING;
-					if (!get_bool_and_bool(lss, command.force_stereo_panning.left, command.force_stereo_panning.right)) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					current_channel_commands->push_back(command);
+			case Command_Type::DUTY_CYCLE_PATTERN: {
+				if (channel_number != 1 && channel_number != 2) {
+					return (channel.result = Result::SONG_ILLEGAL_MACRO);
+				}
+				command.type = Command_Type::DUTY_CYCLE_PATTERN;
+				if (!get_number_and_number_and_number_and_number(line, command.duty_cycle_pattern.duty1, command.duty_cycle_pattern.duty2, command.duty_cycle_pattern.duty3, command.duty_cycle_pattern.duty4)) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 				}
+				if (command.duty_cycle_pattern.duty1 < 0 || command.duty_cycle_pattern.duty1 > 3) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				if (command.duty_cycle_pattern.duty2 < 0 || command.duty_cycle_pattern.duty2 > 3) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				if (command.duty_cycle_pattern.duty3 < 0 || command.duty_cycle_pattern.duty3 > 3) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				if (command.duty_cycle_pattern.duty4 < 0 || command.duty_cycle_pattern.duty4 > 3) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				channel.commands.push_back(command);
+				break;
+			}
 
-				else if (macro == "volume") {
-					command.type = Command_Type::VOLUME;
-					if (!get_number_and_number(lss, command.volume.left, command.volume.right)) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					if (command.volume.left < 0 || command.volume.left > 7) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					if (command.volume.right < 0 || command.volume.right > 7) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					current_channel_commands->push_back(command);
+			case Command_Type::PITCH_SLIDE: {
+				if (channel_number == 4) {
+					return (channel.result = Result::SONG_ILLEGAL_MACRO);
+				}
+				command.type = Command_Type::PITCH_SLIDE;
+				if (!get_number_and_number_and_pitch(line, command.pitch_slide.duration, command.pitch_slide.octave, command.pitch_slide.pitch)) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				if (command.pitch_slide.duration < 1 || command.pitch_slide.duration > 256) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 				}
+				if (command.pitch_slide.octave < 1 || command.pitch_slide.octave > 8) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				channel.commands.push_back(command);
+				break;
+			}
 
-				else if (macro == "pitch_offset") {
-					if (_channel_number == 4) {
-						return (_result = Result::SONG_ILLEGAL_MACRO);
-					}
-					command.type = Command_Type::PITCH_OFFSET;
-					if (!get_number(lss, command.pitch_offset.offset)) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					if (command.pitch_offset.offset < 0 || command.pitch_offset.offset > 65535) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					current_channel_commands->push_back(command);
+			case Command_Type::VIBRATO: {
+				if (channel_number == 4) {
+					return (channel.result = Result::SONG_ILLEGAL_MACRO);
 				}
+				command.type = Command_Type::VIBRATO;
+				if (!get_number_and_number_and_number(line, command.vibrato.delay, command.vibrato.extent, command.vibrato.rate)) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				if (command.vibrato.delay < 0 || command.vibrato.delay > 255) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				if (command.vibrato.extent < 0 || command.vibrato.extent > 15) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				if (command.vibrato.rate < 0 || command.vibrato.rate > 15) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				channel.commands.push_back(command);
+				break;
+			}
 
-				else if (macro == "stereo_panning") {
-					command.type = Command_Type::STEREO_PANNING;
-					if (!get_bool_and_bool(lss, command.stereo_panning.left, command.stereo_panning.right)) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					current_channel_commands->push_back(command);
+			case Command_Type::TOGGLE_NOISE: {
+				if (channel_number != 4) {
+					return (channel.result = Result::SONG_ILLEGAL_MACRO);
+				}
+				command.type = Command_Type::TOGGLE_NOISE;
+				if (!get_number(line, command.toggle_noise.drumkit)) {
+					command.toggle_noise.drumkit = -1;
+				}
+				else if (command.toggle_noise.drumkit < 0 || command.toggle_noise.drumkit > 255) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 				}
+				channel.commands.push_back(command);
+				break;
+			}
 
-				else if (macro == "sound_jump") {
-					command.type = Command_Type::SOUND_JUMP;
-					if (!get_label(lss, command.target, current_scope)) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
+			case Command_Type::FORCE_STEREO_PANNING: {
+				command.type = Command_Type::FORCE_STEREO_PANNING;
+				if (!get_bool_and_bool(line, command.force_stereo_panning.left, command.force_stereo_panning.right)) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				channel.commands.push_back(command);
+				break;
+			}
 
-					if (!visited_labels.count(command.target)) {
-						unvisited_labels.insert(command.target);
-					}
+			case Command_Type::VOLUME: {
+				command.type = Command_Type::VOLUME;
+				if (!get_number_and_number(line, command.volume.left, command.volume.right)) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				if (command.volume.left < 0 || command.volume.left > 7) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				if (command.volume.right < 0 || command.volume.right > 7) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				channel.commands.push_back(command);
+				break;
+			}
 
-					current_channel_commands->push_back(command);
-					done_with_branch = true;
+			case Command_Type::PITCH_OFFSET: {
+				if (channel_number == 4) {
+					return (channel.result = Result::SONG_ILLEGAL_MACRO);
+				}
+				command.type = Command_Type::PITCH_OFFSET;
+				if (!get_number(line, command.pitch_offset.offset)) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				if (command.pitch_offset.offset < 0 || command.pitch_offset.offset > 65535) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 				}
+				channel.commands.push_back(command);
+				break;
+			}
 
-				else if (macro == "sound_loop") {
-					command.type = Command_Type::SOUND_LOOP;
-					if (!get_number_and_label(lss, command.sound_loop.loop_count, command.target, current_scope)) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					if (command.sound_loop.loop_count < 0 || command.sound_loop.loop_count > 255) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
+			case Command_Type::STEREO_PANNING: {
+				command.type = Command_Type::STEREO_PANNING;
+				if (!get_bool_and_bool(line, command.stereo_panning.left, command.stereo_panning.right)) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				channel.commands.push_back(command);
+				break;
+			}
 
-					if (!visited_labels.count(command.target) && command.sound_loop.loop_count != 1) {
-						unvisited_labels.insert(command.target);
-					}
+			case Command_Type::SOUND_JUMP: {
+				command.type = Command_Type::SOUND_JUMP;
+				std::string target;
+				if (!get_label(line, target, current_scope)) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				command.target = target;
 
-					current_channel_commands->push_back(command);
-					if (command.sound_loop.loop_count == 0) {
-						done_with_branch = true;
-					}
+				if (!visited_labels.count(target)) {
+					unvisited_labels.insert(target);
 				}
 
-				else if (macro == "sound_call") {
-					command.type = Command_Type::SOUND_CALL;
-					if (!get_label(lss, command.target, current_scope)) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
+				channel.commands.push_back(command);
+				done_with_branch = true;
+				break;
+			}
 
-					if (!visited_labels.count(command.target)) {
-						unvisited_labels.insert(command.target);
-					}
+			case Command_Type::SOUND_LOOP: {
+				command.type = Command_Type::SOUND_LOOP;
+				std::string target;
+				if (!get_number_and_label(line, command.sound_loop.loop_count, target, current_scope)) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				if (command.sound_loop.loop_count < 0 || command.sound_loop.loop_count > 255) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				command.target = target;
 
-					current_channel_commands->push_back(command);
+				if (!visited_labels.count(target) && command.sound_loop.loop_count != 1) {
+					unvisited_labels.insert(target);
 				}
 
-				else if (macro == "sound_ret") {
-					command.type = Command_Type::SOUND_RET;
-					current_channel_commands->push_back(command);
+				channel.commands.push_back(command);
+				if (command.sound_loop.loop_count == 0) {
 					done_with_branch = true;
 				}
+				break;
+			}
 
-				else if (macro == "toggle_perfect_pitch") {
-					if (_channel_number == 4) {
-						return (_result = Result::SONG_ILLEGAL_MACRO);
-					}
-					command.type = Command_Type::TOGGLE_PERFECT_PITCH;
-					current_channel_commands->push_back(command);
+			case Command_Type::SOUND_CALL: {
+				command.type = Command_Type::SOUND_CALL;
+				std::string target;
+				if (!get_label(line, target, current_scope)) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 				}
+				command.target = target;
 
-				else if (macro == "load_wave") {
-					if (_channel_number != 3) {
-						return (_result = Result::SONG_ILLEGAL_MACRO);
-					}
-					command.type = Command_Type::LOAD_WAVE;
-					Wave wave;
-					if (Parsed_Waves::parse_wave(lss, wave, true) != Parsed_Waves::Result::WAVES_OK) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					command.load_wave.wave = 0x10 + (int32_t)_waves.size();
-					_waves.push_back(wave);
-					current_channel_commands->push_back(command);
+				if (!visited_labels.count(target)) {
+					unvisited_labels.insert(target);
 				}
 
-				else if (macro == "inc_octave") {
-					command.type = Command_Type::INC_OCTAVE;
-					current_channel_commands->push_back(command);
-				}
+				channel.commands.push_back(command);
+				break;
+			}
+
+			case Command_Type::SOUND_RET: {
+				command.type = Command_Type::SOUND_RET;
+				channel.commands.push_back(command);
+				done_with_branch = true;
+				break;
+			}
 
-				else if (macro == "dec_octave") {
-					command.type = Command_Type::DEC_OCTAVE;
-					current_channel_commands->push_back(command);
+			case Command_Type::TOGGLE_PERFECT_PITCH: {
+				if (channel_number == 4) {
+					return (channel.result = Result::SONG_ILLEGAL_MACRO);
 				}
+				command.type = Command_Type::TOGGLE_PERFECT_PITCH;
+				channel.commands.push_back(command);
+				break;
+			}
 
-				else if (macro == "speed") {
-					if (_channel_number == 4) {
-						return (_result = Result::SONG_ILLEGAL_MACRO);
-					}
-					command.type = Command_Type::SPEED;
-					if (!get_number(lss, command.speed.speed)) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					if (command.speed.speed < 1 || command.speed.speed > 15) {
-						return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-					}
-					current_channel_commands->push_back(command);
+			case Command_Type::LOAD_WAVE: {
+				if (channel_number != 3) {
+					return (channel.result = Result::SONG_ILLEGAL_MACRO);
 				}
+				command.type = Command_Type::LOAD_WAVE;
+				Wave wave;
+				if (Parsed_Waves::parse_wave(line, wave, true) != Parsed_Waves::Result::WAVES_OK) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				command.load_wave.wave = 0x10 + (int32_t)channel.waves.size();
+				channel.waves.push_back(wave);
+				channel.commands.push_back(command);
+				break;
+			}
 
-				else if (macro == "channel_volume") {
-					if (_channel_number == 4) {
-						return (_result = Result::SONG_ILLEGAL_MACRO);
-					}
-					if (_channel_number == 3) {
-						command.type = Command_Type::CHANNEL_VOLUME;
-						if (!get_number(lss, command.channel_volume.volume)) {
-							return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-						}
-						if (command.channel_volume.volume < 0 || command.channel_volume.volume > 3) {
-							return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-						}
-						current_channel_commands->push_back(command);
-					}
-					else {
-						command.type = Command_Type::CHANNEL_VOLUME;
-						if (!get_number(lss, command.channel_volume.volume)) {
-							return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-						}
-						if (command.channel_volume.volume < 0 || command.channel_volume.volume > 15) {
-							return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-						}
-						current_channel_commands->push_back(command);
-					}
+			case Command_Type::INC_OCTAVE: {
+				command.type = Command_Type::INC_OCTAVE;
+				channel.commands.push_back(command);
+				break;
+			}
+
+			case Command_Type::DEC_OCTAVE: {
+				command.type = Command_Type::DEC_OCTAVE;
+				channel.commands.push_back(command);
+				break;
+			}
+
+			case Command_Type::SPEED: {
+				if (channel_number == 4) {
+					return (channel.result = Result::SONG_ILLEGAL_MACRO);
 				}
+				command.type = Command_Type::SPEED;
+				if (!get_number(line, command.speed.speed)) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				if (command.speed.speed < 1 || command.speed.speed > 15) {
+					return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+				}
+				channel.commands.push_back(command);
+				break;
+			}
 
-				else if (macro == "fade_wave") {
-					if (_channel_number == 4) {
-						return (_result = Result::SONG_ILLEGAL_MACRO);
-					}
-					if (_channel_number == 3) {
-						command.type = Command_Type::FADE_WAVE;
-						if (!get_number(lss, command.fade_wave.wave)) {
-							return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-						}
-						if (command.fade_wave.wave < 0 || command.fade_wave.wave > 15) {
-							return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-						}
-						current_channel_commands->push_back(command);
+			case Command_Type::CHANNEL_VOLUME: {
+				if (channel_number == 4) {
+					return (channel.result = Result::SONG_ILLEGAL_MACRO);
+				}
+				if (channel_number == 3) {
+					command.type = Command_Type::CHANNEL_VOLUME;
+					if (!get_number(line, command.channel_volume.volume)) {
+						return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 					}
-					else {
-						command.type = Command_Type::FADE_WAVE;
-						if (!get_number(lss, command.fade_wave.fade)) {
-							return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-						}
-						if (command.fade_wave.fade == 8) command.fade_wave.fade = 0; // 8 is used in place of 0
-						if (command.fade_wave.fade < -7 || command.fade_wave.fade > 7) {
-							return (_result = Result::SONG_INVALID_MACRO_ARGUMENT);
-						}
-						current_channel_commands->push_back(command);
+					if (command.channel_volume.volume < 0 || command.channel_volume.volume > 3) {
+						return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 					}
+					channel.commands.push_back(command);
 				}
-
 				else {
-					// unknown command
-					return (_result = Result::SONG_UNRECOGNIZED_MACRO);
+					command.type = Command_Type::CHANNEL_VOLUME;
+					if (!get_number(line, command.channel_volume.volume)) {
+						return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+					}
+					if (command.channel_volume.volume < 0 || command.channel_volume.volume > 15) {
+						return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
+					}
+					channel.commands.push_back(command);
 				}
+				break;
 			}
 
-			if (done_with_branch) {
-				if (unvisited_labels.size() > 0) {
-					_label = *unvisited_labels.begin();
-					current_scope = "";
-					buffered_labels.clear();
-					ifs.seekg(0);
-					_line_number = 0;
-					step = Step::LOOKING_FOR_CHANNEL;
+			case Command_Type::FADE_WAVE: {
+				if (channel_number == 4) {
+					return (channel.result = Result::SONG_ILLEGAL_MACRO);
 				}
-				else {
-					Result r = calc_channel_length(*current_channel_commands, *current_channel_loop_tick, *current_channel_end_tick);
-					if (r != Result::SONG_OK) {
-						return (_result = r);
+				if (channel_number == 3) {
+					command.type = Command_Type::FADE_WAVE;
+					if (!get_number(line, command.fade_wave.wave)) {
+						return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 					}
-
-					if (_channel_2_label.size() > 0 && _channel_number < 2) {
-						_channel_number = 2;
-						_label = _channel_2_label;
-						current_channel_commands = &_channel_2_commands;
-						current_channel_loop_tick = &_channel_2_loop_tick;
-						current_channel_end_tick = &_channel_2_end_tick;
-						current_scope = "";
-						all_song_labels.insert(RANGE(visited_labels));
-						visited_labels.clear();
-						unvisited_labels.clear();
-						buffered_labels.clear();
-						ifs.seekg(0);
-						_line_number = 0;
-						step = Step::LOOKING_FOR_CHANNEL;
-					}
-					else if (_channel_3_label.size() > 0 && _channel_number < 3) {
-						_channel_number = 3;
-						_label = _channel_3_label;
-						current_channel_commands = &_channel_3_commands;
-						current_channel_loop_tick = &_channel_3_loop_tick;
-						current_channel_end_tick = &_channel_3_end_tick;
-						current_scope = "";
-						all_song_labels.insert(RANGE(visited_labels));
-						visited_labels.clear();
-						unvisited_labels.clear();
-						buffered_labels.clear();
-						ifs.seekg(0);
-						_line_number = 0;
-						step = Step::LOOKING_FOR_CHANNEL;
+					if (command.fade_wave.wave < 0 || command.fade_wave.wave > 15) {
+						return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 					}
-					else if (_channel_4_label.size() > 0 && _channel_number < 4) {
-						_channel_number = 4;
-						_label = _channel_4_label;
-						current_channel_commands = &_channel_4_commands;
-						current_channel_loop_tick = &_channel_4_loop_tick;
-						current_channel_end_tick = &_channel_4_end_tick;
-						current_scope = "";
-						all_song_labels.insert(RANGE(visited_labels));
-						visited_labels.clear();
-						unvisited_labels.clear();
-						buffered_labels.clear();
-						ifs.seekg(0);
-						_line_number = 0;
-						step = Step::LOOKING_FOR_CHANNEL;
+					channel.commands.push_back(command);
+				}
+				else {
+					command.type = Command_Type::FADE_WAVE;
+					if (!get_number(line, command.fade_wave.fade)) {
+						return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 					}
-					else {
-						step = Step::DONE;
-						break;
+					if (command.fade_wave.fade == 8) command.fade_wave.fade = 0; // 8 is used in place of 0
+					if (command.fade_wave.fade < -7 || command.fade_wave.fade > 7) {
+						return (channel.result = Result::SONG_INVALID_MACRO_ARGUMENT);
 					}
+					channel.commands.push_back(command);
 				}
+				break;
+			}
+			}
+		}
+
+		if (done_with_branch) {
+			end_span();
+			if (unvisited_labels.size() > 0) {
+				channel.label = *unvisited_labels.begin();
+			}
+			else {
+				return (channel.result = calc_channel_length(channel.commands, channel.loop_tick, channel.end_tick));
+			}
+
+			Result r = seek_label();
+			if (r != Result::SONG_OK) {
+				return (channel.result = r);
 			}
 		}
-	}
 
-	if (step == Step::LOOKING_FOR_HEADER) {
-		return (_result = Result::SONG_INVALID_HEADER);
-	}
-	else if (step == Step::READING_HEADER) {
-		return (_result = Result::SONG_INVALID_HEADER);
-	}
-	else if (step == Step::LOOKING_FOR_CHANNEL) {
-		return (_result = Result::SONG_UNRECOGNIZED_LABEL);
-	}
-	else if (step == Step::READING_CHANNEL) {
-		return (_result = Result::SONG_ENDED_PREMATURELY);
 	}
 
-	return (_result = Result::SONG_OK);
+	return (channel.result = Result::SONG_ENDED_PREMATURELY);
 }
@@ -4,8 +4,42 @@
 #include <vector>
 
 #include "command.h"
+#include "command-list.h"
 #include "parse-waves.h"
 
+class Asm_Reader;
+struct Song_Text;
+struct Parsed_Channel;
+
+// the runs of lines a channel was parsed from, so that a reload
+// can tell which channels have to be parsed again
+struct Channel_Section {
+	struct Span {
+		std::string label;
+		int32_t offset = 0; // from the first line of the span to `label`
+		int32_t length = 0;
+		uint64_t hash = 0;
+	};
+	std::vector<Span> spans;
+	std::vector<std::string> visit_order;
+	bool has_waves = false;
+};
+
+struct Song_Sections {
+	bool valid = false;
+	uint64_t header_hash = 0;
+	Channel_Section channels[4];
+};
+
+// a song header in an asm file that may hold several songs
+struct Indexed_Song {
+	std::string label;
+	int32_t line_number = 0;
+	size_t begin = 0; // where the header's line starts
+	size_t end = 0; // just past the song's last line of code before the next header
+	bool self_contained = false; // whether all its channels start in between
+};
+
 class Parsed_Song {
 public:
 	enum class Result {
@@ -37,10 +71,10 @@ private:
 	std::string _channel_2_label;
 	std::string _channel_3_label;
 	std::string _channel_4_label;
-	std::vector<Command> _channel_1_commands;
-	std::vector<Command> _channel_2_commands;
-	std::vector<Command> _channel_3_commands;
-	std::vector<Command> _channel_4_commands;
+	Command_List _channel_1_commands;
+	Command_List _channel_2_commands;
+	Command_List _channel_3_commands;
+	Command_List _channel_4_commands;
 	int32_t _channel_1_loop_tick = -1;
 	int32_t _channel_2_loop_tick = -1;
 	int32_t _channel_3_loop_tick = -1;
@@ -51,6 +85,8 @@ private:
 	int32_t _channel_4_end_tick = -1;
 	std::vector<Wave> _waves;
 	std::vector<std::string> _mixed_labels;
+	Song_Sections _sections;
+	bool _channel_reused[4] = {};
 	Result _result = Result::SONG_NULL;
 
 	// for error reporting
@@ -58,7 +94,8 @@ private:
 	int32_t _channel_number = 0;
 	std::string _label;
 public:
-	Parsed_Song(const char *f);
+	Parsed_Song(const char *f, const std::string &song_label = "", const Song_Sections *previous = nullptr);
+	Parsed_Song(Asm_Reader &reader, const std::string &song_label = "", const Song_Sections *previous = nullptr);
 	inline ~Parsed_Song() {}
 	inline std::string song_name(void) const { return _song_name; }
 	inline int32_t number_of_channels(void) const { return _number_of_channels; }
@@ -66,10 +103,10 @@ public:
 	inline std::string channel_2_label(void) const { return _channel_2_label; }
 	inline std::string channel_3_label(void) const { return _channel_3_label; }
 	inline std::string channel_4_label(void) const { return _channel_4_label; }
-	inline std::vector<Command> &&channel_1_commands(void) { return std::move(_channel_1_commands); }
-	inline std::vector<Command> &&channel_2_commands(void) { return std::move(_channel_2_commands); }
-	inline std::vector<Command> &&channel_3_commands(void) { return std::move(_channel_3_commands); }
-	inline std::vector<Command> &&channel_4_commands(void) { return std::move(_channel_4_commands); }
+	inline Command_List &&channel_1_commands(void) { return std::move(_channel_1_commands); }
+	inline Command_List &&channel_2_commands(void) { return std::move(_channel_2_commands); }
+	inline Command_List &&channel_3_commands(void) { return std::move(_channel_3_commands); }
+	inline Command_List &&channel_4_commands(void) { return std::move(_channel_4_commands); }
 	inline int32_t channel_1_loop_tick(void) const { return _channel_1_loop_tick; }
 	inline int32_t channel_2_loop_tick(void) const { return _channel_2_loop_tick; }
 	inline int32_t channel_3_loop_tick(void) const { return _channel_3_loop_tick; }
@@ -80,11 +117,16 @@ public:
 	inline int32_t channel_4_end_tick(void) const { return _channel_4_end_tick; }
 	inline std::vector<Wave> &&waves(void) { return std::move(_waves); }
 	inline std::vector<std::string> &&mixed_labels(void) { return std::move(_mixed_labels); }
+	inline Song_Sections &&sections(void) { return std::move(_sections); }
+	inline bool channel_reused(int channel_number) const { return _channel_reused[channel_number - 1]; }
 	inline Result result(void) const { return _result; }
 
 	std::string get_error_message() const;
+
+	static bool index_songs(const char *f, std::vector<Indexed_Song> &songs);
 private:
-	Result parse_song(const char *f);
+	Result parse_song(Asm_Reader &reader, const std::string &song_label, const Song_Sections *previous);
+	static Result parse_channel(const Song_Text &text, int32_t channel_number, const std::string &channel_label, Parsed_Channel &channel);
 };
 
 #endif
@@ -6,6 +6,7 @@
 
 #include "parse-waves.h"
 
+#include "asm-reader.h"
 #include "utils.h"
 
 Parsed_Waves::Parsed_Waves(const char *d) {
@@ -39,9 +40,12 @@ std::string Parsed_Waves::get_error_message() const {
 	}
 }
 
-Parsed_Waves::Result Parsed_Waves::parse_wave(std::istringstream &lss, Wave &wave, bool nybbles) {
+Parsed_Waves::Result Parsed_Waves::parse_wave(std::string_view s, Wave &wave, bool nybbles) {
 	size_t i = 0;
-	for (std::string token; std::getline(lss, token, ',');) {
+	while (!s.empty()) {
+		size_t p = s.find(',');
+		std::string_view token = s.substr(0, p);
+		s.remove_prefix(p == std::string_view::npos ? s.size() : p + 1);
 		if (i >= NUM_WAVE_SAMPLES) {
 			return Result::WAVES_TOO_MANY_SAMPLES;
 		}
@@ -97,10 +101,11 @@ Parsed_Waves::Result Parsed_Waves::parse_waves(const char *d) {
 	return _result;
 }
 
-static bool get_label(std::istringstream &iss, std::string &l, const std::string &scope = "") {
-	iss >> l;
-	rtrim(l, ":");
-	trim(l);
+static bool get_label(std::string_view s, std::string &l, const std::string &scope = "") {
+	trim(s);
+	s = s.substr(0, s.find_first_of(whitespace));
+	rtrim(s, ":");
+	l = s;
 	if (l.size() == 0) {
 		return false;
 	}
@@ -119,30 +124,25 @@ Parsed_Waves::Result Parsed_Waves::try_parse_waves(const char *f) {
 	_result = Result::WAVES_NULL;
 	_line_number = 0;
 
-	std::ifstream ifs;
-	open_ifstream(ifs, f);
-	if (!ifs.good()) {
+	Asm_Reader reader(f);
+	if (!reader.good()) {
 		return (_result = Result::WAVES_BAD_FILE);
 	}
 
-	while (ifs.good()) {
-		std::string line;
-		std::getline(ifs, line);
+	std::string_view line;
+	while (reader.next_line(line)) {
 		_line_number += 1;
-		remove_comment(line);
-		rtrim(line);
 		if (line.size() == 0) { continue; }
 		bool indented = is_indented(line);
-		std::istringstream lss(line);
 
 		if (!indented) {
 			if (_waves_label.size() == 0 && _waves.size() == 0) {
-				get_label(lss, _waves_label);
+				get_label(line, _waves_label);
 			}
 		}
 		else {
-			std::string macro;
-			if (!leading_macro(lss, macro)) {
+			std::string_view macro;
+			if (!leading_macro(line, macro)) {
 				return (_result = Result::WAVES_UNRECOGNIZED_MACRO);
 			}
 			bool nybbles = equals_ignore_case(macro, "dn");
@@ -152,7 +152,7 @@ Parsed_Waves::Result Parsed_Waves::try_parse_waves(const char *f) {
 			_uses_dn |= nybbles;
 
 			Wave wave;
-			Result r = parse_wave(lss, wave, nybbles);
+			Result r = parse_wave(line, wave, nybbles);
 			if (r != Result::WAVES_OK) {
 				return (_result = r);
 			}
@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <array>
 #include <vector>
 
@@ -51,7 +52,7 @@ public:
 
 	std::string get_error_message() const;
 
-	static Result parse_wave(std::istringstream &lss, Wave &wave, bool nybbles);
+	static Result parse_wave(std::string_view s, Wave &wave, bool nybbles);
 private:
 	Result parse_waves(const char *d);
 	Result try_parse_waves(const char *f);
@@ -2204,6 +2204,69 @@ void Piano_Roll::set_active_channel_timeline(const Song &song) {
 	set_timeline_width();
 	scroll_to(std::min(xposition(), scroll_x_max()), yposition());
 	sticky_keys();
+
+	// keep playing, with the edit
+	parent()->hot_swap_playback_module();
+}
+
+void Piano_Roll::set_channel_timelines(const Song &song, const std::set<int32_t> &channel_numbers) {
+	if (channel_numbers.empty()) return;
+
+	_channel_1_loop_tick = song.channel_1_loop_tick();
+	_channel_2_loop_tick = song.channel_2_loop_tick();
+	_channel_3_loop_tick = song.channel_3_loop_tick();
+	_channel_4_loop_tick = song.channel_4_loop_tick();
+	_channel_1_end_tick = song.channel_1_end_tick();
+	_channel_2_end_tick = song.channel_2_end_tick();
+	_channel_3_end_tick = song.channel_3_end_tick();
+	_channel_4_end_tick = song.channel_4_end_tick();
+
+	// every channel is laid out up to the song length
+	if (get_song_length() != _song_length) {
+		clear();
+		set_timeline(song);
+		update_channel_detail(selected_channel());
+		parent()->hot_swap_playback_module();
+		return;
+	}
+
+	_piano_timeline.handle_note_pencil_cancel(0);
+	_piano_timeline.begin();
+	for (int32_t channel_number : channel_numbers) {
+		if (channel_number == 1) {
+			_piano_timeline.clear_channel_1();
+			_channel_1_notes.clear();
+			build_note_view(_piano_timeline._channel_1_loops, _piano_timeline._channel_1_calls, _piano_timeline._channel_1_unused_targets, _piano_timeline._channel_1_tempo_changes, _channel_1_notes, song.channel_1_commands(), _song_length, NOTE_RED);
+			_piano_timeline.set_channel_1(_channel_1_notes);
+		}
+		else if (channel_number == 2) {
+			_piano_timeline.clear_channel_2();
+			_channel_2_notes.clear();
+			build_note_view(_piano_timeline._channel_2_loops, _piano_timeline._channel_2_calls, _piano_timeline._channel_2_unused_targets, _piano_timeline._channel_2_tempo_changes, _channel_2_notes, song.channel_2_commands(), _song_length, NOTE_BLUE);
+			_piano_timeline.set_channel_2(_channel_2_notes);
+		}
+		else if (channel_number == 3) {
+			_piano_timeline.clear_channel_3();
+			_channel_3_notes.clear();
+			build_note_view(_piano_timeline._channel_3_loops, _piano_timeline._channel_3_calls, _piano_timeline._channel_3_unused_targets, _piano_timeline._channel_3_tempo_changes, _channel_3_notes, song.channel_3_commands(), _song_length, NOTE_GREEN);
+			_piano_timeline.set_channel_3(_channel_3_notes);
+		}
+		else if (channel_number == 4) {
+			_piano_timeline.clear_channel_4();
+			_channel_4_notes.clear();
+			build_note_view(_piano_timeline._channel_4_loops, _piano_timeline._channel_4_calls, _piano_timeline._channel_4_unused_targets, _piano_timeline._channel_4_tempo_changes, _channel_4_notes, song.channel_4_commands(), _song_length, NOTE_BROWN);
+			_piano_timeline.set_channel_4(_channel_4_notes);
+			_piano_timeline.set_channel_4_note_tooltips();
+		}
+	}
+	_piano_timeline.end();
+	update_channel_detail(selected_channel());
+
+	set_timeline_width();
+	scroll_to(std::min(xposition(), scroll_x_max()), yposition());
+	sticky_keys();
+
+	parent()->hot_swap_playback_module();
 }
 
 void Piano_Roll::set_active_channel_selection(const std::set<int32_t> &selection) {
@@ -2231,7 +2294,7 @@ void Piano_Roll::build_note_view(
 	std::set<int32_t> &unused_targets,
 	std::set<int32_t> &tempo_changes,
 	std::vector<Note_View> &notes,
-	const std::vector<Command> &commands,
+	const Command_List &commands,
 	int32_t end_tick,
 	Fl_Color color
 ) {
@@ -2251,11 +2314,11 @@ void Piano_Roll::build_note_view(
 
 	std::stack<std::pair<decltype(command_itr), int32_t>> loop_stack;
 	std::stack<decltype(command_itr)> call_stack;
-	std::set<std::string> visited_labels_during_call;
-	std::set<std::string> visited_labels_not_during_call;
+	std::set<Label> visited_labels_during_call;
+	std::set<Label> visited_labels_not_during_call;
 
-	std::set<std::string> loop_targets;
-	std::set<std::string> call_targets;
+	std::set<Label> loop_targets;
+	std::set<Label> call_targets;
 	for (const Command &command : commands) {
 		if (command.type == Command_Type::SOUND_LOOP && command.sound_loop.loop_count > 1) {
 			loop_targets.insert(command.target);
@@ -2265,8 +2328,8 @@ void Piano_Roll::build_note_view(
 		}
 	}
 
-	const auto is_loop_target = [&](const std::vector<std::string> &labels) {
-		for (const std::string &label : labels) {
+	const auto is_loop_target = [&](Label_List labels) {
+		for (Label label : labels) {
 			if (loop_targets.count(label) > 0) {
 				return true;
 			}
@@ -2274,8 +2337,8 @@ void Piano_Roll::build_note_view(
 		return false;
 	};
 
-	const auto is_call_target = [&](const std::vector<std::string> &labels) {
-		for (const std::string &label : labels) {
+	const auto is_call_target = [&](Label_List labels) {
+		for (Label label : labels) {
 			if (call_targets.count(label) > 0) {
 				return true;
 			}
@@ -2284,7 +2347,7 @@ void Piano_Roll::build_note_view(
 	};
 
 	while (command_itr != commands.end() && (tick < end_tick || (!restarted && tick == end_tick && (loop_stack.size() > 0 || call_stack.size() > 0)))) {
-		for (const std::string &label : command_itr->labels) {
+		for (Label label : command_itr->labels) {
 			if (call_stack.size() > 0) {
 				visited_labels_during_call.insert(label);
 			}
@@ -2874,7 +2937,7 @@ int Piano_Roll::scroll_y_max() const {
 }
 
 void Piano_Roll::postprocess_channel(Song &song, int selected_channel) {
-	std::vector<Command> &commands = song.channel_commands(selected_channel);
+	Command_List &commands = song.channel_commands(selected_channel);
 	postprocess(commands);
 
 	int first_channel = first_channel_number();
@@ -2919,7 +2982,7 @@ bool Piano_Roll::test_put_note(Song &song, int32_t tick, int32_t length, int32_t
 	int32_t rest_ticks = note_view->length * note_view->speed;
 	int32_t remaining_rest_ticks = rest_ticks - tick_offset;
 
-	const std::vector<Command> &commands = song.channel_commands(selected_channel());
+	const Command_List &commands = song.channel_commands(selected_channel());
 
 	if (desired_tick_length <= remaining_rest_ticks || is_followed_by_n_ticks_of_rest(commands.begin() + index, commands.end(), desired_tick_length - remaining_rest_ticks, note_view->speed)) {
 		*out_speed = prev_speed;
@@ -3062,7 +3125,7 @@ bool Piano_Roll::set_speed(Song &song, int32_t speed) {
 	std::set<int32_t> selected_notes;
 	std::set<int32_t> selected_boxes;
 
-	const std::vector<Command> &commands = song.channel_commands(selected_channel());
+	const Command_List &commands = song.channel_commands(selected_channel());
 
 	for (auto note_itr = channel->begin(); note_itr != channel->end(); ++note_itr) {
 		Note_Box *note = *note_itr;
@@ -3704,7 +3767,7 @@ bool Piano_Roll::move_loop_left(Song &song, bool dry_run) {
 
 	std::set<int32_t> selected_boxes;
 
-	const std::vector<Command> &commands = song.channel_commands(selected_channel());
+	const Command_List &commands = song.channel_commands(selected_channel());
 
 	for (auto note_itr = channel->begin(); note_itr != channel->end(); ++note_itr) {
 		Note_Box *note = *note_itr;
@@ -3816,7 +3879,7 @@ bool Piano_Roll::move_call_left(Song &song, bool dry_run) {
 
 	std::set<int32_t> selected_boxes;
 
-	const std::vector<Command> &commands = song.channel_commands(selected_channel());
+	const Command_List &commands = song.channel_commands(selected_channel());
 
 	for (auto note_itr = channel->begin(); note_itr != channel->end(); ++note_itr) {
 		Note_Box *note = *note_itr;
@@ -3916,7 +3979,7 @@ bool Piano_Roll::move_left(Song &song, bool dry_run) {
 	std::set<int32_t> selected_notes;
 	std::set<int32_t> selected_boxes;
 
-	const std::vector<Command> &commands = song.channel_commands(selected_channel());
+	const Command_List &commands = song.channel_commands(selected_channel());
 
 	for (auto note_itr = channel->begin(); note_itr != channel->end(); ++note_itr) {
 		Note_Box *note = *note_itr;
@@ -3999,7 +4062,7 @@ bool Piano_Roll::move_loop_right(Song &song, bool dry_run) {
 
 	std::set<int32_t> selected_boxes;
 
-	const std::vector<Command> &commands = song.channel_commands(selected_channel());
+	const Command_List &commands = song.channel_commands(selected_channel());
 
 	for (auto note_itr = channel->rbegin(); note_itr != channel->rend(); ++note_itr) {
 		Note_Box *note = *note_itr;
@@ -4103,7 +4166,7 @@ bool Piano_Roll::move_call_right(Song &song, bool dry_run) {
 
 	std::set<int32_t> selected_boxes;
 
-	const std::vector<Command> &commands = song.channel_commands(selected_channel());
+	const Command_List &commands = song.channel_commands(selected_channel());
 
 	for (auto note_itr = channel->rbegin(); note_itr != channel->rend(); ++note_itr) {
 		Note_Box *note = *note_itr;
@@ -4196,7 +4259,7 @@ bool Piano_Roll::move_right(Song &song, bool dry_run) {
 	std::set<int32_t> selected_notes;
 	std::set<int32_t> selected_boxes;
 
-	const std::vector<Command> &commands = song.channel_commands(selected_channel());
+	const Command_List &commands = song.channel_commands(selected_channel());
 
 	for (auto note_itr = channel->rbegin(); note_itr != channel->rend(); ++note_itr) {
 		Note_Box *note = *note_itr;
@@ -4319,7 +4382,7 @@ bool Piano_Roll::lengthen(Song &song, bool dry_run) {
 
 	int32_t tick_adjustment = 0;
 
-	const std::vector<Command> &commands = song.channel_commands(selected_channel());
+	const Command_List &commands = song.channel_commands(selected_channel());
 
 	for (auto note_itr = channel->begin(); note_itr != channel->end(); ++note_itr) {
 		Note_Box *note = *note_itr;
@@ -4485,7 +4548,7 @@ bool Piano_Roll::glue_note(Song &song, bool dry_run) {
 	if (!channel) return false;
 
 	auto view = active_channel_view();
-	const std::vector<Command> &commands = song.channel_commands(selected_channel());
+	const Command_List &commands = song.channel_commands(selected_channel());
 
 	if (_tick == -1) return false;
 
@@ -4735,7 +4798,7 @@ bool Piano_Roll::extend_loop(Song &song, bool dry_run) {
 	auto loops = _piano_timeline.active_channel_loops();
 	if (!loops) return false;
 
-	const std::vector<Command> &commands = song.channel_commands(selected_channel());
+	const Command_List &commands = song.channel_commands(selected_channel());
 
 	int32_t loop_index = -1;
 	int32_t loop_length = 0;
@@ -4793,7 +4856,7 @@ bool Piano_Roll::unroll_loop(Song &song, bool dry_run) {
 	auto loops = _piano_timeline.active_channel_loops();
 	if (!loops) return false;
 
-	const std::vector<Command> &commands = song.channel_commands(selected_channel());
+	const Command_List &commands = song.channel_commands(selected_channel());
 
 	int32_t loop_index = -1;
 	Note_View start_view, end_view;
@@ -4942,7 +5005,7 @@ bool Piano_Roll::create_loop(Song &song, bool dry_run) {
 		loop_view.speed = start_view.speed;
 	}
 
-	const std::vector<Command> &commands = song.channel_commands(selected_channel());
+	const Command_List &commands = song.channel_commands(selected_channel());
 
 	auto start_itr = commands.begin() + start_index;
 	auto end_itr = commands.begin() + end_index;
@@ -4992,7 +5055,7 @@ bool Piano_Roll::delete_call(Song &song, bool dry_run) {
 	auto calls = _piano_timeline.active_channel_calls();
 	if (!calls) return false;
 
-	const std::vector<Command> &commands = song.channel_commands(selected_channel());
+	const Command_List &commands = song.channel_commands(selected_channel());
 
 	int32_t call_index = -1;
 	int32_t ambiguous_ticks = 0;
@@ -5014,13 +5077,13 @@ bool Piano_Roll::delete_call(Song &song, bool dry_run) {
 	}
 
 	assert(commands[call_index].type == Command_Type::SOUND_CALL);
-	std::string target_label = commands[call_index].target;
+	Label target_label = commands[call_index].target;
 
 	int32_t start_index = itr_index(commands, find_note_with_label(commands, target_label));
 	std::vector<Command> snippet = copy_snippet(commands, start_index, end_view.index, true);
 	assert(snippet.back().type == Command_Type::SOUND_RET);
 
-	const auto snippet_contains_label = [](const std::vector<Command> &snippet, const std::string &label) {
+	const auto snippet_contains_label = [](const std::vector<Command> &snippet, Label label) {
 		for (const Command &command : snippet) {
 			if (std::count(RANGE(command.labels), label) > 0) {
 				return true;
@@ -5041,7 +5104,7 @@ bool Piano_Roll::delete_call(Song &song, bool dry_run) {
 				break;
 			}
 		}
-		for (const std::string &label : command.labels) {
+		for (Label label : command.labels) {
 			if (label.find_first_of(".") == std::string::npos) {
 				erasable = false;
 				break;
@@ -5085,7 +5148,7 @@ bool Piano_Roll::unpack_call(Song &song, bool dry_run) {
 	auto calls = _piano_timeline.active_channel_calls();
 	if (!calls) return false;
 
-	const std::vector<Command> &commands = song.channel_commands(selected_channel());
+	const Command_List &commands = song.channel_commands(selected_channel());
 
 	int32_t call_index = -1;
 	Note_View start_view, end_view;
@@ -5100,12 +5163,12 @@ bool Piano_Roll::unpack_call(Song &song, bool dry_run) {
 	if (call_index == -1) return false;
 
 	assert(commands[call_index].type == Command_Type::SOUND_CALL);
-	std::string target_label = commands[call_index].target;
+	Label target_label = commands[call_index].target;
 
 	int32_t start_index = itr_index(commands, find_note_with_label(commands, target_label));
 	std::vector<Command> snippet = copy_snippet(commands, start_index, end_view.index, true);
 
-	const auto snippet_contains_label = [](const std::vector<Command> &snippet, const std::string &label) {
+	const auto snippet_contains_label = [](const std::vector<Command> &snippet, Label label) {
 		for (const Command &command : snippet) {
 			if (std::count(RANGE(command.labels), label) > 0) {
 				return true;
@@ -5126,7 +5189,7 @@ bool Piano_Roll::unpack_call(Song &song, bool dry_run) {
 				break;
 			}
 		}
-		for (const std::string &label : command.labels) {
+		for (Label label : command.labels) {
 			if (label.find_first_of(".") == std::string::npos) {
 				erasable = false;
 				break;
@@ -5155,7 +5218,7 @@ bool Piano_Roll::unpack_call(Song &song, bool dry_run) {
 		}
 	}
 
-	std::set<std::string> loop_targets;
+	std::set<Label> loop_targets;
 	for (const Command &command : snippet) {
 		if (command.type == Command_Type::SOUND_LOOP) {
 			if (!snippet_contains_label(snippet, command.target)) return false;
@@ -5173,9 +5236,9 @@ bool Piano_Roll::unpack_call(Song &song, bool dry_run) {
 	int loop_number = 1;
 	for (Command &command : snippet) {
 		for (size_t i = 0; i < command.labels.size(); ++i) {
-			std::string old_label = command.labels[i];
-			std::string next_label = get_next_loop_label(commands, scope, loop_number);
-			command.labels[i] = next_label;
+			Label old_label = command.labels[i];
+			Label next_label = get_next_loop_label(commands, scope, loop_number);
+			command.labels.replace(i, next_label);
 			for (Command &other : snippet) {
 				if (other.type == Command_Type::SOUND_LOOP && other.target == old_label) {
 					other.target = next_label;
@@ -5301,7 +5364,7 @@ bool Piano_Roll::create_call(Song &song, bool dry_run) {
 		}
 	}
 
-	const std::vector<Command> &commands = song.channel_commands(selected_channel());
+	const Command_List &commands = song.channel_commands(selected_channel());
 
 	std::vector<Command> snippet = copy_snippet(commands, start_index, end_index, true);
 
@@ -5321,7 +5384,7 @@ bool Piano_Roll::create_call(Song &song, bool dry_run) {
 		}
 	}
 
-	const auto snippet_contains_label = [](const std::vector<Command> &snippet, const std::string &label) {
+	const auto snippet_contains_label = [](const std::vector<Command> &snippet, Label label) {
 		for (const Command &command : snippet) {
 			if (std::count(RANGE(command.labels), label) > 0) {
 				return true;
@@ -5332,7 +5395,7 @@ bool Piano_Roll::create_call(Song &song, bool dry_run) {
 
 	std::vector<std::string> call_labels;
 
-	std::set<std::string> loop_targets;
+	std::set<Label> loop_targets;
 	for (const Command &command : snippet) {
 		if (command.type == Command_Type::SOUND_LOOP) {
 			if (!snippet_contains_label(snippet, command.target)) return false;
@@ -5355,9 +5418,9 @@ bool Piano_Roll::create_call(Song &song, bool dry_run) {
 	int loop_number = 1;
 	for (Command &command : snippet) {
 		for (size_t i = 0; i < command.labels.size(); ++i) {
-			std::string old_label = command.labels[i];
-			std::string next_label = get_next_loop_label(commands, scope, loop_number);
-			command.labels[i] = next_label;
+			Label old_label = command.labels[i];
+			Label next_label = get_next_loop_label(commands, scope, loop_number);
+			command.labels.replace(i, next_label);
 			for (Command &other : snippet) {
 				if (other.type == Command_Type::SOUND_LOOP && other.target == old_label) {
 					other.target = next_label;
@@ -5464,7 +5527,7 @@ bool Piano_Roll::insert_call(Song &song, bool dry_run) {
 	int32_t tail_length = note_view->length * note_view->speed - tick_offset;
 	int32_t call_length = selected_call->end_tick() - selected_call->start_tick();
 
-	const std::vector<Command> &commands = song.channel_commands(selected_channel());
+	const Command_List &commands = song.channel_commands(selected_channel());
 
 	if (call_length > tail_length && !is_followed_by_n_ticks_of_rest(commands.begin() + note_view->index, commands.end(), call_length - tail_length, note_view->speed)) {
 		return false;
@@ -5472,7 +5535,7 @@ bool Piano_Roll::insert_call(Song &song, bool dry_run) {
 
 	int32_t call_index = selected_call->start_note_view().index;
 	assert(commands[call_index].type == Command_Type::SOUND_CALL);
-	std::string target_label = commands[call_index].target;
+	Label target_label = commands[call_index].target;
 
 	const Note_View *start_view = find_note_view_at_tick(*view, selected_call->start_tick());
 	assert(start_view);
@@ -515,11 +515,12 @@ public:
 
 	void set_timeline(const Song &song);
 	void set_active_channel_timeline(const Song &song);
+	void set_channel_timelines(const Song &song, const std::set<int32_t> &channel_numbers);
 	void set_active_channel_selection(const std::set<int32_t> &selection);
 	void select_note_at_tick();
 	void select_call_at_tick();
 
-	void build_note_view(std::vector<Loop_Box *> &loops, std::vector<Call_Box *> &calls, std::set<int32_t> &unused_targets, std::set<int32_t> &tempo_changes, std::vector<Note_View> &notes, const std::vector<Command> &commands, int32_t end_tick, Fl_Color color);
+	void build_note_view(std::vector<Loop_Box *> &loops, std::vector<Call_Box *> &calls, std::set<int32_t> &unused_targets, std::set<int32_t> &tempo_changes, std::vector<Note_View> &notes, const Command_List &commands, int32_t end_tick, Fl_Color color);
 
 	Note_View verify_channel_1_loop_view(Song &song) { return verify_loop_view(song, 1, _channel_1_notes, _channel_1_loop_tick, _channel_1_end_tick); }
 	Note_View verify_channel_2_loop_view(Song &song) { return verify_loop_view(song, 2, _channel_2_notes, _channel_2_loop_tick, _channel_2_end_tick); }
@@ -0,0 +1,123 @@
+#include <algorithm>
+
+#include "playback-module.h"
+
+std::size_t Playback_Module::_buffer_frames = DEFAULT_BUFFER_FRAMES;
+
+void Playback_Module::buffer_frames(std::size_t frames) {
+	_buffer_frames = std::clamp(frames, MIN_BUFFER_FRAMES, BUFFER_SIZE);
+}
+
+bool Playback_Module::start() {
+	if (playing()) return false;
+	PaStream *stream = _stream.paStream();
+	// a stream that completed at the end of the song still has to be
+	// stopped before it can start again
+	if (Pa_IsStreamStopped(stream) == 0) {
+		Pa_StopStream(stream);
+	}
+	if (!_paused) {
+		_ring.clear();
+		_finished = false;
+		_underruns = 0;
+	}
+	_primed = false;
+	_paused = false;
+	return Pa_StartStream(stream) == paNoError;
+}
+
+bool Playback_Module::stop() {
+	_paused = false;
+	bool stopped = Pa_StopStream(_stream.paStream()) == paNoError;
+	_ring.clear();
+	_finished = false;
+	return stopped;
+}
+
+bool Playback_Module::play() {
+	if (!ready() || !playing()) return true;
+
+	std::size_t block = std::min(_buffer_frames, _ring.capacity());
+	while (!_finished && _ring.writable() >= block) {
+		std::size_t count = render_block(_buffer.data(), block);
+		if (count == 0) {
+			_finished = true;
+			break;
+		}
+		_ring.write(_buffer.data(), count);
+	}
+	return true;
+}
+
+void Playback_Module::open_stream(std::size_t ring_buffers) {
+	_ring.resize(_buffer_frames * ring_buffers);
+	_is_interleaved = false;
+	if (!try_open()) {
+		_is_interleaved = true;
+		try_open();
+	}
+}
+
+bool Playback_Module::try_open() {
+	try {
+		portaudio::System &portaudio = portaudio::System::instance();
+		portaudio::DirectionSpecificStreamParameters outputstream_parameters(
+			portaudio.defaultOutputDevice(),
+			2,
+			portaudio::FLOAT32,
+			_is_interleaved,
+			(double)_buffer_frames / SAMPLE_RATE,
+			0
+		);
+		portaudio::StreamParameters stream_parameters(
+			portaudio::DirectionSpecificStreamParameters::null(),
+			outputstream_parameters,
+			SAMPLE_RATE,
+			(unsigned long)_buffer_frames,
+			paNoFlag
+		);
+		_stream.open(stream_parameters, *this, &Playback_Module::stream_callback);
+		return true;
+	}
+	catch (...) {}
+	return false;
+}
+
+int Playback_Module::stream_callback(const void *, void *output, unsigned long frames, const PaStreamCallbackTimeInfo *, PaStreamCallbackFlags flags) {
+	float *left, *right;
+	std::size_t stride;
+	if (_is_interleaved) {
+		left = static_cast<float *>(output);
+		right = left + 1;
+		stride = 2;
+	}
+	else {
+		float * const *buffers = static_cast<float * const *>(output);
+		left = buffers[0];
+		right = buffers[1];
+		stride = 1;
+	}
+
+	// check for the end before reading, since the last frames are written
+	// before the renderer marks it
+	bool finished = _finished;
+	std::size_t count = _ring.read(left, right, frames, stride);
+	for (std::size_t i = count; i < frames; ++i) {
+		left[i * stride] = 0.0f;
+		right[i * stride] = 0.0f;
+	}
+
+	if (count < frames && finished) {
+		return paComplete;
+	}
+	if ((count < frames && _primed) || (flags & paOutputUnderflow)) {
+		_underruns += 1;
+	}
+	if (count > 0) {
+		_primed = true;
+		if (Render_Signal *signal = _render_signal) {
+			signal->notify();
+		}
+	}
+	return paContinue;
+}
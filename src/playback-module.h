@@ -0,0 +1,96 @@
+#ifndef PLAYBACK_MODULE_H
+#define PLAYBACK_MODULE_H
+
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include <portaudiocpp/PortAudioCpp.hxx>
+
+#include "render-signal.h"
+#include "ring-buffer.h"
+
+// the most frames rendered at once, and so the largest stream buffer
+constexpr std::size_t BUFFER_SIZE = 2048;
+constexpr std::size_t MIN_BUFFER_FRAMES = 64;
+constexpr std::size_t DEFAULT_BUFFER_FRAMES = 1024;
+constexpr std::int32_t SAMPLE_RATE = 48000;
+// stream buffers rendered ahead of the one playing; fewer for notes played
+// live, so they sound sooner after they are pressed
+constexpr std::size_t RING_BUFFERS = 3;
+constexpr std::size_t INTERACTIVE_RING_BUFFERS = 2;
+
+// a song rendered for playback; a render thread calls play to keep a ring
+// of a few stream buffers filled ahead, and the stream callback drains it
+// without ever locking or rendering
+class Playback_Module {
+private:
+	static std::size_t _buffer_frames;
+
+	Ring_Buffer _ring;
+	std::array<float, BUFFER_SIZE * 2> _buffer;
+	// set by the renderer once the song has no frames left
+	std::atomic<bool> _finished{false};
+	std::atomic<uint32_t> _underruns{0};
+	std::atomic<Render_Signal *> _render_signal{nullptr};
+	// only the callback touches this, so silence before the first frames
+	// arrive is not counted as an underrun
+	bool _primed = false;
+	bool _is_interleaved = false;
+	bool _paused = false;
+	// declared last so it closes before the ring is destroyed
+	portaudio::MemFunCallbackStream<Playback_Module> _stream;
+public:
+	virtual ~Playback_Module() noexcept {}
+
+	// frames per stream buffer, for modules opened from now on
+	static std::size_t buffer_frames() { return _buffer_frames; }
+	static void buffer_frames(std::size_t frames);
+	// the longest a render thread waits between calls to play, in case it
+	// misses the signal that frames were drained
+	static std::chrono::microseconds fill_interval() { return std::chrono::microseconds(_buffer_frames * 1000000 / SAMPLE_RATE); }
+
+	virtual std::string get_warnings() { return ""; }
+	virtual int32_t tempo_change_wrong_channel() const { return -1; }
+	virtual int32_t tempo_change_mid_note() const { return -1; }
+	virtual bool too_many_drums() const { return false; }
+
+	bool ready() const { return _stream.isOpen(); }
+	bool playing() { return Pa_IsStreamActive(_stream.paStream()) == 1; }
+	bool paused() const { return _paused; }
+	bool stopped() { return !playing() && !paused(); }
+	virtual bool looping() = 0;
+
+	bool start();
+	bool stop();
+	bool pause() { _paused = true; return Pa_StopStream(_stream.paStream()) == paNoError; }
+	// renders until the ring is full; the stream completes by itself once
+	// the song ends and the ring runs dry
+	bool play();
+	// times the stream ran out of frames since playback last started
+	uint32_t underruns() const { return _underruns; }
+	// notified each time the stream drains frames, so the render thread
+	// waiting on it can refill the ring at once
+	void render_signal(Render_Signal *signal) { _render_signal = signal; }
+
+	virtual void mute_channel(int32_t channel, bool mute) = 0;
+
+	virtual int32_t current_tick() const = 0;
+	virtual void set_tick(int32_t tick) = 0;
+
+	virtual double get_position_seconds() = 0;
+	virtual double get_duration_seconds() = 0;
+protected:
+	// opens a planar stream, or an interleaved one if that fails
+	void open_stream(std::size_t ring_buffers = RING_BUFFERS);
+	// fills frames with up to count interleaved stereo frames, returning
+	// how many; zero means the song is over
+	virtual std::size_t render_block(float *frames, std::size_t count) = 0;
+private:
+	bool try_open();
+	int stream_callback(const void *input, void *output, unsigned long frames, const PaStreamCallbackTimeInfo *time_info, PaStreamCallbackFlags flags);
+};
+
+#endif
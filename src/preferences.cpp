@@ -96,3 +96,11 @@ std::string Preferences::get_string(const char *key) {
 void Preferences::set_string(const char *key, const std::string &value) {
 	_preferences->set(key, value.c_str());
 }
+
+std::string Preferences::userdata_path() {
+	char path[FL_PATH_MAX] = {};
+	if (!_preferences->get_userdata_path(path, sizeof(path))) {
+		return "";
+	}
+	return path;
+}
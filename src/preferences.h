@@ -19,6 +19,7 @@ public:
 	static void set(const char *key, int value);
 	static std::string get_string(const char *key);
 	static void set_string(const char *key, const std::string &value);
+	static std::string userdata_path(void);
 };
 
 #endif
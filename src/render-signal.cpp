@@ -0,0 +1,27 @@
+#include "render-signal.h"
+
+void Render_Signal::reset() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_stopped = false;
+	_drained = false;
+}
+
+void Render_Signal::stop() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopped = true;
+	}
+	_condition.notify_all();
+}
+
+void Render_Signal::notify() {
+	_drained.store(true, std::memory_order_release);
+	_condition.notify_one();
+}
+
+bool Render_Signal::wait(std::chrono::microseconds timeout) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_condition.wait_for(lock, timeout, [this]() { return _stopped || _drained.load(std::memory_order_acquire); });
+	_drained.store(false, std::memory_order_relaxed);
+	return !_stopped;
+}
@@ -0,0 +1,30 @@
+#ifndef RENDER_SIGNAL_H
+#define RENDER_SIGNAL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+// wakes a render thread as soon as its stream drains frames from the ring,
+// instead of leaving it to sleep a whole buffer; the stream callback only
+// notifies, so it never waits on the lock
+class Render_Signal {
+private:
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	std::atomic<bool> _drained{false};
+	bool _stopped = false;
+public:
+	// before starting a render thread
+	void reset(void);
+	// wakes the render thread to exit
+	void stop(void);
+	// called by the stream callback after it reads frames
+	void notify(void);
+	// waits for frames to be drained, or for stop, up to timeout in case a
+	// notification was missed; false once stopped
+	bool wait(std::chrono::microseconds timeout);
+};
+
+#endif
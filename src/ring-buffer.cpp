@@ -0,0 +1,50 @@
+#include <algorithm>
+#include <cstring>
+
+#include "ring-buffer.h"
+
+void Ring_Buffer::resize(std::size_t capacity) {
+	_capacity = capacity;
+	_frames.assign(capacity * 2, 0.0f);
+	clear();
+}
+
+void Ring_Buffer::clear() {
+	_written.store(0, std::memory_order_relaxed);
+	_read.store(0, std::memory_order_relaxed);
+}
+
+std::size_t Ring_Buffer::writable() const {
+	return _capacity - (_written.load(std::memory_order_relaxed) - _read.load(std::memory_order_acquire));
+}
+
+std::size_t Ring_Buffer::write(const float *frames, std::size_t count) {
+	std::size_t written = _written.load(std::memory_order_relaxed);
+	count = std::min(count, _capacity - (written - _read.load(std::memory_order_acquire)));
+	if (count == 0) return 0;
+
+	// copy in up to two runs, before and after wrapping around
+	std::size_t start = written % _capacity;
+	std::size_t first = std::min(count, _capacity - start);
+	memcpy(_frames.data() + start * 2, frames, first * 2 * sizeof(float));
+	memcpy(_frames.data(), frames + first * 2, (count - first) * 2 * sizeof(float));
+
+	_written.store(written + count, std::memory_order_release);
+	return count;
+}
+
+std::size_t Ring_Buffer::read(float *left, float *right, std::size_t count, std::size_t stride) {
+	std::size_t read = _read.load(std::memory_order_relaxed);
+	count = std::min(count, _written.load(std::memory_order_acquire) - read);
+	if (count == 0) return 0;
+
+	std::size_t index = read % _capacity;
+	for (std::size_t i = 0; i < count; ++i) {
+		left[i * stride] = _frames[index * 2];
+		right[i * stride] = _frames[index * 2 + 1];
+		if (++index == _capacity) index = 0;
+	}
+
+	_read.store(read + count, std::memory_order_release);
+	return count;
+}
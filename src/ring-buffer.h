@@ -0,0 +1,31 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// interleaved stereo frames passed from one producer thread to one consumer
+// thread without locks, so the audio callback never waits on the renderer
+class Ring_Buffer {
+private:
+	std::vector<float> _frames;
+	std::size_t _capacity = 0;
+	// running totals of frames written and read; each is stored only by its
+	// own side, and they sit on separate cache lines so the sides do not
+	// contend for one
+	alignas(64) std::atomic<std::size_t> _written{0};
+	alignas(64) std::atomic<std::size_t> _read{0};
+public:
+	// neither of these may run while the producer or the consumer does
+	void resize(std::size_t capacity);
+	void clear(void);
+	inline std::size_t capacity(void) const { return _capacity; }
+	// how many frames the producer may write
+	std::size_t writable(void) const;
+	std::size_t write(const float *frames, std::size_t count);
+	// splits frames into left and right, which advance by stride floats
+	std::size_t read(float *left, float *right, std::size_t count, std::size_t stride);
+};
+
+#endif
@@ -1,57 +1,47 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <map>
-#include <stack>
 
 #include "song.h"
+#include "asm-reader.h"
 
-std::string get_scope(const std::vector<Command> &commands, int32_t index) {
-	for (auto command_itr = commands.rbegin() + (commands.size() - 1 - index); command_itr != commands.rend(); ++command_itr) {
-		for (auto label_itr = command_itr->labels.rbegin(); label_itr != command_itr->labels.rend(); ++label_itr) {
-			if (label_itr->find_first_of(".") == std::string::npos) {
-				return *label_itr;
-			}
-		}
-	}
-	assert(false);
-	return "";
+std::string get_scope(const Command_List &commands, int32_t index) {
+	Label scope = commands.find_scope(index);
+	assert(!scope.empty());
+	return scope;
 }
 
-std::string get_next_label(const std::vector<Command> &commands, const std::string &scope, const std::string &prefix, int &i) {
-	const auto is_label_taken = [](const std::vector<Command> &commands, const std::string &label) {
-		for (const Command &command : commands) {
-			for (const std::string &l : command.labels) {
-				if (l == label) {
-					return true;
-				}
-			}
-		}
-		return false;
-	};
-
+std::string get_next_label(const Command_List &commands, const std::string &scope, const std::string &prefix, int &i) {
 	while (true) {
 		std::string label = scope + "." + prefix + (i == 0 ? "" : std::to_string(i));
 		i += 1;
-		if (is_label_taken(commands, label)) {
+		// a candidate that was never interned cannot be in use, and is not interned just to check
+		Label existing;
+		if (Label::find(label, existing) && commands.find_label(existing) != commands.end()) {
 			continue;
 		}
 		return label;
 	}
 }
 
-std::string get_next_loop_label(const std::vector<Command> &commands, const std::string &scope, int &i) {
+std::string get_next_loop_label(const Command_List &commands, const std::string &scope, int &i) {
 	return get_next_label(commands, scope, "loop", i);
 }
 
-std::string get_next_call_label(const std::vector<Command> &commands, const std::string &scope, int &i) {
+std::string get_next_call_label(const Command_List &commands, const std::string &scope, int &i) {
 	return get_next_label(commands, scope, "sub", i);
 }
 
-int count_label_references(const std::vector<Command> &commands, const std::string &label) {
+int count_label_references(const Command_List &commands, Label label) {
+	return (int)commands.count_references(label);
+}
+
+int count_label_references(const std::vector<Command> &snippet, Label label) {
 	int references = 0;
-	for (const Command &command : commands) {
+	for (const Command &command : snippet) {
 		if (
 			(command.type == Command_Type::SOUND_JUMP ||
 			command.type == Command_Type::SOUND_LOOP ||
@@ -64,42 +54,29 @@ int count_label_references(const std::vector<Command> &commands, const std::stri
 	return references;
 }
 
-bool is_label_referenced(const std::vector<Command> &commands, const std::string &label) {
-	for (const Command &command : commands) {
-		if (
-			(command.type == Command_Type::SOUND_JUMP ||
-			command.type == Command_Type::SOUND_LOOP ||
-			command.type == Command_Type::SOUND_CALL) &&
-			command.target == label
-		) {
-			return true;
-		}
-	}
-	return false;
+bool is_label_referenced(const Command_List &commands, Label label) {
+	return commands.count_references(label) > 0;
 }
 
-void delete_label(std::vector<Command> &commands, const std::string &label) {
-	for (Command &command : commands) {
-		for (auto l = command.labels.begin(); l != command.labels.end(); ++l) {
-			if (*l == label) {
-				command.labels.erase(l);
-				return;
-			}
+void delete_label(Command_List &commands, Label label) {
+	auto command_itr = commands.find_label(label);
+	if (command_itr == commands.end()) { return; }
+	Command &command = commands.modify(command_itr);
+	for (auto l = command.labels.begin(); l != command.labels.end(); ++l) {
+		if (*l == label) {
+			command.labels.erase(l);
+			return;
 		}
 	}
 }
 
-std::vector<Command>::const_iterator find_note_with_label(const std::vector<Command> &commands, const std::string &label) {
-	for (auto command_itr = commands.begin(); command_itr != commands.end(); ++command_itr) {
-		if (std::count(RANGE(command_itr->labels), label) > 0) {
-			return command_itr;
-		}
-	}
-	assert(false);
-	return commands.end();
+Command_List::const_iterator find_note_with_label(const Command_List &commands, Label label) {
+	auto command_itr = commands.find_label(label);
+	assert(command_itr != commands.end());
+	return command_itr;
 }
 
-bool is_followed_by_n_ticks_of_rest(std::vector<Command>::const_iterator itr, std::vector<Command>::const_iterator end, int32_t n, int32_t speed) {
+bool is_followed_by_n_ticks_of_rest(Command_List::const_iterator itr, Command_List::const_iterator end, int32_t n, int32_t speed) {
 	int32_t ticks = 0;
 	++itr;
 	while (itr != end) {
@@ -125,7 +102,7 @@ bool is_followed_by_n_ticks_of_rest(std::vector<Command>::const_iterator itr, st
 	return false;
 }
 
-bool is_followed_by_n_ticks_of_rest_no_speed_change(std::vector<Command>::const_iterator itr, std::vector<Command>::const_iterator end, int32_t n, int32_t speed) {
+bool is_followed_by_n_ticks_of_rest_no_speed_change(Command_List::const_iterator itr, Command_List::const_iterator end, int32_t n, int32_t speed) {
 	int32_t ticks = 0;
 	++itr;
 	while (itr != end) {
@@ -149,7 +126,7 @@ bool is_followed_by_n_ticks_of_rest_no_speed_change(std::vector<Command>::const_
 	return false;
 }
 
-std::vector<Command> copy_snippet(const std::vector<Command> &commands, int32_t start_index, int32_t end_index, bool copy_jumps) {
+std::vector<Command> copy_snippet(const Command_List &commands, int32_t start_index, int32_t end_index, bool copy_jumps) {
 	std::vector<Command> snippet;
 
 	auto command_itr = commands.begin() + start_index;
@@ -175,598 +152,57 @@ std::vector<Command> copy_snippet(const std::vector<Command> &commands, int32_t
 	return snippet;
 }
 
-Parsed_Song::Result calc_channel_length(
-	const std::vector<Command> &commands,
-	std::vector<Command>::const_iterator start_itr,
-	std::vector<Command>::const_iterator end_itr,
+static Parsed_Song::Result calc_channel_length(
+	const Command_List &commands,
+	Command_List::const_iterator start_itr,
+	Command_List::const_iterator end_itr,
 	int32_t start_speed,
 	int32_t start_drumkit,
 	int32_t &loop_tick,
-	int32_t &end_tick,
-	Extra_Info *info = nullptr
+	int32_t &end_tick
 ) {
-	int32_t tick = 0;
-	loop_tick = -1;
-	end_tick = -1;
-	int32_t speed = start_speed;
-	int32_t volume = 0;
-	int32_t fade = 0;
-	int32_t drumkit = start_drumkit;
-
-	struct Label_Info {
-		int32_t tick = 0;
-		int32_t index = 0;
-		int32_t speed = 0;
-		int32_t volume = 0;
-		int32_t fade = 0;
-		int32_t drumkit = 0;
-	};
-
-	auto command_itr = start_itr;
-
-	std::stack<std::pair<decltype(command_itr), int32_t>> loop_stack;
-	std::stack<decltype(command_itr)> call_stack;
-	std::set<std::string> visited_labels_during_call;
-	std::set<std::string> visited_labels_not_during_call;
-	std::map<std::string, Label_Info> label_infos;
-
-	while (command_itr != end_itr) {
-		for (const std::string &label : command_itr->labels) {
-			label_infos.insert({ label, { tick, itr_index(commands, command_itr), speed, volume, fade, drumkit } });
-			if (call_stack.size() > 0) {
-				visited_labels_during_call.insert(label);
-			}
-			else {
-				visited_labels_not_during_call.insert(label);
-			}
-		}
-
-		if (command_itr->type == Command_Type::NOTE) {
-			tick += command_itr->note.length * speed;
-		}
-		else if (command_itr->type == Command_Type::DRUM_NOTE) {
-			if (drumkit == -1) {
-				return Parsed_Song::Result::SONG_NO_DRUMKIT_SELECTED;
-			}
-			tick += command_itr->drum_note.length * speed;
-		}
-		else if (command_itr->type == Command_Type::REST) {
-			tick += command_itr->rest.length * speed;
-		}
-		else if (command_itr->type == Command_Type::NOTE_TYPE) {
-			speed = command_itr->note_type.speed;
-			volume = command_itr->note_type.volume;
-			fade = command_itr->note_type.fade;
-		}
-		else if (command_itr->type == Command_Type::DRUM_SPEED) {
-			speed = command_itr->drum_speed.speed;
-		}
-		else if (command_itr->type == Command_Type::VOLUME_ENVELOPE) {
-			volume = command_itr->volume_envelope.volume;
-			fade = command_itr->volume_envelope.fade;
-		}
-		else if (command_itr->type == Command_Type::TOGGLE_NOISE) {
-			if (drumkit == -1 && command_itr->toggle_noise.drumkit == -1) {
-				return Parsed_Song::Result::SONG_TOGGLE_NOISE_ALREADY_DISABLED;
-			}
-			if (drumkit != -1 && command_itr->toggle_noise.drumkit != -1) {
-				return Parsed_Song::Result::SONG_TOGGLE_NOISE_ALREADY_ENABLED;
-			}
-			drumkit = command_itr->toggle_noise.drumkit;
-		}
-		else if (command_itr->type == Command_Type::SOUND_JUMP) {
-			if (
-				!visited_labels_not_during_call.count(command_itr->target) ||
-				(call_stack.size() > 0 && !visited_labels_during_call.count(command_itr->target))
-			) {
-				command_itr = find_note_with_label(commands, command_itr->target);
-				continue;
-			}
-			const Label_Info &label_info = label_infos.at(command_itr->target);
-			loop_tick = label_info.tick;
-			end_tick = tick;
-			if (info) {
-				info->loop_index = label_info.index;
-				info->speed_at_loop = label_info.speed;
-				info->volume_at_loop = label_info.volume;
-				info->fade_at_loop = label_info.fade;
-				info->drumkit_at_loop = label_info.drumkit;
-
-				info->end_index = itr_index(commands, command_itr);
-				info->speed_at_end = speed;
-				info->volume_at_end = volume;
-				info->fade_at_end = fade;
-				info->drumkit_at_end = drumkit;
-			}
-			if (loop_tick == end_tick) {
-				return Parsed_Song::Result::SONG_EMPTY_LOOP;
-			}
-			if (loop_stack.size() > 0) {
-				return Parsed_Song::Result::SONG_UNFINISHED_LOOP;
-			}
-			if (call_stack.size() > 0) {
-				return Parsed_Song::Result::SONG_UNFINISHED_CALL;
-			}
-			break; // song is finished
-		}
-		else if (command_itr->type == Command_Type::SOUND_LOOP) {
-			if (loop_stack.size() > 0 && loop_stack.top().first == command_itr) {
-				loop_stack.top().second -= 1;
-				if (loop_stack.top().second == 0) {
-					loop_stack.pop();
-				}
-				else {
-					command_itr = find_note_with_label(commands, command_itr->target);
-					continue;
-				}
-			}
-			else {
-				if (command_itr->sound_loop.loop_count == 0) {
-					if (
-						!visited_labels_not_during_call.count(command_itr->target) ||
-						(call_stack.size() > 0 && !visited_labels_during_call.count(command_itr->target))
-					) {
-						command_itr = find_note_with_label(commands, command_itr->target);
-						continue;
-					}
-					const Label_Info &label_info = label_infos.at(command_itr->target);
-					loop_tick = label_info.tick;
-					end_tick = tick;
-					if (info) {
-						info->loop_index = label_info.index;
-						info->speed_at_loop = label_info.speed;
-						info->volume_at_loop = label_info.volume;
-						info->fade_at_loop = label_info.fade;
-						info->drumkit_at_loop = label_info.drumkit;
-
-						info->end_index = itr_index(commands, command_itr);
-						info->speed_at_end = speed;
-						info->volume_at_end = volume;
-						info->fade_at_end = fade;
-						info->drumkit_at_end = drumkit;
-					}
-					if (loop_tick == end_tick) {
-						return Parsed_Song::Result::SONG_EMPTY_LOOP;
-					}
-					if (loop_stack.size() > 0) {
-						return Parsed_Song::Result::SONG_UNFINISHED_LOOP;
-					}
-					if (call_stack.size() > 0) {
-						return Parsed_Song::Result::SONG_UNFINISHED_CALL;
-					}
-					break; // song is finished
-				}
-				else if (command_itr->sound_loop.loop_count > 1) {
-					// nested loops not allowed
-					if (loop_stack.size() > 0) {
-						return Parsed_Song::Result::SONG_NESTED_LOOP;
-					}
-
-					loop_stack.emplace(command_itr, command_itr->sound_loop.loop_count - 1);
-					command_itr = find_note_with_label(commands, command_itr->target);
-					continue;
-				}
-			}
-		}
-		else if (command_itr->type == Command_Type::SOUND_CALL) {
-			// nested calls not allowed
-			if (call_stack.size() > 0) {
-				return Parsed_Song::Result::SONG_NESTED_CALL;
-			}
-
-			call_stack.push(command_itr);
-			command_itr = find_note_with_label(commands, command_itr->target);
-			continue;
-		}
-		else if (command_itr->type == Command_Type::SOUND_RET) {
-			if (call_stack.size() == 0) {
-				end_tick = tick;
-				if (info) {
-					info->loop_index = -1;
-					info->speed_at_loop = -1;
-					info->volume_at_loop = -1;
-					info->fade_at_loop = -1;
-					info->drumkit_at_loop = -1;
-
-					info->end_index = itr_index(commands, command_itr);
-					info->speed_at_end = speed;
-					info->volume_at_end = volume;
-					info->fade_at_end = fade;
-					info->drumkit_at_end = drumkit;
-				}
-				if (loop_stack.size() > 0) {
-					return Parsed_Song::Result::SONG_UNFINISHED_LOOP;
-				}
-				break; // song is finished
-			}
-			else {
-				command_itr = call_stack.top();
-				call_stack.pop();
-				visited_labels_during_call.clear();
-			}
-		}
-		else if (command_itr->type == Command_Type::SPEED) {
-			speed = command_itr->speed.speed;
-		}
-		else if (command_itr->type == Command_Type::CHANNEL_VOLUME) {
-			volume = command_itr->channel_volume.volume;
-		}
-		else if (command_itr->type == Command_Type::FADE_WAVE) {
-			fade = command_itr->fade_wave.fade;
-		}
-		++command_itr;
-	}
-
-	end_tick = tick;
-	return Parsed_Song::Result::SONG_OK;
+	Length_Index length_index(itr_index(commands, start_itr), start_speed, start_drumkit);
+	return length_index.calc(commands, end_itr, loop_tick, end_tick);
 }
 
-Parsed_Song::Result calc_channel_length(const std::vector<Command> &commands, int32_t &loop_tick, int32_t &end_tick, Extra_Info *info) {
-	return calc_channel_length(commands, commands.begin(), commands.end(), 1, -1, loop_tick, end_tick, info);
+Parsed_Song::Result calc_channel_length(const Command_List &commands, int32_t &loop_tick, int32_t &end_tick, Extra_Info *info) {
+	return commands.length_index().calc(commands, commands.end(), loop_tick, end_tick, info);
 }
 
-int32_t calc_snippet_length(const std::vector<Command> &commands, const std::vector<Command>::const_iterator &start_itr, const std::vector<Command>::const_iterator &end_itr, const Note_View &start_view) {
+int32_t calc_snippet_length(const Command_List &commands, const Command_List::const_iterator &start_itr, const Command_List::const_iterator &end_itr, const Note_View &start_view) {
 	int32_t loop_tick, end_tick;
 	Parsed_Song::Result r = calc_channel_length(commands, start_itr, end_itr, start_view.speed, start_view.drumkit, loop_tick, end_tick);
 	assert(r == Parsed_Song::Result::SONG_OK);
 	return end_tick;
 }
 
-Note_View get_note_view(const std::vector<Command> &commands, int32_t index, int32_t min_tick) {
-	int32_t tick = 0;
-
+Note_View get_note_view(const Command_List &commands, int32_t index, int32_t min_tick) {
 	Note_View note;
-	note.octave = 8;
-	note.speed = 1;
-
-	auto command_itr = commands.begin();
-
-	std::stack<std::pair<decltype(command_itr), int32_t>> loop_stack;
-	std::stack<decltype(command_itr)> call_stack;
-	std::set<std::string> visited_labels_during_call;
-	std::set<std::string> visited_labels_not_during_call;
-
-	while (command_itr != commands.end()) {
-		for (const std::string &label : command_itr->labels) {
-			if (call_stack.size() > 0) {
-				visited_labels_during_call.insert(label);
-			}
-			else {
-				visited_labels_not_during_call.insert(label);
-			}
-		}
-
-		if (command_itr->type == Command_Type::NOTE) {
-			note.length = command_itr->note.length;
-			note.pitch = command_itr->note.pitch;
-			tick += note.length * note.speed;
-			note.index = itr_index(commands, command_itr);
-
-			if (note.index == index && tick >= min_tick) {
-				return note;
-			}
-
-			note.slide_duration = 0;
-			note.slide_octave = 0;
-			note.slide_pitch = Pitch::REST;
-		}
-		else if (command_itr->type == Command_Type::DRUM_NOTE) {
-			note.length = command_itr->drum_note.length;
-			note.pitch = (Pitch)command_itr->drum_note.instrument;
-			tick += note.length * note.speed;
-			note.index = itr_index(commands, command_itr);
-
-			if (note.index == index && tick >= min_tick) {
-				return note;
-			}
-		}
-		else if (command_itr->type == Command_Type::REST) {
-			note.length = command_itr->rest.length;
-			note.pitch = Pitch::REST;
-			tick += note.length * note.speed;
-			note.index = itr_index(commands, command_itr);
-
-			if (note.index == index && tick >= min_tick) {
-				return note;
-			}
-
-			note.slide_duration = 0;
-			note.slide_octave = 0;
-			note.slide_pitch = Pitch::REST;
-		}
-		else if (command_itr->type == Command_Type::OCTAVE) {
-			note.octave = command_itr->octave.octave;
-		}
-		else if (command_itr->type == Command_Type::NOTE_TYPE) {
-			note.speed = command_itr->note_type.speed;
-			note.volume = command_itr->note_type.volume;
-			note.fade = command_itr->note_type.fade;
-		}
-		else if (command_itr->type == Command_Type::DRUM_SPEED) {
-			note.speed = command_itr->drum_speed.speed;
-		}
-		else if (command_itr->type == Command_Type::TRANSPOSE) {
-			note.transpose_octaves = command_itr->transpose.num_octaves;
-			note.transpose_pitches = command_itr->transpose.num_pitches;
-		}
-		else if (command_itr->type == Command_Type::TEMPO) {
-			note.tempo = command_itr->tempo.tempo;
-		}
-		else if (command_itr->type == Command_Type::DUTY_CYCLE) {
-			note.duty = command_itr->duty_cycle.duty;
-		}
-		else if (command_itr->type == Command_Type::VOLUME_ENVELOPE) {
-			note.volume = command_itr->volume_envelope.volume;
-			note.fade = command_itr->volume_envelope.fade;
-		}
-		else if (command_itr->type == Command_Type::PITCH_SLIDE) {
-			note.slide_duration = command_itr->pitch_slide.duration;
-			note.slide_octave = command_itr->pitch_slide.octave;
-			note.slide_pitch = command_itr->pitch_slide.pitch;
-		}
-		else if (command_itr->type == Command_Type::VIBRATO) {
-			note.vibrato_delay = command_itr->vibrato.delay;
-			note.vibrato_extent = command_itr->vibrato.extent;
-			note.vibrato_rate = command_itr->vibrato.rate;
-		}
-		else if (command_itr->type == Command_Type::TOGGLE_NOISE) {
-			note.drumkit = command_itr->toggle_noise.drumkit;
-		}
-		else if (command_itr->type == Command_Type::FORCE_STEREO_PANNING) {
-			note.panning_left = command_itr->force_stereo_panning.left;
-			note.panning_right = command_itr->force_stereo_panning.right;
-		}
-		else if (command_itr->type == Command_Type::STEREO_PANNING) {
-			note.panning_left = command_itr->stereo_panning.left;
-			note.panning_right = command_itr->stereo_panning.right;
-		}
-		else if (command_itr->type == Command_Type::SOUND_JUMP) {
-			if (
-				!visited_labels_not_during_call.count(command_itr->target) ||
-				(call_stack.size() > 0 && !visited_labels_during_call.count(command_itr->target)) ||
-				tick <= min_tick
-			) {
-				command_itr = find_note_with_label(commands, command_itr->target);
-				continue;
-			}
-			break; // song is finished
-		}
-		else if (command_itr->type == Command_Type::SOUND_LOOP) {
-			if (loop_stack.size() > 0 && loop_stack.top().first == command_itr) {
-				loop_stack.top().second -= 1;
-				if (loop_stack.top().second == 0) {
-					loop_stack.pop();
-				}
-				else {
-					command_itr = find_note_with_label(commands, command_itr->target);
-					continue;
-				}
-			}
-			else {
-				if (command_itr->sound_loop.loop_count == 0) {
-					if (
-						!visited_labels_not_during_call.count(command_itr->target) ||
-						(call_stack.size() > 0 && !visited_labels_during_call.count(command_itr->target)) ||
-						tick <= min_tick
-					) {
-						command_itr = find_note_with_label(commands, command_itr->target);
-						continue;
-					}
-					break; // song is finished
-				}
-				else if (command_itr->sound_loop.loop_count > 1) {
-					// nested loops not allowed
-					assert(loop_stack.size() == 0);
-
-					loop_stack.emplace(command_itr, command_itr->sound_loop.loop_count - 1);
-					command_itr = find_note_with_label(commands, command_itr->target);
-					continue;
-				}
-			}
-		}
-		else if (command_itr->type == Command_Type::SOUND_CALL) {
-			// nested calls not allowed
-			assert(call_stack.size() == 0);
-
-			call_stack.push(command_itr);
-			command_itr = find_note_with_label(commands, command_itr->target);
-			continue;
-		}
-		else if (command_itr->type == Command_Type::SOUND_RET) {
-			if (call_stack.size() == 0) {
-				break; // song is finished
-			}
-			else {
-				command_itr = call_stack.top();
-				call_stack.pop();
-				visited_labels_during_call.clear();
-			}
-		}
-		else if (command_itr->type == Command_Type::LOAD_WAVE) {
-			if (note.wave >= 0x0f) {
-				note.wave = command_itr->load_wave.wave;
-			}
-		}
-		else if (command_itr->type == Command_Type::INC_OCTAVE) {
-			note.octave += 1;
-			if (note.octave > 8) {
-				note.octave = 1;
-			}
-		}
-		else if (command_itr->type == Command_Type::DEC_OCTAVE) {
-			note.octave -= 1;
-			if (note.octave < 1) {
-				note.octave = 8;
-			}
-		}
-		else if (command_itr->type == Command_Type::SPEED) {
-			note.speed = command_itr->speed.speed;
-		}
-		else if (command_itr->type == Command_Type::CHANNEL_VOLUME) {
-			note.volume = command_itr->channel_volume.volume;
-		}
-		else if (command_itr->type == Command_Type::FADE_WAVE) {
-			note.fade = command_itr->fade_wave.fade;
-		}
-		++command_itr;
-	}
-
-	assert(false);
+	bool found = commands.find_note_view(index, min_tick, note);
+	assert(found);
 	return note;
 }
 
 // get the last note or rest that is before `end_tick` which is not part of a loop or a call
-int32_t get_base_index(const std::vector<Command> &commands, int32_t start_tick, int32_t end_tick, int32_t &drumkit_at_base) {
-	int32_t tick = 0;
-	int32_t speed = 1;
-	int32_t drumkit = -1;
-
+int32_t get_base_index(const Command_List &commands, int32_t start_tick, int32_t end_tick, int32_t &drumkit_at_base) {
 	int32_t base_index = -1;
 	drumkit_at_base = -1;
 
-	auto command_itr = commands.begin();
-
-	std::stack<std::pair<decltype(command_itr), int32_t>> loop_stack;
-	std::stack<decltype(command_itr)> call_stack;
-	std::set<std::string> visited_labels_during_call;
-	std::set<std::string> visited_labels_not_during_call;
-
-	while (command_itr != commands.end()) {
-		for (const std::string &label : command_itr->labels) {
-			if (call_stack.size() > 0) {
-				visited_labels_during_call.insert(label);
-			}
-			else {
-				visited_labels_not_during_call.insert(label);
-			}
-		}
-
-		if (command_itr->type == Command_Type::NOTE) {
-			tick += command_itr->note.length * speed;
-
-			if (tick > start_tick && tick <= end_tick && loop_stack.size() == 0 && call_stack.size() == 0) {
-				base_index = itr_index(commands, command_itr);
-				drumkit_at_base = drumkit;
-			}
-			if (tick > end_tick || (tick == end_tick && loop_stack.size() == 0 && call_stack.size() == 0)) {
-				return base_index;
-			}
-		}
-		else if (command_itr->type == Command_Type::DRUM_NOTE) {
-			tick += command_itr->drum_note.length * speed;
-
-			if (tick > start_tick && tick <= end_tick && loop_stack.size() == 0 && call_stack.size() == 0) {
-				base_index = itr_index(commands, command_itr);
-				drumkit_at_base = drumkit;
-			}
-			if (tick > end_tick || (tick == end_tick && loop_stack.size() == 0 && call_stack.size() == 0)) {
-				return base_index;
-			}
-		}
-		else if (command_itr->type == Command_Type::REST) {
-			tick += command_itr->rest.length * speed;
-
-			if (tick > start_tick && tick <= end_tick && loop_stack.size() == 0 && call_stack.size() == 0) {
-				base_index = itr_index(commands, command_itr);
-				drumkit_at_base = drumkit;
-			}
-			if (tick > end_tick || (tick == end_tick && loop_stack.size() == 0 && call_stack.size() == 0)) {
-				return base_index;
-			}
-		}
-		else if (command_itr->type == Command_Type::NOTE_TYPE) {
-			speed = command_itr->note_type.speed;
-		}
-		else if (command_itr->type == Command_Type::DRUM_SPEED) {
-			speed = command_itr->drum_speed.speed;
-		}
-		else if (command_itr->type == Command_Type::TOGGLE_NOISE) {
-			drumkit = command_itr->toggle_noise.drumkit;
-		}
-		else if (command_itr->type == Command_Type::SOUND_JUMP) {
-			if (
-				!visited_labels_not_during_call.count(command_itr->target) ||
-				(call_stack.size() > 0 && !visited_labels_during_call.count(command_itr->target))
-			) {
-				command_itr = find_note_with_label(commands, command_itr->target);
-				continue;
-			}
-			break; // song is finished
-		}
-		else if (command_itr->type == Command_Type::SOUND_LOOP) {
-			if (loop_stack.size() > 0 && loop_stack.top().first == command_itr) {
-				loop_stack.top().second -= 1;
-				if (loop_stack.top().second == 0) {
-					loop_stack.pop();
-					if (tick > start_tick && tick <= end_tick && loop_stack.size() == 0 && call_stack.size() == 0) {
-						base_index = itr_index(commands, command_itr);
-						drumkit_at_base = drumkit;
-					}
-					if (tick > end_tick || (tick == end_tick && loop_stack.size() == 0 && call_stack.size() == 0)) {
-						return base_index;
-					}
-				}
-				else {
-					command_itr = find_note_with_label(commands, command_itr->target);
-					continue;
-				}
-			}
-			else {
-				if (command_itr->sound_loop.loop_count == 0) {
-					if (
-						!visited_labels_not_during_call.count(command_itr->target) ||
-						(call_stack.size() > 0 && !visited_labels_during_call.count(command_itr->target))
-					) {
-						command_itr = find_note_with_label(commands, command_itr->target);
-						continue;
-					}
-					break; // song is finished
-				}
-				else if (command_itr->sound_loop.loop_count > 1) {
-					// nested loops not allowed
-					assert(loop_stack.size() == 0);
-
-					loop_stack.emplace(command_itr, command_itr->sound_loop.loop_count - 1);
-					command_itr = find_note_with_label(commands, command_itr->target);
-					continue;
-				}
-			}
-		}
-		else if (command_itr->type == Command_Type::SOUND_CALL) {
-			// nested calls not allowed
-			assert(call_stack.size() == 0);
-
-			call_stack.push(command_itr);
-			command_itr = find_note_with_label(commands, command_itr->target);
-			continue;
-		}
-		else if (command_itr->type == Command_Type::SOUND_RET) {
-			if (call_stack.size() == 0) {
-				break; // song is finished
-			}
-			else {
-				command_itr = call_stack.top();
-				call_stack.pop();
-				visited_labels_during_call.clear();
-				if (tick > start_tick && tick <= end_tick && loop_stack.size() == 0 && call_stack.size() == 0) {
-					base_index = itr_index(commands, command_itr);
-					drumkit_at_base = drumkit;
-				}
-				if (tick > end_tick || (tick == end_tick && loop_stack.size() == 0 && call_stack.size() == 0)) {
-					return base_index;
-				}
-			}
+	for (const Tick_Index::Event &event : commands.first_pass()) {
+		bool in_base = !event.in_loop && !event.in_call;
+		if (event.tick > start_tick && event.tick <= end_tick && in_base) {
+			base_index = event.index;
+			drumkit_at_base = event.drumkit;
 		}
-		else if (command_itr->type == Command_Type::SPEED) {
-			speed = command_itr->speed.speed;
+		if (event.tick > end_tick || (event.tick == end_tick && in_base)) {
+			return base_index;
 		}
-		++command_itr;
 	}
 
 	return -1;
 }
 
-void split_tempo_change_rests(std::vector<Command> &commands, const std::set<int32_t> &tempo_changes) {
+void split_tempo_change_rests(Command_List &commands, const std::set<int32_t> &tempo_changes) {
 	struct Split_Point {
 		int32_t index;
 		int32_t offset;
@@ -775,131 +211,36 @@ void split_tempo_change_rests(std::vector<Command> &commands, const std::set<int
 
 	std::vector<Split_Point> split_points;
 
-	int32_t tick = 0;
-	int32_t speed = 1;
-
-	auto command_itr = commands.cbegin();
-
-	std::stack<std::pair<decltype(command_itr), int32_t>> loop_stack;
-	std::stack<decltype(command_itr)> call_stack;
-	std::set<std::string> visited_labels_during_call;
-	std::set<std::string> visited_labels_not_during_call;
-
-	while (command_itr != commands.end()) {
-		for (const std::string &label : command_itr->labels) {
-			if (call_stack.size() > 0) {
-				visited_labels_during_call.insert(label);
-			}
-			else {
-				visited_labels_not_during_call.insert(label);
-			}
-		}
-
-		if (command_itr->type == Command_Type::NOTE) {
-			tick += command_itr->note.length * speed;
-		}
-		else if (command_itr->type == Command_Type::DRUM_NOTE) {
-			tick += command_itr->drum_note.length * speed;
-		}
-		else if (command_itr->type == Command_Type::REST) {
-			int32_t t_right = tick + command_itr->rest.length * speed;
-
-			for (int32_t tempo_tick : tempo_changes) {
-				if (tempo_tick > tick && tempo_tick < t_right) {
-					int32_t tick_offset = tempo_tick - tick;
-					if (tick_offset % speed == 0) {
-						int32_t index = itr_index(commands, command_itr);
-						int32_t offset = tick_offset / speed;
-						bool duplicate = false;
-
-						for (const Split_Point &sp : split_points) {
-							if (sp.index == index && sp.offset == offset && sp.speed == speed) {
-								duplicate = true;
-								break;
-							}
-						}
-						if (!duplicate) {
-							split_points.push_back({ index, offset, speed });
+	const Command_List &played = commands;
+	for (const Tick_Index::Event &event : played.first_pass()) {
+		if (played[event.index].type != Command_Type::REST) { continue; }
+		int32_t speed = event.speed;
+		int32_t t_right = event.tick;
+		int32_t tick = t_right - played[event.index].rest.length * speed;
+
+		for (int32_t tempo_tick : tempo_changes) {
+			if (tempo_tick > tick && tempo_tick < t_right) {
+				int32_t tick_offset = tempo_tick - tick;
+				if (tick_offset % speed == 0) {
+					int32_t index = event.index;
+					int32_t offset = tick_offset / speed;
+					bool duplicate = false;
+
+					for (const Split_Point &sp : split_points) {
+						if (sp.index == index && sp.offset == offset && sp.speed == speed) {
+							duplicate = true;
+							break;
 						}
 					}
-					else {
-						// don't auto-split poorly aligned rests for now...
+					if (!duplicate) {
+						split_points.push_back({ index, offset, speed });
 					}
 				}
-			}
-
-			tick = t_right;
-		}
-		else if (command_itr->type == Command_Type::NOTE_TYPE) {
-			speed = command_itr->note_type.speed;
-		}
-		else if (command_itr->type == Command_Type::DRUM_SPEED) {
-			speed = command_itr->drum_speed.speed;
-		}
-		else if (command_itr->type == Command_Type::SOUND_JUMP) {
-			if (
-				!visited_labels_not_during_call.count(command_itr->target) ||
-				(call_stack.size() > 0 && !visited_labels_during_call.count(command_itr->target))
-			) {
-				command_itr = find_note_with_label(commands, command_itr->target);
-				continue;
-			}
-			break; // song is finished
-		}
-		else if (command_itr->type == Command_Type::SOUND_LOOP) {
-			if (loop_stack.size() > 0 && loop_stack.top().first == command_itr) {
-				loop_stack.top().second -= 1;
-				if (loop_stack.top().second == 0) {
-					loop_stack.pop();
-				}
 				else {
-					command_itr = find_note_with_label(commands, command_itr->target);
-					continue;
-				}
-			}
-			else {
-				if (command_itr->sound_loop.loop_count == 0) {
-					if (
-						!visited_labels_not_during_call.count(command_itr->target) ||
-						(call_stack.size() > 0 && !visited_labels_during_call.count(command_itr->target))
-					) {
-						command_itr = find_note_with_label(commands, command_itr->target);
-						continue;
-					}
-					break; // song is finished
-				}
-				else if (command_itr->sound_loop.loop_count > 1) {
-					// nested loops not allowed
-					assert(loop_stack.size() == 0);
-
-					loop_stack.emplace(command_itr, command_itr->sound_loop.loop_count - 1);
-					command_itr = find_note_with_label(commands, command_itr->target);
-					continue;
+					// don't auto-split poorly aligned rests for now...
 				}
 			}
 		}
-		else if (command_itr->type == Command_Type::SOUND_CALL) {
-			// nested calls not allowed
-			assert(call_stack.size() == 0);
-
-			call_stack.push(command_itr);
-			command_itr = find_note_with_label(commands, command_itr->target);
-			continue;
-		}
-		else if (command_itr->type == Command_Type::SOUND_RET) {
-			if (call_stack.size() == 0) {
-				break; // song is finished
-			}
-			else {
-				command_itr = call_stack.top();
-				call_stack.pop();
-				visited_labels_during_call.clear();
-			}
-		}
-		else if (command_itr->type == Command_Type::SPEED) {
-			speed = command_itr->speed.speed;
-		}
-		++command_itr;
 	}
 
 	std::sort(split_points.begin(), split_points.end(),
@@ -925,7 +266,7 @@ void split_tempo_change_rests(std::vector<Command> &commands, const std::set<int
 
 			Command command = Command(Command_Type::REST);
 			command.rest.length = commands[sp_itr->index].rest.length - sp_itr->offset;
-			commands[sp_itr->index].rest.length = sp_itr->offset;
+			commands.modify(sp_itr->index).rest.length = sp_itr->offset;
 			commands.insert(commands.begin() + sp_itr->index + 1, command);
 		}
 	}
@@ -958,73 +299,494 @@ void Song::clear() {
 	_channel_4_end_tick = -1;
 	_waves.clear();
 	_mixed_labels.clear();
+	_sections = {};
+	_saved_song_text.clear();
+	_song_label = "";
 	_result = Parsed_Song::Result::SONG_NULL;
 	_modified = false;
 	_mod_time = 0;
 	_history.clear();
 	_future.clear();
+	_undo_bytes = 0;
+	for (Command_List &remembered : _remembered_commands) {
+		remembered.clear();
+	}
+	_edit_pending = false;
 	_loaded = false;
 }
 
+static void splice_commands(Command_List &commands, int32_t index, size_t count, const std::vector<Command> &replacement) {
+	if (count == replacement.size()) {
+		for (size_t i = 0; i < count; i++) {
+			commands.modify(index + i) = replacement[i];
+		}
+		return;
+	}
+	auto itr = commands.begin() + index;
+	itr = commands.erase(itr, itr + count);
+	commands.insert(itr, RANGE(replacement));
+}
+
+static_assert(sizeof(Command) <= 32, "a command's changed bytes must fit in a 32-bit mask");
+
+static void pack_varint(std::string &packed, uint32_t v) {
+	for (; v >= 0x80; v >>= 7) {
+		packed.push_back((char)(v | 0x80));
+	}
+	packed.push_back((char)v);
+}
+
+static uint32_t unpack_varint(const char *&p) {
+	uint32_t v = 0;
+	for (int shift = 0; ; shift += 7) {
+		uint8_t b = (uint8_t)*p++;
+		v |= (uint32_t)(b & 0x7f) << shift;
+		if (!(b & 0x80)) { return v; }
+	}
+}
+
+// each command is stored as its bytes xored with the previous command's,
+// as a mask of the nonzero bytes followed by those bytes; consecutive
+// commands mostly differ in a field or two, so this is a fraction of their size
+static void pack_commands(std::string &packed, const std::vector<Command> &commands, Command &prev) {
+	for (const Command &command : commands) {
+		const uint8_t *a = (const uint8_t *)&command;
+		const uint8_t *b = (const uint8_t *)&prev;
+		uint32_t mask = 0;
+		for (size_t i = 0; i < sizeof(Command); ++i) {
+			if (a[i] != b[i]) { mask |= 1u << i; }
+		}
+		pack_varint(packed, mask);
+		for (size_t i = 0; i < sizeof(Command); ++i) {
+			if (mask & (1u << i)) { packed.push_back((char)(a[i] ^ b[i])); }
+		}
+		prev = command;
+	}
+}
+
+static void unpack_commands(const char *&p, std::vector<Command> &commands, uint32_t n, Command &prev) {
+	commands.resize(n);
+	for (Command &command : commands) {
+		uint32_t mask = unpack_varint(p);
+		uint8_t *a = (uint8_t *)&command;
+		const uint8_t *b = (const uint8_t *)&prev;
+		for (size_t i = 0; i < sizeof(Command); ++i) {
+			a[i] = (mask & (1u << i)) ? b[i] ^ (uint8_t)*p++ : b[i];
+		}
+		prev = command;
+	}
+}
+
+static void pack_state(Song::Song_State &ss) {
+	if (ss.removed.empty() && ss.inserted.empty()) { return; }
+	std::string packed;
+	pack_varint(packed, (uint32_t)ss.removed.size());
+	pack_varint(packed, (uint32_t)ss.inserted.size());
+	Command prev(Command_Type::REST);
+	pack_commands(packed, ss.removed, prev);
+	pack_commands(packed, ss.inserted, prev);
+	packed.shrink_to_fit();
+	ss.packed = std::move(packed);
+	std::vector<Command>().swap(ss.removed);
+	std::vector<Command>().swap(ss.inserted);
+}
+
+static void unpack_state(Song::Song_State &ss) {
+	if (ss.packed.empty()) { return; }
+	const char *p = ss.packed.data();
+	uint32_t n_removed = unpack_varint(p);
+	uint32_t n_inserted = unpack_varint(p);
+	Command prev(Command_Type::REST);
+	unpack_commands(p, ss.removed, n_removed, prev);
+	unpack_commands(p, ss.inserted, n_inserted, prev);
+	std::string().swap(ss.packed);
+}
+
+static size_t state_bytes(const Song::Song_State &ss) {
+	// a set node is the value plus three links and a color
+	constexpr size_t SELECTION_NODE_BYTES = sizeof(int32_t) + sizeof(void *) * 4;
+	return sizeof(Song::Song_State) +
+		(ss.removed.capacity() + ss.inserted.capacity()) * sizeof(Command) +
+		(ss.packed.capacity() > sizeof(std::string) ? ss.packed.capacity() : 0) +
+		ss.selection.size() * SELECTION_NODE_BYTES;
+}
+
+// diffs a channel against how it was remembered, storing the changed range
+// in `ss` if there is one, and remembers the channel as it is now
+void Song::settle_channel(int channel_number, Song_State *ss) {
+	const Command_List &commands = channel_commands(channel_number);
+	const Command_List &remembered = _remembered_commands[channel_number - 1];
+
+	size_t n = std::min(commands.size(), remembered.size());
+	size_t prefix = commands.common_prefix(remembered);
+	size_t suffix = commands.common_suffix(remembered, n - prefix);
+	if (ss) {
+		ss->index = (int32_t)prefix;
+		ss->removed.assign(remembered.begin() + prefix, remembered.end() - suffix);
+		ss->inserted.assign(commands.begin() + prefix, commands.end() - suffix);
+	}
+	// the copy shares the channel's chunks until the next edit touches them
+	_remembered_commands[channel_number - 1] = commands;
+}
+
+// the latest edit only becomes a splice once something else needs the history,
+// so that postprocessing after the edit is part of it
+void Song::settle_history() {
+	if (_edit_pending) {
+		Song_State &ss = _history.back();
+		_undo_bytes -= state_bytes(ss);
+		settle_channel(ss.channel_number, &ss);
+		_undo_bytes += state_bytes(ss);
+		_edit_pending = false;
+		compact_history();
+	}
+}
+
+// packs the states that have fallen out of easy reach, and drops the ones
+// farthest from the present until the history fits in its budget
+void Song::compact_history() {
+	for (std::deque<Song_State> *states : { &_history, &_future }) {
+		if (states->size() > UNPACKED_HISTORY_SIZE) {
+			Song_State &ss = (*states)[states->size() - 1 - UNPACKED_HISTORY_SIZE];
+			_undo_bytes -= state_bytes(ss);
+			pack_state(ss);
+			_undo_bytes += state_bytes(ss);
+		}
+	}
+	while (_undo_bytes > _undo_budget) {
+		// the latest undo state is always kept
+		std::deque<Song_State> &states = _history.size() > 1 ? _history : _future;
+		if (states.empty()) { break; }
+		_undo_bytes -= state_bytes(states.front());
+		states.pop_front();
+	}
+}
+
+void Song::undo_budget(size_t budget) {
+	_undo_budget = budget;
+	compact_history();
+}
+
 void Song::remember(int channel_number, const std::set<int32_t> &selection, Song_State::Action action, int tick) {
-	_future.clear();
-	while (_history.size() >= MAX_HISTORY_SIZE) { _history.pop_front(); }
+	settle_history();
+	settle_channel(channel_number, nullptr);
 
-	std::vector<Command> &commands = channel_commands(channel_number);
+	for (const Song_State &state : _future) {
+		_undo_bytes -= state_bytes(state);
+	}
+	_future.clear();
 
 	Song_State ss;
 	ss.tick = tick;
 	ss.channel_number = channel_number;
-	ss.commands = commands;
 	ss.selection = selection;
 	ss.action = action;
-	_history.push_back(ss);
+	_undo_bytes += state_bytes(ss);
+	_history.push_back(std::move(ss));
+	_edit_pending = true;
 }
 
 void Song::undo() {
 	if (_history.empty()) { return; }
-	while (_future.size() >= MAX_HISTORY_SIZE) { _future.pop_front(); }
+	settle_history();
 
 	Song_State &prev = _history.back();
-	std::vector<Command> &commands = channel_commands(prev.channel_number);
-
-	Song_State ss;
-	ss.tick = prev.tick;
-	ss.channel_number = prev.channel_number;
-	ss.commands = std::move(commands);
-	ss.selection = std::move(prev.selection);
-	ss.action = prev.action;
-	_future.push_back(ss);
-
-	commands = std::move(prev.commands);
+	_undo_bytes -= state_bytes(prev);
+	unpack_state(prev);
+	_undo_bytes += state_bytes(prev);
+	settle_channel(prev.channel_number, nullptr);
+	splice_commands(channel_commands(prev.channel_number), prev.index, prev.inserted.size(), prev.removed);
+	_remembered_commands[prev.channel_number - 1] = channel_commands(prev.channel_number);
+
+	_future.push_back(std::move(prev));
 	_history.pop_back();
+	compact_history();
 
 	_modified = true;
 }
 
 void Song::redo() {
 	if (_future.empty()) { return; }
-	while (_history.size() >= MAX_HISTORY_SIZE) { _history.pop_front(); }
+	settle_history();
 
 	Song_State &next = _future.back();
-	std::vector<Command> &commands = channel_commands(next.channel_number);
-
-	Song_State ss;
-	ss.tick = next.tick;
-	ss.channel_number = next.channel_number;
-	ss.commands = std::move(commands);
-	ss.selection = std::move(next.selection);
-	ss.action = next.action;
-	_history.push_back(ss);
-
-	commands = std::move(next.commands);
+	_undo_bytes -= state_bytes(next);
+	unpack_state(next);
+	_undo_bytes += state_bytes(next);
+	settle_channel(next.channel_number, nullptr);
+	splice_commands(channel_commands(next.channel_number), next.index, next.removed.size(), next.inserted);
+	_remembered_commands[next.channel_number - 1] = channel_commands(next.channel_number);
+
+	_history.push_back(std::move(next));
 	_future.pop_back();
+	compact_history();
 
 	_modified = true;
 }
 
-Parsed_Song::Result Song::read_song(const char *f) {
-	Parsed_Song data(f);
+// binary snapshot of a parsed song, so reopening an unchanged file
+// skips the asm parser entirely; bump the version whenever the layout
+// of the snapshot or of Command changes
+static constexpr char SONG_CACHE_MAGIC[4] = {'C', 'T', 'S', 'C'};
+static constexpr uint32_t SONG_CACHE_VERSION = 3;
+// each song has one cache file, but every song ever opened keeps its own
+static constexpr int64_t SONG_CACHE_MAX_SIZE = 64 * 1024 * 1024;
+
+static_assert(sizeof(Command::Duty_Cycle_Pattern) >= sizeof(Command::Note_Type), "command payload must be the largest union member");
+static_assert(sizeof(Command::Duty_Cycle_Pattern) >= sizeof(Command::Pitch_Slide), "command payload must be the largest union member");
+static_assert(sizeof(Command::Duty_Cycle_Pattern) >= sizeof(Command::Vibrato), "command payload must be the largest union member");
+
+static std::string song_cache_file(const char *cache_dir, const char *f, const std::string &song_label) {
+	uint64_t h = 14695981039346656037ull;
+	for (const char *c = f; *c; ++c) {
+		h = (h ^ (uint8_t)*c) * 1099511628211ull;
+	}
+	// songs that share a file are cached separately
+	h = (h ^ (uint8_t)'\n') * 1099511628211ull;
+	for (char c : song_label) {
+		h = (h ^ (uint8_t)c) * 1099511628211ull;
+	}
+	char name[32] = {};
+	snprintf(name, sizeof(name), "%016llx.cache", (unsigned long long)h);
+	return std::string(cache_dir) + name;
+}
+
+class Song_Cache_Writer {
+private:
+	std::string _data;
+public:
+	inline const std::string &data(void) const { return _data; }
+	template<typename T> void put(const T &v) { _data.append((const char *)&v, sizeof(T)); }
+	void put_string(const std::string &s) {
+		put((uint32_t)s.size());
+		_data.append(s);
+	}
+	template<typename L> void put_labels(const L &labels) {
+		put((uint32_t)labels.size());
+		for (const std::string &label : labels) {
+			put_string(label);
+		}
+	}
+	void put_commands(const Command_List &commands) {
+		put((uint32_t)commands.size());
+		for (const Command &command : commands) {
+			put((int32_t)command.type);
+			put_labels(command.labels);
+			// label IDs only mean something to this process, so the text is stored
+			put_string(command.target);
+			put(command.duty_cycle_pattern);
+		}
+	}
+	void put_sections(const Song_Sections &sections) {
+		put((uint8_t)sections.valid);
+		put(sections.header_hash);
+		for (const Channel_Section &section : sections.channels) {
+			put((uint32_t)section.spans.size());
+			for (const Channel_Section::Span &span : section.spans) {
+				put_string(span.label);
+				put(span.offset);
+				put(span.length);
+				put(span.hash);
+			}
+			put_labels(section.visit_order);
+			put((uint8_t)section.has_waves);
+		}
+	}
+};
+
+class Song_Cache_Reader {
+private:
+	std::string_view _data;
+	bool _good = true;
+public:
+	Song_Cache_Reader(std::string_view data) : _data(data) {}
+	inline bool good(void) const { return _good; }
+	inline bool done(void) const { return _good && _data.empty(); }
+	template<typename T> bool get(T &v) {
+		if (!_good || _data.size() < sizeof(T)) { return (_good = false); }
+		memcpy(&v, _data.data(), sizeof(T));
+		_data.remove_prefix(sizeof(T));
+		return true;
+	}
+	bool get_count(uint32_t &n, size_t min_item_size) {
+		// reject counts that could not possibly fit in the rest of the file
+		if (!get(n) || (uint64_t)n * min_item_size > _data.size()) { return (_good = false); }
+		return true;
+	}
+	bool get_string(std::string &s) {
+		uint32_t n;
+		if (!get_count(n, 1)) { return false; }
+		s.assign(_data.data(), n);
+		_data.remove_prefix(n);
+		return true;
+	}
+	bool get_labels(std::vector<std::string> &labels) {
+		uint32_t n;
+		if (!get_count(n, sizeof(uint32_t))) { return false; }
+		labels.resize(n);
+		for (std::string &label : labels) {
+			if (!get_string(label)) { return false; }
+		}
+		return true;
+	}
+	bool get_commands(Command_List &commands) {
+		uint32_t n;
+		if (!get_count(n, sizeof(int32_t) * 3 + sizeof(Command::Duty_Cycle_Pattern))) { return false; }
+		commands.resize(n);
+		std::vector<std::string> labels;
+		std::string target;
+		for (uint32_t i = 0; i < n; i++) {
+			Command &command = commands.modify(i);
+			int32_t type;
+			if (!get(type)) { return false; }
+			if (type < 0 || type >= (int32_t)_countof(COMMAND_NAMES)) { return (_good = false); }
+			command.type = (Command_Type)type;
+			if (!get_labels(labels) || !get_string(target) || !get(command.duty_cycle_pattern)) { return false; }
+			command.labels = std::vector<Label>(RANGE(labels));
+			command.target = target;
+		}
+		return true;
+	}
+	bool get_sections(Song_Sections &sections) {
+		uint8_t valid;
+		if (!get(valid) || !get(sections.header_hash)) { return false; }
+		sections.valid = valid != 0;
+		for (Channel_Section &section : sections.channels) {
+			uint32_t n;
+			if (!get_count(n, sizeof(uint32_t) * 3 + sizeof(uint64_t))) { return false; }
+			section.spans.resize(n);
+			for (Channel_Section::Span &span : section.spans) {
+				if (!get_string(span.label) || !get(span.offset) || !get(span.length) || !get(span.hash)) { return false; }
+			}
+			uint8_t has_waves;
+			if (!get_labels(section.visit_order) || !get(has_waves)) { return false; }
+			section.has_waves = has_waves != 0;
+		}
+		return true;
+	}
+};
+
+bool Song::read_song_cache(const char *cache_file, const char *f, const std::string &song_label, int64_t size, int64_t mod_time) {
+	Mapped_File file(cache_file);
+	if (!file.good()) { return false; }
+	Song_Cache_Reader reader(file.text());
+
+	char magic[4];
+	uint32_t version;
+	std::string path, label;
+	int64_t cached_size, cached_mod_time;
+	if (
+		!reader.get(magic) || memcmp(magic, SONG_CACHE_MAGIC, sizeof(magic)) ||
+		!reader.get(version) || version != SONG_CACHE_VERSION ||
+		!reader.get_string(path) || path != f ||
+		!reader.get_string(label) || label != song_label ||
+		!reader.get(cached_size) || cached_size != size ||
+		!reader.get(cached_mod_time) || cached_mod_time != mod_time
+	) {
+		return false;
+	}
+
+	std::string song_name;
+	int32_t number_of_channels;
+	std::string channel_labels[4];
+	Command_List channel_commands[4];
+	int32_t loop_ticks[4], end_ticks[4];
+	std::vector<Wave> waves;
+	std::vector<std::string> mixed_labels;
+	Song_Sections sections;
+	uint32_t num_waves = 0;
+
+	reader.get_string(song_name);
+	reader.get(number_of_channels);
+	for (int i = 0; i < 4; ++i) {
+		reader.get_string(channel_labels[i]);
+		reader.get_commands(channel_commands[i]);
+		reader.get(loop_ticks[i]);
+		reader.get(end_ticks[i]);
+	}
+	if (reader.get_count(num_waves, sizeof(Wave))) {
+		waves.resize(num_waves);
+		for (Wave &wave : waves) {
+			reader.get(wave);
+		}
+	}
+	reader.get_labels(mixed_labels);
+	reader.get_sections(sections);
+	if (!reader.done()) { return false; }
+
+	_song_name = std::move(song_name);
+	_number_of_channels = number_of_channels;
+	_channel_1_label = std::move(channel_labels[0]);
+	_channel_2_label = std::move(channel_labels[1]);
+	_channel_3_label = std::move(channel_labels[2]);
+	_channel_4_label = std::move(channel_labels[3]);
+	_channel_1_commands = std::move(channel_commands[0]);
+	_channel_2_commands = std::move(channel_commands[1]);
+	_channel_3_commands = std::move(channel_commands[2]);
+	_channel_4_commands = std::move(channel_commands[3]);
+	_channel_1_loop_tick = loop_ticks[0];
+	_channel_2_loop_tick = loop_ticks[1];
+	_channel_3_loop_tick = loop_ticks[2];
+	_channel_4_loop_tick = loop_ticks[3];
+	_channel_1_end_tick = end_ticks[0];
+	_channel_2_end_tick = end_ticks[1];
+	_channel_3_end_tick = end_ticks[2];
+	_channel_4_end_tick = end_ticks[3];
+	_waves = std::move(waves);
+	_mixed_labels = std::move(mixed_labels);
+	_sections = std::move(sections);
+	_saved_song_text.clear();
+	return true;
+}
+
+void Song::write_song_cache(const char *cache_file, const char *f, const std::string &song_label, int64_t size, int64_t mod_time) const {
+	Song_Cache_Writer writer;
+	writer.put(SONG_CACHE_MAGIC);
+	writer.put(SONG_CACHE_VERSION);
+	writer.put_string(f);
+	writer.put_string(song_label);
+	writer.put(size);
+	writer.put(mod_time);
+
+	writer.put_string(_song_name);
+	writer.put(_number_of_channels);
+	const std::string *channel_labels[4] = { &_channel_1_label, &_channel_2_label, &_channel_3_label, &_channel_4_label };
+	const Command_List *channel_commands[4] = { &_channel_1_commands, &_channel_2_commands, &_channel_3_commands, &_channel_4_commands };
+	const int32_t loop_ticks[4] = { _channel_1_loop_tick, _channel_2_loop_tick, _channel_3_loop_tick, _channel_4_loop_tick };
+	const int32_t end_ticks[4] = { _channel_1_end_tick, _channel_2_end_tick, _channel_3_end_tick, _channel_4_end_tick };
+	for (int i = 0; i < 4; ++i) {
+		writer.put_string(*channel_labels[i]);
+		writer.put_commands(*channel_commands[i]);
+		writer.put(loop_ticks[i]);
+		writer.put(end_ticks[i]);
+	}
+	writer.put((uint32_t)_waves.size());
+	for (const Wave &wave : _waves) {
+		writer.put(wave);
+	}
+	writer.put_labels(_mixed_labels);
+	writer.put_sections(_sections);
+
+	// a failed or partial write is harmless, since a truncated
+	// snapshot fails validation and falls back to a full parse
+	std::ofstream ofs;
+	open_ofstream(ofs, cache_file);
+	if (!ofs.good()) { return; }
+	ofs.write(writer.data().data(), writer.data().size());
+}
+
+Parsed_Song::Result Song::read_song(const char *f, const char *cache_dir, const std::string &song_label) {
+	int64_t size = file_size(f);
+	int64_t mod_time = file_modified(f);
+	std::string cache_file = cache_dir && *cache_dir ? song_cache_file(cache_dir, f, song_label) : "";
+	if (!cache_file.empty() && read_song_cache(cache_file.c_str(), f, song_label, size, mod_time)) {
+		_song_label = song_label;
+		_mod_time = mod_time;
+		_loaded = true;
+		return (_result = Parsed_Song::Result::SONG_OK);
+	}
+
+	Parsed_Song data(f, song_label);
 	if (data.result() != Parsed_Song::Result::SONG_OK) {
 		_error_message = data.get_error_message();
 		return (_result = data.result());
@@ -1051,15 +813,86 @@ Parsed_Song::Result Song::read_song(const char *f) {
 	_waves = data.waves();
 
 	_mixed_labels = data.mixed_labels();
+	_sections = data.sections();
+	_saved_song_text.clear();
 
-	_mod_time = file_modified(f);
+	_song_label = song_label;
+	_mod_time = mod_time;
+
+	if (!cache_file.empty()) {
+		write_song_cache(cache_file.c_str(), f, song_label, size, mod_time);
+		evict_oldest_files(cache_dir, ".cache", SONG_CACHE_MAX_SIZE);
+	}
 
 	_loaded = true;
 	return (_result = Parsed_Song::Result::SONG_OK);
 }
 
+Parsed_Song::Result Song::reload_song(const char *f, std::set<int32_t> &changed_channels) {
+	settle_history();
+
+	// only the song's own lines were kept when it was saved, so it is read back
+	// from them as if it started the file after something else
+	if (!_saved_song_text.empty()) {
+		Asm_Reader saved_reader(_saved_song_text);
+		Parsed_Song saved(saved_reader);
+		if (saved.result() == Parsed_Song::Result::SONG_OK) {
+			_sections = saved.sections();
+		}
+		_saved_song_text.clear();
+	}
+
+	// unsaved edits are discarded, so nothing can be kept from them
+	Parsed_Song data(f, _song_label, _modified ? nullptr : &_sections);
+	if (data.result() != Parsed_Song::Result::SONG_OK) {
+		_error_message = data.get_error_message();
+		return data.result();
+	}
+
+	_song_name = data.song_name();
+	_number_of_channels = data.number_of_channels();
+	_channel_1_label = data.channel_1_label();
+	_channel_2_label = data.channel_2_label();
+	_channel_3_label = data.channel_3_label();
+	_channel_4_label = data.channel_4_label();
+	Command_List parsed_commands[4] = { data.channel_1_commands(), data.channel_2_commands(), data.channel_3_commands(), data.channel_4_commands() };
+	int32_t parsed_loop_ticks[4] = { data.channel_1_loop_tick(), data.channel_2_loop_tick(), data.channel_3_loop_tick(), data.channel_4_loop_tick() };
+	int32_t parsed_end_ticks[4] = { data.channel_1_end_tick(), data.channel_2_end_tick(), data.channel_3_end_tick(), data.channel_4_end_tick() };
+	int32_t *channel_loop_ticks[4] = { &_channel_1_loop_tick, &_channel_2_loop_tick, &_channel_3_loop_tick, &_channel_4_loop_tick };
+	int32_t *channel_end_ticks[4] = { &_channel_1_end_tick, &_channel_2_end_tick, &_channel_3_end_tick, &_channel_4_end_tick };
+	changed_channels.clear();
+	for (int32_t i = 0; i < 4; ++i) {
+		if (data.channel_reused(i + 1)) { continue; }
+		channel_commands(i + 1) = std::move(parsed_commands[i]);
+		*channel_loop_ticks[i] = parsed_loop_ticks[i];
+		*channel_end_ticks[i] = parsed_end_ticks[i];
+		changed_channels.insert(i + 1);
+	}
+	// channels with inline waves are always parsed again, so these are complete
+	_waves = data.waves();
+
+	_mixed_labels = data.mixed_labels();
+	_sections = data.sections();
+
+	// undo states only hold their own channel, so the others' stay valid
+	const auto is_changed = [&](const Song_State &state) { return changed_channels.count(state.channel_number) > 0; };
+	_history.erase(std::remove_if(RANGE(_history), is_changed), _history.end());
+	_future.erase(std::remove_if(RANGE(_future), is_changed), _future.end());
+	_undo_bytes = 0;
+	for (std::deque<Song_State> *states : { &_history, &_future }) {
+		for (const Song_State &state : *states) {
+			_undo_bytes += state_bytes(state);
+		}
+	}
+
+	_mod_time = file_modified(f);
+	_modified = false;
+
+	return (_result = Parsed_Song::Result::SONG_OK);
+}
+
 void Song::new_song(Song_Options_Dialog::Song_Options options) {
-	auto build_channel = [](std::vector<Command> &commands, const std::string &channel_label, int channel_number, bool first_channel, int32_t loop_tick, int32_t end_tick) {
+	auto build_channel = [](Command_List &commands, const std::string &channel_label, int channel_number, bool first_channel, int32_t loop_tick, int32_t end_tick) {
 		Command command;
 		command.labels.push_back(channel_label);
 
@@ -1101,7 +934,7 @@ void Song::new_song(Song_Options_Dialog::Song_Options options) {
 			commands.push_back(command);
 		}
 
-		auto insert_ticks = [channel_number](std::vector<Command> &commands, Command &command, int32_t ticks_to_insert) {
+		auto insert_ticks = [channel_number](Command_List &commands, Command &command, int32_t ticks_to_insert) {
 			int32_t speed_ticks_to_insert = ticks_to_insert / 12;
 			int32_t rem_ticks_to_insert = ticks_to_insert % 12;
 
@@ -1250,39 +1083,78 @@ Song_Options_Dialog::Song_Options Song::get_options() {
 }
 
 bool Song::write_song(const char *f) {
+	_error_message.clear();
+
+	// a song chosen from a file holding several only replaces its own lines
+	std::string before_song, after_song;
+	std::vector<Indexed_Song> songs;
+	if (_song_label.size() > 0 && Parsed_Song::index_songs(f, songs) && songs.size() > 1) {
+		auto song_itr = std::find_if(RANGE(songs), [this](const Indexed_Song &s) { return s.label == _song_label; });
+		if (song_itr != songs.end()) {
+			if (!song_itr->self_contained) {
+				_error_message = "This song shares labels with other songs in the file,\n"
+					"so it cannot be saved in place.";
+				return false;
+			}
+			Mapped_File file(f);
+			if (!file.good()) {
+				_error_message = "Cannot open song file.";
+				return false;
+			}
+			std::string_view text = file.text();
+			before_song = text.substr(0, song_itr->begin);
+			after_song = text.substr(song_itr->end);
+		}
+	}
+
 	std::ofstream ofs;
 	open_ofstream(ofs, f);
 	if (!ofs.good()) { return false; }
 
-	ofs << _song_name << ":\n";
-	ofs << "\tchannel_count " << _number_of_channels << '\n';
+	// a blank line stands in for whatever is before the song,
+	// so that its header hashes as not starting the file
+	std::string song_text = before_song.empty() ? "" : "\n";
+	song_text += _song_name + ":\n";
+	song_text += "\tchannel_count " + std::to_string(_number_of_channels) + "\n";
 	if (_channel_1_label.size()) {
-		ofs << "\tchannel 1, " << _channel_1_label << '\n';
+		song_text += "\tchannel 1, " + _channel_1_label + "\n";
 	}
 	if (_channel_2_label.size()) {
-		ofs << "\tchannel 2, " << _channel_2_label << '\n';
+		song_text += "\tchannel 2, " + _channel_2_label + "\n";
 	}
 	if (_channel_3_label.size()) {
-		ofs << "\tchannel 3, " << _channel_3_label << '\n';
+		song_text += "\tchannel 3, " + _channel_3_label + "\n";
 	}
 	if (_channel_4_label.size()) {
-		ofs << "\tchannel 4, " << _channel_4_label << '\n';
+		song_text += "\tchannel 4, " + _channel_4_label + "\n";
 	}
 	if (_channel_1_label.size()) {
-		ofs << '\n' << commands_str(_channel_1_commands, 1);
+		song_text += "\n" + commands_str(_channel_1_commands, 1);
 	}
 	if (_channel_2_label.size()) {
-		ofs << '\n' << commands_str(_channel_2_commands, 2);
+		song_text += "\n" + commands_str(_channel_2_commands, 2);
 	}
 	if (_channel_3_label.size()) {
-		ofs << '\n' << commands_str(_channel_3_commands, 3);
+		song_text += "\n" + commands_str(_channel_3_commands, 3);
 	}
 	if (_channel_4_label.size()) {
-		ofs << '\n' << commands_str(_channel_4_commands, 4);
+		song_text += "\n" + commands_str(_channel_4_commands, 4);
 	}
+
+	ofs << before_song;
+	ofs << std::string_view(song_text).substr(before_song.empty() ? 0 : 1);
+	ofs << after_song;
 	ofs.close();
 
 	_mod_time = file_modified(f);
+	if (_song_label.size() > 0) {
+		_song_label = _song_name;
+	}
+
+	// the saved text is what a later reload gets compared with;
+	// a song saved in place holds all its own labels, so its lines parse the same on their own
+	_sections = {};
+	_saved_song_text = std::move(song_text);
 	return true;
 }
 
@@ -1296,6 +1168,59 @@ Note_View find_note_view(const std::vector<Note_View> &view, int32_t index) {
 	return Note_View{};
 }
 
+// each command's first view, so that many notes are looked up in one pass
+static std::vector<const Note_View *> index_note_views(const std::vector<Note_View> &view) {
+	int32_t size = 0;
+	for (const Note_View &note : view) {
+		size = std::max(size, note.index + 1);
+	}
+	std::vector<const Note_View *> views(size, nullptr);
+	for (auto note_itr = view.rbegin(); note_itr != view.rend(); ++note_itr) {
+		if (note_itr->index >= 0) {
+			views[note_itr->index] = &*note_itr;
+		}
+	}
+	return views;
+}
+
+static const Note_View &find_note_view(const std::vector<const Note_View *> &views, int32_t index) {
+	assert(index >= 0 && (size_t)index < views.size() && views[index]);
+	return *views[index];
+}
+
+// rewrites the commands from the first selected note to the last in a
+// single pass, instead of inserting around each note and moving everything
+// after it; edit appends what replaces the note at an index
+template<typename Edit>
+static void rewrite_notes(Command_List &commands, const std::set<int32_t> &selected_notes, Edit edit) {
+	if (selected_notes.empty()) { return; }
+	int32_t first = *selected_notes.begin();
+	int32_t last = *selected_notes.rbegin();
+	std::vector<Command> rewritten;
+	rewritten.reserve(last - first + 1 + selected_notes.size() * 2);
+	auto note_itr = selected_notes.begin();
+	auto command_itr = commands.begin() + first;
+	for (int32_t i = first; i <= last; ++i, ++command_itr) {
+		Command command = *command_itr;
+		if (*note_itr == i) {
+			edit(rewritten, command, i);
+			++note_itr;
+		}
+		else {
+			rewritten.push_back(command);
+		}
+	}
+	splice_commands(commands, first, last - first + 1, rewritten);
+}
+
+// puts a command before a note, moving the note's labels onto it
+static void put_before_note(std::vector<Command> &rewritten, Command command, Command &note) {
+	command.labels = note.labels;
+	note.labels.clear();
+	rewritten.push_back(command);
+	rewritten.push_back(note);
+}
+
 struct Command_Indexes {
 	int32_t rest_index = -1;
 	int32_t octave_index = -1;
@@ -1312,49 +1237,55 @@ struct Command_Indexes {
 	int32_t panning_index = -1;
 };
 
-void shift_indexes(Command_Indexes &indexes, int32_t index) {
-	if (indexes.rest_index > index) {
-		indexes.rest_index -= 1;
+// indexes that pointed at an erased command now point at the one after it,
+// as they would if the command had been erased from the list
+void forward_indexes(Command_Indexes &indexes, int32_t index, int32_t next) {
+	if (indexes.rest_index == index) {
+		indexes.rest_index = next;
 	}
-	if (indexes.octave_index > index) {
-		indexes.octave_index -= 1;
+	if (indexes.octave_index == index) {
+		indexes.octave_index = next;
 	}
-	if (indexes.speed_index > index) {
-		indexes.speed_index -= 1;
+	if (indexes.speed_index == index) {
+		indexes.speed_index = next;
 	}
-	if (indexes.transpose_index > index) {
-		indexes.transpose_index -= 1;
+	if (indexes.transpose_index == index) {
+		indexes.transpose_index = next;
 	}
-	if (indexes.tempo_index > index) {
-		indexes.tempo_index -= 1;
+	if (indexes.tempo_index == index) {
+		indexes.tempo_index = next;
 	}
-	if (indexes.duty_index > index) {
-		indexes.duty_index -= 1;
+	if (indexes.duty_index == index) {
+		indexes.duty_index = next;
 	}
-	if (indexes.vol_env_index > index) {
-		indexes.vol_env_index -= 1;
+	if (indexes.vol_env_index == index) {
+		indexes.vol_env_index = next;
 	}
-	if (indexes.slide_index > index) {
-		indexes.slide_index -= 1;
+	if (indexes.slide_index == index) {
+		indexes.slide_index = next;
 	}
-	if (indexes.vibrato_index > index) {
-		indexes.vibrato_index -= 1;
+	if (indexes.vibrato_index == index) {
+		indexes.vibrato_index = next;
 	}
-	if (indexes.toggle_noise_off_index > index) {
-		indexes.toggle_noise_off_index -= 1;
+	if (indexes.toggle_noise_off_index == index) {
+		indexes.toggle_noise_off_index = next;
 	}
-	if (indexes.toggle_noise_on_index > index) {
-		indexes.toggle_noise_on_index -= 1;
+	if (indexes.toggle_noise_on_index == index) {
+		indexes.toggle_noise_on_index = next;
 	}
-	if (indexes.toggle_noise_off_again_index > index) {
-		indexes.toggle_noise_off_again_index -= 1;
+	if (indexes.toggle_noise_off_again_index == index) {
+		indexes.toggle_noise_off_again_index = next;
 	}
-	if (indexes.panning_index > index) {
-		indexes.panning_index -= 1;
+	if (indexes.panning_index == index) {
+		indexes.panning_index = next;
 	}
 }
 
-void postprocess(std::vector<Command> &commands) {
+// removes redundant commands in passes until there are none left; a pass
+// keeps every command where it is and only unlinks the ones it erases,
+// then drops them all in one sweep at its end
+void postprocess(Command_List &channel) {
+	std::vector<Command> commands(RANGE(channel));
 	for (Command &command : commands) {
 		if (command.type == Command_Type::NOTE_TYPE && command.note_type.wave > 15) {
 			command.note_type.wave = 15;
@@ -1367,6 +1298,8 @@ void postprocess(std::vector<Command> &commands) {
 		}
 	}
 
+	std::vector<int32_t> prev, next;
+	std::vector<bool> erased;
 	bool deleted = false;
 	do {
 		Note_View view;
@@ -1374,14 +1307,28 @@ void postprocess(std::vector<Command> &commands) {
 		int32_t panning_right = -1;
 		Command_Indexes indexes;
 		deleted = false;
+
+		int32_t n = (int32_t)commands.size();
+		prev.resize(n);
+		next.resize(n);
+		for (int32_t i = 0; i < n; ++i) {
+			prev[i] = i - 1;
+			next[i] = i + 1;
+		}
+		erased.assign(n, false);
+		const auto erase_command = [&](int32_t index) {
+			erased[index] = true;
+			if (prev[index] != -1) { next[prev[index]] = next[index]; }
+			if (next[index] != n) { prev[next[index]] = prev[index]; }
+			forward_indexes(indexes, index, next[index]);
+		};
+
 		for (uint32_t i = 0; i < commands.size(); ++i) {
 			if ((is_control_command(commands[i].type) || commands[i].type == Command_Type::REST) && indexes.slide_index != -1) {
 				// automatically delete trailing pitch slide commands
 				deleted = true;
-				commands[indexes.slide_index + 1].labels.insert(commands[indexes.slide_index + 1].labels.begin(), RANGE(commands[indexes.slide_index].labels));
-				commands.erase(commands.begin() + indexes.slide_index);
-				i -= 1;
-				shift_indexes(indexes, indexes.slide_index);
+				commands[next[indexes.slide_index]].labels.insert(commands[next[indexes.slide_index]].labels.begin(), RANGE(commands[indexes.slide_index].labels));
+				erase_command(indexes.slide_index);
 
 				view.slide_duration = 0;
 				view.slide_octave = 0;
@@ -1475,8 +1422,7 @@ void postprocess(std::vector<Command> &commands) {
 						deleted = true;
 						commands[indexes.rest_index].rest.length = commands[indexes.rest_index].rest.length + commands[i].rest.length;
 						assert(commands[i].labels.size() == 0);
-						commands.erase(commands.begin() + i);
-						i -= 1;
+						erase_command(i);
 
 						// stop tracking the previous rest if it is now maxed out
 						if (commands[indexes.rest_index].rest.length == 16) {
@@ -1492,8 +1438,7 @@ void postprocess(std::vector<Command> &commands) {
 					if (view.octave == commands[i].octave.octave) {
 						deleted = true;
 						assert(commands[i].labels.size() == 0);
-						commands.erase(commands.begin() + i);
-						i -= 1;
+						erase_command(i);
 					}
 					// otherwise, track it
 					else {
@@ -1504,10 +1449,8 @@ void postprocess(std::vector<Command> &commands) {
 				else {
 					// octave changed twice in a row, so delete the old one
 					deleted = true;
-					commands[indexes.octave_index + 1].labels.insert(commands[indexes.octave_index + 1].labels.begin(), RANGE(commands[indexes.octave_index].labels));
-					commands.erase(commands.begin() + indexes.octave_index);
-					i -= 1;
-					shift_indexes(indexes, indexes.octave_index);
+					commands[next[indexes.octave_index]].labels.insert(commands[next[indexes.octave_index]].labels.begin(), RANGE(commands[indexes.octave_index].labels));
+					erase_command(indexes.octave_index);
 
 					view.octave = commands[i].octave.octave;
 					indexes.octave_index = i;
@@ -1528,8 +1471,7 @@ void postprocess(std::vector<Command> &commands) {
 					) {
 						deleted = true;
 						assert(commands[i].labels.size() == 0);
-						commands.erase(commands.begin() + i);
-						i -= 1;
+						erase_command(i);
 					}
 					// otherwise, track it
 					else {
@@ -1542,10 +1484,8 @@ void postprocess(std::vector<Command> &commands) {
 				else {
 					// note type changed twice in a row, so delete the old one
 					deleted = true;
-					commands[indexes.speed_index + 1].labels.insert(commands[indexes.speed_index + 1].labels.begin(), RANGE(commands[indexes.speed_index].labels));
-					commands.erase(commands.begin() + indexes.speed_index);
-					i -= 1;
-					shift_indexes(indexes, indexes.speed_index);
+					commands[next[indexes.speed_index]].labels.insert(commands[next[indexes.speed_index]].labels.begin(), RANGE(commands[indexes.speed_index].labels));
+					erase_command(indexes.speed_index);
 
 					view.speed = commands[i].note_type.speed;
 					view.volume = commands[i].note_type.volume;
@@ -1559,8 +1499,7 @@ void postprocess(std::vector<Command> &commands) {
 					if (view.speed == commands[i].drum_speed.speed) {
 						deleted = true;
 						assert(commands[i].labels.size() == 0);
-						commands.erase(commands.begin() + i);
-						i -= 1;
+						erase_command(i);
 					}
 					// otherwise, track it
 					else {
@@ -1571,10 +1510,8 @@ void postprocess(std::vector<Command> &commands) {
 				else {
 					// speed changed twice in a row, so delete the old one
 					deleted = true;
-					commands[indexes.speed_index + 1].labels.insert(commands[indexes.speed_index + 1].labels.begin(), RANGE(commands[indexes.speed_index].labels));
-					commands.erase(commands.begin() + indexes.speed_index);
-					i -= 1;
-					shift_indexes(indexes, indexes.speed_index);
+					commands[next[indexes.speed_index]].labels.insert(commands[next[indexes.speed_index]].labels.begin(), RANGE(commands[indexes.speed_index].labels));
+					erase_command(indexes.speed_index);
 
 					view.speed = commands[i].drum_speed.speed;
 					indexes.speed_index = i;
@@ -1594,8 +1531,7 @@ void postprocess(std::vector<Command> &commands) {
 					) {
 						deleted = true;
 						assert(commands[i].labels.size() == 0);
-						commands.erase(commands.begin() + i);
-						i -= 1;
+						erase_command(i);
 					}
 					// otherwise, track it
 					else {
@@ -1607,10 +1543,8 @@ void postprocess(std::vector<Command> &commands) {
 				else {
 					// transpose changed twice in a row, so delete the old one
 					deleted = true;
-					commands[indexes.transpose_index + 1].labels.insert(commands[indexes.transpose_index + 1].labels.begin(), RANGE(commands[indexes.transpose_index].labels));
-					commands.erase(commands.begin() + indexes.transpose_index);
-					i -= 1;
-					shift_indexes(indexes, indexes.transpose_index);
+					commands[next[indexes.transpose_index]].labels.insert(commands[next[indexes.transpose_index]].labels.begin(), RANGE(commands[indexes.transpose_index].labels));
+					erase_command(indexes.transpose_index);
 
 					view.transpose_octaves = commands[i].transpose.num_octaves;
 					view.transpose_pitches = commands[i].transpose.num_pitches;
@@ -1624,8 +1558,7 @@ void postprocess(std::vector<Command> &commands) {
 					if (view.tempo == commands[i].tempo.tempo) {
 						deleted = true;
 						assert(commands[i].labels.size() == 0);
-						commands.erase(commands.begin() + i);
-						i -= 1;
+						erase_command(i);
 					}
 					// otherwise, track it
 					else {
@@ -1636,10 +1569,8 @@ void postprocess(std::vector<Command> &commands) {
 				else {
 					// tempo changed twice in a row, so delete the old one
 					deleted = true;
-					commands[indexes.tempo_index + 1].labels.insert(commands[indexes.tempo_index + 1].labels.begin(), RANGE(commands[indexes.tempo_index].labels));
-					commands.erase(commands.begin() + indexes.tempo_index);
-					i -= 1;
-					shift_indexes(indexes, indexes.tempo_index);
+					commands[next[indexes.tempo_index]].labels.insert(commands[next[indexes.tempo_index]].labels.begin(), RANGE(commands[indexes.tempo_index].labels));
+					erase_command(indexes.tempo_index);
 
 					view.tempo = commands[i].tempo.tempo;
 					indexes.tempo_index = i;
@@ -1652,8 +1583,7 @@ void postprocess(std::vector<Command> &commands) {
 					if (view.duty == commands[i].duty_cycle.duty) {
 						deleted = true;
 						assert(commands[i].labels.size() == 0);
-						commands.erase(commands.begin() + i);
-						i -= 1;
+						erase_command(i);
 					}
 					// otherwise, track it
 					else {
@@ -1664,10 +1594,8 @@ void postprocess(std::vector<Command> &commands) {
 				else {
 					// duty changed twice in a row, so delete the old one
 					deleted = true;
-					commands[indexes.duty_index + 1].labels.insert(commands[indexes.duty_index + 1].labels.begin(), RANGE(commands[indexes.duty_index].labels));
-					commands.erase(commands.begin() + indexes.duty_index);
-					i -= 1;
-					shift_indexes(indexes, indexes.duty_index);
+					commands[next[indexes.duty_index]].labels.insert(commands[next[indexes.duty_index]].labels.begin(), RANGE(commands[indexes.duty_index].labels));
+					erase_command(indexes.duty_index);
 
 					view.duty = commands[i].duty_cycle.duty;
 					indexes.duty_index = i;
@@ -1683,8 +1611,7 @@ void postprocess(std::vector<Command> &commands) {
 					) {
 						deleted = true;
 						assert(commands[i].labels.size() == 0);
-						commands.erase(commands.begin() + i);
-						i -= 1;
+						erase_command(i);
 					}
 					// otherwise, track it
 					else {
@@ -1697,8 +1624,7 @@ void postprocess(std::vector<Command> &commands) {
 
 							deleted = true;
 							assert(commands[i].labels.size() == 0);
-							commands.erase(commands.begin() + i);
-							i -= 1;
+							erase_command(i);
 						}
 						else {
 							indexes.vol_env_index = i;
@@ -1711,10 +1637,8 @@ void postprocess(std::vector<Command> &commands) {
 				else {
 					// envelope changed twice in a row, so delete the old one
 					deleted = true;
-					commands[indexes.vol_env_index + 1].labels.insert(commands[indexes.vol_env_index + 1].labels.begin(), RANGE(commands[indexes.vol_env_index].labels));
-					commands.erase(commands.begin() + indexes.vol_env_index);
-					i -= 1;
-					shift_indexes(indexes, indexes.vol_env_index);
+					commands[next[indexes.vol_env_index]].labels.insert(commands[next[indexes.vol_env_index]].labels.begin(), RANGE(commands[indexes.vol_env_index].labels));
+					erase_command(indexes.vol_env_index);
 
 					view.volume = commands[i].volume_envelope.volume;
 					view.fade = commands[i].volume_envelope.fade;
@@ -1742,10 +1666,8 @@ void postprocess(std::vector<Command> &commands) {
 				}
 				else {
 					deleted = true;
-					commands[indexes.slide_index + 1].labels.insert(commands[indexes.slide_index + 1].labels.begin(), RANGE(commands[indexes.slide_index].labels));
-					commands.erase(commands.begin() + indexes.slide_index);
-					i -= 1;
-					shift_indexes(indexes, indexes.slide_index);
+					commands[next[indexes.slide_index]].labels.insert(commands[next[indexes.slide_index]].labels.begin(), RANGE(commands[indexes.slide_index].labels));
+					erase_command(indexes.slide_index);
 
 					view.slide_duration = commands[i].pitch_slide.duration;
 					view.slide_octave = commands[i].pitch_slide.octave;
@@ -1764,8 +1686,7 @@ void postprocess(std::vector<Command> &commands) {
 					) {
 						deleted = true;
 						assert(commands[i].labels.size() == 0);
-						commands.erase(commands.begin() + i);
-						i -= 1;
+						erase_command(i);
 					}
 					// otherwise, track it
 					else {
@@ -1778,10 +1699,8 @@ void postprocess(std::vector<Command> &commands) {
 				else {
 					// vibrato changed twice in a row, so delete the old one
 					deleted = true;
-					commands[indexes.vibrato_index + 1].labels.insert(commands[indexes.vibrato_index + 1].labels.begin(), RANGE(commands[indexes.vibrato_index].labels));
-					commands.erase(commands.begin() + indexes.vibrato_index);
-					i -= 1;
-					shift_indexes(indexes, indexes.vibrato_index);
+					commands[next[indexes.vibrato_index]].labels.insert(commands[next[indexes.vibrato_index]].labels.begin(), RANGE(commands[indexes.vibrato_index].labels));
+					erase_command(indexes.vibrato_index);
 
 					view.vibrato_delay = commands[i].vibrato.delay;
 					view.vibrato_extent = commands[i].vibrato.extent;
@@ -1818,13 +1737,10 @@ void postprocess(std::vector<Command> &commands) {
 							if (view.drumkit == commands[i].toggle_noise.drumkit) {
 								deleted = true;
 								assert(commands[i].labels.size() == 0);
-								commands.erase(commands.begin() + i);
-								i -= 1;
+								erase_command(i);
 
 								assert(commands[indexes.toggle_noise_off_index].labels.size() == 0);
-								commands.erase(commands.begin() + indexes.toggle_noise_off_index);
-								i -= 1;
-								shift_indexes(indexes, indexes.toggle_noise_off_index);
+								erase_command(indexes.toggle_noise_off_index);
 								indexes.toggle_noise_off_index = -1;
 							}
 							// otherwise, track it
@@ -1840,14 +1756,10 @@ void postprocess(std::vector<Command> &commands) {
 						// drumkit changed twice in a row, so delete the old one (off and on commands)
 						deleted = true;
 						assert(commands[indexes.toggle_noise_on_index].labels.size() == 0);
-						commands.erase(commands.begin() + indexes.toggle_noise_on_index);
-						i -= 1;
-						shift_indexes(indexes, indexes.toggle_noise_on_index);
+						erase_command(indexes.toggle_noise_on_index);
 
-						commands[indexes.toggle_noise_off_index + 1].labels.insert(commands[indexes.toggle_noise_off_index + 1].labels.begin(), RANGE(commands[indexes.toggle_noise_off_index].labels));
-						commands.erase(commands.begin() + indexes.toggle_noise_off_index);
-						i -= 1;
-						shift_indexes(indexes, indexes.toggle_noise_off_index);
+						commands[next[indexes.toggle_noise_off_index]].labels.insert(commands[next[indexes.toggle_noise_off_index]].labels.begin(), RANGE(commands[indexes.toggle_noise_off_index].labels));
+						erase_command(indexes.toggle_noise_off_index);
 
 						view.drumkit = commands[i].toggle_noise.drumkit;
 						indexes.toggle_noise_off_index = indexes.toggle_noise_off_again_index;
@@ -1866,8 +1778,7 @@ void postprocess(std::vector<Command> &commands) {
 					) {
 						deleted = true;
 						assert(commands[i].labels.size() == 0);
-						commands.erase(commands.begin() + i);
-						i -= 1;
+						erase_command(i);
 					}
 					// otherwise, track it
 					else {
@@ -1879,10 +1790,8 @@ void postprocess(std::vector<Command> &commands) {
 				else {
 					// panning changed twice in a row, so delete the old one
 					deleted = true;
-					commands[indexes.panning_index + 1].labels.insert(commands[indexes.panning_index + 1].labels.begin(), RANGE(commands[indexes.panning_index].labels));
-					commands.erase(commands.begin() + indexes.panning_index);
-					i -= 1;
-					shift_indexes(indexes, indexes.panning_index);
+					commands[next[indexes.panning_index]].labels.insert(commands[next[indexes.panning_index]].labels.begin(), RANGE(commands[indexes.panning_index].labels));
+					erase_command(indexes.panning_index);
 
 					panning_left = commands[i].stereo_panning.left;
 					panning_right = commands[i].stereo_panning.right;
@@ -1895,28 +1804,46 @@ void postprocess(std::vector<Command> &commands) {
 				indexes.panning_index = -1;
 			}
 		}
-	} while (deleted);
 
-	for (uint32_t i = 0; i < commands.size(); ++i) {
-		if (commands[i].type == Command_Type::TEMPO && commands[i].tempo.tempo == 0) {
-			commands[i + 1].labels.insert(commands[i + 1].labels.begin(), RANGE(commands[i].labels));
-			commands.erase(commands.begin() + i);
-			i -= 1;
+		if (deleted) {
+			size_t kept = 0;
+			for (int32_t i = 0; i < n; ++i) {
+				if (!erased[i]) { commands[kept++] = commands[i]; }
+			}
+			commands.resize(kept);
 		}
-		else if (
-			commands[i].type == Command_Type::PITCH_SLIDE &&
+	} while (deleted);
+
+	size_t kept = 0;
+	for (size_t i = 0; i < commands.size(); ++i) {
+		if (
+			(commands[i].type == Command_Type::TEMPO && commands[i].tempo.tempo == 0) ||
+			(commands[i].type == Command_Type::PITCH_SLIDE &&
 			(commands[i].pitch_slide.duration == 0 ||
 			commands[i].pitch_slide.octave == 0 ||
-			commands[i].pitch_slide.pitch == Pitch::REST)
+			commands[i].pitch_slide.pitch == Pitch::REST))
 		) {
-			commands[i + 1].labels.insert(commands[i + 1].labels.begin(), RANGE(commands[i].labels));
-			commands.erase(commands.begin() + i);
-			i -= 1;
+			if (i + 1 < commands.size()) {
+				commands[i + 1].labels.insert(commands[i + 1].labels.begin(), RANGE(commands[i].labels));
+			}
+			continue;
 		}
+		commands[kept++] = commands[i];
 	}
+	commands.resize(kept);
+
+	// write back only the changed range, so the chunks around it stay shared
+	const Command_List &original = channel;
+	size_t common = std::min(original.size(), commands.size());
+	size_t prefix = 0;
+	for (auto itr = original.begin(); prefix < common && !memcmp(&*itr, &commands[prefix], sizeof(Command)); ++itr) { ++prefix; }
+	size_t suffix = 0;
+	for (auto itr = original.rbegin(); suffix < common - prefix && !memcmp(&*itr, &commands[commands.size() - 1 - suffix], sizeof(Command)); ++itr) { ++suffix; }
+	auto itr = channel.erase(channel.begin() + prefix, channel.end() - suffix);
+	channel.insert(itr, commands.begin() + prefix, commands.end() - suffix);
 }
 
-int32_t insert_ticks(int32_t selected_channel, std::vector<Command> &commands, int32_t ticks_to_insert, int32_t index, int32_t speed = 1, int32_t volume = 0, int32_t fade = 0) {
+int32_t insert_ticks(int32_t selected_channel, Command_List &commands, int32_t ticks_to_insert, int32_t index, int32_t speed = 1, int32_t volume = 0, int32_t fade = 0) {
 	int32_t inserted = 0;
 
 	int32_t speed_ticks_to_insert = ticks_to_insert / speed;
@@ -1951,7 +1878,7 @@ int32_t insert_ticks(int32_t selected_channel, std::vector<Command> &commands, i
 	return inserted;
 }
 
-void erase_ticks(int32_t selected_channel, std::vector<Command> &commands, int32_t ticks_to_erase, int32_t index, int32_t speed, int32_t volume, int32_t fade) {
+void erase_ticks(int32_t selected_channel, Command_List &commands, int32_t ticks_to_erase, int32_t index, int32_t speed, int32_t volume, int32_t fade) {
 	int32_t ticks = 0;
 	index += 1;
 	while (index < (int32_t)commands.size()) {
@@ -1978,7 +1905,7 @@ void erase_ticks(int32_t selected_channel, std::vector<Command> &commands, int32
 	}
 }
 
-void resize_channel(int32_t selected_channel, std::vector<Command> &commands, const std::string &channel_label, int32_t new_loop_tick, int32_t new_end_tick) {
+void resize_channel(int32_t selected_channel, Command_List &commands, const std::string &channel_label, int32_t new_loop_tick, int32_t new_end_tick) {
 	int32_t old_loop_tick, old_end_tick;
 	Extra_Info original_info;
 	calc_channel_length(commands, old_loop_tick, old_end_tick, &original_info);
@@ -2038,12 +1965,12 @@ void resize_channel(int32_t selected_channel, std::vector<Command> &commands, co
 			if (commands[original_info.end_index].target == channel_label) {
 				int i = 0;
 				std::string loop_label = get_next_label(commands, channel_label, "mainLoop", i);
-				commands[0].labels.push_back(loop_label);
-				commands[original_info.end_index].target = loop_label;
+				commands.modify(0).labels.push_back(loop_label);
+				commands.modify(original_info.end_index).target = loop_label;
 			}
 			for (size_t i = commands[0].labels.size() - 1; i < commands[0].labels.size(); --i) {
 				if (commands[0].labels[i] == channel_label) {
-					commands[0].labels.erase(commands[0].labels.begin() + i);
+					commands.modify(0).labels.erase(commands.modify(0).labels.begin() + i);
 				}
 			}
 		}
@@ -2065,7 +1992,7 @@ void resize_channel(int32_t selected_channel, std::vector<Command> &commands, co
 				command.note_type.fade = 0;
 				if (base_loop_index != loop_index) {
 					command.labels = std::move(commands[base_loop_index].labels);
-					commands[base_loop_index].labels.clear();
+					commands.modify(base_loop_index).labels.clear();
 				}
 				commands.insert(commands.begin() + base_loop_index, command);
 				loop_index += 1;
@@ -2080,7 +2007,7 @@ void resize_channel(int32_t selected_channel, std::vector<Command> &commands, co
 				command.toggle_noise.drumkit = 0;
 				if (base_loop_index != loop_index) {
 					command.labels = std::move(commands[base_loop_index].labels);
-					commands[base_loop_index].labels.clear();
+					commands.modify(base_loop_index).labels.clear();
 				}
 				commands.insert(commands.begin() + base_loop_index, command);
 				loop_index += 1;
@@ -2106,7 +2033,7 @@ void resize_channel(int32_t selected_channel, std::vector<Command> &commands, co
 			command.note_type.fade = original_info.fade_at_loop;
 			if (base_loop_index != loop_index) {
 				command.labels = std::move(commands[base_loop_index].labels);
-				commands[base_loop_index].labels.clear();
+				commands.modify(base_loop_index).labels.clear();
 			}
 			commands.insert(commands.begin() + base_loop_index, command);
 			if (loop_index >= base_loop_index) loop_index += 1;
@@ -2121,7 +2048,7 @@ void resize_channel(int32_t selected_channel, std::vector<Command> &commands, co
 					command.toggle_noise.drumkit = -1;
 					if (base_loop_index != loop_index) {
 						command.labels = std::move(commands[base_loop_index].labels);
-						commands[base_loop_index].labels.clear();
+						commands.modify(base_loop_index).labels.clear();
 					}
 					commands.insert(commands.begin() + base_loop_index, command);
 					if (loop_index >= base_loop_index) loop_index += 1;
@@ -2134,7 +2061,7 @@ void resize_channel(int32_t selected_channel, std::vector<Command> &commands, co
 					command.toggle_noise.drumkit = original_info.drumkit_at_loop;
 					if (base_loop_index != loop_index) {
 						command.labels = std::move(commands[base_loop_index].labels);
-						commands[base_loop_index].labels.clear();
+						commands.modify(base_loop_index).labels.clear();
 					}
 					commands.insert(commands.begin() + base_loop_index, command);
 					if (loop_index >= base_loop_index) loop_index += 1;
@@ -2147,7 +2074,7 @@ void resize_channel(int32_t selected_channel, std::vector<Command> &commands, co
 			command.drum_speed.speed = original_info.speed_at_loop;
 			if (base_loop_index != loop_index) {
 				command.labels = std::move(commands[base_loop_index].labels);
-				commands[base_loop_index].labels.clear();
+				commands.modify(base_loop_index).labels.clear();
 			}
 			commands.insert(commands.begin() + base_loop_index, command);
 			if (loop_index >= base_loop_index) loop_index += 1;
@@ -2156,7 +2083,7 @@ void resize_channel(int32_t selected_channel, std::vector<Command> &commands, co
 		}
 
 		if (original_info.loop_index == 0) {
-			commands[0].labels.insert(commands[0].labels.begin(), channel_label);
+			commands.modify(0).labels.insert(commands.modify(0).labels.begin(), channel_label);
 		}
 
 		while (loop_index != base_loop_index) {
@@ -2167,7 +2094,7 @@ void resize_channel(int32_t selected_channel, std::vector<Command> &commands, co
 				base_loop_index = itr_index(commands, find_note_with_label(commands, commands[base_loop_index].target));
 				continue;
 			}
-			commands[base_loop_index + 1].labels.insert(commands[base_loop_index + 1].labels.begin(), RANGE(commands[base_loop_index].labels));
+			commands.modify(base_loop_index + 1).labels.insert(commands.modify(base_loop_index + 1).labels.begin(), RANGE(commands[base_loop_index].labels));
 			commands.erase(commands.begin() + base_loop_index);
 			if (loop_index > base_loop_index) {
 				loop_index -= 1;
@@ -2242,7 +2169,7 @@ void resize_channel(int32_t selected_channel, std::vector<Command> &commands, co
 		if (info.end_index == 0) {
 			for (size_t i = commands[0].labels.size() - 1; i < commands[0].labels.size(); --i) {
 				if (commands[0].labels[i] == channel_label) {
-					commands[0].labels.erase(commands[0].labels.begin() + i);
+					commands.modify(0).labels.erase(commands.modify(0).labels.begin() + i);
 				}
 			}
 		}
@@ -2264,7 +2191,7 @@ void resize_channel(int32_t selected_channel, std::vector<Command> &commands, co
 				command.note_type.fade = 0;
 				if (base_end_index != end_index) {
 					command.labels = std::move(commands[base_end_index].labels);
-					commands[base_end_index].labels.clear();
+					commands.modify(base_end_index).labels.clear();
 				}
 				commands.insert(commands.begin() + base_end_index, command);
 				if (end_index >= base_end_index) end_index += 1;
@@ -2280,7 +2207,7 @@ void resize_channel(int32_t selected_channel, std::vector<Command> &commands, co
 					command.toggle_noise.drumkit = 0;
 					if (base_end_index != end_index) {
 						command.labels = std::move(commands[base_end_index].labels);
-						commands[base_end_index].labels.clear();
+						commands.modify(base_end_index).labels.clear();
 					}
 					commands.insert(commands.begin() + base_end_index, command);
 					if (end_index >= base_end_index) end_index += 1;
@@ -2293,7 +2220,7 @@ void resize_channel(int32_t selected_channel, std::vector<Command> &commands, co
 				command.drum_speed.speed = 12;
 				if (base_end_index != end_index) {
 					command.labels = std::move(commands[base_end_index].labels);
-					commands[base_end_index].labels.clear();
+					commands.modify(base_end_index).labels.clear();
 				}
 				commands.insert(commands.begin() + base_end_index, command);
 				if (end_index >= base_end_index) end_index += 1;
@@ -2311,7 +2238,7 @@ void resize_channel(int32_t selected_channel, std::vector<Command> &commands, co
 			command.note_type.fade = info.fade_at_end;
 			if (base_end_index != end_index) {
 				command.labels = std::move(commands[base_end_index].labels);
-				commands[base_end_index].labels.clear();
+				commands.modify(base_end_index).labels.clear();
 			}
 			commands.insert(commands.begin() + base_end_index, command);
 			if (end_index >= base_end_index) end_index += 1;
@@ -2326,7 +2253,7 @@ void resize_channel(int32_t selected_channel, std::vector<Command> &commands, co
 					command.toggle_noise.drumkit = -1;
 					if (base_end_index != end_index) {
 						command.labels = std::move(commands[base_end_index].labels);
-						commands[base_end_index].labels.clear();
+						commands.modify(base_end_index).labels.clear();
 					}
 					commands.insert(commands.begin() + base_end_index, command);
 					if (end_index >= base_end_index) end_index += 1;
@@ -2339,7 +2266,7 @@ void resize_channel(int32_t selected_channel, std::vector<Command> &commands, co
 					command.toggle_noise.drumkit = info.drumkit_at_end;
 					if (base_end_index != end_index) {
 						command.labels = std::move(commands[base_end_index].labels);
-						commands[base_end_index].labels.clear();
+						commands.modify(base_end_index).labels.clear();
 					}
 					commands.insert(commands.begin() + base_end_index, command);
 					if (end_index >= base_end_index) end_index += 1;
@@ -2352,7 +2279,7 @@ void resize_channel(int32_t selected_channel, std::vector<Command> &commands, co
 			command.drum_speed.speed = info.speed_at_end;
 			if (base_end_index != end_index) {
 				command.labels = std::move(commands[base_end_index].labels);
-				commands[base_end_index].labels.clear();
+				commands.modify(base_end_index).labels.clear();
 			}
 			commands.insert(commands.begin() + base_end_index, command);
 			if (end_index >= base_end_index) end_index += 1;
@@ -2361,7 +2288,7 @@ void resize_channel(int32_t selected_channel, std::vector<Command> &commands, co
 		}
 
 		if (original_info.end_index == 0) {
-			commands[0].labels.insert(commands[0].labels.begin(), channel_label);
+			commands.modify(0).labels.insert(commands.modify(0).labels.begin(), channel_label);
 		}
 
 		while (end_index != base_end_index) {
@@ -2372,7 +2299,7 @@ void resize_channel(int32_t selected_channel, std::vector<Command> &commands, co
 				base_end_index = itr_index(commands, find_note_with_label(commands, commands[base_end_index].target));
 				continue;
 			}
-			commands[base_end_index + 1].labels.insert(commands[base_end_index + 1].labels.begin(), RANGE(commands[base_end_index].labels));
+			commands.modify(base_end_index + 1).labels.insert(commands.modify(base_end_index + 1).labels.begin(), RANGE(commands[base_end_index].labels));
 			commands.erase(commands.begin() + base_end_index);
 			if (end_index > base_end_index) {
 				end_index -= 1;
@@ -2402,7 +2329,7 @@ void resize_channel(int32_t selected_channel, std::vector<Command> &commands, co
 
 int32_t Song::put_note(const int selected_channel, const std::set<int32_t> &selected_boxes, Pitch pitch, int32_t octave, int32_t old_octave, int32_t old_speed, int32_t prev_length, int32_t prev_speed, int32_t index, int32_t tick, int32_t tick_offset, bool set_drumkit, bool duplicate) {
 	remember(selected_channel, selected_boxes, duplicate ? Song_State::Action::DUPLICATE_NOTE : Song_State::Action::PUT_NOTE, tick);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
 
 	Command_Type new_type =
 		pitch == Pitch::REST ? Command_Type::REST :
@@ -2421,12 +2348,12 @@ int32_t Song::put_note(const int selected_channel, const std::set<int32_t> &sele
 	int32_t speed = old_speed;
 
 	if (tick_offset == 0) {
-		commands[index].type = new_type;
-		commands[index].note.length = length;
-		commands[index].note.pitch = pitch;
+		commands.modify(index).type = new_type;
+		commands.modify(index).note.length = length;
+		commands.modify(index).note.pitch = pitch;
 	}
 	else {
-		commands[index].note.length = tick_offset;
+		commands.modify(index).note.length = tick_offset;
 
 		Command command = Command(new_type);
 		command.note.length = length;
@@ -2447,7 +2374,7 @@ int32_t Song::put_note(const int selected_channel, const std::set<int32_t> &sele
 		Command command = Command(Command_Type::OCTAVE);
 		command.octave.octave = octave;
 		command.labels = std::move(commands[index].labels);
-		commands[index].labels.clear();
+		commands.modify(index).labels.clear();
 		commands.insert(commands.begin() + index, command);
 		index += 1;
 
@@ -2460,7 +2387,7 @@ int32_t Song::put_note(const int selected_channel, const std::set<int32_t> &sele
 		Command command = Command(Command_Type::TOGGLE_NOISE);
 		command.toggle_noise.drumkit = 0;
 		command.labels = std::move(commands[index].labels);
-		commands[index].labels.clear();
+		commands.modify(index).labels.clear();
 		commands.insert(commands.begin() + index, command);
 		index += 1;
 
@@ -2495,7 +2422,7 @@ int32_t Song::put_note(const int selected_channel, const std::set<int32_t> &sele
 		}
 
 		length = final_length;
-		commands[index].note.length = length;
+		commands.modify(index).note.length = length;
 
 		if (speed != final_speed) {
 			speed = final_speed;
@@ -2504,7 +2431,7 @@ int32_t Song::put_note(const int selected_channel, const std::set<int32_t> &sele
 			command.note_type.volume = note_view.volume;
 			command.note_type.fade = note_view.fade;
 			command.labels = std::move(commands[index].labels);
-			commands[index].labels.clear();
+			commands.modify(index).labels.clear();
 			commands.insert(commands.begin() + index, command);
 			index += 1;
 
@@ -2529,7 +2456,7 @@ int32_t Song::put_note(const int selected_channel, const std::set<int32_t> &sele
 
 void Song::apply_format_painter(const int selected_channel, const std::set<int32_t> &selected_boxes, const Note_View &from_view, const Note_View &to_view, int32_t tick, bool full, bool ambiguous) {
 	remember(selected_channel, selected_boxes, full ? Song_State::Action::FORMAT_PAINTER_ADVANCED : Song_State::Action::FORMAT_PAINTER, tick);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
 
 	int32_t index = to_view.index;
 
@@ -2541,7 +2468,7 @@ void Song::apply_format_painter(const int selected_channel, const std::set<int32
 				command.pitch_slide.octave = from_view.slide_octave;
 				command.pitch_slide.pitch = from_view.slide_pitch;
 				command.labels = std::move(commands[index].labels);
-				commands[index].labels.clear();
+				commands.modify(index).labels.clear();
 				commands.insert(commands.begin() + index, command);
 			}
 			{
@@ -2549,7 +2476,7 @@ void Song::apply_format_painter(const int selected_channel, const std::set<int32
 				command.transpose.num_octaves = from_view.transpose_octaves;
 				command.transpose.num_pitches = from_view.transpose_pitches;
 				command.labels = std::move(commands[index].labels);
-				commands[index].labels.clear();
+				commands.modify(index).labels.clear();
 				commands.insert(commands.begin() + index, command);
 			}
 		}
@@ -2557,7 +2484,7 @@ void Song::apply_format_painter(const int selected_channel, const std::set<int32
 			Command command = Command(Command_Type::TEMPO);
 			command.tempo.tempo = from_view.tempo;
 			command.labels = std::move(commands[index].labels);
-			commands[index].labels.clear();
+			commands.modify(index).labels.clear();
 			commands.insert(commands.begin() + index, command);
 		}
 	}
@@ -2567,7 +2494,7 @@ void Song::apply_format_painter(const int selected_channel, const std::set<int32
 			Command command = Command(Command_Type::DUTY_CYCLE);
 			command.duty_cycle.duty = from_view.duty;
 			command.labels = std::move(commands[index].labels);
-			commands[index].labels.clear();
+			commands.modify(index).labels.clear();
 			commands.insert(commands.begin() + index, command);
 		}
 		{
@@ -2576,7 +2503,7 @@ void Song::apply_format_painter(const int selected_channel, const std::set<int32
 			command.vibrato.extent = from_view.vibrato_extent;
 			command.vibrato.rate = from_view.vibrato_rate;
 			command.labels = std::move(commands[index].labels);
-			commands[index].labels.clear();
+			commands.modify(index).labels.clear();
 			commands.insert(commands.begin() + index, command);
 		}
 		if (from_view.index == to_view.index && !ambiguous) {
@@ -2585,7 +2512,7 @@ void Song::apply_format_painter(const int selected_channel, const std::set<int32
 			command.note_type.volume = from_view.volume;
 			command.note_type.fade = from_view.fade;
 			command.labels = std::move(commands[index].labels);
-			commands[index].labels.clear();
+			commands.modify(index).labels.clear();
 			commands.insert(commands.begin() + index, command);
 		}
 		else {
@@ -2593,14 +2520,14 @@ void Song::apply_format_painter(const int selected_channel, const std::set<int32
 			command.volume_envelope.volume = from_view.volume;
 			command.volume_envelope.fade = from_view.fade;
 			command.labels = std::move(commands[index].labels);
-			commands[index].labels.clear();
+			commands.modify(index).labels.clear();
 			commands.insert(commands.begin() + index, command);
 		}
 		if (from_view.index == to_view.index) {
 			Command command = Command(Command_Type::OCTAVE);
 			command.octave.octave = from_view.octave;
 			command.labels = std::move(commands[index].labels);
-			commands[index].labels.clear();
+			commands.modify(index).labels.clear();
 			commands.insert(commands.begin() + index, command);
 		}
 	}
@@ -2611,7 +2538,7 @@ void Song::apply_format_painter(const int selected_channel, const std::set<int32
 			command.vibrato.extent = from_view.vibrato_extent;
 			command.vibrato.rate = from_view.vibrato_rate;
 			command.labels = std::move(commands[index].labels);
-			commands[index].labels.clear();
+			commands.modify(index).labels.clear();
 			commands.insert(commands.begin() + index, command);
 		}
 		if (from_view.index == to_view.index && !ambiguous) {
@@ -2620,7 +2547,7 @@ void Song::apply_format_painter(const int selected_channel, const std::set<int32
 			command.note_type.volume = from_view.volume;
 			command.note_type.wave = from_view.wave;
 			command.labels = std::move(commands[index].labels);
-			commands[index].labels.clear();
+			commands.modify(index).labels.clear();
 			commands.insert(commands.begin() + index, command);
 		}
 		else {
@@ -2628,14 +2555,14 @@ void Song::apply_format_painter(const int selected_channel, const std::set<int32
 			command.volume_envelope.volume = from_view.volume;
 			command.volume_envelope.wave = from_view.wave;
 			command.labels = std::move(commands[index].labels);
-			commands[index].labels.clear();
+			commands.modify(index).labels.clear();
 			commands.insert(commands.begin() + index, command);
 		}
 		if (from_view.index == to_view.index) {
 			Command command = Command(Command_Type::OCTAVE);
 			command.octave.octave = from_view.octave;
 			command.labels = std::move(commands[index].labels);
-			commands[index].labels.clear();
+			commands.modify(index).labels.clear();
 			commands.insert(commands.begin() + index, command);
 		}
 	}
@@ -2644,14 +2571,14 @@ void Song::apply_format_painter(const int selected_channel, const std::set<int32
 			Command command = Command(Command_Type::DRUM_SPEED);
 			command.drum_speed.speed = from_view.speed;
 			command.labels = std::move(commands[index].labels);
-			commands[index].labels.clear();
+			commands.modify(index).labels.clear();
 			commands.insert(commands.begin() + index, command);
 		}
 		if (from_view.drumkit != -1 && to_view.drumkit != -1) {
 			Command command = Command(Command_Type::TOGGLE_NOISE);
 			command.toggle_noise.drumkit = -1;
 			command.labels = std::move(commands[index].labels);
-			commands[index].labels.clear();
+			commands.modify(index).labels.clear();
 			commands.insert(commands.begin() + index, command);
 
 			command = Command(Command_Type::TOGGLE_NOISE);
@@ -2665,11 +2592,12 @@ void Song::apply_format_painter(const int selected_channel, const std::set<int32
 
 void Song::set_speed(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, const std::vector<Note_View> &view, int32_t speed) {
 	remember(selected_channel, selected_boxes, Song_State::Action::SET_SPEED);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
+	std::vector<const Note_View *> views = index_note_views(view);
 
 	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
 		if (selected_channel == 4) {
-			Note_View note_view = find_note_view(view, *note_itr);
+			const Note_View &note_view = find_note_view(views, *note_itr);
 
 			Command command = Command(Command_Type::DRUM_SPEED);
 			command.drum_speed.speed = note_view.speed;
@@ -2686,11 +2614,11 @@ void Song::set_speed(const int selected_channel, const std::set<int32_t> &select
 
 			command.drum_speed.speed = speed;
 			command.labels = std::move(commands[*note_itr].labels);
-			commands[*note_itr].labels.clear();
+			commands.modify(*note_itr).labels.clear();
 			commands.insert(commands.begin() + *note_itr, command);
 		}
 		else {
-			Note_View note_view = find_note_view(view, *note_itr);
+			const Note_View &note_view = find_note_view(views, *note_itr);
 
 			Command command = Command(Command_Type::NOTE_TYPE);
 			command.note_type.speed = note_view.speed;
@@ -2709,7 +2637,7 @@ void Song::set_speed(const int selected_channel, const std::set<int32_t> &select
 
 			command.note_type.speed = speed;
 			command.labels = std::move(commands[*note_itr].labels);
-			commands[*note_itr].labels.clear();
+			commands.modify(*note_itr).labels.clear();
 			commands.insert(commands.begin() + *note_itr, command);
 		}
 	}
@@ -2719,372 +2647,356 @@ void Song::set_speed(const int selected_channel, const std::set<int32_t> &select
 
 void Song::set_volume(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, const std::vector<Note_View> &view, int32_t volume) {
 	remember(selected_channel, selected_boxes, Song_State::Action::SET_VOLUME);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
+	std::vector<const Note_View *> views = index_note_views(view);
 
-	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
-		Note_View note_view = find_note_view(view, *note_itr);
+	rewrite_notes(commands, selected_notes, [&](std::vector<Command> &rewritten, Command &note, int32_t index) {
+		const Note_View &note_view = find_note_view(views, index);
 		Command command = Command(Command_Type::VOLUME_ENVELOPE);
 		command.volume_envelope.volume = volume;
 		command.volume_envelope.fade = note_view.fade;
-		command.labels = std::move(commands[*note_itr].labels);
-		commands[*note_itr].labels.clear();
-		commands.insert(commands.begin() + *note_itr, command);
-	}
+		put_before_note(rewritten, command, note);
+	});
 
 	_modified = true;
 }
 
 void Song::set_fade(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, const std::vector<Note_View> &view, int32_t fade) {
 	remember(selected_channel, selected_boxes, Song_State::Action::SET_FADE);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
+	std::vector<const Note_View *> views = index_note_views(view);
 
-	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
-		Note_View note_view = find_note_view(view, *note_itr);
+	rewrite_notes(commands, selected_notes, [&](std::vector<Command> &rewritten, Command &note, int32_t index) {
+		const Note_View &note_view = find_note_view(views, index);
 		Command command = Command(Command_Type::VOLUME_ENVELOPE);
 		command.volume_envelope.volume = note_view.volume;
 		command.volume_envelope.fade = fade;
-		command.labels = std::move(commands[*note_itr].labels);
-		commands[*note_itr].labels.clear();
-		commands.insert(commands.begin() + *note_itr, command);
-	}
+		put_before_note(rewritten, command, note);
+	});
 
 	_modified = true;
 }
 
 void Song::set_vibrato_delay(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, const std::vector<Note_View> &view, int32_t delay) {
 	remember(selected_channel, selected_boxes, Song_State::Action::SET_VIBRATO_DELAY);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
+	std::vector<const Note_View *> views = index_note_views(view);
 
-	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
-		Note_View note_view = find_note_view(view, *note_itr);
+	rewrite_notes(commands, selected_notes, [&](std::vector<Command> &rewritten, Command &note, int32_t index) {
+		const Note_View &note_view = find_note_view(views, index);
 		Command command = Command(Command_Type::VIBRATO);
 		command.vibrato.delay = delay;
 		command.vibrato.extent = note_view.vibrato_extent;
 		command.vibrato.rate = note_view.vibrato_rate;
-		command.labels = std::move(commands[*note_itr].labels);
-		commands[*note_itr].labels.clear();
-		commands.insert(commands.begin() + *note_itr, command);
-	}
+		put_before_note(rewritten, command, note);
+	});
 
 	_modified = true;
 }
 
 void Song::set_vibrato_extent(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, const std::vector<Note_View> &view, int32_t extent) {
 	remember(selected_channel, selected_boxes, Song_State::Action::SET_VIBRATO_EXTENT);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
+	std::vector<const Note_View *> views = index_note_views(view);
 
-	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
-		Note_View note_view = find_note_view(view, *note_itr);
+	rewrite_notes(commands, selected_notes, [&](std::vector<Command> &rewritten, Command &note, int32_t index) {
+		const Note_View &note_view = find_note_view(views, index);
 		Command command = Command(Command_Type::VIBRATO);
 		command.vibrato.delay = note_view.vibrato_delay;
 		command.vibrato.extent = extent;
 		command.vibrato.rate = note_view.vibrato_rate;
-		command.labels = std::move(commands[*note_itr].labels);
-		commands[*note_itr].labels.clear();
-		commands.insert(commands.begin() + *note_itr, command);
-	}
+		put_before_note(rewritten, command, note);
+	});
 
 	_modified = true;
 }
 
 void Song::set_vibrato_rate(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, const std::vector<Note_View> &view, int32_t rate) {
 	remember(selected_channel, selected_boxes, Song_State::Action::SET_VIBRATO_RATE);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
+	std::vector<const Note_View *> views = index_note_views(view);
 
-	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
-		Note_View note_view = find_note_view(view, *note_itr);
+	rewrite_notes(commands, selected_notes, [&](std::vector<Command> &rewritten, Command &note, int32_t index) {
+		const Note_View &note_view = find_note_view(views, index);
 		Command command = Command(Command_Type::VIBRATO);
 		command.vibrato.delay = note_view.vibrato_delay;
 		command.vibrato.extent = note_view.vibrato_extent;
 		command.vibrato.rate = rate;
-		command.labels = std::move(commands[*note_itr].labels);
-		commands[*note_itr].labels.clear();
-		commands.insert(commands.begin() + *note_itr, command);
-	}
+		put_before_note(rewritten, command, note);
+	});
 
 	_modified = true;
 }
 
 void Song::set_wave(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, const std::vector<Note_View> &view, int32_t wave) {
 	remember(selected_channel, selected_boxes, Song_State::Action::SET_WAVE);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
+	std::vector<const Note_View *> views = index_note_views(view);
 
-	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
-		Note_View note_view = find_note_view(view, *note_itr);
+	rewrite_notes(commands, selected_notes, [&](std::vector<Command> &rewritten, Command &note, int32_t index) {
+		const Note_View &note_view = find_note_view(views, index);
 		Command command = Command(Command_Type::VOLUME_ENVELOPE);
 		command.volume_envelope.volume = note_view.volume;
 		command.volume_envelope.wave = wave;
-		command.labels = std::move(commands[*note_itr].labels);
-		commands[*note_itr].labels.clear();
-		commands.insert(commands.begin() + *note_itr, command);
-	}
+		put_before_note(rewritten, command, note);
+	});
 
 	_modified = true;
 }
 
 void Song::set_drumkit(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, int32_t drumkit) {
 	remember(selected_channel, selected_boxes, Song_State::Action::SET_DRUMKIT);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
 
-	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+	rewrite_notes(commands, selected_notes, [&](std::vector<Command> &rewritten, Command &note, int32_t) {
 		Command command = Command(Command_Type::TOGGLE_NOISE);
 		command.toggle_noise.drumkit = -1;
-		command.labels = std::move(commands[*note_itr].labels);
-		commands[*note_itr].labels.clear();
-		commands.insert(commands.begin() + *note_itr, command);
+		command.labels = note.labels;
+		note.labels.clear();
+		rewritten.push_back(command);
 
 		command = Command(Command_Type::TOGGLE_NOISE);
 		command.toggle_noise.drumkit = drumkit;
-		commands.insert(commands.begin() + *note_itr + 1, command);
-	}
+		rewritten.push_back(command);
+		rewritten.push_back(note);
+	});
 
 	_modified = true;
 }
 
 void Song::set_duty(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, int32_t duty) {
 	remember(selected_channel, selected_boxes, Song_State::Action::SET_DUTY);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
 
-	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+	rewrite_notes(commands, selected_notes, [&](std::vector<Command> &rewritten, Command &note, int32_t) {
 		Command command = Command(Command_Type::DUTY_CYCLE);
 		command.duty_cycle.duty = duty;
-		command.labels = std::move(commands[*note_itr].labels);
-		commands[*note_itr].labels.clear();
-		commands.insert(commands.begin() + *note_itr, command);
-	}
+		put_before_note(rewritten, command, note);
+	});
 
 	_modified = true;
 }
 
 void Song::set_tempo(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, int32_t tempo) {
 	remember(selected_channel, selected_boxes, Song_State::Action::SET_TEMPO);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
 
-	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+	rewrite_notes(commands, selected_notes, [&](std::vector<Command> &rewritten, Command &note, int32_t) {
 		Command command = Command(Command_Type::TEMPO);
 		command.tempo.tempo = tempo;
-		command.labels = std::move(commands[*note_itr].labels);
-		commands[*note_itr].labels.clear();
-		commands.insert(commands.begin() + *note_itr, command);
-	}
+		put_before_note(rewritten, command, note);
+	});
 
 	_modified = true;
 }
 
 void Song::set_transpose_octaves(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, const std::vector<Note_View> &view, int32_t octaves) {
 	remember(selected_channel, selected_boxes, Song_State::Action::SET_TRANSPOSE_OCTAVES);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
+	std::vector<const Note_View *> views = index_note_views(view);
 
-	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
-		Note_View note_view = find_note_view(view, *note_itr);
+	rewrite_notes(commands, selected_notes, [&](std::vector<Command> &rewritten, Command &note, int32_t index) {
+		const Note_View &note_view = find_note_view(views, index);
 		Command command = Command(Command_Type::TRANSPOSE);
 		command.transpose.num_octaves = octaves;
 		command.transpose.num_pitches = note_view.transpose_pitches;
-		command.labels = std::move(commands[*note_itr].labels);
-		commands[*note_itr].labels.clear();
-		commands.insert(commands.begin() + *note_itr, command);
-	}
+		put_before_note(rewritten, command, note);
+	});
 
 	_modified = true;
 }
 
 void Song::set_transpose_pitches(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, const std::vector<Note_View> &view, int32_t pitches) {
 	remember(selected_channel, selected_boxes, Song_State::Action::SET_TRANSPOSE_PITCHES);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
+	std::vector<const Note_View *> views = index_note_views(view);
 
-	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
-		Note_View note_view = find_note_view(view, *note_itr);
+	rewrite_notes(commands, selected_notes, [&](std::vector<Command> &rewritten, Command &note, int32_t index) {
+		const Note_View &note_view = find_note_view(views, index);
 		Command command = Command(Command_Type::TRANSPOSE);
 		command.transpose.num_octaves = note_view.transpose_octaves;
 		command.transpose.num_pitches = pitches;
-		command.labels = std::move(commands[*note_itr].labels);
-		commands[*note_itr].labels.clear();
-		commands.insert(commands.begin() + *note_itr, command);
-	}
+		put_before_note(rewritten, command, note);
+	});
 
 	_modified = true;
 }
 
 void Song::set_slide_duration(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, const std::vector<Note_View> &view, int32_t duration) {
 	remember(selected_channel, selected_boxes, Song_State::Action::SET_SLIDE_DURATION);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
+	std::vector<const Note_View *> views = index_note_views(view);
 
-	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
-		Note_View note_view = find_note_view(view, *note_itr);
+	rewrite_notes(commands, selected_notes, [&](std::vector<Command> &rewritten, Command &note, int32_t index) {
+		const Note_View &note_view = find_note_view(views, index);
 		Command command = Command(Command_Type::PITCH_SLIDE);
 		command.pitch_slide.duration = duration;
 		command.pitch_slide.octave = note_view.slide_octave;
 		command.pitch_slide.pitch = note_view.slide_pitch;
-		command.labels = std::move(commands[*note_itr].labels);
-		commands[*note_itr].labels.clear();
-		commands.insert(commands.begin() + *note_itr, command);
-	}
+		put_before_note(rewritten, command, note);
+	});
 
 	_modified = true;
 }
 
 void Song::set_slide_octave(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, const std::vector<Note_View> &view, int32_t octave) {
 	remember(selected_channel, selected_boxes, Song_State::Action::SET_SLIDE_OCTAVE);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
+	std::vector<const Note_View *> views = index_note_views(view);
 
-	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
-		Note_View note_view = find_note_view(view, *note_itr);
+	rewrite_notes(commands, selected_notes, [&](std::vector<Command> &rewritten, Command &note, int32_t index) {
+		const Note_View &note_view = find_note_view(views, index);
 		Command command = Command(Command_Type::PITCH_SLIDE);
 		command.pitch_slide.duration = note_view.slide_duration;
 		command.pitch_slide.octave = octave;
 		command.pitch_slide.pitch = note_view.slide_pitch;
-		command.labels = std::move(commands[*note_itr].labels);
-		commands[*note_itr].labels.clear();
-		commands.insert(commands.begin() + *note_itr, command);
-	}
+		put_before_note(rewritten, command, note);
+	});
 
 	_modified = true;
 }
 
 void Song::set_slide_pitch(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, const std::vector<Note_View> &view, Pitch pitch) {
 	remember(selected_channel, selected_boxes, Song_State::Action::SET_SLIDE_PITCH);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
+	std::vector<const Note_View *> views = index_note_views(view);
 
-	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
-		Note_View note_view = find_note_view(view, *note_itr);
+	rewrite_notes(commands, selected_notes, [&](std::vector<Command> &rewritten, Command &note, int32_t index) {
+		const Note_View &note_view = find_note_view(views, index);
 		Command command = Command(Command_Type::PITCH_SLIDE);
 		command.pitch_slide.duration = note_view.slide_duration;
 		command.pitch_slide.octave = note_view.slide_octave;
 		command.pitch_slide.pitch = pitch;
-		command.labels = std::move(commands[*note_itr].labels);
-		commands[*note_itr].labels.clear();
-		commands.insert(commands.begin() + *note_itr, command);
-	}
+		put_before_note(rewritten, command, note);
+	});
 
 	_modified = true;
 }
 
 void Song::set_slide(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, int32_t duration, int32_t octave, Pitch pitch) {
 	remember(selected_channel, selected_boxes, Song_State::Action::SET_SLIDE);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
 
-	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+	rewrite_notes(commands, selected_notes, [&](std::vector<Command> &rewritten, Command &note, int32_t) {
 		Command command = Command(Command_Type::PITCH_SLIDE);
 		command.pitch_slide.duration = duration;
 		command.pitch_slide.octave = octave;
 		command.pitch_slide.pitch = pitch;
-		command.labels = std::move(commands[*note_itr].labels);
-		commands[*note_itr].labels.clear();
-		commands.insert(commands.begin() + *note_itr, command);
-	}
+		put_before_note(rewritten, command, note);
+	});
 
 	_modified = true;
 }
 
 void Song::set_stereo_panning(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, bool left, bool right) {
 	remember(selected_channel, selected_boxes, Song_State::Action::SET_STEREO_PANNING);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
 
-	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+	rewrite_notes(commands, selected_notes, [&](std::vector<Command> &rewritten, Command &note, int32_t) {
 		Command command = Command(Command_Type::STEREO_PANNING);
 		command.stereo_panning.left = left;
 		command.stereo_panning.right = right;
-		command.labels = std::move(commands[*note_itr].labels);
-		commands[*note_itr].labels.clear();
-		commands.insert(commands.begin() + *note_itr, command);
-	}
+		put_before_note(rewritten, command, note);
+	});
 
 	_modified = true;
 }
 
 void Song::pitch_up(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, const std::vector<Note_View> &view) {
 	remember(selected_channel, selected_boxes, Song_State::Action::PITCH_UP);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
+	std::vector<const Note_View *> views = index_note_views(view);
 
-	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
-		if (commands[*note_itr].note.pitch == Pitch::B_NAT) {
-			commands[*note_itr].note.pitch = Pitch::C_NAT;
+	rewrite_notes(commands, selected_notes, [&](std::vector<Command> &rewritten, Command &note, int32_t index) {
+		if (note.note.pitch == Pitch::B_NAT) {
+			note.note.pitch = Pitch::C_NAT;
 
-			Note_View note_view = find_note_view(view, *note_itr);
+			const Note_View &note_view = find_note_view(views, index);
 			Command command = Command(Command_Type::OCTAVE);
-			command.octave.octave = note_view.octave;
-			commands.insert(commands.begin() + *note_itr + 1, command);
-
 			command.octave.octave = note_view.octave + 1;
-			command.labels = std::move(commands[*note_itr].labels);
-			commands[*note_itr].labels.clear();
-			commands.insert(commands.begin() + *note_itr, command);
+			put_before_note(rewritten, command, note);
+
+			command = Command(Command_Type::OCTAVE);
+			command.octave.octave = note_view.octave;
+			rewritten.push_back(command);
 		}
 		else {
-			commands[*note_itr].note.pitch = (Pitch)((int)commands[*note_itr].note.pitch + 1);
+			note.note.pitch = (Pitch)((int)note.note.pitch + 1);
+			rewritten.push_back(note);
 		}
-	}
+	});
 
 	_modified = true;
 }
 
 void Song::pitch_down(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, const std::vector<Note_View> &view) {
 	remember(selected_channel, selected_boxes, Song_State::Action::PITCH_DOWN);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
+	std::vector<const Note_View *> views = index_note_views(view);
 
-	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
-		if (commands[*note_itr].note.pitch == Pitch::C_NAT) {
-			commands[*note_itr].note.pitch = Pitch::B_NAT;
+	rewrite_notes(commands, selected_notes, [&](std::vector<Command> &rewritten, Command &note, int32_t index) {
+		if (note.note.pitch == Pitch::C_NAT) {
+			note.note.pitch = Pitch::B_NAT;
 
-			Note_View note_view = find_note_view(view, *note_itr);
+			const Note_View &note_view = find_note_view(views, index);
 			Command command = Command(Command_Type::OCTAVE);
-			command.octave.octave = note_view.octave;
-			commands.insert(commands.begin() + *note_itr + 1, command);
-
 			command.octave.octave = note_view.octave - 1;
-			command.labels = std::move(commands[*note_itr].labels);
-			commands[*note_itr].labels.clear();
-			commands.insert(commands.begin() + *note_itr, command);
+			put_before_note(rewritten, command, note);
+
+			command = Command(Command_Type::OCTAVE);
+			command.octave.octave = note_view.octave;
+			rewritten.push_back(command);
 		}
 		else {
-			commands[*note_itr].note.pitch = (Pitch)((int)commands[*note_itr].note.pitch - 1);
+			note.note.pitch = (Pitch)((int)note.note.pitch - 1);
+			rewritten.push_back(note);
 		}
-	}
+	});
 
 	_modified = true;
 }
 
 void Song::octave_up(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, const std::vector<Note_View> &view) {
 	remember(selected_channel, selected_boxes, Song_State::Action::OCTAVE_UP);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
+	std::vector<const Note_View *> views = index_note_views(view);
 
-	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
-		Note_View note_view = find_note_view(view, *note_itr);
+	rewrite_notes(commands, selected_notes, [&](std::vector<Command> &rewritten, Command &note, int32_t index) {
+		const Note_View &note_view = find_note_view(views, index);
 		Command command = Command(Command_Type::OCTAVE);
-		command.octave.octave = note_view.octave;
-		commands.insert(commands.begin() + *note_itr + 1, command);
-
 		command.octave.octave = note_view.octave + 1;
-		command.labels = std::move(commands[*note_itr].labels);
-		commands[*note_itr].labels.clear();
-		commands.insert(commands.begin() + *note_itr, command);
-	}
+		put_before_note(rewritten, command, note);
+
+		command = Command(Command_Type::OCTAVE);
+		command.octave.octave = note_view.octave;
+		rewritten.push_back(command);
+	});
 
 	_modified = true;
 }
 
 void Song::octave_down(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, const std::vector<Note_View> &view) {
 	remember(selected_channel, selected_boxes, Song_State::Action::OCTAVE_DOWN);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
+	std::vector<const Note_View *> views = index_note_views(view);
 
-	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
-		Note_View note_view = find_note_view(view, *note_itr);
+	rewrite_notes(commands, selected_notes, [&](std::vector<Command> &rewritten, Command &note, int32_t index) {
+		const Note_View &note_view = find_note_view(views, index);
 		Command command = Command(Command_Type::OCTAVE);
-		command.octave.octave = note_view.octave;
-		commands.insert(commands.begin() + *note_itr + 1, command);
-
 		command.octave.octave = note_view.octave - 1;
-		command.labels = std::move(commands[*note_itr].labels);
-		commands[*note_itr].labels.clear();
-		commands.insert(commands.begin() + *note_itr, command);
-	}
+		put_before_note(rewritten, command, note);
+
+		command = Command(Command_Type::OCTAVE);
+		command.octave.octave = note_view.octave;
+		rewritten.push_back(command);
+	});
 
 	_modified = true;
 }
 
 void Song::move_loop_left(const int selected_channel, const std::set<int32_t> &selected_boxes, const std::vector<Note_View> &view, Note_View start_view, Note_View end_view) {
 	remember(selected_channel, selected_boxes, Song_State::Action::MOVE_LEFT);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
 
 	auto command_itr = commands.rbegin() + (commands.size() - 1 - start_view.index);
 	assert(commands[start_view.index].labels.size() == 1);
@@ -3125,11 +3037,11 @@ void Song::move_loop_left(const int selected_channel, const std::set<int32_t> &s
 	}
 
 	if (commands[rest_index].rest.length == 1) {
-		commands[rest_index + 1].labels.insert(commands[rest_index + 1].labels.begin(), RANGE(commands[rest_index].labels));
+		commands.modify(rest_index + 1).labels.insert(commands.modify(rest_index + 1).labels.begin(), RANGE(commands[rest_index].labels));
 		commands.erase(commands.begin() + rest_index);
 	}
 	else {
-		commands[rest_index].rest.length -= 1;
+		commands.modify(rest_index).rest.length -= 1;
 	}
 
 	_modified = true;
@@ -3137,7 +3049,7 @@ void Song::move_loop_left(const int selected_channel, const std::set<int32_t> &s
 
 void Song::move_call_left(const int selected_channel, const std::set<int32_t> &selected_boxes, const std::vector<Note_View> &view, Note_View start_view, Note_View end_view) {
 	remember(selected_channel, selected_boxes, Song_State::Action::MOVE_LEFT);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
 
 	auto command_itr = commands.rbegin() + (commands.size() - 1 - start_view.index);
 	assert(commands[start_view.index].labels.size() == 0);
@@ -3178,11 +3090,11 @@ void Song::move_call_left(const int selected_channel, const std::set<int32_t> &s
 	}
 
 	if (commands[rest_index].rest.length == 1) {
-		commands[rest_index + 1].labels.insert(commands[rest_index + 1].labels.begin(), RANGE(commands[rest_index].labels));
+		commands.modify(rest_index + 1).labels.insert(commands.modify(rest_index + 1).labels.begin(), RANGE(commands[rest_index].labels));
 		commands.erase(commands.begin() + rest_index);
 	}
 	else {
-		commands[rest_index].rest.length -= 1;
+		commands.modify(rest_index).rest.length -= 1;
 	}
 
 	_modified = true;
@@ -3190,14 +3102,15 @@ void Song::move_call_left(const int selected_channel, const std::set<int32_t> &s
 
 void Song::move_left(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, const std::vector<Note_View> &view) {
 	remember(selected_channel, selected_boxes, Song_State::Action::MOVE_LEFT);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
+	std::vector<const Note_View *> views = index_note_views(view);
 
 	int32_t offset = 0;
 
 	for (auto note_itr = selected_notes.begin(); note_itr != selected_notes.end(); ++note_itr) {
 		auto command_itr = commands.rbegin() + (commands.size() - 1 - (*note_itr + offset));
 		assert(commands[*note_itr + offset].labels.size() == 0);
-		Note_View note_view = find_note_view(view, *note_itr);
+		const Note_View &note_view = find_note_view(views, *note_itr);
 
 		const auto find_preceding_rest = [&](decltype(command_itr) itr) {
 			++itr;
@@ -3235,11 +3148,11 @@ void Song::move_left(const int selected_channel, const std::set<int32_t> &select
 		}
 
 		if (commands[rest_index].rest.length == 1) {
-			commands[rest_index + 1].labels.insert(commands[rest_index + 1].labels.begin(), RANGE(commands[rest_index].labels));
+			commands.modify(rest_index + 1).labels.insert(commands.modify(rest_index + 1).labels.begin(), RANGE(commands[rest_index].labels));
 			commands.erase(commands.begin() + rest_index);
 		}
 		else {
-			commands[rest_index].rest.length -= 1;
+			commands.modify(rest_index).rest.length -= 1;
 			offset += 1;
 		}
 
@@ -3251,7 +3164,7 @@ void Song::move_left(const int selected_channel, const std::set<int32_t> &select
 
 void Song::move_loop_right(const int selected_channel, const std::set<int32_t> &selected_boxes, const std::vector<Note_View> &view, Note_View start_view, Note_View end_view) {
 	remember(selected_channel, selected_boxes, Song_State::Action::MOVE_RIGHT);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
 
 	auto command_itr = commands.begin() + end_view.index;
 
@@ -3275,20 +3188,20 @@ void Song::move_loop_right(const int selected_channel, const std::set<int32_t> &
 		commands.erase(commands.begin() + rest_index);
 	}
 	else {
-		commands[rest_index].rest.length -= 1;
+		commands.modify(rest_index).rest.length -= 1;
 	}
 
-	std::string label = commands[end_view.index].target;
+	Label label = commands[end_view.index].target;
 
-	std::vector<std::string> labels = std::move(commands[start_view.index].labels);
-	commands[start_view.index].labels.clear();
+	Label_List labels = commands[start_view.index].labels;
+	commands.modify(start_view.index).labels.clear();
 
 	for (size_t i = labels.size() - 1; i < labels.size(); --i) {
 		if (labels[i] == label) {
 			labels.erase(labels.begin() + i);
 		}
 	}
-	commands[start_view.index].labels.push_back(label);
+	commands.modify(start_view.index).labels.push_back(label);
 
 	if (start_view.speed != rest_view.speed) {
 		Command command = Command(selected_channel == 4 ? Command_Type::DRUM_SPEED : Command_Type::NOTE_TYPE);
@@ -3310,14 +3223,14 @@ void Song::move_loop_right(const int selected_channel, const std::set<int32_t> &
 		commands.insert(commands.begin() + start_view.index, command);
 	}
 
-	commands[start_view.index].labels = std::move(labels);
+	commands.modify(start_view.index).labels = labels;
 
 	_modified = true;
 }
 
 void Song::move_call_right(const int selected_channel, const std::set<int32_t> &selected_boxes, const std::vector<Note_View> &view, Note_View start_view, Note_View end_view) {
 	remember(selected_channel, selected_boxes, Song_State::Action::MOVE_RIGHT);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
 
 	auto command_itr = commands.begin() + start_view.index;
 
@@ -3341,11 +3254,11 @@ void Song::move_call_right(const int selected_channel, const std::set<int32_t> &
 		commands.erase(commands.begin() + rest_index);
 	}
 	else {
-		commands[rest_index].rest.length -= 1;
+		commands.modify(rest_index).rest.length -= 1;
 	}
 
-	std::vector<std::string> labels = std::move(commands[start_view.index].labels);
-	commands[start_view.index].labels.clear();
+	Label_List labels = commands[start_view.index].labels;
+	commands.modify(start_view.index).labels.clear();
 
 	if (start_view.speed != rest_view.speed) {
 		Command command = Command(selected_channel == 4 ? Command_Type::DRUM_SPEED : Command_Type::NOTE_TYPE);
@@ -3367,18 +3280,19 @@ void Song::move_call_right(const int selected_channel, const std::set<int32_t> &
 		commands.insert(commands.begin() + start_view.index, command);
 	}
 
-	commands[start_view.index].labels = std::move(labels);
+	commands.modify(start_view.index).labels = labels;
 
 	_modified = true;
 }
 
 void Song::move_right(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, const std::vector<Note_View> &view) {
 	remember(selected_channel, selected_boxes, Song_State::Action::MOVE_RIGHT);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
+	std::vector<const Note_View *> views = index_note_views(view);
 
 	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
 		auto command_itr = commands.begin() + *note_itr;
-		Note_View note_view = find_note_view(view, *note_itr);
+		const Note_View &note_view = find_note_view(views, *note_itr);
 
 		const auto find_following_rest = [&](decltype(command_itr) itr) {
 			++itr;
@@ -3400,11 +3314,11 @@ void Song::move_right(const int selected_channel, const std::set<int32_t> &selec
 			commands.erase(commands.begin() + rest_index);
 		}
 		else {
-			commands[rest_index].rest.length -= 1;
+			commands.modify(rest_index).rest.length -= 1;
 		}
 
-		std::vector<std::string> labels = std::move(commands[*note_itr].labels);
-		commands[*note_itr].labels.clear();
+		Label_List labels = commands[*note_itr].labels;
+		commands.modify(*note_itr).labels.clear();
 
 		if (note_view.speed != rest_view.speed) {
 			Command command = Command(selected_channel == 4 ? Command_Type::DRUM_SPEED : Command_Type::NOTE_TYPE);
@@ -3426,7 +3340,7 @@ void Song::move_right(const int selected_channel, const std::set<int32_t> &selec
 			commands.insert(commands.begin() + *note_itr, command);
 		}
 
-		commands[*note_itr].labels = std::move(labels);
+		commands.modify(*note_itr).labels = labels;
 	}
 
 	_modified = true;
@@ -3434,25 +3348,28 @@ void Song::move_right(const int selected_channel, const std::set<int32_t> &selec
 
 void Song::shorten(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, int32_t tick) {
 	remember(selected_channel, selected_boxes, Song_State::Action::SHORTEN, tick);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
+
+	rewrite_notes(commands, selected_notes, [&](std::vector<Command> &rewritten, Command &note, int32_t) {
+		note.note.length -= 1;
+		rewritten.push_back(note);
 
-	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
 		Command command = Command(Command_Type::REST);
 		command.rest.length = 1;
-		commands.insert(commands.begin() + *note_itr + 1, command);
-		commands[*note_itr].note.length -= 1;
-	}
+		rewritten.push_back(command);
+	});
 
 	_modified = true;
 }
 
 void Song::lengthen(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes, const std::vector<Note_View> &view, int32_t tick) {
 	remember(selected_channel, selected_boxes, Song_State::Action::LENGTHEN, tick);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
+	std::vector<const Note_View *> views = index_note_views(view);
 
 	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
-		Note_View note_view = find_note_view(view, *note_itr);
-		commands[*note_itr].note.length += 1;
+		const Note_View &note_view = find_note_view(views, *note_itr);
+		commands.modify(*note_itr).note.length += 1;
 		erase_ticks(selected_channel, commands, note_view.speed, *note_itr, note_view.speed, note_view.volume, note_view.fade);
 	}
 
@@ -3461,10 +3378,10 @@ void Song::lengthen(const int selected_channel, const std::set<int32_t> &selecte
 
 void Song::delete_selection(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes) {
 	remember(selected_channel, selected_boxes, Song_State::Action::DELETE_SELECTION);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
 
 	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
-		commands[*note_itr].type = Command_Type::REST;
+		commands.modify(*note_itr).type = Command_Type::REST;
 	}
 
 	_modified = true;
@@ -3472,10 +3389,10 @@ void Song::delete_selection(const int selected_channel, const std::set<int32_t>
 
 void Song::snip_selection(const int selected_channel, const std::set<int32_t> &selected_notes, const std::set<int32_t> &selected_boxes) {
 	remember(selected_channel, selected_boxes, Song_State::Action::SNIP_SELECTION);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
 
 	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
-		commands[*note_itr + 1].labels.insert(commands[*note_itr + 1].labels.begin(), RANGE(commands[*note_itr].labels));
+		commands.modify(*note_itr + 1).labels.insert(commands.modify(*note_itr + 1).labels.begin(), RANGE(commands[*note_itr].labels));
 		commands.erase(commands.begin() + *note_itr);
 	}
 
@@ -3486,7 +3403,7 @@ void Song::snip_selection(const int selected_channel, const std::set<int32_t> &s
 
 void Song::split_note(const int selected_channel, const std::set<int32_t> &selected_boxes, int32_t index, int32_t tick, int32_t tick_offset) {
 	remember(selected_channel, selected_boxes, Song_State::Action::SPLIT_NOTE, tick);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
 
 	assert(
 		commands[index].type == Command_Type::NOTE ||
@@ -3497,7 +3414,7 @@ void Song::split_note(const int selected_channel, const std::set<int32_t> &selec
 	Command command = Command(commands[index].type);
 	command.note.length = commands[index].note.length - tick_offset;
 	command.note.pitch = commands[index].note.pitch;
-	commands[index].note.length = tick_offset;
+	commands.modify(index).note.length = tick_offset;
 	commands.insert(commands.begin() + index + 1, command);
 
 	_modified = true;
@@ -3505,7 +3422,7 @@ void Song::split_note(const int selected_channel, const std::set<int32_t> &selec
 
 void Song::glue_note(const int selected_channel, const std::set<int32_t> &selected_boxes, int32_t index, int32_t tick) {
 	remember(selected_channel, selected_boxes, Song_State::Action::GLUE_NOTE, tick);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
 
 	assert(index > 0);
 	assert(
@@ -3519,7 +3436,7 @@ void Song::glue_note(const int selected_channel, const std::set<int32_t> &select
 		commands[index].labels.size() == 0
 	);
 
-	commands[index - 1].note.length += commands[index].note.length;
+	commands.modify(index - 1).note.length += commands[index].note.length;
 	commands.erase(commands.begin() + index);
 
 	_modified = true;
@@ -3527,7 +3444,7 @@ void Song::glue_note(const int selected_channel, const std::set<int32_t> &select
 
 void Song::insert_rest(const int selected_channel, const std::set<int32_t> &selected_boxes, int32_t index, int32_t tick, int32_t tick_offset) {
 	remember(selected_channel, selected_boxes, Song_State::Action::INSERT_REST, tick);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
 
 	assert(
 		commands[index].type == Command_Type::REST ||
@@ -3541,7 +3458,7 @@ void Song::insert_rest(const int selected_channel, const std::set<int32_t> &sele
 		assert(commands[index].type == Command_Type::REST);
 		Command command = Command(Command_Type::REST);
 		command.rest.length = commands[index].rest.length - tick_offset;
-		commands[index].rest.length = tick_offset;
+		commands.modify(index).rest.length = tick_offset;
 		commands.insert(commands.begin() + index + 1, command);
 		index += 1;
 	}
@@ -3549,7 +3466,7 @@ void Song::insert_rest(const int selected_channel, const std::set<int32_t> &sele
 	Command command = Command(Command_Type::REST);
 	command.rest.length = 1;
 	command.labels = std::move(commands[index].labels);
-	commands[index].labels.clear();
+	commands.modify(index).labels.clear();
 	commands.insert(commands.begin() + index, command);
 
 	resize_channel(selected_channel, commands, channel_label(selected_channel), channel_loop_tick(selected_channel), channel_end_tick(selected_channel));
@@ -3565,27 +3482,29 @@ void Song::postprocess_channel(const int selected_channel, const std::set<int32_
 void Song::resize_song(const Song_Options_Dialog::Song_Options &options) {
 	_history.clear();
 	_future.clear();
+	_undo_bytes = 0;
+	_edit_pending = false;
 
 	if (options.channel_1) {
-		std::vector<Command> &commands = channel_commands(1);
+		Command_List &commands = channel_commands(1);
 		resize_channel(1, commands, channel_label(1), options.looping ? options.channel_1_loop_tick : -1, options.channel_1_end_tick);
 		if (options.looping) _channel_1_loop_tick = options.channel_1_loop_tick;
 		_channel_1_end_tick = options.channel_1_end_tick;
 	}
 	if (options.channel_2) {
-		std::vector<Command> &commands = channel_commands(2);
+		Command_List &commands = channel_commands(2);
 		resize_channel(2, commands, channel_label(2), options.looping ? options.channel_2_loop_tick : -1, options.channel_2_end_tick);
 		if (options.looping) _channel_2_loop_tick = options.channel_2_loop_tick;
 		_channel_2_end_tick = options.channel_2_end_tick;
 	}
 	if (options.channel_3) {
-		std::vector<Command> &commands = channel_commands(3);
+		Command_List &commands = channel_commands(3);
 		resize_channel(3, commands, channel_label(3), options.looping ? options.channel_3_loop_tick : -1, options.channel_3_end_tick);
 		if (options.looping) _channel_3_loop_tick = options.channel_3_loop_tick;
 		_channel_3_end_tick = options.channel_3_end_tick;
 	}
 	if (options.channel_4) {
-		std::vector<Command> &commands = channel_commands(4);
+		Command_List &commands = channel_commands(4);
 		resize_channel(4, commands, channel_label(4), options.looping ? options.channel_4_loop_tick : -1, options.channel_4_end_tick);
 		if (options.looping) _channel_4_loop_tick = options.channel_4_loop_tick;
 		_channel_4_end_tick = options.channel_4_end_tick;
@@ -3596,20 +3515,20 @@ void Song::resize_song(const Song_Options_Dialog::Song_Options &options) {
 
 void Song::reduce_loop(const int selected_channel, const std::set<int32_t> &selected_boxes, int32_t tick, int32_t loop_index, int32_t loop_length, Note_View start_view, Note_View end_view) {
 	remember(selected_channel, selected_boxes, Song_State::Action::REDUCE_LOOP, tick);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
 
 	assert(commands[loop_index].type == Command_Type::SOUND_LOOP);
 	assert(commands[loop_index].sound_loop.loop_count > 1);
 	assert(end_view.speed != 0);
 
-	commands[loop_index].sound_loop.loop_count -= 1;
+	commands.modify(loop_index).sound_loop.loop_count -= 1;
 
 	insert_ticks(selected_channel, commands, loop_length, loop_index + 1, end_view.speed, end_view.volume, end_view.fade);
 
 	if (commands[loop_index].sound_loop.loop_count == 1) {
-		std::string target = commands[loop_index].target;
+		Label target = commands[loop_index].target;
 
-		commands[loop_index + 1].labels.insert(commands[loop_index + 1].labels.begin(), RANGE(commands[loop_index].labels));
+		commands.modify(loop_index + 1).labels.insert(commands.modify(loop_index + 1).labels.begin(), RANGE(commands[loop_index].labels));
 		commands.erase(commands.begin() + loop_index);
 
 		if (target != channel_label(selected_channel) && target.find_first_of(".") != std::string::npos && !is_label_referenced(commands, target)) {
@@ -3622,14 +3541,14 @@ void Song::reduce_loop(const int selected_channel, const std::set<int32_t> &sele
 
 void Song::extend_loop(const int selected_channel, const std::set<int32_t> &selected_boxes, int32_t tick, int32_t loop_index, int32_t loop_length, Note_View start_view, Note_View end_view) {
 	remember(selected_channel, selected_boxes, Song_State::Action::EXTEND_LOOP, tick);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
 
 	assert(commands[loop_index].type == Command_Type::SOUND_LOOP);
 	assert(commands[loop_index].sound_loop.loop_count > 1);
 	assert(commands[loop_index].sound_loop.loop_count < 255);
 	assert(end_view.speed != 0);
 
-	commands[loop_index].sound_loop.loop_count += 1;
+	commands.modify(loop_index).sound_loop.loop_count += 1;
 
 	erase_ticks(selected_channel, commands, loop_length, loop_index, end_view.speed, end_view.volume, end_view.fade);
 
@@ -3638,19 +3557,19 @@ void Song::extend_loop(const int selected_channel, const std::set<int32_t> &sele
 
 void Song::unroll_loop(const int selected_channel, const std::set<int32_t> &selected_boxes, int32_t tick, int32_t loop_index, const std::vector<Command> &snippet) {
 	remember(selected_channel, selected_boxes, Song_State::Action::UNROLL_LOOP, tick);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
 
 	assert(commands[loop_index].type == Command_Type::SOUND_LOOP);
 	assert(commands[loop_index].sound_loop.loop_count > 1);
 
-	commands[loop_index].sound_loop.loop_count -= 1;
+	commands.modify(loop_index).sound_loop.loop_count -= 1;
 
 	commands.insert(commands.begin() + (loop_index + 1), RANGE(snippet));
 
 	if (commands[loop_index].sound_loop.loop_count == 1) {
-		std::string target = commands[loop_index].target;
+		Label target = commands[loop_index].target;
 
-		commands[loop_index + 1].labels.insert(commands[loop_index + 1].labels.begin(), RANGE(commands[loop_index].labels));
+		commands.modify(loop_index + 1).labels.insert(commands.modify(loop_index + 1).labels.begin(), RANGE(commands[loop_index].labels));
 		commands.erase(commands.begin() + loop_index);
 
 		if (target != channel_label(selected_channel) && target.find_first_of(".") != std::string::npos && !is_label_referenced(commands, target)) {
@@ -3663,14 +3582,14 @@ void Song::unroll_loop(const int selected_channel, const std::set<int32_t> &sele
 
 void Song::create_loop(const int selected_channel, const std::set<int32_t> &selected_boxes, int32_t tick, int32_t start_index, int32_t end_index, int32_t loop_length, Note_View start_view, Note_View end_view, bool ambiguous_start) {
 	remember(selected_channel, selected_boxes, Song_State::Action::CREATE_LOOP, tick);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
 
 	assert(end_view.speed != 0);
 
 	std::string scope = get_scope(commands, start_index);
 	int loop_number = 1;
 	std::string loop_label = get_next_loop_label(commands, scope, loop_number);
-	commands[start_index].labels.push_back(loop_label);
+	commands.modify(start_index).labels.push_back(loop_label);
 
 	if (start_view.octave != end_view.octave) {
 		Command command = Command(Command_Type::OCTAVE);
@@ -3708,7 +3627,7 @@ void Song::create_loop(const int selected_channel, const std::set<int32_t> &sele
 
 void Song::delete_call(const int selected_channel, const std::set<int32_t> &selected_boxes, int32_t tick, int32_t call_index, int32_t ambiguous_ticks, int32_t unambiguous_ticks, Note_View start_view, Note_View end_view, int32_t start_index, int32_t end_index) {
 	remember(selected_channel, selected_boxes, Song_State::Action::DELETE_CALL, tick);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
 
 	assert(commands[call_index].type == Command_Type::SOUND_CALL);
 	assert(start_view.speed != 0);
@@ -3772,7 +3691,7 @@ void Song::delete_call(const int selected_channel, const std::set<int32_t> &sele
 
 	insert_ticks(selected_channel, commands, ambiguous_ticks, call_index + 1);
 
-	commands[call_index + 1].labels.insert(commands[call_index + 1].labels.begin(), RANGE(commands[call_index].labels));
+	commands.modify(call_index + 1).labels.insert(commands.modify(call_index + 1).labels.begin(), RANGE(commands[call_index].labels));
 	commands.erase(commands.begin() + call_index);
 
 	_modified = true;
@@ -3780,7 +3699,7 @@ void Song::delete_call(const int selected_channel, const std::set<int32_t> &sele
 
 void Song::unpack_call(const int selected_channel, const std::set<int32_t> &selected_boxes, int32_t tick, int32_t call_index, const std::vector<Command> &snippet, int32_t start_index, int32_t end_index) {
 	remember(selected_channel, selected_boxes, Song_State::Action::UNPACK_CALL, tick);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
 
 	assert(commands[call_index].type == Command_Type::SOUND_CALL);
 
@@ -3792,7 +3711,7 @@ void Song::unpack_call(const int selected_channel, const std::set<int32_t> &sele
 
 	commands.insert(commands.begin() + (call_index + 1), RANGE(snippet));
 
-	commands[call_index + 1].labels.insert(commands[call_index + 1].labels.begin(), RANGE(commands[call_index].labels));
+	commands.modify(call_index + 1).labels.insert(commands.modify(call_index + 1).labels.begin(), RANGE(commands[call_index].labels));
 	commands.erase(commands.begin() + call_index);
 
 	_modified = true;
@@ -3800,7 +3719,7 @@ void Song::unpack_call(const int selected_channel, const std::set<int32_t> &sele
 
 void Song::create_call(const int selected_channel, const std::set<int32_t> &selected_boxes, int32_t tick, int32_t start_index, int32_t end_index, const std::vector<Command> &snippet, const std::vector<std::string> &call_labels) {
 	remember(selected_channel, selected_boxes, Song_State::Action::CREATE_CALL, tick);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
 
 	assert(snippet.size() > 0 && snippet[0].labels.size() > 0);
 
@@ -3808,7 +3727,7 @@ void Song::create_call(const int selected_channel, const std::set<int32_t> &sele
 
 	Command call = Command(Command_Type::SOUND_CALL);
 	call.target = snippet[0].labels[0];
-	call.labels = call_labels;
+	call.labels = std::vector<Label>(RANGE(call_labels));
 	commands.insert(commands.begin() + end_index + 1, call);
 
 	for (int32_t i = end_index; i >= start_index; --i) {
@@ -3818,9 +3737,9 @@ void Song::create_call(const int selected_channel, const std::set<int32_t> &sele
 	_modified = true;
 }
 
-void Song::insert_call(const int selected_channel, const std::set<int32_t> &selected_boxes, int32_t tick, int32_t tick_offset, int32_t insert_index, const std::string &target_label, int32_t call_length, Note_View insert_view, Note_View start_view, Note_View end_view) {
+void Song::insert_call(const int selected_channel, const std::set<int32_t> &selected_boxes, int32_t tick, int32_t tick_offset, int32_t insert_index, Label target_label, int32_t call_length, Note_View insert_view, Note_View start_view, Note_View end_view) {
 	remember(selected_channel, selected_boxes, Song_State::Action::INSERT_CALL, tick);
-	std::vector<Command> &commands = channel_commands(selected_channel);
+	Command_List &commands = channel_commands(selected_channel);
 
 	assert(commands[insert_index].type == Command_Type::REST);
 
@@ -3830,7 +3749,7 @@ void Song::insert_call(const int selected_channel, const std::set<int32_t> &sele
 	if (tail_length < commands[insert_index].rest.length) {
 		Command command = Command(Command_Type::REST);
 		command.rest.length = tail_length;
-		commands[insert_index].rest.length -= tail_length;
+		commands.modify(insert_index).rest.length -= tail_length;
 		commands.insert(commands.begin() + insert_index + 1, command);
 		insert_index += 1;
 	}
@@ -3839,7 +3758,7 @@ void Song::insert_call(const int selected_channel, const std::set<int32_t> &sele
 		Command command = Command(Command_Type::OCTAVE);
 		command.octave.octave = start_view.octave;
 		command.labels = std::move(commands[insert_index].labels);
-		commands[insert_index].labels.clear();
+		commands.modify(insert_index).labels.clear();
 		commands.insert(commands.begin() + insert_index, command);
 		insert_index += 1;
 	}
@@ -3850,7 +3769,7 @@ void Song::insert_call(const int selected_channel, const std::set<int32_t> &sele
 		command.note_type.volume = start_view.volume;
 		command.note_type.fade = start_view.fade;
 		command.labels = std::move(commands[insert_index].labels);
-		commands[insert_index].labels.clear();
+		commands.modify(insert_index).labels.clear();
 		commands.insert(commands.begin() + insert_index, command);
 		insert_index += 1;
 	}
@@ -3861,7 +3780,7 @@ void Song::insert_call(const int selected_channel, const std::set<int32_t> &sele
 			Command command = Command(Command_Type::TOGGLE_NOISE);
 			command.toggle_noise.drumkit = -1;
 			command.labels = std::move(commands[insert_index].labels);
-			commands[insert_index].labels.clear();
+			commands.modify(insert_index).labels.clear();
 			commands.insert(commands.begin() + insert_index, command);
 			insert_index += 1;
 		}
@@ -3870,7 +3789,7 @@ void Song::insert_call(const int selected_channel, const std::set<int32_t> &sele
 			Command command = Command(Command_Type::TOGGLE_NOISE);
 			command.toggle_noise.drumkit = start_view.drumkit;
 			command.labels = std::move(commands[insert_index].labels);
-			commands[insert_index].labels.clear();
+			commands.modify(insert_index).labels.clear();
 			commands.insert(commands.begin() + insert_index, command);
 			insert_index += 1;
 		}
@@ -3879,7 +3798,7 @@ void Song::insert_call(const int selected_channel, const std::set<int32_t> &sele
 	Command call = Command(Command_Type::SOUND_CALL);
 	call.target = target_label;
 	call.labels = std::move(commands[insert_index].labels);
-	commands[insert_index].labels.clear();
+	commands.modify(insert_index).labels.clear();
 	commands.insert(commands.begin() + insert_index, call);
 
 	{
@@ -3920,7 +3839,7 @@ void Song::insert_call(const int selected_channel, const std::set<int32_t> &sele
 	_modified = true;
 }
 
-std::string Song::commands_str(const std::vector<Command> &commands, int32_t channel_number) const {
+std::string Song::commands_str(const Command_List &commands, int32_t channel_number) const {
 	const auto to_local_label = [](const std::string &label, const std::string &scope) {
 		std::size_t dot = label.find_first_of(".");
 		return dot != std::string::npos && label.substr(0, dot) == scope ? &label[dot] : label.c_str();
@@ -4185,7 +4104,7 @@ const char *Song::get_action_message(Song_State::Action action) const {
 	}
 }
 
-std::vector<Command> &Song::channel_commands(const int selected_channel) {
+Command_List &Song::channel_commands(const int selected_channel) {
 	assert(selected_channel >= 1 && selected_channel <= 4);
 	if (selected_channel == 1) {
 		return _channel_1_commands;
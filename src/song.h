@@ -7,54 +7,45 @@
 
 #include "utils.h"
 #include "command.h"
+#include "command-list.h"
+#include "length-index.h"
 #include "parse-song.h"
 #include "option-dialogs.h"
 
-#define MAX_HISTORY_SIZE 256
+#define DEFAULT_UNDO_BUDGET (64 * 1024 * 1024)
+#define UNPACKED_HISTORY_SIZE 16
 
 template<typename T>
 inline int32_t itr_index(const typename std::vector<T> &vec, const typename std::vector<T>::const_iterator &itr) { return (int32_t)(itr - vec.begin()); }
+inline int32_t itr_index(const Command_List &commands, const Command_List::const_iterator &itr) { return (int32_t)(itr - commands.begin()); }
 
-std::string get_scope(const std::vector<Command> &commands, int32_t index);
+std::string get_scope(const Command_List &commands, int32_t index);
 
-std::string get_next_label(const std::vector<Command> &commands, const std::string &scope, const std::string &prefix, int &i);
-std::string get_next_loop_label(const std::vector<Command> &commands, const std::string &scope, int &i);
-std::string get_next_call_label(const std::vector<Command> &commands, const std::string &scope, int &i);
+std::string get_next_label(const Command_List &commands, const std::string &scope, const std::string &prefix, int &i);
+std::string get_next_loop_label(const Command_List &commands, const std::string &scope, int &i);
+std::string get_next_call_label(const Command_List &commands, const std::string &scope, int &i);
 
-int count_label_references(const std::vector<Command> &commands, const std::string &label);
-bool is_label_referenced(const std::vector<Command> &commands, const std::string &label);
-void delete_label(std::vector<Command> &commands, const std::string &label);
+int count_label_references(const Command_List &commands, Label label);
+int count_label_references(const std::vector<Command> &snippet, Label label);
+bool is_label_referenced(const Command_List &commands, Label label);
+void delete_label(Command_List &commands, Label label);
 
-std::vector<Command>::const_iterator find_note_with_label(const std::vector<Command> &commands, const std::string &label);
+Command_List::const_iterator find_note_with_label(const Command_List &commands, Label label);
 
-bool is_followed_by_n_ticks_of_rest(std::vector<Command>::const_iterator itr, std::vector<Command>::const_iterator end, int32_t n, int32_t speed);
-bool is_followed_by_n_ticks_of_rest_no_speed_change(std::vector<Command>::const_iterator itr, std::vector<Command>::const_iterator end, int32_t n, int32_t speed);
+bool is_followed_by_n_ticks_of_rest(Command_List::const_iterator itr, Command_List::const_iterator end, int32_t n, int32_t speed);
+bool is_followed_by_n_ticks_of_rest_no_speed_change(Command_List::const_iterator itr, Command_List::const_iterator end, int32_t n, int32_t speed);
 
-std::vector<Command> copy_snippet(const std::vector<Command> &commands, int32_t start_index, int32_t end_index, bool copy_jumps = false);
+std::vector<Command> copy_snippet(const Command_List &commands, int32_t start_index, int32_t end_index, bool copy_jumps = false);
 
-struct Extra_Info {
-	int32_t loop_index = 0;
-	int32_t speed_at_loop = 1;
-	int32_t volume_at_loop = 0;
-	int32_t fade_at_loop = 0;
-	int32_t drumkit_at_loop = -1;
+Parsed_Song::Result calc_channel_length(const Command_List &commands, int32_t &loop_tick, int32_t &end_tick, Extra_Info *info = nullptr);
 
-	int32_t end_index = 0;
-	int32_t speed_at_end = 1;
-	int32_t volume_at_end = 0;
-	int32_t fade_at_end = 0;
-	int32_t drumkit_at_end = -1;
-};
-
-Parsed_Song::Result calc_channel_length(const std::vector<Command> &commands, int32_t &loop_tick, int32_t &end_tick, Extra_Info *info = nullptr);
-
-int32_t calc_snippet_length(const std::vector<Command> &commands, const std::vector<Command>::const_iterator &start_itr, const std::vector<Command>::const_iterator &end_itr, const Note_View &start_view);
+int32_t calc_snippet_length(const Command_List &commands, const Command_List::const_iterator &start_itr, const Command_List::const_iterator &end_itr, const Note_View &start_view);
 
-Note_View get_note_view(const std::vector<Command> &commands, int32_t index, int32_t min_tick = 0);
+Note_View get_note_view(const Command_List &commands, int32_t index, int32_t min_tick = 0);
 
-void postprocess(std::vector<Command> &commands);
+void postprocess(Command_List &commands);
 
-void split_tempo_change_rests(std::vector<Command> &commands, const std::set<int32_t> &tempo_changes);
+void split_tempo_change_rests(Command_List &commands, const std::set<int32_t> &tempo_changes);
 
 class Song {
 public:
@@ -106,7 +97,12 @@ public:
 		};
 		int tick = -1;
 		int channel_number = 0;
-		std::vector<Command> commands;
+		// the edit as a splice of the channel's commands, replayable both ways
+		int32_t index = 0;
+		std::vector<Command> removed;
+		std::vector<Command> inserted;
+		// deeper states keep their splice packed until it is replayed
+		std::string packed;
 		std::set<int32_t> selection;
 		Action action = {};
 	};
@@ -117,10 +113,10 @@ private:
 	std::string _channel_2_label;
 	std::string _channel_3_label;
 	std::string _channel_4_label;
-	std::vector<Command> _channel_1_commands;
-	std::vector<Command> _channel_2_commands;
-	std::vector<Command> _channel_3_commands;
-	std::vector<Command> _channel_4_commands;
+	Command_List _channel_1_commands;
+	Command_List _channel_2_commands;
+	Command_List _channel_3_commands;
+	Command_List _channel_4_commands;
 	int32_t _channel_1_loop_tick = -1;
 	int32_t _channel_2_loop_tick = -1;
 	int32_t _channel_3_loop_tick = -1;
@@ -134,14 +130,33 @@ private:
 
 	std::vector<std::string> _mixed_labels;
 
+	Song_Sections _sections;
+	// the song's own lines as last saved, which _sections are worked out
+	// from on the next reload instead of parsing the file on every save
+	std::string _saved_song_text;
+
+	// the header label the song was chosen by, in a file holding several songs
+	std::string _song_label;
+
 	Parsed_Song::Result _result = Parsed_Song::Result::SONG_NULL;
 
 	bool _modified = false;
 	std::deque<Song_State> _history, _future;
+	size_t _undo_bytes = 0;
+	size_t _undo_budget = DEFAULT_UNDO_BUDGET;
+	// each channel as of its latest undo state, which edits are diffed against
+	Command_List _remembered_commands[4];
+	bool _edit_pending = false;
 	int64_t _mod_time = 0;
 	bool _loaded = false;
 
 	std::string _error_message;
+
+	void settle_channel(int channel_number, Song_State *ss);
+	void settle_history(void);
+	void compact_history(void);
+	bool read_song_cache(const char *cache_file, const char *f, const std::string &song_label, int64_t size, int64_t mod_time);
+	void write_song_cache(const char *cache_file, const char *f, const std::string &song_label, int64_t size, int64_t mod_time) const;
 public:
 	Song();
 	~Song();
@@ -161,21 +176,25 @@ public:
 	inline Song_State::Action redo_action(void) const { return _future.back().action; }
 	inline const char *undo_action_message(void) const { return get_action_message(_history.back().action); }
 	inline const char *redo_action_message(void) const { return get_action_message(_future.back().action); }
+	inline size_t undo_memory(void) const { return _undo_bytes; }
+	inline size_t undo_budget(void) const { return _undo_budget; }
+	void undo_budget(size_t budget);
 	inline bool loaded(void) const { return _loaded; }
 	void clear();
 	void remember(int channel_number, const std::set<int32_t> &selection, Song_State::Action action, int tick = -1);
 	void undo();
 	void redo();
-	Parsed_Song::Result read_song(const char *f);
+	Parsed_Song::Result read_song(const char *f, const char *cache_dir = nullptr, const std::string &song_label = "");
+	Parsed_Song::Result reload_song(const char *f, std::set<int32_t> &changed_channels);
 	void new_song(Song_Options_Dialog::Song_Options options);
 	Song_Options_Dialog::Song_Options get_options();
 	bool write_song(const char *f);
 	const char *error_message() const { return _error_message.c_str(); }
 
-	const std::vector<Command> &channel_1_commands() const { return _channel_1_commands; }
-	const std::vector<Command> &channel_2_commands() const { return _channel_2_commands; }
-	const std::vector<Command> &channel_3_commands() const { return _channel_3_commands; }
-	const std::vector<Command> &channel_4_commands() const { return _channel_4_commands; }
+	const Command_List &channel_1_commands() const { return _channel_1_commands; }
+	const Command_List &channel_2_commands() const { return _channel_2_commands; }
+	const Command_List &channel_3_commands() const { return _channel_3_commands; }
+	const Command_List &channel_4_commands() const { return _channel_4_commands; }
 	int32_t channel_1_loop_tick(void) const { return _channel_1_loop_tick; }
 	int32_t channel_2_loop_tick(void) const { return _channel_2_loop_tick; }
 	int32_t channel_3_loop_tick(void) const { return _channel_3_loop_tick; }
@@ -235,9 +254,9 @@ public:
 	void delete_call(const int selected_channel, const std::set<int32_t> &selected_boxes, int32_t tick, int32_t call_index, int32_t ambiguous_ticks, int32_t unambiguous_ticks, Note_View start_view, Note_View end_view, int32_t start_index, int32_t end_index);
 	void unpack_call(const int selected_channel, const std::set<int32_t> &selected_boxes, int32_t tick, int32_t call_index, const std::vector<Command> &snippet, int32_t start_index, int32_t end_index);
 	void create_call(const int selected_channel, const std::set<int32_t> &selected_boxes, int32_t tick, int32_t start_index, int32_t end_index, const std::vector<Command> &snippet, const std::vector<std::string> &call_labels);
-	void insert_call(const int selected_channel, const std::set<int32_t> &selected_boxes, int32_t tick, int32_t tick_offset, int32_t insert_index, const std::string &target_label, int32_t call_length, Note_View insert_view, Note_View start_view, Note_View end_view);
+	void insert_call(const int selected_channel, const std::set<int32_t> &selected_boxes, int32_t tick, int32_t tick_offset, int32_t insert_index, Label target_label, int32_t call_length, Note_View insert_view, Note_View start_view, Note_View end_view);
 
-	std::vector<Command> &channel_commands(const int selected_channel);
+	Command_List &channel_commands(const int selected_channel);
 	const std::string &channel_label(const int selected_channel) const;
 	int32_t channel_loop_tick(const int selected_channel) const;
 	int32_t channel_end_tick(const int selected_channel) const;
@@ -245,7 +264,7 @@ public:
 	int32_t max_wave_id() const;
 	int32_t max_drumkit_id() const;
 private:
-	std::string commands_str(const std::vector<Command> &commands, int32_t channel_number) const;
+	std::string commands_str(const Command_List &commands, int32_t channel_number) const;
 	const char *get_action_message(Song_State::Action action) const;
 };
 
@@ -0,0 +1,331 @@
+#include <algorithm>
+#include <cassert>
+
+#include "utils.h"
+#include "command-list.h"
+#include "tick-index.h"
+
+// commands played between checkpoints when there are no jumps, loops or calls
+static constexpr uint32_t CHECKPOINT_INTERVAL = 256;
+
+void Tick_Index::clear() {
+	_notes.clear();
+	_end_ticks.clear();
+	_plays.clear();
+	_events.clear();
+	_first_pass = NOT_ENDED;
+	_checkpoints.clear();
+	_state = State();
+	_visited_labels_not_during_call.clear();
+	_visited_label_log.clear();
+	_finished = false;
+	_horizon = 0;
+	_edited = NOT_EDITED;
+}
+
+void Tick_Index::rewind() {
+	if (_edited == NOT_EDITED) { return; }
+	size_t edited = _edited;
+	_edited = NOT_EDITED;
+	if (_state.reach < (int64_t)edited) { return; }
+
+	// the first checkpoint never read anything, so one is always left
+	auto checkpoint_itr = std::partition_point(RANGE(_checkpoints), [edited](const State &state) {
+		return state.reach < (int64_t)edited;
+	});
+	assert(checkpoint_itr != _checkpoints.begin());
+	_state = *(checkpoint_itr - 1);
+	_checkpoints.erase(checkpoint_itr, _checkpoints.end());
+	// replay only as far as the queries after the edit ask for, instead of
+	// as far as any query has ever asked
+	_horizon = 0;
+	for (; _visited_label_log.size() > _state.visited_labels_logged; _visited_label_log.pop_back()) {
+		_visited_labels_not_during_call.erase(_visited_label_log.back());
+	}
+
+	for (size_t i = _notes.size(); i-- > _state.played; ) {
+		_plays[_notes[i].index].pop_back();
+	}
+	_notes.resize(_state.played);
+	_end_ticks.resize(_state.played);
+	// every note left was played before reaching the edit
+	_plays.resize(std::min(_plays.size(), edited));
+	_events.resize(_state.events);
+	if (!_state.restarted) {
+		_first_pass = NOT_ENDED;
+	}
+	_finished = false;
+}
+
+void Tick_Index::play(const Command_List &commands) {
+	State &state = _state;
+	Note_View &note = state.note;
+	auto command_itr = commands.begin() + state.index;
+
+	const auto jump = [&](Label target) {
+		command_itr = commands.find_label(target);
+		state.index = (int32_t)(command_itr - commands.begin());
+		state.reach = std::max(state.reach, state.index);
+	};
+
+	const auto add_event = [&]() {
+		_events.push_back({ state.tick, state.index, note.speed, state.drumkit, state.loop_stack.size() > 0, state.call_stack.size() > 0 });
+		state.events += 1;
+	};
+
+	const auto play_note = [&](int32_t length) {
+		note.length = length;
+		state.tick += note.length * note.speed;
+		note.index = state.index;
+		if (_plays.size() <= (size_t)state.index) {
+			_plays.resize(state.index + 1);
+		}
+		_plays[state.index].push_back(state.played++);
+		_notes.push_back(note);
+		_end_ticks.push_back(state.tick);
+		add_event();
+	};
+
+	const auto end_first_pass = [&]() {
+		if (!state.restarted) {
+			state.restarted = true;
+			_first_pass = _events.size();
+		}
+	};
+
+	const auto may_jump = [&]() {
+		if (
+			!_visited_labels_not_during_call.count(command_itr->target) ||
+			(state.call_stack.size() > 0 && !state.visited_labels_during_call.count(command_itr->target))
+		) {
+			return true;
+		}
+		end_first_pass();
+		return state.tick <= _horizon;
+	};
+
+	while (command_itr != commands.end()) {
+		if (
+			_checkpoints.empty() ||
+			(state.steps != _checkpoints.back().steps &&
+			(is_control_command(command_itr->type) || state.steps - _checkpoints.back().steps >= CHECKPOINT_INTERVAL))
+		) {
+			state.visited_labels_logged = (uint32_t)_visited_label_log.size();
+			_checkpoints.push_back(state);
+		}
+		state.reach = std::max(state.reach, state.index);
+		state.steps += 1;
+
+		for (Label label : command_itr->labels) {
+			if (state.call_stack.size() > 0) {
+				state.visited_labels_during_call.insert(label);
+			}
+			else if (_visited_labels_not_during_call.insert(label).second) {
+				_visited_label_log.push_back(label);
+			}
+		}
+
+		if (command_itr->type == Command_Type::NOTE) {
+			note.pitch = command_itr->note.pitch;
+			play_note(command_itr->note.length);
+
+			note.slide_duration = 0;
+			note.slide_octave = 0;
+			note.slide_pitch = Pitch::REST;
+		}
+		else if (command_itr->type == Command_Type::DRUM_NOTE) {
+			note.pitch = (Pitch)command_itr->drum_note.instrument;
+			play_note(command_itr->drum_note.length);
+		}
+		else if (command_itr->type == Command_Type::REST) {
+			note.pitch = Pitch::REST;
+			play_note(command_itr->rest.length);
+
+			note.slide_duration = 0;
+			note.slide_octave = 0;
+			note.slide_pitch = Pitch::REST;
+		}
+		else if (command_itr->type == Command_Type::OCTAVE) {
+			note.octave = command_itr->octave.octave;
+		}
+		else if (command_itr->type == Command_Type::NOTE_TYPE) {
+			note.speed = command_itr->note_type.speed;
+			note.volume = command_itr->note_type.volume;
+			note.fade = command_itr->note_type.fade;
+		}
+		else if (command_itr->type == Command_Type::DRUM_SPEED) {
+			note.speed = command_itr->drum_speed.speed;
+		}
+		else if (command_itr->type == Command_Type::TRANSPOSE) {
+			note.transpose_octaves = command_itr->transpose.num_octaves;
+			note.transpose_pitches = command_itr->transpose.num_pitches;
+		}
+		else if (command_itr->type == Command_Type::TEMPO) {
+			note.tempo = command_itr->tempo.tempo;
+		}
+		else if (command_itr->type == Command_Type::DUTY_CYCLE) {
+			note.duty = command_itr->duty_cycle.duty;
+		}
+		else if (command_itr->type == Command_Type::VOLUME_ENVELOPE) {
+			note.volume = command_itr->volume_envelope.volume;
+			note.fade = command_itr->volume_envelope.fade;
+		}
+		else if (command_itr->type == Command_Type::PITCH_SLIDE) {
+			note.slide_duration = command_itr->pitch_slide.duration;
+			note.slide_octave = command_itr->pitch_slide.octave;
+			note.slide_pitch = command_itr->pitch_slide.pitch;
+		}
+		else if (command_itr->type == Command_Type::VIBRATO) {
+			note.vibrato_delay = command_itr->vibrato.delay;
+			note.vibrato_extent = command_itr->vibrato.extent;
+			note.vibrato_rate = command_itr->vibrato.rate;
+		}
+		else if (command_itr->type == Command_Type::TOGGLE_NOISE) {
+			note.drumkit = command_itr->toggle_noise.drumkit;
+			state.drumkit = command_itr->toggle_noise.drumkit;
+		}
+		else if (command_itr->type == Command_Type::FORCE_STEREO_PANNING) {
+			note.panning_left = command_itr->force_stereo_panning.left;
+			note.panning_right = command_itr->force_stereo_panning.right;
+		}
+		else if (command_itr->type == Command_Type::STEREO_PANNING) {
+			note.panning_left = command_itr->stereo_panning.left;
+			note.panning_right = command_itr->stereo_panning.right;
+		}
+		else if (command_itr->type == Command_Type::SOUND_JUMP) {
+			if (may_jump()) {
+				jump(command_itr->target);
+				continue;
+			}
+			_finished = true;
+			return; // song is finished
+		}
+		else if (command_itr->type == Command_Type::SOUND_LOOP) {
+			if (state.loop_stack.size() > 0 && state.loop_stack.back().first == state.index) {
+				state.loop_stack.back().second -= 1;
+				if (state.loop_stack.back().second == 0) {
+					state.loop_stack.pop_back();
+					add_event();
+				}
+				else {
+					jump(command_itr->target);
+					continue;
+				}
+			}
+			else {
+				if (command_itr->sound_loop.loop_count == 0) {
+					if (may_jump()) {
+						jump(command_itr->target);
+						continue;
+					}
+					_finished = true;
+					return; // song is finished
+				}
+				else if (command_itr->sound_loop.loop_count > 1) {
+					// nested loops not allowed
+					assert(state.loop_stack.size() == 0);
+
+					state.loop_stack.emplace_back(state.index, command_itr->sound_loop.loop_count - 1);
+					jump(command_itr->target);
+					continue;
+				}
+			}
+		}
+		else if (command_itr->type == Command_Type::SOUND_CALL) {
+			// nested calls not allowed
+			assert(state.call_stack.size() == 0);
+
+			state.call_stack.push_back(state.index);
+			jump(command_itr->target);
+			continue;
+		}
+		else if (command_itr->type == Command_Type::SOUND_RET) {
+			if (state.call_stack.size() == 0) {
+				end_first_pass();
+				_finished = true;
+				return; // song is finished
+			}
+			else {
+				state.index = state.call_stack.back();
+				command_itr = commands.begin() + state.index;
+				state.call_stack.pop_back();
+				state.visited_labels_during_call.clear();
+				add_event();
+			}
+		}
+		else if (command_itr->type == Command_Type::LOAD_WAVE) {
+			if (note.wave >= 0x0f) {
+				note.wave = command_itr->load_wave.wave;
+			}
+		}
+		else if (command_itr->type == Command_Type::INC_OCTAVE) {
+			note.octave += 1;
+			if (note.octave > 8) {
+				note.octave = 1;
+			}
+		}
+		else if (command_itr->type == Command_Type::DEC_OCTAVE) {
+			note.octave -= 1;
+			if (note.octave < 1) {
+				note.octave = 8;
+			}
+		}
+		else if (command_itr->type == Command_Type::SPEED) {
+			note.speed = command_itr->speed.speed;
+		}
+		else if (command_itr->type == Command_Type::CHANNEL_VOLUME) {
+			note.volume = command_itr->channel_volume.volume;
+		}
+		else if (command_itr->type == Command_Type::FADE_WAVE) {
+			note.fade = command_itr->fade_wave.fade;
+		}
+		++command_itr;
+		++state.index;
+	}
+
+	// running off the end depends on nothing being added after it
+	state.reach = std::max(state.reach, (int32_t)commands.size());
+	end_first_pass();
+	_finished = true;
+}
+
+void Tick_Index::update(const Command_List &commands, int32_t horizon) {
+	rewind();
+	if (horizon > _horizon) {
+		_horizon = horizon;
+		// a song that finished on a jump back replays that jump, which now loops
+		_finished = false;
+	}
+	if (!_finished) {
+		play(commands);
+	}
+}
+
+bool Tick_Index::find_note_view(const Command_List &commands, int32_t index, int32_t min_tick, Note_View &view) {
+	update(commands, min_tick);
+	if (index >= 0 && (size_t)index < _plays.size()) {
+		const std::vector<uint32_t> &plays = _plays[index];
+		auto play_itr = std::lower_bound(RANGE(plays), min_tick, [this](uint32_t play, int32_t tick) {
+			return _end_ticks[play] < tick;
+		});
+		if (play_itr != plays.end()) {
+			view = _notes[*play_itr];
+			return true;
+		}
+	}
+	return false;
+}
+
+const Note_View *Tick_Index::find_note_at_tick(const Command_List &commands, int32_t tick, int32_t *tick_offset) {
+	update(commands, tick);
+	size_t i = std::upper_bound(RANGE(_end_ticks), tick) - _end_ticks.begin();
+	if (i == _notes.size()) { return nullptr; }
+	if (tick_offset) { *tick_offset = tick - (i > 0 ? _end_ticks[i - 1] : 0); }
+	return &_notes[i];
+}
+
+Tick_Index::Events Tick_Index::first_pass(const Command_List &commands) {
+	update(commands, 0);
+	assert(_first_pass != NOT_ENDED);
+	return { _events.data(), _events.data() + _first_pass };
+}
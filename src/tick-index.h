@@ -0,0 +1,100 @@
+#ifndef TICK_INDEX_H
+#define TICK_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "command.h"
+
+class Command_List;
+
+// a channel's notes and rests in the order they play, so that the view at
+// a command or the note at a tick is found by binary search instead of by
+// playing the channel from its start
+//
+// the player's state is saved at every jump, loop, call and return, and
+// every so often in between; an edit only discards what was played after
+// the last checkpoint that had not read the edited commands yet, and the
+// next query resumes playing from there
+//
+// it also keeps the channel flattened into events, one for each note or
+// rest, loop end and return, so that other passes over the channel read
+// them instead of playing its loops and calls again
+class Tick_Index {
+public:
+	struct Event {
+		// the tick it ends on, and its command; a return is at its call
+		int32_t tick = 0;
+		int32_t index = 0;
+		int32_t speed = 1;
+		// -1 until noise is toggled on
+		int32_t drumkit = -1;
+		bool in_loop = false;
+		bool in_call = false;
+	};
+	struct Events {
+		const Event *first = nullptr;
+		const Event *last = nullptr;
+		inline const Event *begin(void) const { return first; }
+		inline const Event *end(void) const { return last; }
+	};
+private:
+	struct State {
+		Note_View note;
+		int32_t tick = 0;
+		int32_t index = 0;
+		int32_t drumkit = -1;
+		std::vector<std::pair<int32_t, int32_t>> loop_stack;
+		std::vector<int32_t> call_stack;
+		std::set<Label> visited_labels_during_call;
+		// how many commands and notes were played before this state, and
+		// how many labels had been logged
+		uint32_t steps = 0;
+		uint32_t played = 0;
+		uint32_t events = 0;
+		uint32_t visited_labels_logged = 0;
+		// the furthest command that was read before this state
+		int32_t reach = -1;
+		// whether the song had already ended and started over
+		bool restarted = false;
+		State() { note.octave = 8; note.speed = 1; }
+	};
+	std::vector<Note_View> _notes;
+	// the tick each note or rest ends on
+	std::vector<int32_t> _end_ticks;
+	// where in _notes each command was played
+	std::vector<std::vector<uint32_t>> _plays;
+	std::vector<Event> _events;
+	// how many events were played before the song first ended
+	static constexpr size_t NOT_ENDED = SIZE_MAX;
+	size_t _first_pass = NOT_ENDED;
+	std::vector<State> _checkpoints;
+	State _state;
+	// labels are only ever added to this, so instead of being saved with
+	// each checkpoint, they are logged and rewound to its count
+	std::set<Label> _visited_labels_not_during_call;
+	std::vector<Label> _visited_label_log;
+	bool _finished = false;
+	// the song is played past its end until this tick, the way
+	// get_note_view keeps looping until it reaches min_tick; an edit
+	// resets it, so it only grows with the queries since the last one
+	int32_t _horizon = 0;
+	// the first command that may have changed since it was played
+	static constexpr size_t NOT_EDITED = SIZE_MAX;
+	size_t _edited = NOT_EDITED;
+
+	void rewind(void);
+	void play(const Command_List &commands);
+	void update(const Command_List &commands, int32_t horizon);
+public:
+	void clear(void);
+	inline void invalidate(size_t index) { if (index < _edited) { _edited = index; } }
+	bool find_note_view(const Command_List &commands, int32_t index, int32_t min_tick, Note_View &view);
+	const Note_View *find_note_at_tick(const Command_List &commands, int32_t tick, int32_t *tick_offset);
+	Events first_pass(const Command_List &commands);
+};
+
+#endif
@@ -6,6 +6,8 @@
 #include <cctype>
 #include <cwctype>
 #include <algorithm>
+#include <tuple>
+#include <vector>
 #include <sys/stat.h>
 
 #pragma warning(push, 0)
@@ -64,17 +66,33 @@ void rtrim(std::string &s, const std::string &t) {
 	s.erase(p + 1);
 }
 
-bool leading_macro(std::istringstream &iss, std::string &macro, const char *v) {
-	int first = iss.peek();
-	bool indented = first == ' ' || first == '\t';
-	if (indented) { iss >> std::ws >> macro >> std::ws; }
+void trim(std::string_view &s, std::string_view t) {
+	size_t p = s.find_first_not_of(t);
+	s.remove_prefix(p == std::string_view::npos ? s.size() : p);
+	rtrim(s, t);
+}
+
+void rtrim(std::string_view &s, std::string_view t) {
+	size_t p = s.find_last_not_of(t);
+	s.remove_suffix(s.size() - (p + 1));
+}
+
+bool leading_macro(std::string_view &s, std::string_view &macro, const char *v) {
+	bool indented = is_indented(s);
+	if (indented) {
+		trim(s);
+		size_t p = s.find_first_of(whitespace);
+		macro = s.substr(0, p);
+		s.remove_prefix(macro.size());
+		trim(s);
+	}
 	return indented && (!v || macro == v);
 }
 
-void remove_comment(std::string &s) {
+void remove_comment(std::string_view &s) {
 	size_t p = s.find(';');
-	if (p != std::string::npos) {
-		s.erase(p);
+	if (p != std::string_view::npos) {
+		s.remove_suffix(s.size() - p);
 	}
 }
 
@@ -103,6 +121,13 @@ int64_t file_modified(const char *f) {
 	return r ? 0 : s.st_mtime;
 }
 
+int64_t file_size(const char *f) {
+	if (!f) { return 0; }
+	struct stat s;
+	int r = fl_stat(f, &s);
+	return r ? 0 : s.st_size;
+}
+
 void open_ifstream(std::ifstream &ifs, const char *f) {
 #ifdef _WIN32
 	wchar_t wf[FL_PATH_MAX] = {};
@@ -123,36 +148,75 @@ void open_ofstream(std::ofstream &ofs, const char *f) {
 #endif
 }
 
-bool parse_value(std::string s, int32_t &v) {
+// deletes the least recently written files with the extension until the rest fit
+void evict_oldest_files(const char *dir, const char *ext, int64_t max_size) {
+	dirent **list = NULL;
+	int n = fl_filename_list(dir, &list);
+	if (n < 0) { return; }
+	std::vector<std::tuple<int64_t, int64_t, std::string>> files;
+	int64_t total = 0;
+	for (int i = 0; i < n; ++i) {
+		const char *name = list[i]->d_name;
+		// subdirectories end in '/', so they never match
+		if (strcmp(fl_filename_ext(name), ext)) { continue; }
+		std::string path = std::string(dir) + name;
+		struct stat s;
+		if (fl_stat(path.c_str(), &s)) { continue; }
+		files.emplace_back(s.st_mtime, s.st_size, path);
+		total += s.st_size;
+	}
+	fl_filename_free_list(&list, n);
+	if (total <= max_size) { return; }
+	std::sort(RANGE(files));
+	for (const auto &[modified, size, path] : files) {
+		if (total <= max_size) { break; }
+		if (!fl_unlink(path.c_str())) {
+			total -= size;
+		}
+	}
+}
+
+static bool parse_digits(std::string_view s, const std::string &digits, int base, int32_t &v) {
+	if (s.empty() || s.find_first_not_of(digits) != std::string_view::npos) return false;
+	// saturate like strtol
+	long n = 0;
+	for (char c : s) {
+		long d = c <= '9' ? c - '0' : tolower(c) - 'a' + 10;
+		if (n > (std::numeric_limits<long>::max() - d) / base) {
+			n = std::numeric_limits<long>::max();
+			break;
+		}
+		n = n * base + d;
+	}
+	v = (int32_t)n;
+	return true;
+}
+
+bool parse_value(std::string_view s, int32_t &v) {
 	trim(s);
 	if (!s.empty()) {
 		int32_t scale = 1;
 		if (s[0] == '-') {
-			s.erase(0, 1);
+			s.remove_prefix(1);
 			trim(s);
 			if (s.empty()) return false;
 			scale = -1;
 		}
+		bool ok;
 		if (s[0] == '$') {
-			s.erase(0, 1);
-			if (s.empty() || !is_hex(s)) return false;
-			v = (int32_t)strtol(s.c_str(), NULL, 16) * scale;
+			ok = parse_digits(s.substr(1), hex, 16, v);
 		}
 		else if (s[0] == '&') {
-			s.erase(0, 1);
-			if (s.empty() || !is_octal(s)) return false;
-			v = (int32_t)strtol(s.c_str(), NULL, 8) * scale;
+			ok = parse_digits(s.substr(1), octal, 8, v);
 		}
 		else if (s[0] == '%') {
-			s.erase(0, 1);
-			if (s.empty() || !is_binary(s)) return false;
-			v = (int32_t)strtol(s.c_str(), NULL, 2) * scale;
+			ok = parse_digits(s.substr(1), binary, 2, v);
 		}
 		else {
-			if (!is_decimal(s)) return false;
-			v = (int32_t)strtol(s.c_str(), NULL, 10) * scale;
+			ok = parse_digits(s, decimal, 10, v);
 		}
-		return true;
+		if (ok) v *= scale;
+		return ok;
 	}
 	return false;
 }
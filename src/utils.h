@@ -99,16 +99,20 @@ bool is_octal(std::string_view s);
 bool is_binary(std::string_view s);
 void trim(std::string &s, const std::string &t = whitespace);
 void rtrim(std::string &s, const std::string &t = whitespace);
-bool leading_macro(std::istringstream &iss, std::string &macro, const char *v = NULL);
-void remove_comment(std::string &s);
+void trim(std::string_view &s, std::string_view t = whitespace);
+void rtrim(std::string_view &s, std::string_view t = whitespace);
+bool leading_macro(std::string_view &s, std::string_view &macro, const char *v = NULL);
+void remove_comment(std::string_view &s);
 void add_dot_ext(const char *f, const char *ext, char *s);
 int text_width(const char *l, int pad = 0);
 bool file_exists(const char *f);
 int64_t file_modified(const char *f);
+int64_t file_size(const char *f);
 void open_ifstream(std::ifstream &ifs, const char *f);
 void open_ofstream(std::ofstream &ofs, const char *f);
+void evict_oldest_files(const char *dir, const char *ext, int64_t max_size);
 
-bool parse_value(std::string s, int32_t &v);
+bool parse_value(std::string_view s, int32_t &v);
 bool is_label_valid(const std::string &label);
 
 #endif
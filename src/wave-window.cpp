@@ -227,15 +227,17 @@ void Wave_Window::refresh() {
 }
 
 void Wave_Window::start_audio_thread() {
-	_audio_kill_signal = std::promise<void>();
-	std::future<void> kill_future = _audio_kill_signal.get_future();
-	_audio_thread = std::thread(&playback_thread, this, std::move(kill_future));
+	_audio_signal.reset();
+	if (_mod) {
+		_mod->render_signal(&_audio_signal);
+	}
+	_audio_thread = std::thread(&playback_thread, this);
 }
 
 void Wave_Window::stop_audio_thread() {
 	if (_audio_thread.joinable()) {
 		_audio_mutex.lock();
-		_audio_kill_signal.set_value();
+		_audio_signal.stop();
 		_audio_thread.join();
 		_audio_mutex.unlock();
 	}
@@ -635,13 +637,13 @@ void Wave_Window::invert_cb(Fl_Widget *, Wave_Window *ww) {
 	ww->regenerate_mod();
 }
 
-void Wave_Window::playback_thread(Wave_Window *ww, std::future<void> kill_signal) {
+void Wave_Window::playback_thread(Wave_Window *ww) {
 	Pitch pitch = Pitch::REST;
 	int32_t octave = 0;
 	int instrument = 0;
 
 	int error_count = 0;
-	while (kill_signal.wait_for(std::chrono::milliseconds(8)) == std::future_status::timeout) {
+	while (ww->_audio_signal.wait(Playback_Module::fill_interval())) {
 		if (ww->_audio_mutex.try_lock()) {
 			IT_Module *mod = ww->_mod;
 			if (mod && mod->playing()) {
@@ -1,7 +1,8 @@
 #ifndef WAVE_WINDOW_H
 #define WAVE_WINDOW_H
 
-#include <future>
+#include <mutex>
+#include <thread>
 
 #pragma warning(push, 0)
 #include <FL/Fl_Double_Window.H>
@@ -69,7 +70,7 @@ private:
 	int32_t _mod_channel = -1;
 	std::thread _audio_thread;
 	std::mutex _audio_mutex;
-	std::promise<void> _audio_kill_signal;
+	Render_Signal _audio_signal;
 public:
 	Wave_Window(int x, int y);
 	~Wave_Window();
@@ -111,7 +112,7 @@ private:
 	static void flip_cb(Fl_Widget *w, Wave_Window *ww);
 	static void invert_cb(Fl_Widget *w, Wave_Window *ww);
 
-	static void playback_thread(Wave_Window *ww, std::future<void> kill_signal);
+	static void playback_thread(Wave_Window *ww);
 };
 
 #endif
@@ -0,0 +1,746 @@
+#ifndef POSTPROCESS_REFERENCE_H
+#define POSTPROCESS_REFERENCE_H
+
+#include <cassert>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "utils.h"
+#include "command.h"
+
+// postprocess as it was before it became linear: a fixpoint loop that
+// erases each redundant command as soon as it finds it. kept verbatim,
+// on a plain vector, for the equivalence test and the benchmark to
+// compare against
+
+struct Reference_Indexes {
+	int32_t rest_index = -1;
+	int32_t octave_index = -1;
+	int32_t speed_index = -1;
+	int32_t transpose_index = -1;
+	int32_t tempo_index = -1;
+	int32_t duty_index = -1;
+	int32_t vol_env_index = -1;
+	int32_t slide_index = -1;
+	int32_t vibrato_index = -1;
+	int32_t toggle_noise_off_index = -1;
+	int32_t toggle_noise_on_index = -1;
+	int32_t toggle_noise_off_again_index = -1;
+	int32_t panning_index = -1;
+};
+
+inline void reference_shift_indexes(Reference_Indexes &indexes, int32_t index) {
+	if (indexes.rest_index > index) {
+		indexes.rest_index -= 1;
+	}
+	if (indexes.octave_index > index) {
+		indexes.octave_index -= 1;
+	}
+	if (indexes.speed_index > index) {
+		indexes.speed_index -= 1;
+	}
+	if (indexes.transpose_index > index) {
+		indexes.transpose_index -= 1;
+	}
+	if (indexes.tempo_index > index) {
+		indexes.tempo_index -= 1;
+	}
+	if (indexes.duty_index > index) {
+		indexes.duty_index -= 1;
+	}
+	if (indexes.vol_env_index > index) {
+		indexes.vol_env_index -= 1;
+	}
+	if (indexes.slide_index > index) {
+		indexes.slide_index -= 1;
+	}
+	if (indexes.vibrato_index > index) {
+		indexes.vibrato_index -= 1;
+	}
+	if (indexes.toggle_noise_off_index > index) {
+		indexes.toggle_noise_off_index -= 1;
+	}
+	if (indexes.toggle_noise_on_index > index) {
+		indexes.toggle_noise_on_index -= 1;
+	}
+	if (indexes.toggle_noise_off_again_index > index) {
+		indexes.toggle_noise_off_again_index -= 1;
+	}
+	if (indexes.panning_index > index) {
+		indexes.panning_index -= 1;
+	}
+}
+
+inline void reference_postprocess(std::vector<Command> &commands) {
+	for (Command &command : commands) {
+		if (command.type == Command_Type::NOTE_TYPE && command.note_type.wave > 15) {
+			command.note_type.wave = 15;
+		}
+		else if (command.type == Command_Type::VOLUME_ENVELOPE && command.volume_envelope.wave > 15) {
+			command.volume_envelope.wave = 15;
+		}
+		else if (command.type == Command_Type::FADE_WAVE && command.fade_wave.wave > 15) {
+			command.fade_wave.wave = 15;
+		}
+	}
+
+	bool deleted = false;
+	do {
+		Note_View view;
+		int32_t panning_left = -1;
+		int32_t panning_right = -1;
+		Reference_Indexes indexes;
+		deleted = false;
+		for (uint32_t i = 0; i < commands.size(); ++i) {
+			if ((is_control_command(commands[i].type) || commands[i].type == Command_Type::REST) && indexes.slide_index != -1) {
+				// automatically delete trailing pitch slide commands
+				deleted = true;
+				commands[indexes.slide_index + 1].labels.insert(commands[indexes.slide_index + 1].labels.begin(), RANGE(commands[indexes.slide_index].labels));
+				commands.erase(commands.begin() + indexes.slide_index);
+				i -= 1;
+				reference_shift_indexes(indexes, indexes.slide_index);
+
+				view.slide_duration = 0;
+				view.slide_octave = 0;
+				view.slide_pitch = Pitch::REST;
+				indexes.slide_index = -1;
+			}
+			if (
+				commands[i].labels.size() > 0 ||
+				is_control_command(commands[i].type)
+			) {
+				// on hard boundary, forget everything
+				view = Note_View{};
+				view.volume = -1;
+				view.fade = -1;
+				view.drumkit = -1;
+				view.transpose_octaves = -1;
+				view.transpose_pitches = -1;
+				view.duty = -1;
+				view.vibrato_delay = -1;
+				view.vibrato_extent = -1;
+				view.vibrato_rate = -1;
+				panning_left = -1;
+				panning_right = -1;
+				indexes.rest_index = -1;
+				indexes.octave_index = -1;
+				indexes.speed_index = -1;
+				indexes.transpose_index = -1;
+				indexes.tempo_index = -1;
+				indexes.duty_index = -1;
+				indexes.vol_env_index = -1;
+				indexes.slide_index = -1;
+				indexes.vibrato_index = -1;
+				indexes.toggle_noise_off_index = -1;
+				indexes.toggle_noise_on_index = -1;
+				indexes.toggle_noise_off_again_index = -1;
+				indexes.panning_index = -1;
+			}
+			if (
+				is_global_command(commands[i].type) ||
+				is_speed_command(commands[i].type)
+			) {
+				// on tempo or speed change, don't tamper with previous rest
+				indexes.rest_index = -1;
+			}
+			if (commands[i].type == Command_Type::NOTE_TYPE) {
+				// on note type change, don't tamper with previous envelope
+				indexes.vol_env_index = -1;
+			}
+			if (commands[i].type == Command_Type::REST) {
+				// on rest, don't tamper with previous speed or tempo
+				indexes.speed_index = -1;
+				indexes.tempo_index = -1;
+			}
+			if (is_note_command(commands[i].type)) {
+				// on note, don't tamper with any previous commands
+				view.slide_duration = 0;
+				view.slide_octave = 0;
+				view.slide_pitch = Pitch::REST;
+				indexes.rest_index = -1;
+				indexes.octave_index = -1;
+				indexes.speed_index = -1;
+				indexes.transpose_index = -1;
+				indexes.tempo_index = -1;
+				indexes.duty_index = -1;
+				indexes.vol_env_index = -1;
+				indexes.slide_index = -1;
+				indexes.vibrato_index = -1;
+				indexes.toggle_noise_off_index = -1;
+				indexes.toggle_noise_on_index = -1;
+				indexes.toggle_noise_off_again_index = -1;
+				indexes.panning_index = -1;
+			}
+
+			if (commands[i].type == Command_Type::REST) {
+				if (indexes.rest_index == -1) {
+					// track this rest to possibly add to later, if it is not maxed out
+					if (commands[i].rest.length < 16) {
+						indexes.rest_index = i;
+					}
+				}
+				else {
+					// if the previous rest and current rest can't fit into one rest command...
+					if (commands[indexes.rest_index].rest.length + commands[i].rest.length > 16) {
+						// then max out the previous rest, put the remainder into the current rest, and start tracking the current rest
+						commands[i].rest.length = commands[indexes.rest_index].rest.length + commands[i].rest.length - 16;
+						commands[indexes.rest_index].rest.length = 16;
+						indexes.rest_index = i;
+					}
+					// otherwise, combine into the previous rest and delete the current rest
+					else {
+						deleted = true;
+						commands[indexes.rest_index].rest.length = commands[indexes.rest_index].rest.length + commands[i].rest.length;
+						assert(commands[i].labels.size() == 0);
+						commands.erase(commands.begin() + i);
+						i -= 1;
+
+						// stop tracking the previous rest if it is now maxed out
+						if (commands[indexes.rest_index].rest.length == 16) {
+							indexes.rest_index = -1;
+						}
+					}
+				}
+			}
+
+			else if (commands[i].type == Command_Type::OCTAVE) {
+				if (indexes.octave_index == -1) {
+					// if the octave isn't changing, delete it
+					if (view.octave == commands[i].octave.octave) {
+						deleted = true;
+						assert(commands[i].labels.size() == 0);
+						commands.erase(commands.begin() + i);
+						i -= 1;
+					}
+					// otherwise, track it
+					else {
+						view.octave = commands[i].octave.octave;
+						indexes.octave_index = i;
+					}
+				}
+				else {
+					// octave changed twice in a row, so delete the old one
+					deleted = true;
+					commands[indexes.octave_index + 1].labels.insert(commands[indexes.octave_index + 1].labels.begin(), RANGE(commands[indexes.octave_index].labels));
+					commands.erase(commands.begin() + indexes.octave_index);
+					i -= 1;
+					reference_shift_indexes(indexes, indexes.octave_index);
+
+					view.octave = commands[i].octave.octave;
+					indexes.octave_index = i;
+				}
+			}
+			else if (commands[i].type == Command_Type::INC_OCTAVE || commands[i].type == Command_Type::DEC_OCTAVE) {
+				view.octave = 0;
+				indexes.octave_index = -1;
+			}
+
+			else if (commands[i].type == Command_Type::NOTE_TYPE) {
+				if (indexes.speed_index == -1) {
+					// if the note type isn't changing, delete it
+					if (
+						view.speed == commands[i].note_type.speed &&
+						view.volume == commands[i].note_type.volume &&
+						view.fade == commands[i].note_type.fade
+					) {
+						deleted = true;
+						assert(commands[i].labels.size() == 0);
+						commands.erase(commands.begin() + i);
+						i -= 1;
+					}
+					// otherwise, track it
+					else {
+						view.speed = commands[i].note_type.speed;
+						view.volume = commands[i].note_type.volume;
+						view.fade = commands[i].note_type.fade;
+						indexes.speed_index = i;
+					}
+				}
+				else {
+					// note type changed twice in a row, so delete the old one
+					deleted = true;
+					commands[indexes.speed_index + 1].labels.insert(commands[indexes.speed_index + 1].labels.begin(), RANGE(commands[indexes.speed_index].labels));
+					commands.erase(commands.begin() + indexes.speed_index);
+					i -= 1;
+					reference_shift_indexes(indexes, indexes.speed_index);
+
+					view.speed = commands[i].note_type.speed;
+					view.volume = commands[i].note_type.volume;
+					view.fade = commands[i].note_type.fade;
+					indexes.speed_index = i;
+				}
+			}
+			else if (commands[i].type == Command_Type::DRUM_SPEED) {
+				if (indexes.speed_index == -1) {
+					// if the speed isn't changing, delete it
+					if (view.speed == commands[i].drum_speed.speed) {
+						deleted = true;
+						assert(commands[i].labels.size() == 0);
+						commands.erase(commands.begin() + i);
+						i -= 1;
+					}
+					// otherwise, track it
+					else {
+						view.speed = commands[i].drum_speed.speed;
+						indexes.speed_index = i;
+					}
+				}
+				else {
+					// speed changed twice in a row, so delete the old one
+					deleted = true;
+					commands[indexes.speed_index + 1].labels.insert(commands[indexes.speed_index + 1].labels.begin(), RANGE(commands[indexes.speed_index].labels));
+					commands.erase(commands.begin() + indexes.speed_index);
+					i -= 1;
+					reference_shift_indexes(indexes, indexes.speed_index);
+
+					view.speed = commands[i].drum_speed.speed;
+					indexes.speed_index = i;
+				}
+			}
+			else if (commands[i].type == Command_Type::SPEED) {
+				view.speed = commands[i].speed.speed;
+				indexes.speed_index = i;
+			}
+
+			else if (commands[i].type == Command_Type::TRANSPOSE) {
+				if (indexes.transpose_index == -1) {
+					// if the transpose isn't changing, delete it
+					if (
+						view.transpose_octaves == commands[i].transpose.num_octaves &&
+						view.transpose_pitches == commands[i].transpose.num_pitches
+					) {
+						deleted = true;
+						assert(commands[i].labels.size() == 0);
+						commands.erase(commands.begin() + i);
+						i -= 1;
+					}
+					// otherwise, track it
+					else {
+						view.transpose_octaves = commands[i].transpose.num_octaves;
+						view.transpose_pitches = commands[i].transpose.num_pitches;
+						indexes.transpose_index = i;
+					}
+				}
+				else {
+					// transpose changed twice in a row, so delete the old one
+					deleted = true;
+					commands[indexes.transpose_index + 1].labels.insert(commands[indexes.transpose_index + 1].labels.begin(), RANGE(commands[indexes.transpose_index].labels));
+					commands.erase(commands.begin() + indexes.transpose_index);
+					i -= 1;
+					reference_shift_indexes(indexes, indexes.transpose_index);
+
+					view.transpose_octaves = commands[i].transpose.num_octaves;
+					view.transpose_pitches = commands[i].transpose.num_pitches;
+					indexes.transpose_index = i;
+				}
+			}
+
+			else if (commands[i].type == Command_Type::TEMPO) {
+				if (indexes.tempo_index == -1) {
+					// if the tempo isn't changing, delete it
+					if (view.tempo == commands[i].tempo.tempo) {
+						deleted = true;
+						assert(commands[i].labels.size() == 0);
+						commands.erase(commands.begin() + i);
+						i -= 1;
+					}
+					// otherwise, track it
+					else {
+						view.tempo = commands[i].tempo.tempo;
+						indexes.tempo_index = i;
+					}
+				}
+				else {
+					// tempo changed twice in a row, so delete the old one
+					deleted = true;
+					commands[indexes.tempo_index + 1].labels.insert(commands[indexes.tempo_index + 1].labels.begin(), RANGE(commands[indexes.tempo_index].labels));
+					commands.erase(commands.begin() + indexes.tempo_index);
+					i -= 1;
+					reference_shift_indexes(indexes, indexes.tempo_index);
+
+					view.tempo = commands[i].tempo.tempo;
+					indexes.tempo_index = i;
+				}
+			}
+
+			else if (commands[i].type == Command_Type::DUTY_CYCLE) {
+				if (indexes.duty_index == -1) {
+					// if the duty isn't changing, delete it
+					if (view.duty == commands[i].duty_cycle.duty) {
+						deleted = true;
+						assert(commands[i].labels.size() == 0);
+						commands.erase(commands.begin() + i);
+						i -= 1;
+					}
+					// otherwise, track it
+					else {
+						view.duty = commands[i].duty_cycle.duty;
+						indexes.duty_index = i;
+					}
+				}
+				else {
+					// duty changed twice in a row, so delete the old one
+					deleted = true;
+					commands[indexes.duty_index + 1].labels.insert(commands[indexes.duty_index + 1].labels.begin(), RANGE(commands[indexes.duty_index].labels));
+					commands.erase(commands.begin() + indexes.duty_index);
+					i -= 1;
+					reference_shift_indexes(indexes, indexes.duty_index);
+
+					view.duty = commands[i].duty_cycle.duty;
+					indexes.duty_index = i;
+				}
+			}
+
+			else if (commands[i].type == Command_Type::VOLUME_ENVELOPE) {
+				if (indexes.vol_env_index == -1) {
+					// if the envelope isn't changing, delete it
+					if (
+						view.volume == commands[i].volume_envelope.volume &&
+						view.fade == commands[i].volume_envelope.fade
+					) {
+						deleted = true;
+						assert(commands[i].labels.size() == 0);
+						commands.erase(commands.begin() + i);
+						i -= 1;
+					}
+					// otherwise, track it
+					else {
+						view.volume = commands[i].volume_envelope.volume;
+						view.fade = commands[i].volume_envelope.fade;
+
+						if (indexes.speed_index != -1 && commands[indexes.speed_index].type == Command_Type::NOTE_TYPE) {
+							commands[indexes.speed_index].note_type.volume = view.volume;
+							commands[indexes.speed_index].note_type.fade = view.fade;
+
+							deleted = true;
+							assert(commands[i].labels.size() == 0);
+							commands.erase(commands.begin() + i);
+							i -= 1;
+						}
+						else {
+							indexes.vol_env_index = i;
+
+							// allow note type commands to delete this envelope too
+							indexes.speed_index = i;
+						}
+					}
+				}
+				else {
+					// envelope changed twice in a row, so delete the old one
+					deleted = true;
+					commands[indexes.vol_env_index + 1].labels.insert(commands[indexes.vol_env_index + 1].labels.begin(), RANGE(commands[indexes.vol_env_index].labels));
+					commands.erase(commands.begin() + indexes.vol_env_index);
+					i -= 1;
+					reference_shift_indexes(indexes, indexes.vol_env_index);
+
+					view.volume = commands[i].volume_envelope.volume;
+					view.fade = commands[i].volume_envelope.fade;
+					indexes.vol_env_index = i;
+
+					// allow note type commands to delete this envelope too
+					indexes.speed_index = i;
+				}
+			}
+			else if (commands[i].type == Command_Type::CHANNEL_VOLUME) {
+				view.volume = commands[i].channel_volume.volume;
+				indexes.vol_env_index = i;
+			}
+			else if (commands[i].type == Command_Type::FADE_WAVE) {
+				view.fade = commands[i].fade_wave.fade;
+				indexes.vol_env_index = i;
+			}
+
+			else if (commands[i].type == Command_Type::PITCH_SLIDE) {
+				if (indexes.slide_index == -1) {
+					view.slide_duration = commands[i].pitch_slide.duration;
+					view.slide_octave = commands[i].pitch_slide.octave;
+					view.slide_pitch = commands[i].pitch_slide.pitch;
+					indexes.slide_index = i;
+				}
+				else {
+					deleted = true;
+					commands[indexes.slide_index + 1].labels.insert(commands[indexes.slide_index + 1].labels.begin(), RANGE(commands[indexes.slide_index].labels));
+					commands.erase(commands.begin() + indexes.slide_index);
+					i -= 1;
+					reference_shift_indexes(indexes, indexes.slide_index);
+
+					view.slide_duration = commands[i].pitch_slide.duration;
+					view.slide_octave = commands[i].pitch_slide.octave;
+					view.slide_pitch = commands[i].pitch_slide.pitch;
+					indexes.slide_index = i;
+				}
+			}
+
+			else if (commands[i].type == Command_Type::VIBRATO) {
+				if (indexes.vibrato_index == -1) {
+					// if the vibrato isn't changing, delete it
+					if (
+						view.vibrato_delay == commands[i].vibrato.delay &&
+						view.vibrato_extent == commands[i].vibrato.extent &&
+						view.vibrato_rate == commands[i].vibrato.rate
+					) {
+						deleted = true;
+						assert(commands[i].labels.size() == 0);
+						commands.erase(commands.begin() + i);
+						i -= 1;
+					}
+					// otherwise, track it
+					else {
+						view.vibrato_delay = commands[i].vibrato.delay;
+						view.vibrato_extent = commands[i].vibrato.extent;
+						view.vibrato_rate = commands[i].vibrato.rate;
+						indexes.vibrato_index = i;
+					}
+				}
+				else {
+					// vibrato changed twice in a row, so delete the old one
+					deleted = true;
+					commands[indexes.vibrato_index + 1].labels.insert(commands[indexes.vibrato_index + 1].labels.begin(), RANGE(commands[indexes.vibrato_index].labels));
+					commands.erase(commands.begin() + indexes.vibrato_index);
+					i -= 1;
+					reference_shift_indexes(indexes, indexes.vibrato_index);
+
+					view.vibrato_delay = commands[i].vibrato.delay;
+					view.vibrato_extent = commands[i].vibrato.extent;
+					view.vibrato_rate = commands[i].vibrato.rate;
+					indexes.vibrato_index = i;
+				}
+			}
+
+			else if (commands[i].type == Command_Type::TOGGLE_NOISE) {
+				// off command
+				if (commands[i].toggle_noise.drumkit == -1) {
+					if (indexes.toggle_noise_off_index == -1) {
+						assert(indexes.toggle_noise_on_index == -1);
+						assert(indexes.toggle_noise_off_again_index == -1);
+						indexes.toggle_noise_off_index = i;
+					}
+					else {
+						assert(indexes.toggle_noise_on_index != -1);
+						assert(indexes.toggle_noise_off_again_index == -1);
+						indexes.toggle_noise_off_again_index = i;
+					}
+				}
+				// on command
+				else {
+					if (indexes.toggle_noise_on_index == -1) {
+						if (indexes.toggle_noise_off_index == -1) {
+							// probably the initial drumkit setting...
+							view.drumkit = commands[i].toggle_noise.drumkit;
+						}
+						else {
+							assert(indexes.toggle_noise_off_index != -1);
+							assert(indexes.toggle_noise_off_again_index == -1);
+							// if the drumkit isn't changing, delete it (off and on commands)
+							if (view.drumkit == commands[i].toggle_noise.drumkit) {
+								deleted = true;
+								assert(commands[i].labels.size() == 0);
+								commands.erase(commands.begin() + i);
+								i -= 1;
+
+								assert(commands[indexes.toggle_noise_off_index].labels.size() == 0);
+								commands.erase(commands.begin() + indexes.toggle_noise_off_index);
+								i -= 1;
+								reference_shift_indexes(indexes, indexes.toggle_noise_off_index);
+								indexes.toggle_noise_off_index = -1;
+							}
+							// otherwise, track it
+							else {
+								view.drumkit = commands[i].toggle_noise.drumkit;
+								indexes.toggle_noise_on_index = i;
+							}
+						}
+					}
+					else {
+						assert(indexes.toggle_noise_off_index != -1);
+						assert(indexes.toggle_noise_off_again_index != -1);
+						// drumkit changed twice in a row, so delete the old one (off and on commands)
+						deleted = true;
+						assert(commands[indexes.toggle_noise_on_index].labels.size() == 0);
+						commands.erase(commands.begin() + indexes.toggle_noise_on_index);
+						i -= 1;
+						reference_shift_indexes(indexes, indexes.toggle_noise_on_index);
+
+						commands[indexes.toggle_noise_off_index + 1].labels.insert(commands[indexes.toggle_noise_off_index + 1].labels.begin(), RANGE(commands[indexes.toggle_noise_off_index].labels));
+						commands.erase(commands.begin() + indexes.toggle_noise_off_index);
+						i -= 1;
+						reference_shift_indexes(indexes, indexes.toggle_noise_off_index);
+
+						view.drumkit = commands[i].toggle_noise.drumkit;
+						indexes.toggle_noise_off_index = indexes.toggle_noise_off_again_index;
+						indexes.toggle_noise_on_index = i;
+						indexes.toggle_noise_off_again_index = -1;
+					}
+				}
+			}
+
+			else if (commands[i].type == Command_Type::STEREO_PANNING) {
+				if (indexes.panning_index == -1) {
+					// if the panning isn't changing, delete it
+					if (
+						panning_left == commands[i].stereo_panning.left &&
+						panning_right == commands[i].stereo_panning.right
+					) {
+						deleted = true;
+						assert(commands[i].labels.size() == 0);
+						commands.erase(commands.begin() + i);
+						i -= 1;
+					}
+					// otherwise, track it
+					else {
+						panning_left = commands[i].stereo_panning.left;
+						panning_right = commands[i].stereo_panning.right;
+						indexes.panning_index = i;
+					}
+				}
+				else {
+					// panning changed twice in a row, so delete the old one
+					deleted = true;
+					commands[indexes.panning_index + 1].labels.insert(commands[indexes.panning_index + 1].labels.begin(), RANGE(commands[indexes.panning_index].labels));
+					commands.erase(commands.begin() + indexes.panning_index);
+					i -= 1;
+					reference_shift_indexes(indexes, indexes.panning_index);
+
+					panning_left = commands[i].stereo_panning.left;
+					panning_right = commands[i].stereo_panning.right;
+					indexes.panning_index = i;
+				}
+			}
+			else if (commands[i].type == Command_Type::FORCE_STEREO_PANNING) {
+				panning_left = -1;
+				panning_right = -1;
+				indexes.panning_index = -1;
+			}
+		}
+	} while (deleted);
+
+	for (uint32_t i = 0; i < commands.size(); ++i) {
+		if (commands[i].type == Command_Type::TEMPO && commands[i].tempo.tempo == 0) {
+			commands[i + 1].labels.insert(commands[i + 1].labels.begin(), RANGE(commands[i].labels));
+			commands.erase(commands.begin() + i);
+			i -= 1;
+		}
+		else if (
+			commands[i].type == Command_Type::PITCH_SLIDE &&
+			(commands[i].pitch_slide.duration == 0 ||
+			commands[i].pitch_slide.octave == 0 ||
+			commands[i].pitch_slide.pitch == Pitch::REST)
+		) {
+			commands[i + 1].labels.insert(commands[i + 1].labels.begin(), RANGE(commands[i].labels));
+			commands.erase(commands.begin() + i);
+			i -= 1;
+		}
+	}
+}
+// a random channel of the commands postprocess cares about, in runs
+// that leave plenty to merge and delete. toggle_noise comes in unlabeled
+// off/on pairs and tempo is never 0, as the editor writes them, since
+// the old loop asserts it never erases a label in place; and the channel
+// ends in sound_ret, since its final sweep reads the command after a
+// deleted one
+inline std::vector<Command> random_channel(std::mt19937 &rng, size_t n, bool noise) {
+	auto random = [&](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rng); };
+	std::vector<Command> commands;
+	bool noise_on = false;
+	int labels = 0;
+	while (commands.size() < n) {
+		Command command(Command_Type::REST);
+		switch (random(0, 19)) {
+		case 0: case 1: case 2:
+			command.rest.length = random(1, 16);
+			break;
+		case 3: case 4: case 5:
+			if (noise) {
+				command.type = Command_Type::DRUM_NOTE;
+				command.drum_note.length = random(1, 16);
+				command.drum_note.instrument = random(1, 12);
+			}
+			else {
+				command.type = Command_Type::NOTE;
+				command.note.length = random(1, 16);
+				command.note.pitch = (Pitch)random(1, 12);
+			}
+			break;
+		case 6:
+			command.type = Command_Type::OCTAVE;
+			command.octave.octave = random(1, 3);
+			break;
+		case 7:
+			if (noise) {
+				command.type = Command_Type::DRUM_SPEED;
+				command.drum_speed.speed = random(1, 3);
+			}
+			else {
+				command.type = Command_Type::NOTE_TYPE;
+				command.note_type.speed = random(1, 3);
+				command.note_type.volume = random(0, 2);
+				command.note_type.fade = random(0, 20);
+			}
+			break;
+		case 8:
+			command.type = Command_Type::VOLUME_ENVELOPE;
+			command.volume_envelope.volume = random(0, 2);
+			command.volume_envelope.fade = random(0, 20);
+			break;
+		case 9:
+			command.type = Command_Type::TRANSPOSE;
+			command.transpose.num_octaves = random(0, 1);
+			command.transpose.num_pitches = random(0, 1);
+			break;
+		case 10:
+			command.type = Command_Type::TEMPO;
+			command.tempo.tempo = random(1, 2) * 64;
+			break;
+		case 11:
+			command.type = Command_Type::DUTY_CYCLE;
+			command.duty_cycle.duty = random(0, 1);
+			break;
+		case 12:
+			command.type = Command_Type::PITCH_SLIDE;
+			command.pitch_slide.duration = random(0, 2);
+			command.pitch_slide.octave = random(0, 2);
+			command.pitch_slide.pitch = (Pitch)random(0, 12);
+			break;
+		case 13:
+			command.type = Command_Type::VIBRATO;
+			command.vibrato.delay = random(0, 1);
+			command.vibrato.extent = random(0, 1);
+			command.vibrato.rate = random(0, 1);
+			break;
+		case 14:
+			command.type = Command_Type::STEREO_PANNING;
+			command.stereo_panning.left = random(0, 1);
+			command.stereo_panning.right = random(0, 1);
+			break;
+		case 15:
+			command.type = Command_Type::TOGGLE_NOISE;
+			command.toggle_noise.drumkit = noise_on ? -1 : random(0, 2);
+			noise_on = !noise_on;
+			break;
+		case 16:
+			command.type = random(0, 1) ? Command_Type::CHANNEL_VOLUME : Command_Type::FADE_WAVE;
+			command.channel_volume.volume = random(0, 20);
+			break;
+		case 17:
+			command.type = random(0, 1) ? Command_Type::INC_OCTAVE : Command_Type::FORCE_STEREO_PANNING;
+			break;
+		case 18:
+			command.type = Command_Type::SPEED;
+			command.speed.speed = random(1, 3);
+			break;
+		default:
+			command.type = random(0, 1) ? Command_Type::SOUND_CALL : Command_Type::SOUND_LOOP;
+			command.target = "Ref.loop" + std::to_string(random(0, 9));
+			break;
+		}
+		if (command.type != Command_Type::TOGGLE_NOISE && random(0, 9) == 0) {
+			command.labels.push_back("Ref.label" + std::to_string(labels++));
+		}
+		commands.push_back(command);
+	}
+	commands.push_back(Command(Command_Type::SOUND_RET));
+	return commands;
+}
+
+#endif
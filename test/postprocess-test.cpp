@@ -0,0 +1,64 @@
+// checks postprocess against the old fixpoint loop it replaced, on random
+// channels and on every channel of any songs given
+//
+// usage: postprocess-test [file.asm...]
+
+#include <cstdio>
+#include <cstring>
+
+#include "song.h"
+
+#include "postprocess-reference.h"
+
+static bool same_commands(const Command_List &commands, const std::vector<Command> &expected) {
+	if (commands.size() != expected.size()) { return false; }
+	for (size_t i = 0; i < expected.size(); ++i) {
+		if (memcmp(&commands[i], &expected[i], sizeof(Command))) { return false; }
+	}
+	return true;
+}
+
+static bool check(const std::vector<Command> &channel, const char *what) {
+	std::vector<Command> expected = channel;
+	reference_postprocess(expected);
+	Command_List commands(RANGE(channel));
+	postprocess(commands);
+	if (!same_commands(commands, expected)) {
+		fprintf(stderr, "%s: %zu commands postprocess to %zu, expected %zu\n", what, channel.size(), commands.size(), expected.size());
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char **argv) {
+	int failures = 0;
+
+	std::mt19937 rng(1);
+	for (int seed = 0; seed < 2000; ++seed) {
+		size_t n = seed < 1000 ? seed % 50 : 500;
+		std::vector<Command> channel = random_channel(rng, n, seed % 4 == 3);
+		std::string what = "random channel " + std::to_string(seed);
+		failures += !check(channel, what.c_str());
+	}
+
+	for (int i = 1; i < argc; ++i) {
+		Song song;
+		if (song.read_song(argv[i]) != Parsed_Song::Result::SONG_OK) {
+			fprintf(stderr, "%s: cannot read\n", argv[i]);
+			++failures;
+			continue;
+		}
+		for (int c = 1; c <= 4; ++c) {
+			const Command_List &commands = song.channel_commands(c);
+			std::string what = std::string(argv[i]) + " channel " + std::to_string(c);
+			failures += !check(std::vector<Command>(RANGE(commands)), what.c_str());
+		}
+	}
+
+	if (failures) {
+		fprintf(stderr, "%d failed\n", failures);
+		return 1;
+	}
+	puts("postprocess matches the reference");
+	return 0;
+}
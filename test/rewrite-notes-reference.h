@@ -0,0 +1,300 @@
+#ifndef REWRITE_NOTES_REFERENCE_H
+#define REWRITE_NOTES_REFERENCE_H
+
+#include <cassert>
+#include <set>
+#include <vector>
+
+#include "command.h"
+
+// the bulk note setters as they were before they rewrote the selection in
+// one pass: each selected note's view is found by scanning the whole view,
+// and its commands are inserted in the middle of the channel, one note at
+// a time. kept verbatim, on a plain vector, for the benchmark to compare
+// against
+
+inline Note_View reference_find_note_view(const std::vector<Note_View> &view, int32_t index) {
+	for (const Note_View &note : view) {
+		if (note.index == index) {
+			return note;
+		}
+	}
+	assert(false);
+	return Note_View{};
+}
+
+inline void reference_set_volume(std::vector<Command> &commands, const std::set<int32_t> &selected_notes, const std::vector<Note_View> &view, int32_t volume) {
+	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+		Note_View note_view = reference_find_note_view(view, *note_itr);
+		Command command = Command(Command_Type::VOLUME_ENVELOPE);
+		command.volume_envelope.volume = volume;
+		command.volume_envelope.fade = note_view.fade;
+		command.labels = std::move(commands[*note_itr].labels);
+		commands[*note_itr].labels.clear();
+		commands.insert(commands.begin() + *note_itr, command);
+	}
+}
+
+inline void reference_set_fade(std::vector<Command> &commands, const std::set<int32_t> &selected_notes, const std::vector<Note_View> &view, int32_t fade) {
+	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+		Note_View note_view = reference_find_note_view(view, *note_itr);
+		Command command = Command(Command_Type::VOLUME_ENVELOPE);
+		command.volume_envelope.volume = note_view.volume;
+		command.volume_envelope.fade = fade;
+		command.labels = std::move(commands[*note_itr].labels);
+		commands[*note_itr].labels.clear();
+		commands.insert(commands.begin() + *note_itr, command);
+	}
+}
+
+inline void reference_set_vibrato_delay(std::vector<Command> &commands, const std::set<int32_t> &selected_notes, const std::vector<Note_View> &view, int32_t delay) {
+	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+		Note_View note_view = reference_find_note_view(view, *note_itr);
+		Command command = Command(Command_Type::VIBRATO);
+		command.vibrato.delay = delay;
+		command.vibrato.extent = note_view.vibrato_extent;
+		command.vibrato.rate = note_view.vibrato_rate;
+		command.labels = std::move(commands[*note_itr].labels);
+		commands[*note_itr].labels.clear();
+		commands.insert(commands.begin() + *note_itr, command);
+	}
+}
+
+inline void reference_set_vibrato_extent(std::vector<Command> &commands, const std::set<int32_t> &selected_notes, const std::vector<Note_View> &view, int32_t extent) {
+	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+		Note_View note_view = reference_find_note_view(view, *note_itr);
+		Command command = Command(Command_Type::VIBRATO);
+		command.vibrato.delay = note_view.vibrato_delay;
+		command.vibrato.extent = extent;
+		command.vibrato.rate = note_view.vibrato_rate;
+		command.labels = std::move(commands[*note_itr].labels);
+		commands[*note_itr].labels.clear();
+		commands.insert(commands.begin() + *note_itr, command);
+	}
+}
+
+inline void reference_set_vibrato_rate(std::vector<Command> &commands, const std::set<int32_t> &selected_notes, const std::vector<Note_View> &view, int32_t rate) {
+	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+		Note_View note_view = reference_find_note_view(view, *note_itr);
+		Command command = Command(Command_Type::VIBRATO);
+		command.vibrato.delay = note_view.vibrato_delay;
+		command.vibrato.extent = note_view.vibrato_extent;
+		command.vibrato.rate = rate;
+		command.labels = std::move(commands[*note_itr].labels);
+		commands[*note_itr].labels.clear();
+		commands.insert(commands.begin() + *note_itr, command);
+	}
+}
+
+inline void reference_set_wave(std::vector<Command> &commands, const std::set<int32_t> &selected_notes, const std::vector<Note_View> &view, int32_t wave) {
+	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+		Note_View note_view = reference_find_note_view(view, *note_itr);
+		Command command = Command(Command_Type::VOLUME_ENVELOPE);
+		command.volume_envelope.volume = note_view.volume;
+		command.volume_envelope.wave = wave;
+		command.labels = std::move(commands[*note_itr].labels);
+		commands[*note_itr].labels.clear();
+		commands.insert(commands.begin() + *note_itr, command);
+	}
+}
+
+inline void reference_set_drumkit(std::vector<Command> &commands, const std::set<int32_t> &selected_notes, int32_t drumkit) {
+	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+		Command command = Command(Command_Type::TOGGLE_NOISE);
+		command.toggle_noise.drumkit = -1;
+		command.labels = std::move(commands[*note_itr].labels);
+		commands[*note_itr].labels.clear();
+		commands.insert(commands.begin() + *note_itr, command);
+
+		command = Command(Command_Type::TOGGLE_NOISE);
+		command.toggle_noise.drumkit = drumkit;
+		commands.insert(commands.begin() + *note_itr + 1, command);
+	}
+}
+
+inline void reference_set_duty(std::vector<Command> &commands, const std::set<int32_t> &selected_notes, int32_t duty) {
+	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+		Command command = Command(Command_Type::DUTY_CYCLE);
+		command.duty_cycle.duty = duty;
+		command.labels = std::move(commands[*note_itr].labels);
+		commands[*note_itr].labels.clear();
+		commands.insert(commands.begin() + *note_itr, command);
+	}
+}
+
+inline void reference_set_tempo(std::vector<Command> &commands, const std::set<int32_t> &selected_notes, int32_t tempo) {
+	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+		Command command = Command(Command_Type::TEMPO);
+		command.tempo.tempo = tempo;
+		command.labels = std::move(commands[*note_itr].labels);
+		commands[*note_itr].labels.clear();
+		commands.insert(commands.begin() + *note_itr, command);
+	}
+}
+
+inline void reference_set_transpose_octaves(std::vector<Command> &commands, const std::set<int32_t> &selected_notes, const std::vector<Note_View> &view, int32_t octaves) {
+	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+		Note_View note_view = reference_find_note_view(view, *note_itr);
+		Command command = Command(Command_Type::TRANSPOSE);
+		command.transpose.num_octaves = octaves;
+		command.transpose.num_pitches = note_view.transpose_pitches;
+		command.labels = std::move(commands[*note_itr].labels);
+		commands[*note_itr].labels.clear();
+		commands.insert(commands.begin() + *note_itr, command);
+	}
+}
+
+inline void reference_set_transpose_pitches(std::vector<Command> &commands, const std::set<int32_t> &selected_notes, const std::vector<Note_View> &view, int32_t pitches) {
+	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+		Note_View note_view = reference_find_note_view(view, *note_itr);
+		Command command = Command(Command_Type::TRANSPOSE);
+		command.transpose.num_octaves = note_view.transpose_octaves;
+		command.transpose.num_pitches = pitches;
+		command.labels = std::move(commands[*note_itr].labels);
+		commands[*note_itr].labels.clear();
+		commands.insert(commands.begin() + *note_itr, command);
+	}
+}
+
+inline void reference_set_slide_duration(std::vector<Command> &commands, const std::set<int32_t> &selected_notes, const std::vector<Note_View> &view, int32_t duration) {
+	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+		Note_View note_view = reference_find_note_view(view, *note_itr);
+		Command command = Command(Command_Type::PITCH_SLIDE);
+		command.pitch_slide.duration = duration;
+		command.pitch_slide.octave = note_view.slide_octave;
+		command.pitch_slide.pitch = note_view.slide_pitch;
+		command.labels = std::move(commands[*note_itr].labels);
+		commands[*note_itr].labels.clear();
+		commands.insert(commands.begin() + *note_itr, command);
+	}
+}
+
+inline void reference_set_slide_octave(std::vector<Command> &commands, const std::set<int32_t> &selected_notes, const std::vector<Note_View> &view, int32_t octave) {
+	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+		Note_View note_view = reference_find_note_view(view, *note_itr);
+		Command command = Command(Command_Type::PITCH_SLIDE);
+		command.pitch_slide.duration = note_view.slide_duration;
+		command.pitch_slide.octave = octave;
+		command.pitch_slide.pitch = note_view.slide_pitch;
+		command.labels = std::move(commands[*note_itr].labels);
+		commands[*note_itr].labels.clear();
+		commands.insert(commands.begin() + *note_itr, command);
+	}
+}
+
+inline void reference_set_slide_pitch(std::vector<Command> &commands, const std::set<int32_t> &selected_notes, const std::vector<Note_View> &view, Pitch pitch) {
+	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+		Note_View note_view = reference_find_note_view(view, *note_itr);
+		Command command = Command(Command_Type::PITCH_SLIDE);
+		command.pitch_slide.duration = note_view.slide_duration;
+		command.pitch_slide.octave = note_view.slide_octave;
+		command.pitch_slide.pitch = pitch;
+		command.labels = std::move(commands[*note_itr].labels);
+		commands[*note_itr].labels.clear();
+		commands.insert(commands.begin() + *note_itr, command);
+	}
+}
+
+inline void reference_set_slide(std::vector<Command> &commands, const std::set<int32_t> &selected_notes, int32_t duration, int32_t octave, Pitch pitch) {
+	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+		Command command = Command(Command_Type::PITCH_SLIDE);
+		command.pitch_slide.duration = duration;
+		command.pitch_slide.octave = octave;
+		command.pitch_slide.pitch = pitch;
+		command.labels = std::move(commands[*note_itr].labels);
+		commands[*note_itr].labels.clear();
+		commands.insert(commands.begin() + *note_itr, command);
+	}
+}
+
+inline void reference_set_stereo_panning(std::vector<Command> &commands, const std::set<int32_t> &selected_notes, bool left, bool right) {
+	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+		Command command = Command(Command_Type::STEREO_PANNING);
+		command.stereo_panning.left = left;
+		command.stereo_panning.right = right;
+		command.labels = std::move(commands[*note_itr].labels);
+		commands[*note_itr].labels.clear();
+		commands.insert(commands.begin() + *note_itr, command);
+	}
+}
+
+inline void reference_pitch_up(std::vector<Command> &commands, const std::set<int32_t> &selected_notes, const std::vector<Note_View> &view) {
+	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+		if (commands[*note_itr].note.pitch == Pitch::B_NAT) {
+			commands[*note_itr].note.pitch = Pitch::C_NAT;
+
+			Note_View note_view = reference_find_note_view(view, *note_itr);
+			Command command = Command(Command_Type::OCTAVE);
+			command.octave.octave = note_view.octave;
+			commands.insert(commands.begin() + *note_itr + 1, command);
+
+			command.octave.octave = note_view.octave + 1;
+			command.labels = std::move(commands[*note_itr].labels);
+			commands[*note_itr].labels.clear();
+			commands.insert(commands.begin() + *note_itr, command);
+		}
+		else {
+			commands[*note_itr].note.pitch = (Pitch)((int)commands[*note_itr].note.pitch + 1);
+		}
+	}
+}
+
+inline void reference_pitch_down(std::vector<Command> &commands, const std::set<int32_t> &selected_notes, const std::vector<Note_View> &view) {
+	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+		if (commands[*note_itr].note.pitch == Pitch::C_NAT) {
+			commands[*note_itr].note.pitch = Pitch::B_NAT;
+
+			Note_View note_view = reference_find_note_view(view, *note_itr);
+			Command command = Command(Command_Type::OCTAVE);
+			command.octave.octave = note_view.octave;
+			commands.insert(commands.begin() + *note_itr + 1, command);
+
+			command.octave.octave = note_view.octave - 1;
+			command.labels = std::move(commands[*note_itr].labels);
+			commands[*note_itr].labels.clear();
+			commands.insert(commands.begin() + *note_itr, command);
+		}
+		else {
+			commands[*note_itr].note.pitch = (Pitch)((int)commands[*note_itr].note.pitch - 1);
+		}
+	}
+}
+
+inline void reference_octave_up(std::vector<Command> &commands, const std::set<int32_t> &selected_notes, const std::vector<Note_View> &view) {
+	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+		Note_View note_view = reference_find_note_view(view, *note_itr);
+		Command command = Command(Command_Type::OCTAVE);
+		command.octave.octave = note_view.octave;
+		commands.insert(commands.begin() + *note_itr + 1, command);
+
+		command.octave.octave = note_view.octave + 1;
+		command.labels = std::move(commands[*note_itr].labels);
+		commands[*note_itr].labels.clear();
+		commands.insert(commands.begin() + *note_itr, command);
+	}
+}
+
+inline void reference_octave_down(std::vector<Command> &commands, const std::set<int32_t> &selected_notes, const std::vector<Note_View> &view) {
+	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+		Note_View note_view = reference_find_note_view(view, *note_itr);
+		Command command = Command(Command_Type::OCTAVE);
+		command.octave.octave = note_view.octave;
+		commands.insert(commands.begin() + *note_itr + 1, command);
+
+		command.octave.octave = note_view.octave - 1;
+		command.labels = std::move(commands[*note_itr].labels);
+		commands[*note_itr].labels.clear();
+		commands.insert(commands.begin() + *note_itr, command);
+	}
+}
+
+inline void reference_shorten(std::vector<Command> &commands, const std::set<int32_t> &selected_notes) {
+	for (auto note_itr = selected_notes.rbegin(); note_itr != selected_notes.rend(); ++note_itr) {
+		Command command = Command(Command_Type::REST);
+		command.rest.length = 1;
+		commands.insert(commands.begin() + *note_itr + 1, command);
+		commands[*note_itr].note.length -= 1;
+	}
+}
+
+#endif
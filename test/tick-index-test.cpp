@@ -0,0 +1,106 @@
+// checks that a channel's tick index, queried far past the song's end and
+// then edited, answers the same as one built fresh from the edited commands
+//
+// usage: tick-index-test [file.asm...]
+
+#include <cstdio>
+#include <random>
+
+#include "song.h"
+
+static bool same_view(const Note_View &a, const Note_View &b) {
+	return a.index == b.index && a.length == b.length && a.pitch == b.pitch && a.octave == b.octave && a.speed == b.speed;
+}
+
+static bool check_ticks(const Command_List &commands, std::mt19937 &rng, int32_t max_tick, const char *what) {
+	std::vector<Command> flat(RANGE(commands));
+	Command_List fresh(RANGE(flat));
+	for (int i = 0; i < 200; ++i) {
+		int32_t tick = (int32_t)(rng() % (uint32_t)(max_tick + 1));
+		int32_t offset = -1, fresh_offset = -1;
+		const Note_View *note = commands.find_note_at_tick(tick, &offset);
+		const Note_View *fresh_note = fresh.find_note_at_tick(tick, &fresh_offset);
+		if (!note != !fresh_note || (note && (!same_view(*note, *fresh_note) || offset != fresh_offset))) {
+			fprintf(stderr, "%s: different note at tick %d\n", what, tick);
+			return false;
+		}
+	}
+	return true;
+}
+
+// edits note and rest lengths, each one after a query far past the end
+static bool check_edits(Command_List &commands, std::mt19937 &rng, const char *what) {
+	std::vector<size_t> lengths;
+	for (size_t i = 0; i < commands.size(); ++i) {
+		if (commands[i].type == Command_Type::NOTE || commands[i].type == Command_Type::REST) {
+			lengths.push_back(i);
+		}
+	}
+	if (lengths.empty()) { return true; }
+	for (int edit = 0; edit < 10; ++edit) {
+		int32_t far_tick = 100000 + (int32_t)(rng() % 100000);
+		commands.find_note_at_tick(far_tick);
+		Command &command = commands.modify(lengths[rng() % lengths.size()]);
+		int32_t length = 1 + (int32_t)(rng() % 16);
+		(command.type == Command_Type::NOTE ? command.note.length : command.rest.length) = length;
+		if (!check_ticks(commands, rng, far_tick * 2, what)) { return false; }
+	}
+	return true;
+}
+
+static Command rest(int32_t length) {
+	Command command(Command_Type::REST);
+	command.rest.length = length;
+	return command;
+}
+
+int main(int argc, char **argv) {
+	int failures = 0;
+	std::mt19937 rng(1);
+
+	// loops forever, and never reaches its second rest
+	std::vector<Command> channel;
+	channel.push_back(rest(4));
+	channel.back().labels.push_back("Test.main");
+	channel.push_back(rest(2));
+	channel.push_back(Command(Command_Type::NOTE));
+	channel.back().note.pitch = Pitch::C_NAT;
+	channel.back().note.length = 3;
+	channel.push_back(Command(Command_Type::SOUND_JUMP));
+	channel.back().target = "Test.main";
+	channel.push_back(rest(1));
+	channel.push_back(Command(Command_Type::SOUND_RET));
+	Command_List commands(RANGE(channel));
+
+	Note_View view;
+	view.length = -1;
+	if (commands.find_note_view(4, 1000, view) || view.length != -1) {
+		fprintf(stderr, "unplayed rest: found a view\n");
+		++failures;
+	}
+	if (!commands.find_note_view(1, 1000, view) || view.index != 1 || view.length != 2) {
+		fprintf(stderr, "looped rest: wrong view\n");
+		++failures;
+	}
+	failures += !check_edits(commands, rng, "looping channel");
+
+	for (int i = 1; i < argc; ++i) {
+		Song song;
+		if (song.read_song(argv[i]) != Parsed_Song::Result::SONG_OK) {
+			fprintf(stderr, "%s: cannot read\n", argv[i]);
+			++failures;
+			continue;
+		}
+		for (int c = 1; c <= 4; ++c) {
+			std::string what = std::string(argv[i]) + " channel " + std::to_string(c);
+			failures += !check_edits(song.channel_commands(c), rng, what.c_str());
+		}
+	}
+
+	if (failures) {
+		fprintf(stderr, "%d failed\n", failures);
+		return 1;
+	}
+	puts("tick index matches a fresh one after edits");
+	return 0;
+}